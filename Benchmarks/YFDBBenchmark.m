@@ -0,0 +1,878 @@
+//
+//  YFDBBenchmark.m
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import <Foundation/Foundation.h>
+#import <sqlite3.h>
+#import <time.h>
+#import <stdlib.h>
+
+#import "YFDB.h"
+
+// MARK: - Options
+
+typedef struct {
+    NSUInteger rowCount;        // rows per insert run and rows in the lookup table
+    NSUInteger autocommitRows;  // autocommit inserts pay a commit each, so fewer of them
+    NSUInteger lookupCount;     // timed point selects / binds per run
+    NSUInteger runs;            // timed runs per benchmark, after one warm up run
+    unsigned int seed;
+    __unsafe_unretained NSString *filter;
+} YFBenchmarkOptions;
+
+static void YFBenchmarkUsage(void) {
+    fprintf(stderr,
+            "usage: YFDBBenchmark [--rows N] [--autocommit-rows N] [--lookups N] [--runs N]\n"
+            "                     [--seed N] [--filter SUBSTRING] [--output PATH]\n");
+}
+
+// MARK: - Timing
+
+static uint64_t YFBenchmarkNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int YFBenchmarkCompareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/** Nearest rank percentile of a sorted array. */
+
+static double YFBenchmarkPercentile(const double *sorted, NSUInteger count, double percentile) {
+    if (!count) {
+        return 0;
+    }
+    NSUInteger rank = (NSUInteger)ceil(percentile / 100.0 * count);
+    return sorted[rank ? rank - 1 : 0];
+}
+
+/** Collects per operation samples (nanoseconds) and per run totals for one benchmark. */
+
+@interface YFBenchmarkRecorder : NSObject
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic, copy) NSString *storage;
+@property (nonatomic) NSUInteger operationsPerRun;
+- (void)addSample:(uint64_t)nanoseconds;
+- (void)addRun:(uint64_t)nanoseconds;
+- (NSDictionary *)dictionaryRepresentation;
+@end
+
+@implementation YFBenchmarkRecorder {
+    double      *_samples;
+    NSUInteger  _sampleCount;
+    NSUInteger  _sampleCapacity;
+    NSMutableArray<NSNumber *> *_runs;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _runs = [NSMutableArray array];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    free(_samples);
+}
+
+- (void)addSample:(uint64_t)nanoseconds {
+    if (_sampleCount == _sampleCapacity) {
+        _sampleCapacity = _sampleCapacity ? _sampleCapacity * 2 : 1024;
+        _samples = realloc(_samples, _sampleCapacity * sizeof(double));
+    }
+    _samples[_sampleCount++] = (double)nanoseconds / 1000.0;
+}
+
+- (void)addRun:(uint64_t)nanoseconds {
+    [_runs addObject:@((double)nanoseconds / 1e9)];
+}
+
+- (NSDictionary *)dictionaryRepresentation {
+
+    NSArray<NSNumber *> *runs = [_runs sortedArrayUsingSelector:@selector(compare:)];
+    double medianRun = [runs count] ? [runs[[runs count] / 2] doubleValue] : 0;
+    double bestRun = [runs count] ? [[runs firstObject] doubleValue] : 0;
+
+    NSMutableDictionary *result = [NSMutableDictionary dictionary];
+    result[@"name"] = _name;
+    result[@"storage"] = _storage;
+    result[@"operationsPerRun"] = @(_operationsPerRun);
+    result[@"runs"] = @([runs count]);
+    result[@"runSeconds"] = runs;
+    result[@"medianRunSeconds"] = @(medianRun);
+    result[@"operationsPerSecond"] = @(medianRun > 0 ? _operationsPerRun / medianRun : 0);
+    result[@"bestOperationsPerSecond"] = @(bestRun > 0 ? _operationsPerRun / bestRun : 0);
+
+    if (_sampleCount) {
+        qsort(_samples, _sampleCount, sizeof(double), YFBenchmarkCompareDoubles);
+        double total = 0;
+        for (NSUInteger i = 0; i < _sampleCount; i++) {
+            total += _samples[i];
+        }
+        result[@"latencyMicroseconds"] = @{@"samples": @(_sampleCount),
+                                           @"mean": @(total / _sampleCount),
+                                           @"min": @(_samples[0]),
+                                           @"p50": @(YFBenchmarkPercentile(_samples, _sampleCount, 50)),
+                                           @"p90": @(YFBenchmarkPercentile(_samples, _sampleCount, 90)),
+                                           @"p99": @(YFBenchmarkPercentile(_samples, _sampleCount, 99)),
+                                           @"max": @(_samples[_sampleCount - 1])};
+    }
+
+    return result;
+}
+
+@end
+
+// MARK: - Fixtures
+
+/** Same shape as the example app's person model. */
+
+@interface YFBenchmarkPerson : NSObject
+@property (nonatomic) int ID;
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic, copy) NSString *phone;
+@property (nonatomic, copy) NSString *address;
+@property (nonatomic) int score;
+@end
+
+@implementation YFBenchmarkPerson
+@end
+
+static NSString *YFBenchmarkTemporaryPath(void) {
+    NSString *name = [NSString stringWithFormat:@"yfdb-benchmark-%d-%@.sqlite", [[NSProcessInfo processInfo] processIdentifier], [[NSUUID UUID] UUIDString]];
+    return [NSTemporaryDirectory() stringByAppendingPathComponent:name];
+}
+
+static void YFBenchmarkRemoveDatabase(NSString *path) {
+    if (!path) {
+        return;
+    }
+    NSFileManager *fm = [NSFileManager defaultManager];
+    for (NSString *suffix in @[@"", @"-wal", @"-shm", @"-journal"]) {
+        [fm removeItemAtPath:[path stringByAppendingString:suffix] error:nil];
+    }
+}
+
+/** Opens a fresh database with the person table; @c path is @c nil  for in-memory. */
+
+static YFDatabase *YFBenchmarkOpenDatabase(NSString *path, BOOL cacheStatements) {
+    YFBenchmarkRemoveDatabase(path);
+
+    YFDatabase *db = [YFDatabase databaseWithPath:path ? path : @":memory:"];
+    if (![db open]) {
+        fprintf(stderr, "could not open %s\n", [[db lastErrorMessage] UTF8String]);
+        exit(1);
+    }
+
+    [db setShouldCacheStatements:cacheStatements];
+    [db executeStatements:@"PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;"];
+    [db executeUpdate:@"CREATE TABLE person (ID INTEGER PRIMARY KEY, name TEXT, phone TEXT, address TEXT, score INTEGER)"];
+
+    return db;
+}
+
+/** Deterministic row contents, so every run and every machine inserts the same bytes. */
+
+static NSArray<NSArray *> *YFBenchmarkMakeRows(NSUInteger count, unsigned int seed) {
+    srandom(seed);
+    NSMutableArray *rows = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        long r = random();
+        [rows addObject:@[@(i + 1),
+                          [NSString stringWithFormat:@"person-%lu", (unsigned long)i],
+                          [NSString stringWithFormat:@"+86 1%010ld", r % 10000000000L],
+                          [NSString stringWithFormat:@"%ld Benchmark Road, Suite %lu", r % 9973, (unsigned long)(i % 97)],
+                          @((int)(r % 100))]];
+    }
+    return rows;
+}
+
+static void YFBenchmarkFill(YFDatabase *db, NSArray<NSArray *> *rows) {
+    [db beginTransaction];
+    for (NSArray *row in rows) {
+        [db executeUpdate:@"INSERT INTO person (ID, name, phone, address, score) VALUES (?, ?, ?, ?, ?)" withArgumentsInArray:row];
+    }
+    [db commit];
+}
+
+// MARK: - Runner
+
+@interface YFBenchmarkRunner : NSObject
+@property (nonatomic) YFBenchmarkOptions options;
+@property (nonatomic, strong) NSArray<NSArray *> *rows;
+@property (nonatomic, strong) NSMutableArray<NSDictionary *> *results;
+@end
+
+@implementation YFBenchmarkRunner
+
+- (BOOL)shouldRun:(NSString *)name {
+    NSString *filter = _options.filter;
+    return ![filter length] || [name rangeOfString:filter].location != NSNotFound;
+}
+
+/** Runs @c body  once to warm up, then @c runs  times while timing each run.
+
+ @c body  receives the recorder (for per operation samples; @c nil  during warm up) and returns after @c operations  operations.
+ */
+
+- (void)measure:(NSString *)name storage:(NSString *)storage operations:(NSUInteger)operations body:(void (^)(YFBenchmarkRecorder *recorder))body {
+
+    NSString *fullName = [NSString stringWithFormat:@"%@/%@", name, storage];
+    if (![self shouldRun:fullName]) {
+        return;
+    }
+
+    YFBenchmarkRecorder *recorder = [[YFBenchmarkRecorder alloc] init];
+    recorder.name = name;
+    recorder.storage = storage;
+    recorder.operationsPerRun = operations;
+
+    @autoreleasepool {
+        body(nil);
+    }
+
+    for (NSUInteger run = 0; run < _options.runs; run++) {
+        @autoreleasepool {
+            uint64_t start = YFBenchmarkNow();
+            body(recorder);
+            [recorder addRun:YFBenchmarkNow() - start];
+        }
+    }
+
+    NSDictionary *result = [recorder dictionaryRepresentation];
+    [_results addObject:result];
+
+    fprintf(stderr, "%-40s %12.0f ops/s  p50 %8.2f us  p99 %8.2f us\n", [fullName UTF8String],
+            [result[@"operationsPerSecond"] doubleValue],
+            [result[@"latencyMicroseconds"][@"p50"] doubleValue],
+            [result[@"latencyMicroseconds"][@"p99"] doubleValue]);
+}
+
+// MARK: Inserts
+
+- (void)runInsertBenchmarksWithStorage:(NSString *)storage {
+
+    static NSString * const insertSQL = @"INSERT INTO person (ID, name, phone, address, score) VALUES (?, ?, ?, ?, ?)";
+    BOOL onDisk = [storage isEqualToString:@"file"];
+    NSArray<NSArray *> *allRows = _rows;
+
+    for (NSNumber *cached in @[@NO, @YES]) {
+
+        BOOL cache = [cached boolValue];
+        NSString *suffix = cache ? @"cached" : @"uncached";
+
+        NSUInteger autocommitCount = MIN(_options.autocommitRows, [allRows count]);
+        NSArray<NSArray *> *autocommitRows = [allRows subarrayWithRange:NSMakeRange(0, autocommitCount)];
+
+        [self measure:[@"insert.autocommit." stringByAppendingString:suffix] storage:storage operations:autocommitCount body:^(YFBenchmarkRecorder *recorder) {
+            NSString *path = onDisk ? YFBenchmarkTemporaryPath() : nil;
+            YFDatabase *db = YFBenchmarkOpenDatabase(path, cache);
+            for (NSArray *row in autocommitRows) {
+                uint64_t start = YFBenchmarkNow();
+                [db executeUpdate:insertSQL withArgumentsInArray:row];
+                [recorder addSample:YFBenchmarkNow() - start];
+            }
+            [db close];
+            YFBenchmarkRemoveDatabase(path);
+        }];
+
+        [self measure:[@"insert.transaction." stringByAppendingString:suffix] storage:storage operations:[allRows count] body:^(YFBenchmarkRecorder *recorder) {
+            NSString *path = onDisk ? YFBenchmarkTemporaryPath() : nil;
+            YFDatabase *db = YFBenchmarkOpenDatabase(path, cache);
+            [db beginTransaction];
+            for (NSArray *row in allRows) {
+                uint64_t start = YFBenchmarkNow();
+                [db executeUpdate:insertSQL withArgumentsInArray:row];
+                [recorder addSample:YFBenchmarkNow() - start];
+            }
+            [db commit];
+            [db close];
+            YFBenchmarkRemoveDatabase(path);
+        }];
+    }
+
+    [self measure:@"insert.batch" storage:storage operations:[allRows count] body:^(YFBenchmarkRecorder *recorder) {
+        NSString *path = onDisk ? YFBenchmarkTemporaryPath() : nil;
+        YFDatabase *db = YFBenchmarkOpenDatabase(path, YES);
+        NSError *error = nil;
+        YFBatchResult *result = [db executeBatch:insertSQL rows:allRows error:&error];
+        if (![result succeeded]) {
+            fprintf(stderr, "batch insert failed: %s\n", [[error localizedDescription] UTF8String]);
+            exit(1);
+        }
+        [db close];
+        YFBenchmarkRemoveDatabase(path);
+    }];
+
+    [self measure:@"insert.prepared" storage:storage operations:[allRows count] body:^(YFBenchmarkRecorder *recorder) {
+        NSString *path = onDisk ? YFBenchmarkTemporaryPath() : nil;
+        YFDatabase *db = YFBenchmarkOpenDatabase(path, YES);
+        NSError *error = nil;
+        YFPreparedStatement *statement = [db prepareStatement:insertSQL error:&error];
+        if (!statement) {
+            fprintf(stderr, "could not prepare %s: %s\n", [insertSQL UTF8String], [[error localizedDescription] UTF8String]);
+            exit(1);
+        }
+        [db beginTransaction];
+        for (NSArray *row in allRows) {
+            uint64_t start = YFBenchmarkNow();
+            [statement bindInt:[row[0] intValue] atIndex:1];
+            [statement bindTextNoCopy:row[1] atIndex:2];
+            [statement bindTextNoCopy:row[2] atIndex:3];
+            [statement bindTextNoCopy:row[3] atIndex:4];
+            [statement bindInt:[row[4] intValue] atIndex:5];
+            if (![statement stepWithError:&error]) {
+                fprintf(stderr, "prepared insert failed: %s\n", [[error localizedDescription] UTF8String]);
+                exit(1);
+            }
+            [statement reset];
+            [recorder addSample:YFBenchmarkNow() - start];
+        }
+        [db commit];
+        [statement close];
+        [db close];
+        YFBenchmarkRemoveDatabase(path);
+    }];
+}
+
+// MARK: Selects and materialization
+
+- (void)runSelectBenchmarksWithStorage:(NSString *)storage {
+
+    NSString *path = [storage isEqualToString:@"file"] ? YFBenchmarkTemporaryPath() : nil;
+    YFDatabase *db = YFBenchmarkOpenDatabase(path, YES);
+    YFBenchmarkFill(db, _rows);
+
+    NSUInteger rowCount = [_rows count];
+    NSUInteger lookups = _options.lookupCount;
+
+    // the same pseudo random key sequence for every run
+    int *keys = malloc(lookups * sizeof(int));
+    srandom(_options.seed);
+    for (NSUInteger i = 0; i < lookups; i++) {
+        keys[i] = (int)(random() % rowCount) + 1;
+    }
+
+    [self measure:@"select.point.intForColumn" storage:storage operations:lookups body:^(YFBenchmarkRecorder *recorder) {
+        for (NSUInteger i = 0; i < lookups; i++) {
+            uint64_t start = YFBenchmarkNow();
+            YFResultSet *rs = [db executeQuery:@"SELECT score FROM person WHERE ID = ?", @(keys[i])];
+            if ([rs next]) {
+                (void)[rs intForColumnIndex:0];
+            }
+            [rs close];
+            [recorder addSample:YFBenchmarkNow() - start];
+        }
+    }];
+
+    [self measure:@"select.point.resultDictionary" storage:storage operations:lookups body:^(YFBenchmarkRecorder *recorder) {
+        for (NSUInteger i = 0; i < lookups; i++) {
+            uint64_t start = YFBenchmarkNow();
+            YFResultSet *rs = [db executeQuery:@"SELECT * FROM person WHERE ID = ?", @(keys[i])];
+            if ([rs next]) {
+                (void)[rs resultDictionary];
+            }
+            [rs close];
+            [recorder addSample:YFBenchmarkNow() - start];
+        }
+    }];
+
+    [self measure:@"select.point.prepared" storage:storage operations:lookups body:^(YFBenchmarkRecorder *recorder) {
+        YFPreparedStatement *statement = [db prepareStatement:@"SELECT score FROM person WHERE ID = ?" error:nil];
+        for (NSUInteger i = 0; i < lookups; i++) {
+            uint64_t start = YFBenchmarkNow();
+            [statement bindInt:keys[i] atIndex:1];
+            if ([statement next]) {
+                (void)[statement intForColumnIndex:0];
+            }
+            [statement reset];
+            [recorder addSample:YFBenchmarkNow() - start];
+        }
+        [statement close];
+    }];
+
+    // whole table scans: samples are per row
+
+    [self measure:@"materialize.resultDictionary" storage:storage operations:rowCount body:^(YFBenchmarkRecorder *recorder) {
+        YFResultSet *rs = [db executeQuery:@"SELECT * FROM person"];
+        uint64_t start = YFBenchmarkNow();
+        while ([rs next]) {
+            (void)[rs resultDictionary];
+            uint64_t now = YFBenchmarkNow();
+            [recorder addSample:now - start];
+            start = now;
+        }
+        [rs close];
+    }];
+
+    [self measure:@"materialize.resultDictionaryView" storage:storage operations:rowCount body:^(YFBenchmarkRecorder *recorder) {
+        YFResultSet *rs = [db executeQuery:@"SELECT * FROM person"];
+        NSDictionary *view = [rs resultDictionaryView];
+        uint64_t start = YFBenchmarkNow();
+        while ([rs next]) {
+            (void)view[@"name"];
+            (void)view[@"score"];
+            uint64_t now = YFBenchmarkNow();
+            [recorder addSample:now - start];
+            start = now;
+        }
+        [rs close];
+    }];
+
+    [self measure:@"materialize.kvcMagic" storage:storage operations:rowCount body:^(YFBenchmarkRecorder *recorder) {
+        YFResultSet *rs = [db executeQuery:@"SELECT * FROM person"];
+        uint64_t start = YFBenchmarkNow();
+        while ([rs next]) {
+            YFBenchmarkPerson *person = [[YFBenchmarkPerson alloc] init];
+            [rs kvcMagic:person];
+            uint64_t now = YFBenchmarkNow();
+            [recorder addSample:now - start];
+            start = now;
+        }
+        [rs close];
+    }];
+
+    [self measure:@"materialize.objectsOfClass" storage:storage operations:rowCount body:^(YFBenchmarkRecorder *recorder) {
+        YFResultSet *rs = [db executeQuery:@"SELECT * FROM person"];
+        (void)[rs objectsOfClass:[YFBenchmarkPerson class]];
+    }];
+
+    free(keys);
+    [db close];
+    YFBenchmarkRemoveDatabase(path);
+}
+
+// MARK: Binding
+
+- (void)runBindBenchmarks {
+
+    // bind and reset only, never stepped, so only argument conversion and sqlite3_bind_* are timed
+    YFDatabase *db = YFBenchmarkOpenDatabase(nil, YES);
+    [db executeUpdate:@"CREATE TABLE bind_target (value)"];
+
+    NSUInteger count = _options.lookupCount;
+    NSData *blob = [[NSMutableData dataWithLength:256] copy];
+    NSDictionary<NSString *, id> *values = @{@"int": @42,
+                                             @"int64": @(INT64_MAX - 7),
+                                             @"double": @3.14159,
+                                             @"bool": @YES,
+                                             @"text.short": @"hello",
+                                             @"text.long": [@"" stringByPaddingToLength:1024 withString:@"yfdb " startingAtIndex:0],
+                                             @"blob": blob,
+                                             @"date": [NSDate dateWithTimeIntervalSince1970:1700000000],
+                                             @"null": [NSNull null]};
+
+    for (NSString *type in [[values allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+        id value = values[type];
+
+        [self measure:[@"bind.bindObject." stringByAppendingString:type] storage:@"memory" operations:count body:^(YFBenchmarkRecorder *recorder) {
+            YFPreparedStatement *statement = [db prepareStatement:@"INSERT INTO bind_target (value) VALUES (?)" error:nil];
+            for (NSUInteger i = 0; i < count; i++) {
+                uint64_t start = YFBenchmarkNow();
+                [statement bindObject:value atIndex:1];
+                [statement clearBindings];
+                [recorder addSample:YFBenchmarkNow() - start];
+            }
+            [statement close];
+        }];
+
+        [self measure:[@"bind.executeUpdate." stringByAppendingString:type] storage:@"memory" operations:count body:^(YFBenchmarkRecorder *recorder) {
+            [db beginTransaction];
+            for (NSUInteger i = 0; i < count; i++) {
+                uint64_t start = YFBenchmarkNow();
+                [db executeUpdate:@"INSERT INTO bind_target (value) VALUES (?)", value];
+                [recorder addSample:YFBenchmarkNow() - start];
+            }
+            [db rollback];
+        }];
+    }
+
+    // the same insert through a format template and through ? placeholders
+    [db executeUpdate:@"CREATE TABLE format_target (id INTEGER, name TEXT, score REAL)"];
+
+    [self measure:@"format.executeUpdateWithFormat" storage:@"memory" operations:count body:^(YFBenchmarkRecorder *recorder) {
+        [db beginTransaction];
+        for (NSUInteger i = 0; i < count; i++) {
+            uint64_t start = YFBenchmarkNow();
+            [db executeUpdateWithFormat:@"INSERT INTO format_target (id, name, score) VALUES (%lu, %@, %f)", (unsigned long)i, @"hello", 3.5];
+            [recorder addSample:YFBenchmarkNow() - start];
+        }
+        [db rollback];
+    }];
+
+    [self measure:@"format.executeUpdate" storage:@"memory" operations:count body:^(YFBenchmarkRecorder *recorder) {
+        [db beginTransaction];
+        for (NSUInteger i = 0; i < count; i++) {
+            uint64_t start = YFBenchmarkNow();
+            [db executeUpdate:@"INSERT INTO format_target (id, name, score) VALUES (?, ?, ?)", @(i), @"hello", @3.5];
+            [recorder addSample:YFBenchmarkNow() - start];
+        }
+        [db rollback];
+    }];
+
+    [db close];
+}
+
+// MARK: Scripts
+
+- (void)runScriptBenchmarks {
+
+    // a maintenance style script, run again and again: sqlite3_exec against the prepare_v2 walk with its split cache
+    YFDatabase *db = YFBenchmarkOpenDatabase(nil, YES);
+    [db executeUpdate:@"CREATE TABLE sync_state (key TEXT PRIMARY KEY, value)"];
+    [db executeUpdate:@"CREATE TABLE sync_log (at INTEGER, message TEXT)"];
+
+    NSMutableString *script = [NSMutableString string];
+    for (NSUInteger i = 0; i < 24; i++) {
+        [script appendFormat:@"INSERT OR REPLACE INTO sync_state (key, value) VALUES ('key%lu', %lu);\n", (unsigned long)i, (unsigned long)i];
+    }
+    [script appendString:@"DELETE FROM sync_log WHERE at < 0;\nSELECT count(*) FROM sync_state;\n"];
+
+    NSUInteger count = MAX(_options.lookupCount / 100, (NSUInteger)1);
+
+    [self measure:@"script.executeStatements" storage:@"memory" operations:count body:^(YFBenchmarkRecorder *recorder) {
+        for (NSUInteger i = 0; i < count; i++) {
+            uint64_t start = YFBenchmarkNow();
+            [db executeStatements:script];
+            [recorder addSample:YFBenchmarkNow() - start];
+        }
+    }];
+
+    [self measure:@"script.executeScript" storage:@"memory" operations:count body:^(YFBenchmarkRecorder *recorder) {
+        for (NSUInteger i = 0; i < count; i++) {
+            uint64_t start = YFBenchmarkNow();
+            [db executeScript:script error:nil];
+            [recorder addSample:YFBenchmarkNow() - start];
+        }
+    }];
+
+    [db close];
+}
+
+// MARK: Dates
+
+- (void)runDateBenchmarks {
+
+    NSUInteger count = _options.lookupCount;
+    NSDictionary<NSString *, NSNumber *> *storages = @{@"timestamp": @(YFDateStorageTimestamp),
+                                                       @"formatter": @(YFDateStorageFormatter),
+                                                       @"iso8601": @(YFDateStorageISO8601),
+                                                       @"epochMilliseconds": @(YFDateStorageEpochMilliseconds)};
+
+    NSMutableArray<NSDate *> *dates = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        [dates addObject:[NSDate dateWithTimeIntervalSince1970:1600000000 + (NSTimeInterval)i * 3600.25]];
+    }
+
+    for (NSString *name in [[storages allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+        YFDatabase *db = YFBenchmarkOpenDatabase(nil, YES);
+        if ([storages[name] integerValue] == YFDateStorageFormatter) {
+            [db setDateFormat:[YFDatabase storeableDateFormat:@"yyyy-MM-dd'T'HH:mm:ss.SSS'Z'"]];
+        }
+        db.dateStorage = [storages[name] integerValue];
+        [db executeUpdate:@"CREATE TABLE event (at)"];
+
+        [self measure:@"date.bind" storage:name operations:count body:^(YFBenchmarkRecorder *recorder) {
+            [db executeUpdate:@"DELETE FROM event"];
+            YFPreparedStatement *statement = [db prepareStatement:@"INSERT INTO event (at) VALUES (?)" error:nil];
+            [db beginTransaction];
+            for (NSDate *date in dates) {
+                uint64_t start = YFBenchmarkNow();
+                [statement bindObject:date atIndex:1];
+                [statement step];
+                [statement reset];
+                [recorder addSample:YFBenchmarkNow() - start];
+            }
+            [db commit];
+            [statement close];
+        }];
+
+        // samples are per row
+        [self measure:@"date.read" storage:name operations:count body:^(YFBenchmarkRecorder *recorder) {
+            YFResultSet *rs = [db executeQuery:@"SELECT at FROM event"];
+            uint64_t start = YFBenchmarkNow();
+            while ([rs next]) {
+                (void)[rs dateForColumnIndex:0];
+                uint64_t now = YFBenchmarkNow();
+                [recorder addSample:now - start];
+                start = now;
+            }
+            [rs close];
+        }];
+
+        [db close];
+    }
+}
+
+- (void)runFunctionBenchmarks {
+
+    NSUInteger count = _options.lookupCount;
+    YFDatabase *db = YFBenchmarkOpenDatabase(nil, YES);
+
+    __unsafe_unretained YFDatabase *unretainedDB = db;
+    [db makeFunctionNamed:@"twice_legacy" arguments:1 block:^(void *context, int argc, void **argv) {
+        [unretainedDB resultLong:[unretainedDB valueLong:argv[0]] * 2 context:context];
+    }];
+    [db makeScalarFunctionNamed:@"twice" arguments:1 options:YFFunctionOptionsDeterministic block:^(YFFunctionContext *context) {
+        [context resultInt64:[context int64AtIndex:0] * 2];
+    } error:nil];
+    [db makeAggregateFunctionNamed:@"total_objc" arguments:1 options:YFFunctionOptionsDeterministic step:^(YFFunctionContext *context, id __strong *state) {
+        *state = @([*state longLongValue] + [context int64AtIndex:0]);
+    } final:^(YFFunctionContext *context, id state) {
+        [context resultInt64:[state longLongValue]];
+    } error:nil];
+
+    [db executeUpdate:@"CREATE TABLE number (value INTEGER)"];
+    [db beginTransaction];
+    for (NSUInteger i = 0; i < count; i++) {
+        [db executeUpdate:@"INSERT INTO number (value) VALUES (?)", @(i)];
+    }
+    [db commit];
+
+    // one sample per query over the whole table
+    for (NSString *function in @[@"twice_legacy", @"twice"]) {
+        NSString *sql = [NSString stringWithFormat:@"SELECT sum(%@(value)) FROM number", function];
+        [self measure:[@"function.scalar." stringByAppendingString:function] storage:@"memory" operations:count body:^(YFBenchmarkRecorder *recorder) {
+            uint64_t start = YFBenchmarkNow();
+            (void)[db longForQuery:sql];
+            [recorder addSample:YFBenchmarkNow() - start];
+        }];
+    }
+
+    for (NSString *function in @[@"sum", @"total_objc"]) {
+        NSString *sql = [NSString stringWithFormat:@"SELECT %@(value) FROM number", function];
+        [self measure:[@"function.aggregate." stringByAppendingString:function] storage:@"memory" operations:count body:^(YFBenchmarkRecorder *recorder) {
+            uint64_t start = YFBenchmarkNow();
+            (void)[db longForQuery:sql];
+            [recorder addSample:YFBenchmarkNow() - start];
+        }];
+    }
+
+    [db close];
+}
+
+// MARK: Virtual tables
+
+- (void)runVirtualTableBenchmarks {
+
+    // samples are per join, including the copy into a temporary table where there is one
+    NSUInteger count = _options.lookupCount;
+    YFDatabase *db = YFBenchmarkOpenDatabase(nil, YES);
+
+    [db executeUpdate:@"CREATE TABLE customer (id INTEGER PRIMARY KEY, name TEXT)"];
+    [db beginTransaction];
+    for (NSUInteger i = 0; i < count; i++) {
+        [db executeUpdate:@"INSERT INTO customer (id, name) VALUES (?, ?)", @(i), [NSString stringWithFormat:@"customer %lu", (unsigned long)i]];
+    }
+    [db commit];
+
+    NSMutableArray<NSArray *> *orders = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        [orders addObject:@[@((i * 7919) % count), @(i % 100)]];
+    }
+
+    [db makeVirtualTableNamed:@"orders_array" provider:[YFArrayTableProvider providerWithColumnNames:@[@"customer_id", @"total"] rows:orders] error:nil];
+
+    [self measure:@"vtable.join.tempTable" storage:@"memory" operations:count body:^(YFBenchmarkRecorder *recorder) {
+        uint64_t start = YFBenchmarkNow();
+        [db executeUpdate:@"CREATE TEMP TABLE orders_copy (customer_id INTEGER, total INTEGER)"];
+        YFPreparedStatement *statement = [db prepareStatement:@"INSERT INTO orders_copy (customer_id, total) VALUES (?, ?)" error:nil];
+        [db beginTransaction];
+        for (NSArray *order in orders) {
+            [statement bindObject:order[0] atIndex:1];
+            [statement bindObject:order[1] atIndex:2];
+            [statement step];
+            [statement reset];
+        }
+        [db commit];
+        [statement close];
+        (void)[db longForQuery:@"SELECT sum(o.total) FROM orders_copy o JOIN customer c ON c.id = o.customer_id"];
+        [db executeUpdate:@"DROP TABLE orders_copy"];
+        [recorder addSample:YFBenchmarkNow() - start];
+    }];
+
+    [self measure:@"vtable.join.array" storage:@"memory" operations:count body:^(YFBenchmarkRecorder *recorder) {
+        uint64_t start = YFBenchmarkNow();
+        (void)[db longForQuery:@"SELECT sum(o.total) FROM orders_array o JOIN customer c ON c.id = o.customer_id"];
+        [recorder addSample:YFBenchmarkNow() - start];
+    }];
+
+    [db close];
+}
+
+// MARK: IN lists
+
+- (void)runInListBenchmarks {
+
+    // samples are per lookup of a list of 1 to 100 ids, so placeholder lists take 100 distinct SQL texts
+    NSUInteger count = _options.lookupCount / 10;
+    YFDatabase *db = YFBenchmarkOpenDatabase(nil, YES);
+
+    [db executeUpdate:@"CREATE TABLE item (id INTEGER PRIMARY KEY, name TEXT)"];
+    [db beginTransaction];
+    for (NSUInteger i = 0; i < 10000; i++) {
+        [db executeUpdate:@"INSERT INTO item (id, name) VALUES (?, ?)", @(i), [NSString stringWithFormat:@"item %lu", (unsigned long)i]];
+    }
+    [db commit];
+
+    srandom(_options.seed);
+    NSMutableArray<NSArray<NSNumber *> *> *lists = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++) {
+        NSUInteger length = 1 + i % 100;
+        NSMutableArray<NSNumber *> *ids = [NSMutableArray arrayWithCapacity:length];
+        for (NSUInteger j = 0; j < length; j++) {
+            [ids addObject:@(random() % 10000)];
+        }
+        [lists addObject:ids];
+    }
+
+    [self measure:@"in.placeholders" storage:@"memory" operations:count body:^(YFBenchmarkRecorder *recorder) {
+        for (NSArray<NSNumber *> *ids in lists) {
+            uint64_t start = YFBenchmarkNow();
+            NSMutableString *sql = [NSMutableString stringWithString:@"SELECT name FROM item WHERE id IN (?"];
+            for (NSUInteger j = 1; j < [ids count]; j++) {
+                [sql appendString:@", ?"];
+            }
+            [sql appendString:@")"];
+            YFResultSet *rs = [db executeQuery:sql withArgumentsInArray:ids];
+            while ([rs next]) {
+            }
+            [rs close];
+            [recorder addSample:YFBenchmarkNow() - start];
+        }
+    }];
+
+    [self measure:@"in.carray" storage:@"memory" operations:count body:^(YFBenchmarkRecorder *recorder) {
+        for (NSArray<NSNumber *> *ids in lists) {
+            uint64_t start = YFBenchmarkNow();
+            YFResultSet *rs = [db executeQuery:@"SELECT name FROM item WHERE id IN yfdb_carray(?)", [YFArrayParameter parameterWithArray:ids]];
+            while ([rs next]) {
+            }
+            [rs close];
+            [recorder addSample:YFBenchmarkNow() - start];
+        }
+    }];
+
+    [db close];
+}
+
+@end
+
+// MARK: - main
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+
+        YFBenchmarkOptions options = {
+            .rowCount = 20000,
+            .autocommitRows = 500,
+            .lookupCount = 20000,
+            .runs = 5,
+            .seed = 20231101,
+        };
+        NSString *outputPath = nil;
+        NSString *filter = nil;
+
+        for (int i = 1; i < argc; i++) {
+            const char *arg = argv[i];
+            const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+            if (!strcmp(arg, "--help") || !strcmp(arg, "-h")) {
+                YFBenchmarkUsage();
+                return 0;
+            }
+            if (!value) {
+                YFBenchmarkUsage();
+                return 2;
+            }
+
+            if (!strcmp(arg, "--rows")) {
+                options.rowCount = (NSUInteger)strtoul(value, NULL, 10);
+            }
+            else if (!strcmp(arg, "--autocommit-rows")) {
+                options.autocommitRows = (NSUInteger)strtoul(value, NULL, 10);
+            }
+            else if (!strcmp(arg, "--lookups")) {
+                options.lookupCount = (NSUInteger)strtoul(value, NULL, 10);
+            }
+            else if (!strcmp(arg, "--runs")) {
+                options.runs = (NSUInteger)strtoul(value, NULL, 10);
+            }
+            else if (!strcmp(arg, "--seed")) {
+                options.seed = (unsigned int)strtoul(value, NULL, 10);
+            }
+            else if (!strcmp(arg, "--filter")) {
+                filter = [NSString stringWithUTF8String:value];
+            }
+            else if (!strcmp(arg, "--output")) {
+                outputPath = [NSString stringWithUTF8String:value];
+            }
+            else {
+                YFBenchmarkUsage();
+                return 2;
+            }
+            i++;
+        }
+
+        if (!options.rowCount || !options.lookupCount || !options.runs) {
+            YFBenchmarkUsage();
+            return 2;
+        }
+
+        options.filter = filter;
+
+        YFBenchmarkRunner *runner = [[YFBenchmarkRunner alloc] init];
+        runner.options = options;
+        runner.rows = YFBenchmarkMakeRows(options.rowCount, options.seed);
+        runner.results = [NSMutableArray array];
+
+        for (NSString *storage in @[@"memory", @"file"]) {
+            [runner runInsertBenchmarksWithStorage:storage];
+            [runner runSelectBenchmarksWithStorage:storage];
+        }
+        [runner runBindBenchmarks];
+        [runner runScriptBenchmarks];
+        [runner runDateBenchmarks];
+        [runner runFunctionBenchmarks];
+        [runner runVirtualTableBenchmarks];
+        [runner runInListBenchmarks];
+
+        NSProcessInfo *processInfo = [NSProcessInfo processInfo];
+        NSDictionary *report = @{@"environment": @{@"sqliteVersion": [YFDatabase sqliteLibVersion],
+                                                   @"operatingSystem": [processInfo operatingSystemVersionString],
+                                                   @"processorCount": @([processInfo activeProcessorCount]),
+                                                   @"date": [[NSDate date] description]},
+                                 @"options": @{@"rows": @(options.rowCount),
+                                               @"autocommitRows": @(options.autocommitRows),
+                                               @"lookups": @(options.lookupCount),
+                                               @"runs": @(options.runs),
+                                               @"seed": @(options.seed)},
+                                 @"benchmarks": runner.results};
+
+        NSError *error = nil;
+        NSData *json = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:&error];
+        if (!json) {
+            fprintf(stderr, "could not encode results: %s\n", [[error localizedDescription] UTF8String]);
+            return 1;
+        }
+
+        if (outputPath) {
+            if (![json writeToFile:outputPath options:NSDataWritingAtomic error:&error]) {
+                fprintf(stderr, "could not write %s: %s\n", [outputPath UTF8String], [[error localizedDescription] UTF8String]);
+                return 1;
+            }
+        }
+        else {
+            fwrite([json bytes], 1, [json length], stdout);
+            fputc('\n', stdout);
+        }
+    }
+    return 0;
+}
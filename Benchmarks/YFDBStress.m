@@ -0,0 +1,697 @@
+//
+//  YFDBStress.m
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import <Foundation/Foundation.h>
+#import <sqlite3.h>
+#import <pthread.h>
+#import <time.h>
+#import <stdlib.h>
+
+#import "YFDB.h"
+
+// MARK: - Options
+
+typedef NS_ENUM(NSInteger, YFStressMode) {
+    YFStressModeQueue,
+    YFStressModePool,
+    YFStressModeReadWritePool,
+};
+
+typedef struct {
+    NSUInteger threads;
+    NSUInteger readPercent;             // chance, in percent, that an operation is a read
+    NSTimeInterval duration;            // seconds per configuration
+    NSUInteger poolSize;                // maximumNumberOfDatabasesToCreate / maximumNumberOfReaders; 0 for no limit
+    NSUInteger rowCount;
+    NSUInteger payloadBytes;            // size of the address column, to approximate real rows
+    NSUInteger writesPerTransaction;
+    NSTimeInterval busyTimeout;
+    NSTimeInterval checkoutTimeout;
+    unsigned int seed;
+} YFStressOptions;
+
+static void YFStressUsage(void) {
+    fprintf(stderr,
+            "usage: YFDBStress [--mode queue|pool|readwrite|all] [--journal wal|delete|truncate|all]\n"
+            "                  [--threads N] [--read-percent P] [--duration SECONDS] [--pool-size N]\n"
+            "                  [--rows N] [--payload-bytes N] [--writes-per-transaction N]\n"
+            "                  [--busy-timeout SECONDS] [--checkout-timeout SECONDS] [--seed N] [--output PATH]\n");
+}
+
+static NSString *YFStressModeName(YFStressMode mode) {
+    switch (mode) {
+        case YFStressModeQueue:         return @"queue";
+        case YFStressModePool:          return @"pool";
+        case YFStressModeReadWritePool: return @"readwrite";
+    }
+    return @"unknown";
+}
+
+// MARK: - Samples
+
+static uint64_t YFStressNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int YFStressCompareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/** Growable array of durations in microseconds. Each worker owns its own, so no locking. */
+
+@interface YFStressSamples : NSObject
+- (void)add:(uint64_t)nanoseconds;
+- (void)addSamples:(YFStressSamples *)other;
+- (NSUInteger)count;
+- (NSDictionary *)percentiles;
+@end
+
+@implementation YFStressSamples {
+    double      *_values;
+    NSUInteger  _count;
+    NSUInteger  _capacity;
+}
+
+- (void)dealloc {
+    free(_values);
+}
+
+- (void)reserve:(NSUInteger)extra {
+    if (_count + extra <= _capacity) {
+        return;
+    }
+    while (_count + extra > _capacity) {
+        _capacity = _capacity ? _capacity * 2 : 4096;
+    }
+    _values = realloc(_values, _capacity * sizeof(double));
+}
+
+- (void)add:(uint64_t)nanoseconds {
+    [self reserve:1];
+    _values[_count++] = (double)nanoseconds / 1000.0;
+}
+
+- (void)addSamples:(YFStressSamples *)other {
+    [self reserve:other->_count];
+    memcpy(_values + _count, other->_values, other->_count * sizeof(double));
+    _count += other->_count;
+}
+
+- (NSUInteger)count {
+    return _count;
+}
+
+- (double)percentile:(double)percentile {
+    NSUInteger rank = (NSUInteger)ceil(percentile / 100.0 * _count);
+    return _values[rank ? rank - 1 : 0];
+}
+
+- (NSDictionary *)percentiles {
+    if (!_count) {
+        return @{@"samples": @0};
+    }
+    qsort(_values, _count, sizeof(double), YFStressCompareDoubles);
+    double total = 0;
+    for (NSUInteger i = 0; i < _count; i++) {
+        total += _values[i];
+    }
+    return @{@"samples": @(_count),
+             @"mean": @(total / _count),
+             @"p50": @([self percentile:50]),
+             @"p90": @([self percentile:90]),
+             @"p99": @([self percentile:99]),
+             @"p999": @([self percentile:99.9]),
+             @"max": @(_values[_count - 1])};
+}
+
+@end
+
+// MARK: - Target
+
+/** Runs a block on a reader or on the writer of whatever is under test. */
+
+@interface YFStressTarget : NSObject
+@property (nonatomic, copy) void (^read)(void (^block)(YFDatabase *db));
+@property (nonatomic, copy) void (^write)(void (^block)(YFDatabase *db));
+@property (nonatomic, copy) NSDictionary *(^statistics)(void);
+@property (nonatomic, copy) void (^close)(void);
+@end
+
+@implementation YFStressTarget
+@end
+
+// MARK: - Worker
+
+@interface YFStressWorker : NSObject {
+    @public
+    YFStressOptions     _options;
+    uint64_t            _deadline;
+    unsigned int        _seed;
+
+    NSUInteger          _reads;
+    NSUInteger          _writes;
+    NSUInteger          _failedReads;
+    NSUInteger          _failedWrites;
+    NSUInteger          _skipped;           // pool handed no database (checkout timeout)
+
+    YFStressSamples     *_readWait;
+    YFStressSamples     *_readExecution;
+    YFStressSamples     *_writeWait;
+    YFStressSamples     *_writeExecution;
+
+    NSMutableSet        *_databases;        // every connection this worker ran on
+}
+@property (nonatomic, strong) YFStressTarget *target;
+- (void)run;
+@end
+
+@implementation YFStressWorker
+
+- (instancetype)init {
+    self = [super init];
+    if (self) {
+        _readWait = [[YFStressSamples alloc] init];
+        _readExecution = [[YFStressSamples alloc] init];
+        _writeWait = [[YFStressSamples alloc] init];
+        _writeExecution = [[YFStressSamples alloc] init];
+        _databases = [NSMutableSet set];
+    }
+    return self;
+}
+
+/** First sight of a connection: remember it for the busy statistics and give it the busy timeout. Only called while the connection is held. */
+
+- (void)noteDatabase:(YFDatabase *)db {
+    if (![_databases containsObject:db]) {
+        [_databases addObject:db];
+        [db setMaxBusyRetryTimeInterval:_options.busyTimeout];
+    }
+}
+
+- (void)readOnce {
+    int key = (int)(rand_r(&_seed) % _options.rowCount) + 1;
+    __block BOOL ran = NO;
+
+    uint64_t start = YFStressNow();
+    _target.read(^(YFDatabase *db) {
+        uint64_t began = YFStressNow();
+        [self->_readWait add:began - start];
+        [self noteDatabase:db];
+        ran = YES;
+
+        YFResultSet *rs = [db executeQuery:@"SELECT ID, name, phone, address, score FROM person WHERE ID = ?", @(key)];
+        if ([rs next]) {
+            (void)[rs stringForColumnIndex:1];
+            (void)[rs stringForColumnIndex:3];
+            (void)[rs intForColumnIndex:4];
+        }
+        else {
+            self->_failedReads++;
+        }
+        [rs close];
+
+        [self->_readExecution add:YFStressNow() - began];
+    });
+
+    if (ran) {
+        _reads++;
+    }
+    else {
+        _skipped++;
+    }
+}
+
+- (void)writeOnce {
+    NSUInteger count = MAX(_options.writesPerTransaction, (NSUInteger)1);
+    __block BOOL ran = NO;
+
+    uint64_t start = YFStressNow();
+    _target.write(^(YFDatabase *db) {
+        uint64_t began = YFStressNow();
+        [self->_writeWait add:began - start];
+        [self noteDatabase:db];
+        ran = YES;
+
+        BOOL ok = YES;
+        if (count > 1) {
+            ok = [db beginImmediateTransaction];
+        }
+        for (NSUInteger i = 0; ok && i < count; i++) {
+            int key = (int)(rand_r(&self->_seed) % self->_options.rowCount) + 1;
+            ok = [db executeUpdate:@"UPDATE person SET score = score + 1 WHERE ID = ?", @(key)];
+        }
+        if (count > 1) {
+            ok = ok ? [db commit] : ([db rollback], NO);
+        }
+        if (!ok) {
+            self->_failedWrites++;
+        }
+
+        [self->_writeExecution add:YFStressNow() - began];
+    });
+
+    if (ran) {
+        _writes++;
+    }
+    else {
+        _skipped++;
+    }
+}
+
+- (void)run {
+    while (YFStressNow() < _deadline) {
+        @autoreleasepool {
+            if ((NSUInteger)(rand_r(&_seed) % 100) < _options.readPercent) {
+                [self readOnce];
+            }
+            else {
+                [self writeOnce];
+            }
+        }
+    }
+}
+
+@end
+
+static void *YFStressWorkerMain(void *context) {
+    @autoreleasepool {
+        YFStressWorker *worker = (__bridge_transfer YFStressWorker *)context;
+        [worker run];
+    }
+    return NULL;
+}
+
+// MARK: - Fixtures
+
+static NSString *YFStressTemporaryPath(void) {
+    NSString *name = [NSString stringWithFormat:@"yfdb-stress-%d-%@.sqlite", [[NSProcessInfo processInfo] processIdentifier], [[NSUUID UUID] UUIDString]];
+    return [NSTemporaryDirectory() stringByAppendingPathComponent:name];
+}
+
+static void YFStressRemoveDatabase(NSString *path) {
+    NSFileManager *fm = [NSFileManager defaultManager];
+    for (NSString *suffix in @[@"", @"-wal", @"-shm", @"-journal"]) {
+        [fm removeItemAtPath:[path stringByAppendingString:suffix] error:nil];
+    }
+}
+
+static BOOL YFStressCreateDatabase(NSString *path, NSString *journalMode, YFStressOptions options) {
+    YFDatabase *db = [YFDatabase databaseWithPath:path];
+    if (![db open]) {
+        fprintf(stderr, "could not open %s: %s\n", [path UTF8String], [[db lastErrorMessage] UTF8String]);
+        return NO;
+    }
+
+    NSString *mode = [db stringForQuery:[NSString stringWithFormat:@"PRAGMA journal_mode=%@", journalMode]];
+    if ([mode caseInsensitiveCompare:journalMode] != NSOrderedSame) {
+        fprintf(stderr, "journal_mode=%s was refused (got %s)\n", [journalMode UTF8String], [mode UTF8String]);
+    }
+
+    [db executeUpdate:@"CREATE TABLE person (ID INTEGER PRIMARY KEY, name TEXT, phone TEXT, address TEXT, score INTEGER)"];
+
+    NSString *payload = [@"" stringByPaddingToLength:options.payloadBytes withString:@"YFDB stress payload " startingAtIndex:0];
+    srandom(options.seed);
+
+    YFBatchResult *result = [db executeBatch:@"INSERT INTO person (ID, name, phone, address, score) VALUES (?, ?, ?, ?, ?)" withRowBinder:^BOOL(YFPreparedStatement *statement, NSUInteger rowIndex) {
+        if (rowIndex >= options.rowCount) {
+            return NO;
+        }
+        [statement bindInt64:(int64_t)rowIndex + 1 atIndex:1];
+        [statement bindText:[NSString stringWithFormat:@"person-%lu", (unsigned long)rowIndex] atIndex:2];
+        [statement bindText:[NSString stringWithFormat:@"+86 1%010ld", random() % 10000000000L] atIndex:3];
+        [statement bindTextNoCopy:payload atIndex:4];
+        [statement bindInt:(int)(random() % 100) atIndex:5];
+        return YES;
+    } error:nil];
+
+    [db close];
+
+    if (![result succeeded]) {
+        fprintf(stderr, "could not fill %s: %s\n", [path UTF8String], [[[result error] localizedDescription] UTF8String]);
+        return NO;
+    }
+    return YES;
+}
+
+static NSDictionary *YFStressPoolStatistics(YFDatabasePool *pool) {
+    return @{@"openDatabases": @([pool countOfOpenDatabases]),
+             @"highWaterMarkOfCheckedOutDatabases": @([pool highWaterMarkOfCheckedOutDatabases]),
+             @"exhaustionWaits": @([pool countOfWaits]),
+             @"checkoutTimeouts": @([pool countOfCheckoutTimeouts]),
+             @"maximumWaitQueueDepth": @([pool maximumWaitQueueDepth]),
+             @"totalWaitSeconds": @([pool totalWaitTime])};
+}
+
+static YFStressTarget *YFStressMakeTarget(YFStressMode mode, NSString *path, YFStressOptions options) {
+
+    YFStressTarget *target = [[YFStressTarget alloc] init];
+
+    switch (mode) {
+        case YFStressModeQueue: {
+            YFDatabaseQueue *queue = [YFDatabaseQueue databaseQueueWithPath:path];
+            if (!queue) {
+                return nil;
+            }
+            target.read = ^(void (^block)(YFDatabase *db)) {
+                [queue inDatabase:block];
+            };
+            target.write = target.read;
+            target.statistics = ^NSDictionary *{
+                return @{};
+            };
+            target.close = ^{
+                [queue close];
+            };
+            break;
+        }
+        case YFStressModePool: {
+            YFDatabasePool *pool = [YFDatabasePool databasePoolWithPath:path];
+            [pool setMaximumNumberOfDatabasesToCreate:options.poolSize];
+            [pool setCheckoutTimeout:options.checkoutTimeout];
+            target.read = ^(void (^block)(YFDatabase *db)) {
+                [pool inDatabase:block];
+            };
+            target.write = target.read;
+            target.statistics = ^NSDictionary *{
+                return @{@"pool": YFStressPoolStatistics(pool)};
+            };
+            target.close = ^{
+                [pool releaseAllDatabases];
+            };
+            break;
+        }
+        case YFStressModeReadWritePool: {
+            YFDatabaseReadWritePool *pool = [YFDatabaseReadWritePool databaseReadWritePoolWithPath:path];
+            if (!pool) {
+                return nil;
+            }
+            if (options.poolSize) {
+                [pool setMaximumNumberOfReaders:options.poolSize];
+            }
+            [[pool readerPool] setCheckoutTimeout:options.checkoutTimeout];
+            target.read = ^(void (^block)(YFDatabase *db)) {
+                [pool inReadDatabase:block];
+            };
+            target.write = ^(void (^block)(YFDatabase *db)) {
+                [pool inWriteDatabase:block];
+            };
+            target.statistics = ^NSDictionary *{
+                return @{@"readerPool": YFStressPoolStatistics([pool readerPool])};
+            };
+            target.close = ^{
+                [pool close];
+            };
+            break;
+        }
+    }
+
+    return target;
+}
+
+// MARK: - Run
+
+static NSDictionary *YFStressRunConfiguration(YFStressMode mode, NSString *journalMode, YFStressOptions options) {
+
+    NSString *path = YFStressTemporaryPath();
+    YFStressRemoveDatabase(path);
+
+    // the read/write pool always switches to WAL
+    NSString *effectiveJournalMode = mode == YFStressModeReadWritePool ? @"wal" : journalMode;
+
+    if (!YFStressCreateDatabase(path, effectiveJournalMode, options)) {
+        YFStressRemoveDatabase(path);
+        return nil;
+    }
+
+    YFStressTarget *target = YFStressMakeTarget(mode, path, options);
+    if (!target) {
+        fprintf(stderr, "could not open %s for %s\n", [path UTF8String], [YFStressModeName(mode) UTF8String]);
+        YFStressRemoveDatabase(path);
+        return nil;
+    }
+
+    NSMutableArray<YFStressWorker *> *workers = [NSMutableArray array];
+    pthread_t *threads = calloc(options.threads, sizeof(pthread_t));
+
+    uint64_t start = YFStressNow();
+    uint64_t deadline = start + (uint64_t)(options.duration * 1e9);
+
+    for (NSUInteger i = 0; i < options.threads; i++) {
+        YFStressWorker *worker = [[YFStressWorker alloc] init];
+        worker->_options = options;
+        worker->_deadline = deadline;
+        worker->_seed = options.seed + (unsigned int)i * 7919;
+        worker.target = target;
+        [workers addObject:worker];
+
+        if (pthread_create(&threads[i], NULL, YFStressWorkerMain, (__bridge_retained void *)worker) != 0) {
+            fprintf(stderr, "could not start thread %lu\n", (unsigned long)i);
+            exit(1);
+        }
+    }
+
+    for (NSUInteger i = 0; i < options.threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    double elapsed = (double)(YFStressNow() - start) / 1e9;
+
+    // merge per worker results
+    YFStressSamples *readWait = [[YFStressSamples alloc] init];
+    YFStressSamples *readExecution = [[YFStressSamples alloc] init];
+    YFStressSamples *writeWait = [[YFStressSamples alloc] init];
+    YFStressSamples *writeExecution = [[YFStressSamples alloc] init];
+    NSMutableSet *databases = [NSMutableSet set];
+    NSUInteger reads = 0, writes = 0, failedReads = 0, failedWrites = 0, skipped = 0;
+
+    for (YFStressWorker *worker in workers) {
+        [readWait addSamples:worker->_readWait];
+        [readExecution addSamples:worker->_readExecution];
+        [writeWait addSamples:worker->_writeWait];
+        [writeExecution addSamples:worker->_writeExecution];
+        [databases unionSet:worker->_databases];
+        reads += worker->_reads;
+        writes += worker->_writes;
+        failedReads += worker->_failedReads;
+        failedWrites += worker->_failedWrites;
+        skipped += worker->_skipped;
+    }
+
+    // every worker has finished, so the connections are idle and their counters stable
+    NSUInteger busyEvents = 0, busyRetries = 0, busyTimeouts = 0, busySnapshots = 0;
+    NSTimeInterval busyWait = 0, longestBusyWait = 0;
+    for (YFDatabase *db in databases) {
+        busyEvents += [db busyEventCount];
+        busyRetries += [db busyRetryCount];
+        busyTimeouts += [db busyTimeoutCount];
+        busySnapshots += [db busySnapshotCount];
+        busyWait += [db totalBusyWaitTime];
+        longestBusyWait = MAX(longestBusyWait, [db longestBusyWait]);
+    }
+
+    NSMutableDictionary *result = [NSMutableDictionary dictionary];
+    result[@"mode"] = YFStressModeName(mode);
+    result[@"journalMode"] = effectiveJournalMode;
+    result[@"threads"] = @(options.threads);
+    result[@"readPercent"] = @(options.readPercent);
+    result[@"poolSize"] = @(options.poolSize);
+    result[@"elapsedSeconds"] = @(elapsed);
+    result[@"operations"] = @{@"reads": @(reads),
+                              @"writes": @(writes),
+                              @"failedReads": @(failedReads),
+                              @"failedWrites": @(failedWrites),
+                              @"skipped": @(skipped),
+                              @"readsPerSecond": @(reads / elapsed),
+                              @"writesPerSecond": @(writes / elapsed),
+                              @"operationsPerSecond": @((reads + writes) / elapsed)};
+    result[@"latencyMicroseconds"] = @{@"readWait": [readWait percentiles],
+                                       @"readExecution": [readExecution percentiles],
+                                       @"writeWait": [writeWait percentiles],
+                                       @"writeExecution": [writeExecution percentiles]};
+    result[@"busy"] = @{@"connections": @([databases count]),
+                        @"events": @(busyEvents),
+                        @"retries": @(busyRetries),
+                        @"timeouts": @(busyTimeouts),
+                        @"snapshotConflicts": @(busySnapshots),
+                        @"totalWaitSeconds": @(busyWait),
+                        @"longestWaitSeconds": @(longestBusyWait)};
+    [result addEntriesFromDictionary:target.statistics()];
+
+    [databases removeAllObjects];
+    target.close();
+    YFStressRemoveDatabase(path);
+
+    fprintf(stderr, "%-10s %-8s %6.0f reads/s %6.0f writes/s  wait p99 r %8.1f us w %8.1f us  busy retries %lu\n",
+            [YFStressModeName(mode) UTF8String], [effectiveJournalMode UTF8String],
+            reads / elapsed, writes / elapsed,
+            [result[@"latencyMicroseconds"][@"readWait"][@"p99"] doubleValue],
+            [result[@"latencyMicroseconds"][@"writeWait"][@"p99"] doubleValue],
+            (unsigned long)busyRetries);
+
+    return result;
+}
+
+// MARK: - main
+
+int main(int argc, const char *argv[]) {
+    @autoreleasepool {
+
+        YFStressOptions options = {
+            .threads = 8,
+            .readPercent = 80,
+            .duration = 5,
+            .poolSize = 4,
+            .rowCount = 10000,
+            .payloadBytes = 64,
+            .writesPerTransaction = 1,
+            .busyTimeout = 2,
+            .checkoutTimeout = 0,
+            .seed = 20231101,
+        };
+        NSString *modeName = @"all";
+        NSString *journalName = @"wal";
+        NSString *outputPath = nil;
+
+        for (int i = 1; i < argc; i++) {
+            const char *arg = argv[i];
+            const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+            if (!strcmp(arg, "--help") || !strcmp(arg, "-h")) {
+                YFStressUsage();
+                return 0;
+            }
+            if (!value) {
+                YFStressUsage();
+                return 2;
+            }
+
+            if (!strcmp(arg, "--mode")) {
+                modeName = [NSString stringWithUTF8String:value];
+            }
+            else if (!strcmp(arg, "--journal")) {
+                journalName = [[NSString stringWithUTF8String:value] lowercaseString];
+            }
+            else if (!strcmp(arg, "--threads")) {
+                options.threads = (NSUInteger)strtoul(value, NULL, 10);
+            }
+            else if (!strcmp(arg, "--read-percent")) {
+                options.readPercent = MIN((NSUInteger)strtoul(value, NULL, 10), (NSUInteger)100);
+            }
+            else if (!strcmp(arg, "--duration")) {
+                options.duration = strtod(value, NULL);
+            }
+            else if (!strcmp(arg, "--pool-size")) {
+                options.poolSize = (NSUInteger)strtoul(value, NULL, 10);
+            }
+            else if (!strcmp(arg, "--rows")) {
+                options.rowCount = (NSUInteger)strtoul(value, NULL, 10);
+            }
+            else if (!strcmp(arg, "--payload-bytes")) {
+                options.payloadBytes = (NSUInteger)strtoul(value, NULL, 10);
+            }
+            else if (!strcmp(arg, "--writes-per-transaction")) {
+                options.writesPerTransaction = (NSUInteger)strtoul(value, NULL, 10);
+            }
+            else if (!strcmp(arg, "--busy-timeout")) {
+                options.busyTimeout = strtod(value, NULL);
+            }
+            else if (!strcmp(arg, "--checkout-timeout")) {
+                options.checkoutTimeout = strtod(value, NULL);
+            }
+            else if (!strcmp(arg, "--seed")) {
+                options.seed = (unsigned int)strtoul(value, NULL, 10);
+            }
+            else if (!strcmp(arg, "--output")) {
+                outputPath = [NSString stringWithUTF8String:value];
+            }
+            else {
+                YFStressUsage();
+                return 2;
+            }
+            i++;
+        }
+
+        if (!options.threads || !options.rowCount || options.duration <= 0) {
+            YFStressUsage();
+            return 2;
+        }
+
+        NSMutableArray<NSNumber *> *modes = [NSMutableArray array];
+        if ([modeName isEqualToString:@"queue"] || [modeName isEqualToString:@"all"]) {
+            [modes addObject:@(YFStressModeQueue)];
+        }
+        if ([modeName isEqualToString:@"pool"] || [modeName isEqualToString:@"all"]) {
+            [modes addObject:@(YFStressModePool)];
+        }
+        if ([modeName isEqualToString:@"readwrite"] || [modeName isEqualToString:@"all"]) {
+            [modes addObject:@(YFStressModeReadWritePool)];
+        }
+
+        NSArray<NSString *> *journalModes = [journalName isEqualToString:@"all"] ? @[@"wal", @"delete", @"truncate"] : @[journalName];
+
+        if (![modes count]) {
+            YFStressUsage();
+            return 2;
+        }
+
+        NSMutableArray *results = [NSMutableArray array];
+        for (NSNumber *mode in modes) {
+            for (NSString *journalMode in journalModes) {
+                // the read/write pool is WAL only; run it once
+                if ([mode integerValue] == YFStressModeReadWritePool && ![journalMode isEqualToString:[journalModes firstObject]]) {
+                    continue;
+                }
+                @autoreleasepool {
+                    NSDictionary *result = YFStressRunConfiguration([mode integerValue], journalMode, options);
+                    if (result) {
+                        [results addObject:result];
+                    }
+                }
+            }
+        }
+
+        NSProcessInfo *processInfo = [NSProcessInfo processInfo];
+        NSDictionary *report = @{@"environment": @{@"sqliteVersion": [YFDatabase sqliteLibVersion],
+                                                   @"operatingSystem": [processInfo operatingSystemVersionString],
+                                                   @"processorCount": @([processInfo activeProcessorCount]),
+                                                   @"date": [[NSDate date] description]},
+                                 @"options": @{@"threads": @(options.threads),
+                                               @"readPercent": @(options.readPercent),
+                                               @"durationSeconds": @(options.duration),
+                                               @"poolSize": @(options.poolSize),
+                                               @"rows": @(options.rowCount),
+                                               @"payloadBytes": @(options.payloadBytes),
+                                               @"writesPerTransaction": @(options.writesPerTransaction),
+                                               @"busyTimeoutSeconds": @(options.busyTimeout),
+                                               @"checkoutTimeoutSeconds": @(options.checkoutTimeout),
+                                               @"seed": @(options.seed)},
+                                 @"configurations": results};
+
+        NSError *error = nil;
+        NSData *json = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:&error];
+        if (!json) {
+            fprintf(stderr, "could not encode results: %s\n", [[error localizedDescription] UTF8String]);
+            return 1;
+        }
+
+        if (outputPath) {
+            if (![json writeToFile:outputPath options:NSDataWritingAtomic error:&error]) {
+                fprintf(stderr, "could not write %s: %s\n", [outputPath UTF8String], [[error localizedDescription] UTF8String]);
+                return 1;
+            }
+        }
+        else {
+            fwrite([json bytes], 1, [json length], stdout);
+            fputc('\n', stdout);
+        }
+    }
+    return 0;
+}
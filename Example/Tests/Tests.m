@@ -8,8 +8,37 @@
 
 @import XCTest;
 
-@interface Tests : XCTestCase
+#import <YFDB/YFDB.h>
+#import <sqlite3.h>
+
+@interface YFTestPerson : NSObject
+@property (nonatomic) int64_t identifier;
+@property (nonatomic, copy) NSString *name;
+@property (nonatomic) double score;
+@property (nonatomic, strong) NSNumber *rank;
+@end
+
+@implementation YFTestPerson
+@end
+
+@interface YFTestObserver : NSObject
+@property (nonatomic, strong) NSMutableArray<NSString *> *changedKeys;
+@end
+
+@implementation YFTestObserver
 
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary *)change context:(void *)context
+{
+    [self.changedKeys addObject:keyPath];
+}
+
+@end
+
+@interface Tests : XCTestCase
+{
+    YFDatabase  *_db;
+    NSString    *_poolPath;
+}
 @end
 
 @implementation Tests
@@ -17,19 +46,1669 @@
 - (void)setUp
 {
     [super setUp];
-    // Put setup code here. This method is called before the invocation of each test method in the class.
+
+    _db = [YFDatabase databaseWithPath:nil];
+    XCTAssertTrue([_db open]);
+    XCTAssertTrue([_db executeUpdate:@"CREATE TABLE person (id INTEGER PRIMARY KEY, name TEXT NOT NULL, score REAL)"]);
+
+    _poolPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSString stringWithFormat:@"%@.sqlite", [[NSUUID UUID] UUIDString]]];
 }
 
 - (void)tearDown
 {
-    // Put teardown code here. This method is called after the invocation of each test method in the class.
+    [_db close];
+    _db = nil;
+
+    [[NSFileManager defaultManager] removeItemAtPath:_poolPath error:nil];
+
     [super tearDown];
 }
 
-- (void)testExample
+- (BOOL)waitUntil:(BOOL (^)(void))condition
 {
-    XCTFail(@"No implementation for \"%s\"", __PRETTY_FUNCTION__);
+    NSDate *deadline = [NSDate dateWithTimeIntervalSinceNow:5];
+
+    while (!condition()) {
+        if ([deadline timeIntervalSinceNow] < 0) {
+            return NO;
+        }
+        [NSThread sleepForTimeInterval:0.01];
+    }
+
+    return YES;
 }
 
-@end
+- (YFDatabasePool *)poolWithMaximumDatabases:(NSUInteger)maximum
+{
+    YFDatabasePool *pool = [YFDatabasePool databasePoolWithPath:_poolPath];
+    [pool setMaximumNumberOfDatabasesToCreate:maximum];
+    return pool;
+}
+
+#pragma mark Prepared statements
+
+- (void)testPreparedStatementRebindsAndSteps
+{
+    NSError *error = nil;
+    YFPreparedStatement *insert = [_db prepareStatement:@"INSERT INTO person (id, name, score) VALUES (?, ?, ?)" error:&error];
+    XCTAssertNotNil(insert, @"%@", error);
+    XCTAssertEqual([insert parameterCount], 3);
+
+    NSArray *names = @[@"Ann", @"Bob"];
+    for (int i = 0; i < 2; i++) {
+        XCTAssertTrue([insert bindInt64:i + 1 atIndex:1]);
+        XCTAssertTrue([insert bindText:names[(NSUInteger)i] atIndex:2]);
+        XCTAssertTrue([insert bindDouble:i + 0.5 atIndex:3]);
+        XCTAssertTrue([insert stepWithError:&error], @"%@", error);
+        XCTAssertTrue([insert reset]);
+    }
+    [insert close];
+
+    YFPreparedStatement *select = [_db prepareStatement:@"SELECT name, score FROM person WHERE id = ?" error:&error];
+    XCTAssertTrue([select bindInt64:2 atIndex:1]);
+    XCTAssertTrue([select next]);
+    XCTAssertEqualObjects([select stringForColumnIndex:0], @"Bob");
+    XCTAssertEqualWithAccuracy([select doubleForColumnIndex:1], 1.5, 0.0001);
+    XCTAssertFalse([select next]);
+    [select close];
+}
+
+- (void)testPreparedStatementReportsBadIndex
+{
+    YFPreparedStatement *insert = [_db prepareStatement:@"INSERT INTO person (id, name) VALUES (?, ?)" error:nil];
+    XCTAssertFalse([insert bindInt:1 atIndex:3]);
+    [insert close];
+}
+
+- (void)testPreparedStatementWithColdStatementCache
+{
+    [_db setShouldCacheStatements:YES];
+
+    // the first prepare misses the cache; the second takes the statement the first one handed back
+    for (int i = 0; i < 2; i++) {
+        NSError *error = nil;
+        YFPreparedStatement *insert = [_db prepareStatement:@"INSERT INTO person (id, name) VALUES (?, ?)" error:&error];
+        XCTAssertNotNil(insert, @"%@", error);
+        XCTAssertTrue([insert bindInt:i + 1 atIndex:1]);
+        XCTAssertTrue([insert bindText:@"Ann" atIndex:2]);
+        XCTAssertTrue([insert stepWithError:&error], @"%@", error);
+        [insert close];
+    }
+
+    XCTAssertEqual([[_db statementCache] missCount], 1u);
+    XCTAssertEqual([[_db statementCache] hitCount], 1u);
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM person"], 2);
+}
+
+#pragma mark Statement cache
+
+- (void)testStatementCacheReusesStatement
+{
+    [_db setShouldCacheStatements:YES];
+
+    for (int i = 0; i < 3; i++) {
+        YFResultSet *rs = [_db executeQuery:@"SELECT count(*) FROM person"];
+        XCTAssertTrue([rs next]);
+        [rs close];
+    }
+
+    YFStatementCache *cache = [_db statementCache];
+    XCTAssertEqual([cache count], 1u);
+    XCTAssertEqual([cache missCount], 1u);
+    XCTAssertEqual([cache hitCount], 2u);
+}
+
+- (void)testStatementCacheEvictsLeastRecentlyUsed
+{
+    [_db setShouldCacheStatements:YES];
+    [_db setMaximumCachedStatementCount:2];
+
+    for (int i = 0; i < 3; i++) {
+        YFResultSet *rs = [_db executeQuery:[NSString stringWithFormat:@"SELECT %d", i]];
+        XCTAssertTrue([rs next]);
+        [rs close];
+    }
+
+    YFStatementCache *cache = [_db statementCache];
+    XCTAssertEqual([cache count], 2u);
+    XCTAssertEqual([cache evictionCount], 1u);
+
+    // the oldest query was evicted, the newest is still there
+    [cache resetStatistics];
+    [[_db executeQuery:@"SELECT 2"] close];
+    [[_db executeQuery:@"SELECT 0"] close];
+    XCTAssertEqual([cache hitCount], 1u);
+    XCTAssertEqual([cache missCount], 1u);
+}
+
+- (void)testStatementCacheKeepsBoundResultSetStatement
+{
+    [_db setShouldCacheStatements:YES];
+    [_db setMaximumCachedStatementCount:1];
+
+    YFResultSet *rs = [_db prepare:@"SELECT ?"];
+    XCTAssertTrue([rs bindWithArray:@[@7]]);
+
+    // a full cache evicts idle statements only, never the one the result set still holds
+    for (int i = 0; i < 3; i++) {
+        [[_db executeQuery:[NSString stringWithFormat:@"SELECT %d", i]] close];
+    }
+
+    XCTAssertTrue([rs next]);
+    XCTAssertEqual([rs intForColumnIndex:0], 7);
+    [rs close];
+}
+
+#pragma mark Binding
+
+- (void)testBindsEachTypeAsItsStorageClass
+{
+    XCTAssertTrue([_db executeUpdate:@"CREATE TABLE value (v)"]);
+
+    NSArray *values = @[@YES, @42, @(UINT32_MAX), @(INT64_MAX), @1.5, @"text", [@"blob" dataUsingEncoding:NSUTF8StringEncoding], [NSNull null]];
+    for (id value in values) {
+        XCTAssertTrue([_db executeUpdate:@"INSERT INTO value (v) VALUES (?)", value]);
+    }
+
+    YFResultSet *rs = [_db executeQuery:@"SELECT typeof(v), v FROM value ORDER BY rowid"];
+    NSArray *types = @[@"integer", @"integer", @"integer", @"integer", @"real", @"text", @"blob", @"null"];
+    for (NSString *type in types) {
+        XCTAssertTrue([rs next]);
+        XCTAssertEqualObjects([rs stringForColumnIndex:0], type);
+    }
+    XCTAssertFalse([rs next]);
+    [rs close];
+
+    XCTAssertEqual([_db longForQuery:@"SELECT v FROM value WHERE rowid = 3"], (long)UINT32_MAX);
+    XCTAssertEqual([_db longForQuery:@"SELECT v FROM value WHERE rowid = 4"], (long)INT64_MAX);
+}
+
+- (void)testUpdateDoesNotKeepTheCallersBytes
+{
+    [_db setShouldCacheStatements:YES];
+
+    // executeUpdate: binds without copying, so the row must hold the value as it was when it returned
+    for (int i = 0; i < 2; i++) {
+        @autoreleasepool {
+            NSMutableString *name = [NSMutableString stringWithFormat:@"name %d", i];
+            XCTAssertTrue([_db executeUpdate:@"INSERT INTO person (id, name) VALUES (?, ?)", @(i), name]);
+            [name setString:@"changed"];
+        }
+    }
+
+    XCTAssertEqualObjects([_db stringForQuery:@"SELECT group_concat(name, ',') FROM (SELECT name FROM person ORDER BY id)"], @"name 0,name 1");
+    XCTAssertEqual([[_db statementCache] hitCount], 1u);
+}
+
+#pragma mark Batch
+
+- (void)testBatchInsertsEveryRow
+{
+    NSError *error = nil;
+    YFBatchResult *result = [_db executeBatch:@"INSERT INTO person (id, name) VALUES (?, ?)" rows:@[@[@1, @"Ann"], @[@2, @"Bob"], @[@3, @"Cid"]] error:&error];
+
+    XCTAssertTrue([result succeeded]);
+    XCTAssertNil(error);
+    XCTAssertEqual([result rowCount], 3u);
+    XCTAssertEqual([result changes], 3LL);
+    XCTAssertEqual([result failedRowIndex], (NSUInteger)NSNotFound);
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM person"], 3);
+}
+
+- (void)testBatchRollsBackOnFailingRow
+{
+    NSError *error = nil;
+    YFBatchResult *result = [_db executeBatch:@"INSERT INTO person (id, name) VALUES (:id, :name)" rows:@[@{@"id" : @1, @"name" : @"Ann"}, @{@"id" : @2}] error:&error];
+
+    XCTAssertFalse([result succeeded]);
+    XCTAssertNotNil(error);
+    XCTAssertEqual([result failedRowIndex], 1u);
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM person"], 0);
+}
+
+- (void)testBatchWithColdStatementCache
+{
+    [_db setShouldCacheStatements:YES];
+
+    for (int i = 0; i < 2; i++) {
+        NSError *error = nil;
+        YFBatchResult *result = [_db executeBatch:@"INSERT INTO person (id, name) VALUES (?, ?)" rows:@[@[@(i * 2 + 1), @"Ann"], @[@(i * 2 + 2), @"Bob"]] error:&error];
+        XCTAssertTrue([result succeeded], @"%@", error);
+    }
+
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM person"], 4);
+}
+
+- (void)testBatchRowBinderRollsBackOnFailedBind
+{
+    NSError *error = nil;
+    YFBatchResult *result = [_db executeBatch:@"INSERT INTO person (id, name) VALUES (?, ?)" withRowBinder:^BOOL(YFPreparedStatement *statement, NSUInteger rowIndex) {
+        if (rowIndex == 3) {
+            return NO;
+        }
+        [statement bindInt64:(int64_t)rowIndex + 1 atIndex:1];
+        [statement bindText:@"Ann" atIndex:2];
+        if (rowIndex == 1) {
+            // there is no third parameter; the batch must not run the row or commit the first one
+            [statement bindText:@"Bob" atIndex:3];
+        }
+        return YES;
+    } error:&error];
+
+    XCTAssertFalse([result succeeded]);
+    XCTAssertEqual([error code], SQLITE_RANGE);
+    XCTAssertEqual([result failedRowIndex], 1u);
+    XCTAssertEqual([result rowCount], 1u);
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM person"], 0);
+}
+
+- (void)testBatchInsideTransactionRollsBackToItsSavePoint
+{
+    XCTAssertTrue([_db beginTransaction]);
+    XCTAssertTrue([_db executeUpdate:@"INSERT INTO person (id, name) VALUES (1, 'Ann')"]);
+
+    YFBatchResult *result = [_db executeBatch:@"INSERT INTO person (id, name) VALUES (?, ?)" rows:@[@[@2, @"Bob"], @[@1, @"Dup"]] error:nil];
+    XCTAssertFalse([result succeeded]);
+
+    XCTAssertTrue([_db commit]);
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM person"], 1);
+}
+
+#pragma mark Pool wait queue
+
+- (void)testPoolWaiterGetsCheckedInDatabase
+{
+    YFDatabasePool *pool = [self poolWithMaximumDatabases:1];
+    [pool setCheckoutTimeout:5];
+
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    __block BOOL waiterRan = NO;
+
+    [pool inDatabase:^(YFDatabase *db) {
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            [pool inDatabase:^(YFDatabase *other) {
+                waiterRan = YES;
+            }];
+            dispatch_semaphore_signal(done);
+        });
+
+        XCTAssertTrue([self waitUntil:^BOOL{ return [pool countOfWaitingCallers] == 1; }]);
+    }];
+
+    XCTAssertEqual(dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    XCTAssertTrue(waiterRan);
+    XCTAssertEqual([pool countOfWaits], 1u);
+    XCTAssertEqual([pool countOfCheckoutTimeouts], 0u);
+    XCTAssertEqual([pool countOfOpenDatabases], 1u);
+}
+
+- (void)testPoolCheckoutTimesOut
+{
+    YFDatabasePool *pool = [self poolWithMaximumDatabases:1];
+    [pool setCheckoutTimeout:0.1];
+
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    __block BOOL waiterRan = NO;
+
+    [pool inDatabase:^(YFDatabase *db) {
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            [pool inDatabase:^(YFDatabase *other) {
+                waiterRan = YES;
+            }];
+            dispatch_semaphore_signal(done);
+        });
+
+        XCTAssertEqual(dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, 5 * NSEC_PER_SEC)), 0);
+    }];
+
+    XCTAssertFalse(waiterRan);
+    XCTAssertEqual([pool countOfCheckoutTimeouts], 1u);
+}
+
+- (void)testPoolNestedCheckoutDoesNotDeadlock
+{
+    YFDatabasePool *pool = [self poolWithMaximumDatabases:1];
+    __block BOOL nestedRan = NO;
+
+    [pool inDatabase:^(YFDatabase *db) {
+        [pool inDatabase:^(YFDatabase *other) {
+            nestedRan = YES;
+        }];
+    }];
+
+    XCTAssertFalse(nestedRan);
+    XCTAssertEqual([pool countOfWaits], 0u);
+
+    // the refused checkout must not leave the thread marked as holding a database
+    __block BOOL ran = NO;
+    [pool inDatabase:^(YFDatabase *db) {
+        ran = YES;
+    }];
+    XCTAssertTrue(ran);
+}
+
+#pragma mark Pool checkout
+
+- (void)testPoolReusesCheckedInDatabase
+{
+    YFDatabasePool *pool = [self poolWithMaximumDatabases:2];
+    __block YFDatabase *first = nil;
+    __block YFDatabase *second = nil;
+
+    [pool inDatabase:^(YFDatabase *db) {
+        first = db;
+        XCTAssertEqual([pool countOfCheckedOutDatabases], 1u);
+    }];
+    [pool inDatabase:^(YFDatabase *db) {
+        second = db;
+    }];
+
+    XCTAssertTrue(first == second);
+    XCTAssertEqual([pool countOfOpenDatabases], 1u);
+    XCTAssertEqual([pool countOfCheckedInDatabases], 1u);
+    XCTAssertEqual([pool countOfCheckedOutDatabases], 0u);
+    XCTAssertEqual([pool highWaterMarkOfCheckedOutDatabases], 1u);
+}
+
+- (void)testPoolReopensDatabaseClosedBehindItsBack
+{
+    YFDatabasePool *pool = [self poolWithMaximumDatabases:1];
+    __block YFDatabase *pooled = nil;
+
+    [pool inDatabase:^(YFDatabase *db) {
+        pooled = db;
+    }];
+    [pooled close];
+
+    __block BOOL open = NO;
+    [pool inDatabase:^(YFDatabase *db) {
+        open = [db goodConnection];
+    }];
+
+    XCTAssertTrue(open);
+    XCTAssertEqual([pool countOfOpenDatabases], 1u);
+}
+
+- (void)testPoolConcurrentCheckoutsStayWithinMaximum
+{
+    YFDatabasePool *pool = [self poolWithMaximumDatabases:2];
+    [pool setCheckoutTimeout:5];
+
+    dispatch_group_t group = dispatch_group_create();
+    for (int i = 0; i < 8; i++) {
+        dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            [pool inDatabase:^(YFDatabase *db) {
+                [NSThread sleepForTimeInterval:0.01];
+            }];
+        });
+    }
+
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)), 0);
+    XCTAssertLessThanOrEqual([pool countOfOpenDatabases], 2u);
+    XCTAssertLessThanOrEqual([pool highWaterMarkOfCheckedOutDatabases], 2u);
+    XCTAssertEqual([pool countOfCheckedOutDatabases], 0u);
+    XCTAssertEqual([pool countOfCheckoutTimeouts], 0u);
+}
+
+#pragma mark Read/write pool
+
+- (void)testReadWritePoolReadsWhatTheWriterCommitted
+{
+    YFDatabaseReadWritePool *pool = [[YFDatabaseReadWritePool alloc] initWithPath:_poolPath maximumNumberOfReaders:2];
+    XCTAssertNotNil(pool);
+
+    [pool inWriteTransaction:^(YFDatabase *db, BOOL *rollback) {
+        XCTAssertTrue([db executeUpdate:@"CREATE TABLE t (name TEXT)"]);
+        XCTAssertTrue([db executeUpdate:@"INSERT INTO t (name) VALUES (?)", @"Ann"]);
+    }];
+
+    __block NSString *journalMode = nil;
+    __block int count = 0;
+    __block BOOL readerWrote = YES;
+    [pool inReadDatabase:^(YFDatabase *db) {
+        journalMode = [db stringForQuery:@"PRAGMA journal_mode"];
+        count = [db intForQuery:@"SELECT count(*) FROM t"];
+        readerWrote = [db executeUpdate:@"INSERT INTO t (name) VALUES ('Bob')"];
+    }];
+
+    XCTAssertEqualObjects([journalMode lowercaseString], @"wal");
+    XCTAssertEqual(count, 1);
+    XCTAssertFalse(readerWrote);
+
+    [pool close];
+}
+
+- (void)testReadWritePoolRejectsInMemoryPaths
+{
+    XCTAssertNil([[YFDatabaseReadWritePool alloc] initWithPath:@":memory:"]);
+    XCTAssertNil([[YFDatabaseReadWritePool alloc] initWithPath:@""]);
+}
+
+#pragma mark Async queue
+
+- (void)testQueueAsyncTransactionCompletes
+{
+    YFDatabaseQueue *queue = [YFDatabaseQueue databaseQueueWithPath:_poolPath];
+    [queue inDatabase:^(YFDatabase *db) {
+        XCTAssertTrue([db executeUpdate:@"CREATE TABLE t (name TEXT)"]);
+    }];
+
+    XCTestExpectation *committed = [self expectationWithDescription:@"committed"];
+    dispatch_queue_t completionQueue = dispatch_queue_create("YFDBTests.completion", DISPATCH_QUEUE_SERIAL);
+
+    [queue inTransactionAsync:^(YFDatabase *db, BOOL *rollback) {
+        XCTAssertTrue([db executeUpdate:@"INSERT INTO t (name) VALUES ('Ann')"]);
+    } completionQueue:completionQueue completion:^(BOOL didCommit, NSError *error) {
+        XCTAssertTrue(didCommit);
+        XCTAssertNil(error);
+        [committed fulfill];
+    }];
+
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+
+    __block int count = 0;
+    [queue inDatabase:^(YFDatabase *db) {
+        count = [db intForQuery:@"SELECT count(*) FROM t"];
+    }];
+    XCTAssertEqual(count, 1);
+    [queue close];
+}
+
+- (void)testQueueCoalescedWritesShareOneTransaction
+{
+    YFDatabaseQueue *queue = [YFDatabaseQueue databaseQueueWithPath:_poolPath];
+    [queue setWriteCoalescingInterval:0.05];
+    [queue inDatabase:^(YFDatabase *db) {
+        XCTAssertTrue([db executeUpdate:@"CREATE TABLE t (name TEXT)"]);
+    }];
+
+    dispatch_queue_t completionQueue = dispatch_queue_create("YFDBTests.completion", DISPATCH_QUEUE_SERIAL);
+    NSMutableArray<NSNumber *> *outcomes = [NSMutableArray array];
+    NSMutableArray<XCTestExpectation *> *expectations = [NSMutableArray array];
+
+    for (int i = 0; i < 3; i++) {
+        XCTestExpectation *done = [self expectationWithDescription:[NSString stringWithFormat:@"write %d", i]];
+        [expectations addObject:done];
+
+        [queue inCoalescedWrite:^(YFDatabase *db, BOOL *rollback) {
+            [db executeUpdate:@"INSERT INTO t (name) VALUES (?)", [NSString stringWithFormat:@"row %d", i]];
+            // the second write undoes itself only
+            *rollback = (i == 1);
+        } completionQueue:completionQueue completion:^(BOOL didCommit, NSError *error) {
+            [outcomes addObject:@(didCommit)];
+            [done fulfill];
+        }];
+    }
+
+    [self waitForExpectationsWithTimeout:5 handler:nil];
+
+    XCTAssertEqualObjects(outcomes, (@[@YES, @NO, @YES]));
+
+    __block int count = 0;
+    [queue inDatabase:^(YFDatabase *db) {
+        count = [db intForQuery:@"SELECT count(*) FROM t"];
+    }];
+    XCTAssertEqual(count, 2);
+    [queue close];
+}
+
+#pragma mark Columnar fetch
+
+- (void)testFetchColumnsIntoBuffers
+{
+    [_db executeBatch:@"INSERT INTO person (id, name, score) VALUES (?, ?, ?)" rows:@[@[@1, @"Ann", @1.5], @[@2, @"Bob", [NSNull null]], @[@3, @"Cid", @3.5]] error:nil];
+
+    int64_t ids[2];
+    double scores[2];
+    BOOL scoreNulls[2];
+    uint8_t names[16];
+    size_t nameOffsets[3];
+    YFColumnBuffer columns[3] = {
+        { .columnIndex = 0, .type = YFColumnBufferTypeInt64,  .values = ids },
+        { .columnIndex = 1, .type = YFColumnBufferTypeText,   .bytes = names, .bytesCapacity = sizeof(names), .offsets = nameOffsets },
+        { .columnIndex = 2, .type = YFColumnBufferTypeDouble, .values = scores, .nulls = scoreNulls },
+    };
+
+    NSError *error = nil;
+    YFResultSet *rs = [_db executeQuery:@"SELECT id, name, score FROM person ORDER BY id"];
+
+    XCTAssertEqual([rs fetchColumnsInto:columns count:3 maxRows:2 error:&error], 2);
+    XCTAssertEqual(ids[0], 1);
+    XCTAssertEqual(ids[1], 2);
+    XCTAssertEqual(nameOffsets[1] - nameOffsets[0], 3u);
+    XCTAssertEqual(memcmp(names + nameOffsets[1], "Bob", 3), 0);
+    XCTAssertEqualWithAccuracy(scores[0], 1.5, 0.0001);
+    XCTAssertFalse(scoreNulls[0]);
+    XCTAssertTrue(scoreNulls[1]);
+
+    XCTAssertEqual([rs fetchColumnsInto:columns count:3 maxRows:2 error:&error], 1);
+    XCTAssertEqual(ids[0], 3);
+    XCTAssertEqual([rs fetchColumnsInto:columns count:3 maxRows:2 error:&error], 0);
+    [rs close];
+}
+
+- (void)testFetchColumnsRejectsBadBuffers
+{
+    [_db executeUpdate:@"INSERT INTO person (id, name) VALUES (1, 'Ann')"];
+
+    int64_t ids[1];
+    YFColumnBuffer column = { .columnIndex = 5, .type = YFColumnBufferTypeInt64, .values = ids };
+
+    NSError *error = nil;
+    YFResultSet *rs = [_db executeQuery:@"SELECT id FROM person"];
+
+    XCTAssertEqual([rs fetchColumnsInto:&column count:1 maxRows:1 error:&error], -1);
+    XCTAssertEqual([error code], SQLITE_RANGE);
+
+    column.columnIndex = 0;
+    error = nil;
+    XCTAssertEqual([rs fetchColumnsInto:&column count:1 maxRows:0 error:&error], -1);
+    XCTAssertEqual([error code], SQLITE_MISUSE);
+
+    // neither failure stepped the result set
+    XCTAssertTrue([rs next]);
+    XCTAssertEqual([rs intForColumnIndex:0], 1);
+    [rs close];
+}
+
+- (void)testFetchColumnsLeavesTooBigRowCurrent
+{
+    [_db executeUpdate:@"INSERT INTO person (id, name) VALUES (1, 'a name longer than the buffer')"];
+
+    uint8_t names[4];
+    size_t nameOffsets[2];
+    YFColumnBuffer column = { .columnIndex = 0, .type = YFColumnBufferTypeText, .bytes = names, .bytesCapacity = sizeof(names), .offsets = nameOffsets };
+
+    NSError *error = nil;
+    YFResultSet *rs = [_db executeQuery:@"SELECT name FROM person"];
+
+    XCTAssertEqual([rs fetchColumnsInto:&column count:1 maxRows:1 error:&error], -1);
+    XCTAssertEqual([error code], SQLITE_TOOBIG);
+    XCTAssertTrue([rs next]);
+    XCTAssertEqualObjects([rs stringForColumnIndex:0], @"a name longer than the buffer");
+    [rs close];
+}
+
+#pragma mark Column names
+
+- (void)testColumnIndexForName
+{
+    [_db executeUpdate:@"INSERT INTO person (id, name) VALUES (1, 'Ann')"];
+
+    YFResultSet *rs = [_db executeQuery:@"SELECT id, name AS Name FROM person"];
+    XCTAssertTrue([rs next]);
+    XCTAssertEqual([rs columnIndexForName:@"Name"], 1);
+    XCTAssertEqual([rs columnIndexForName:@"NAME"], 1);
+    XCTAssertEqual([rs columnIndexForName:@"missing"], -1);
+    XCTAssertEqualObjects([rs stringForColumn:@"name"], @"Ann");
+
+    // the map handed out is the caller's own copy
+    [[rs columnNameToIndexMap] removeAllObjects];
+    XCTAssertEqual([rs columnIndexForName:@"id"], 0);
+    [rs close];
+}
+
+- (void)testColumnNamesFollowSchemaChange
+{
+    [_db setShouldCacheStatements:YES];
+    [_db executeUpdate:@"INSERT INTO person (id, name) VALUES (1, 'Ann')"];
+
+    YFResultSet *rs = [_db executeQuery:@"SELECT * FROM person"];
+    XCTAssertTrue([rs next]);
+    XCTAssertEqual([rs columnIndexForName:@"nickname"], -1);
+    [rs close];
+
+    XCTAssertTrue([_db executeUpdate:@"ALTER TABLE person ADD COLUMN nickname TEXT DEFAULT 'A'"]);
+
+    // the cached statement is prepared again by SQLite and now has the new column
+    rs = [_db executeQuery:@"SELECT * FROM person"];
+    XCTAssertTrue([rs next]);
+    XCTAssertEqual([rs columnIndexForName:@"nickname"], 3);
+    XCTAssertEqualObjects([rs stringForColumn:@"nickname"], @"A");
+    [rs close];
+}
+
+#pragma mark Row mapper
+
+- (void)testRowMapperFillsObjects
+{
+    [_db executeBatch:@"INSERT INTO person (id, name, score) VALUES (?, ?, ?)" rows:@[@[@1, @"Ann", @1.5], @[@2, @"Bob", [NSNull null]]] error:nil];
+
+    YFResultSet *rs = [_db executeQuery:@"SELECT id AS identifier, name, score, id * 10 AS Rank FROM person ORDER BY id"];
+    NSArray<YFTestPerson *> *people = [[YFRowMapper mapperForClass:[YFTestPerson class]] objectsFromResultSet:rs];
+
+    XCTAssertEqual([people count], 2u);
+    XCTAssertEqual(people[0].identifier, 1);
+    XCTAssertEqualObjects(people[0].name, @"Ann");
+    XCTAssertEqualWithAccuracy(people[0].score, 1.5, 0.0001);
+    XCTAssertEqualObjects(people[1].rank, @20);
+    // NULL leaves the property alone
+    XCTAssertEqual(people[1].score, 0);
+}
+
+- (void)testRowMapperNotifiesObservers
+{
+    [_db executeUpdate:@"INSERT INTO person (id, name, score) VALUES (1, 'Ann', 2)"];
+
+    YFTestPerson *person = [[YFTestPerson alloc] init];
+    YFTestObserver *observer = [[YFTestObserver alloc] init];
+    observer.changedKeys = [NSMutableArray array];
+    [person addObserver:observer forKeyPath:@"name" options:NSKeyValueObservingOptionNew context:NULL];
+
+    YFResultSet *rs = [_db executeQuery:@"SELECT name, score FROM person"];
+    XCTAssertTrue([rs next]);
+    [[YFRowMapper mapperForClass:[YFTestPerson class]] fillObject:person fromResultSet:rs];
+    [rs close];
+
+    [person removeObserver:observer forKeyPath:@"name"];
+
+    XCTAssertEqualObjects(person.name, @"Ann");
+    XCTAssertEqualObjects(observer.changedKeys, @[@"name"]);
+}
+
+- (void)testRowMapperFollowsColumnChangesOfAQuery
+{
+#if SQLITE_VERSION_NUMBER >= 3025000
+    [_db setShouldCacheStatements:YES];
+    [_db executeUpdate:@"INSERT INTO person (id, name, score) VALUES (1, 'Ann', 2)"];
+    YFRowMapper *mapper = [YFRowMapper mapperForClass:[YFTestPerson class]];
+
+    YFResultSet *rs = [_db executeQuery:@"SELECT * FROM person"];
+    XCTAssertTrue([rs next]);
+    XCTAssertEqualObjects([(YFTestPerson *)[mapper objectFromResultSet:rs] name], @"Ann");
+    [rs close];
+
+    // the same SQL now has different columns, so the cached plan must not be reused
+    XCTAssertTrue([_db executeUpdate:@"ALTER TABLE person RENAME COLUMN score TO rank"]);
+
+    rs = [_db executeQuery:@"SELECT * FROM person"];
+    XCTAssertTrue([rs next]);
+    YFTestPerson *person = [mapper objectFromResultSet:rs];
+    [rs close];
+
+    XCTAssertEqualObjects(person.rank, @2);
+    XCTAssertEqual(person.score, 0);
+#endif
+}
+
+#pragma mark Row dictionaries
+
+- (void)testResultDictionaryAndView
+{
+    [_db executeBatch:@"INSERT INTO person (id, name) VALUES (?, ?)" rows:@[@[@1, @"Ann"], @[@2, @"Bob"]] error:nil];
+
+    YFResultSet *rs = [_db executeQuery:@"SELECT id, name, score FROM person ORDER BY id"];
+    XCTAssertTrue([rs next]);
+
+    NSDictionary *row = [rs resultDictionary];
+    XCTAssertEqualObjects(row, (@{@"id" : @1, @"name" : @"Ann", @"score" : [NSNull null]}));
+
+    NSDictionary *view = [rs resultDictionaryView];
+    NSDictionary *snapshot = [view copy];
+    XCTAssertEqualObjects(view[@"name"], @"Ann");
+    XCTAssertEqual([view count], 3u);
+
+    XCTAssertTrue([rs next]);
+    XCTAssertTrue([rs resultDictionaryView] == view);
+    XCTAssertEqualObjects(view[@"name"], @"Bob");
+    XCTAssertEqualObjects(snapshot[@"name"], @"Ann");
+    [rs close];
+}
+
+- (void)testExecuteStatementsRowsOutliveTheBlock
+{
+    NSMutableArray<NSDictionary *> *rows = [NSMutableArray array];
+    __block NSUInteger looked = 0;
+
+    BOOL success = [_db executeStatements:@"INSERT INTO person (id, name) VALUES (1, 'Ann'), (2, 'Bob'); SELECT id, name, score FROM person ORDER BY id; SELECT 'x' AS other" withResultBlock:^int(NSDictionary *row) {
+        if (row[@"name"]) {
+            looked++;
+        }
+        [rows addObject:row];
+        return 0;
+    }];
+
+    XCTAssertTrue(success);
+    XCTAssertEqual(looked, 2u);
+    XCTAssertEqual([rows count], 3u);
+    XCTAssertEqualObjects(rows[0], (@{@"id" : @"1", @"name" : @"Ann", @"score" : [NSNull null]}));
+    XCTAssertEqualObjects(rows[1][@"name"], @"Bob");
+    XCTAssertEqualObjects(rows[2], @{@"other" : @"x"});
+}
+
+#pragma mark Busy handling
+
+- (void)testDefaultBusyPolicySpinsThenBacksOff
+{
+    YFBusyPolicy *policy = [YFBusyPolicy defaultPolicy];
+
+    for (int retry = 0; retry < [policy spinCount]; retry++) {
+        XCTAssertEqual([policy delayForRetry:retry elapsed:0], 0);
+    }
+
+    NSTimeInterval first = [policy delayForRetry:[policy spinCount] elapsed:0];
+    XCTAssertGreaterThanOrEqual(first, [policy initialBackoff] / 2);
+    XCTAssertLessThanOrEqual(first, [policy initialBackoff]);
+    XCTAssertLessThanOrEqual([policy delayForRetry:1000 elapsed:0], [policy maximumBackoff]);
+}
+
+- (void)testBusyHandlerGivesUpAfterTimeout
+{
+    YFDatabase *holder = [YFDatabase databaseWithPath:_poolPath];
+    YFDatabase *waiter = [YFDatabase databaseWithPath:_poolPath];
+    XCTAssertTrue([holder open]);
+    XCTAssertTrue([waiter open]);
+    XCTAssertTrue([holder executeUpdate:@"CREATE TABLE t (n INTEGER)"]);
+
+    [waiter setMaxBusyRetryTimeInterval:0.1];
+
+    XCTAssertTrue([holder beginExclusiveTransaction]);
+    XCTAssertFalse([waiter executeUpdate:@"INSERT INTO t (n) VALUES (1)"]);
+    XCTAssertTrue([holder commit]);
+
+    XCTAssertEqual([waiter busyEventCount], 1u);
+    XCTAssertEqual([waiter busyTimeoutCount], 1u);
+    XCTAssertGreaterThan([waiter busyRetryCount], 0u);
+    XCTAssertGreaterThan([waiter totalBusyWaitTime], 0);
+
+    [holder close];
+    [waiter close];
+}
+
+- (YFDatabaseQueue *)walQueueWithRetries:(NSUInteger)retries
+{
+    YFDatabaseQueue *queue = [YFDatabaseQueue databaseQueueWithPath:_poolPath];
+    [queue setMaximumTransactionRetries:retries];
+    [queue inDatabase:^(YFDatabase *db) {
+        XCTAssertTrue([db executeStatements:@"PRAGMA journal_mode=WAL; CREATE TABLE t (n INTEGER)"]);
+    }];
+    return queue;
+}
+
+- (void)testStaleSnapshotRunsTransactionAgain
+{
+    YFDatabaseQueue *queue = [self walQueueWithRetries:2];
+    YFDatabase *other = [YFDatabase databaseWithPath:_poolPath];
+    XCTAssertTrue([other open]);
+
+    __block int attempts = 0;
+    [queue inDeferredTransaction:^(YFDatabase *db, BOOL *rollback) {
+        attempts++;
+        // the read pins a snapshot, which the other connection's commit makes stale
+        [db intForQuery:@"SELECT count(*) FROM t"];
+        if (attempts == 1) {
+            XCTAssertTrue([other executeUpdate:@"INSERT INTO t (n) VALUES (1)"]);
+        }
+        [db executeUpdate:@"INSERT INTO t (n) VALUES (2)"];
+    }];
+
+    XCTAssertEqual(attempts, 2);
+    XCTAssertEqual([other intForQuery:@"SELECT count(*) FROM t"], 2);
+
+    [other close];
+    [queue close];
+}
 
+- (void)testStaleSnapshotWithoutRetriesLeavesCommitToTheBlock
+{
+    YFDatabaseQueue *queue = [self walQueueWithRetries:0];
+    YFDatabase *other = [YFDatabase databaseWithPath:_poolPath];
+    XCTAssertTrue([other open]);
+
+    __block int attempts = 0;
+    __block BOOL wrote = YES;
+    [queue inDeferredTransaction:^(YFDatabase *db, BOOL *rollback) {
+        attempts++;
+        [db intForQuery:@"SELECT count(*) FROM t"];
+        XCTAssertTrue([other executeUpdate:@"INSERT INTO t (n) VALUES (1)"]);
+        wrote = [db executeUpdate:@"INSERT INTO t (n) VALUES (2)"];
+    }];
+
+    XCTAssertEqual(attempts, 1);
+    XCTAssertFalse(wrote);
+    XCTAssertEqual([other intForQuery:@"SELECT count(*) FROM t"], 1);
+
+    [other close];
+    [queue close];
+}
+
+#pragma mark Profiler
+
+- (YFQueryStatistics *)statisticsForQuery:(NSString *)query inSnapshot:(YFProfilerSnapshot *)snapshot
+{
+    for (YFQueryStatistics *statistics in [snapshot queries]) {
+        if ([[statistics query] isEqualToString:query]) {
+            return statistics;
+        }
+    }
+    return nil;
+}
+
+- (void)testProfilerCountsRunsAndRows
+{
+#if SQLITE_VERSION_NUMBER >= 3014000
+    [_db executeBatch:@"INSERT INTO person (id, name) VALUES (?, ?)" rows:@[@[@1, @"Ann"], @[@2, @"Bob"]] error:nil];
+
+    YFDatabaseProfiler *profiler = [[YFDatabaseProfiler alloc] init];
+    [_db setProfiler:profiler];
+
+    NSString *query = @"SELECT name FROM person WHERE name LIKE 'A%' OR id > 0";
+    for (int i = 0; i < 3; i++) {
+        YFResultSet *rs = [_db executeQuery:query];
+        while ([rs next]) {}
+        [rs close];
+    }
+
+    YFQueryStatistics *statistics = [self statisticsForQuery:query inSnapshot:[profiler snapshot]];
+    XCTAssertNotNil(statistics);
+    XCTAssertEqual([statistics callCount], 3u);
+    XCTAssertEqual([statistics rowCount], 6ull);
+    XCTAssertGreaterThan([statistics fullScanStepCount], 0ull);
+    XCTAssertGreaterThanOrEqual([statistics maximumTime], [statistics medianTime]);
+
+    [profiler reset];
+    XCTAssertEqual([[[profiler snapshot] queries] count], 0u);
+
+    [_db setProfiler:nil];
+#endif
+}
+
+- (void)testProfilerLogsSlowQueries
+{
+#if SQLITE_VERSION_NUMBER >= 3014000
+    YFDatabaseProfiler *profiler = [[YFDatabaseProfiler alloc] init];
+    [profiler setSlowQueryThreshold:0.001];
+    [profiler setMaximumSlowQueryCount:2];
+    [profiler setLogsExpandedSQL:YES];
+
+    NSMutableArray<NSString *> *handled = [NSMutableArray array];
+    [profiler setSlowQueryHandler:^(YFSlowQuery *slowQuery) {
+        [handled addObject:[slowQuery query]];
+    }];
+    [_db setProfiler:profiler];
+
+    // SQLite times statements to the millisecond, so they have to be slow for real
+    NSString *query = @"WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c WHERE x < ?) SELECT count(*) FROM c";
+    for (int i = 0; i < 3; i++) {
+        XCTAssertEqual([_db intForQuery:query, @(500000 + i)], 500000 + i);
+    }
+
+    NSArray<YFSlowQuery *> *slowQueries = [[profiler snapshot] slowQueries];
+    XCTAssertEqual([slowQueries count], 2u);
+    XCTAssertTrue([[[slowQueries lastObject] query] containsString:@"x < 500002"]);
+    XCTAssertEqual([handled count], 3u);
+
+    [_db setProfiler:nil];
+#endif
+}
+
+#pragma mark Mixed workload
+
+- (void)testReadWritePoolMixedWorkloadFromManyThreads
+{
+    YFDatabaseReadWritePool *pool = [[YFDatabaseReadWritePool alloc] initWithPath:_poolPath maximumNumberOfReaders:3];
+    [[pool readerPool] setCheckoutTimeout:5];
+    [pool inWriteDatabase:^(YFDatabase *db) {
+        XCTAssertTrue([db executeUpdate:@"CREATE TABLE t (n INTEGER)"]);
+    }];
+
+    // the shape of a stress run: writers append, readers count, each on its own thread
+    dispatch_group_t group = dispatch_group_create();
+    __block BOOL countsOnlyGrew = YES;
+    for (int thread = 0; thread < 8; thread++) {
+        dispatch_group_async(group, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            int lastCount = 0;
+            for (int i = 0; i < 25; i++) {
+                if (thread % 2 == 0) {
+                    [pool inWriteTransaction:^(YFDatabase *db, BOOL *rollback) {
+                        [db executeUpdate:@"INSERT INTO t (n) VALUES (?)", @(thread * 100 + i)];
+                    }];
+                }
+                else {
+                    __block int count = 0;
+                    [pool inReadDatabase:^(YFDatabase *db) {
+                        count = [db intForQuery:@"SELECT count(*) FROM t"];
+                    }];
+                    if (count < lastCount) {
+                        countsOnlyGrew = NO;
+                    }
+                    lastCount = count;
+                }
+            }
+        });
+    }
+
+    XCTAssertEqual(dispatch_group_wait(group, dispatch_time(DISPATCH_TIME_NOW, 30 * NSEC_PER_SEC)), 0);
+    XCTAssertTrue(countsOnlyGrew);
+    XCTAssertLessThanOrEqual([[pool readerPool] highWaterMarkOfCheckedOutDatabases], 3u);
+    XCTAssertEqual([[pool readerPool] countOfCheckoutTimeouts], 0u);
+
+    __block int total = 0;
+    __block NSUInteger busyTimeouts = 0;
+    [pool inWriteDatabase:^(YFDatabase *db) {
+        total = [db intForQuery:@"SELECT count(*) FROM t"];
+        busyTimeouts = [db busyTimeoutCount];
+    }];
+    XCTAssertEqual(total, 100);
+    XCTAssertEqual(busyTimeouts, 0u);
+
+    [pool close];
+}
+
+#pragma mark Result cache
+
+- (void)testResultCacheHitsUntilTheTableChanges
+{
+    YFQueryResultCache *cache = [[YFQueryResultCache alloc] init];
+    [_db setResultCache:cache];
+    [_db executeUpdate:@"INSERT INTO person (id, name) VALUES (1, 'Ann')"];
+
+    NSString *query = @"SELECT name FROM person WHERE id = ?";
+    NSArray *first = [_db executeCachedQuery:query withArgumentsInArray:@[@1] error:nil];
+    NSArray *second = [_db executeCachedQuery:query withArgumentsInArray:@[@1] error:nil];
+    XCTAssertEqualObjects([[first firstObject] objectForKey:@"name"], @"Ann");
+    XCTAssertEqualObjects(first, second);
+    XCTAssertEqual([cache hitCount], 1u);
+    XCTAssertEqual([cache missCount], 1u);
+
+    XCTAssertTrue([_db executeUpdate:@"UPDATE person SET name = 'Bob' WHERE id = 1"]);
+    NSArray *third = [_db executeCachedQuery:query withArgumentsInArray:@[@1] error:nil];
+    XCTAssertEqualObjects([[third firstObject] objectForKey:@"name"], @"Bob");
+    XCTAssertEqual([cache invalidationCount], 1u);
+
+    [_db setResultCache:nil];
+}
+
+- (void)testResultCacheSkipsFunctionsNotKnownToBeDeterministic
+{
+    YFQueryResultCache *cache = [[YFQueryResultCache alloc] init];
+    [_db setResultCache:cache];
+
+    __block long long ticks = 0;
+    [_db makeFunctionNamed:@"my_now" arguments:0 block:^(void *context, int argc, void **argv) {
+        sqlite3_result_int64(context, ++ticks);
+    }];
+
+    NSArray *first = [_db executeCachedQuery:@"SELECT my_now() AS t" withArgumentsInArray:nil error:nil];
+    NSArray *second = [_db executeCachedQuery:@"SELECT my_now() AS t" withArgumentsInArray:nil error:nil];
+    XCTAssertEqualObjects([[first firstObject] objectForKey:@"t"], @1);
+    XCTAssertEqualObjects([[second firstObject] objectForKey:@"t"], @2);
+
+    [_db executeCachedQuery:@"SELECT random() AS r" withArgumentsInArray:nil error:nil];
+    XCTAssertEqual([cache count], 0u);
+    XCTAssertEqual([cache uncacheableCount], 3u);
+
+    // declared deterministic, the same function may be cached
+    XCTAssertTrue([_db makeScalarFunctionNamed:@"my_now" arguments:0 options:YFFunctionOptionsDeterministic block:^(YFFunctionContext *context) {
+        [context resultInt64:++ticks];
+    } error:nil]);
+
+    NSArray *third = [_db executeCachedQuery:@"SELECT my_now() AS t" withArgumentsInArray:nil error:nil];
+    NSArray *fourth = [_db executeCachedQuery:@"SELECT my_now() AS t" withArgumentsInArray:nil error:nil];
+    XCTAssertEqualObjects(third, fourth);
+    XCTAssertEqual([cache count], 1u);
+
+    [_db setResultCache:nil];
+}
+
+- (void)testResultCacheProbesDoNotExpireCachedStatements
+{
+#if SQLITE_VERSION_NUMBER >= 3020000
+    [_db setShouldCacheStatements:YES];
+    [_db executeUpdate:@"INSERT INTO person (id, name) VALUES (1, 'Ann')"];
+
+    YFQueryResultCache *cache = [[YFQueryResultCache alloc] init];
+    [_db setResultCache:cache];
+
+    YFResultSet *rs = [_db executeQuery:@"SELECT name FROM person"];
+    while ([rs next]) {}
+    sqlite3_stmt *pStmt = [[rs statement] statement];
+    [rs close];
+
+    // each new query is probed under the authorizer
+    for (int i = 0; i < 3; i++) {
+        NSString *query = [NSString stringWithFormat:@"SELECT count(*) AS n FROM person WHERE id > %d", i];
+        XCTAssertNotNil([_db executeCachedQuery:query withArgumentsInArray:nil error:nil]);
+    }
+    XCTAssertEqual([cache count], 3u);
+
+    rs = [_db executeQuery:@"SELECT name FROM person"];
+    XCTAssertTrue([rs next]);
+    XCTAssertEqualObjects([rs stringForColumnIndex:0], @"Ann");
+    XCTAssertEqual([[rs statement] statement], pStmt);
+    XCTAssertEqual(sqlite3_stmt_status(pStmt, SQLITE_STMTSTATUS_REPREPARE, 0), 0);
+    [rs close];
+
+    [_db setResultCache:nil];
+#endif
+}
+
+#pragma mark Blob handles
+
+- (NSData *)patternOfLength:(NSUInteger)length
+{
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    uint8_t *bytes = [data mutableBytes];
+    for (NSUInteger i = 0; i < length; i++) {
+        bytes[i] = (uint8_t)(i * 7);
+    }
+    return data;
+}
+
+- (void)testBlobHandleFillsAReservedZeroBlobThroughStreams
+{
+    XCTAssertTrue([_db executeUpdate:@"CREATE TABLE attachment (id INTEGER PRIMARY KEY, body BLOB)"]);
+    XCTAssertTrue([_db executeUpdate:@"INSERT INTO attachment (body) VALUES (?)", [YFZeroBlob zeroBlobWithLength:100000]]);
+    int64_t rowid = [_db lastInsertRowId];
+
+    NSError *error = nil;
+    YFBlobHandle *blob = [_db openBlobInTable:@"attachment" column:@"body" row:rowid writable:YES error:&error];
+    XCTAssertNotNil(blob, @"%@", error);
+    XCTAssertEqual([blob length], 100000u);
+
+    // a buffer much smaller than the blob, so the copy takes many passes
+    NSData *payload = [self patternOfLength:100000];
+    XCTAssertTrue([blob copyFromInputStream:[NSInputStream inputStreamWithData:payload] toOffset:0 bufferSize:4096 error:&error], @"%@", error);
+
+    NSOutputStream *output = [NSOutputStream outputStreamToMemory];
+    XCTAssertTrue([blob copyToOutputStream:output bufferSize:4096 error:&error], @"%@", error);
+    XCTAssertEqualObjects([output propertyForKey:NSStreamDataWrittenToMemoryStreamKey], payload);
+
+    NSData *tail = [blob readDataOfLength:100 atOffset:99950 error:&error];
+    XCTAssertEqualObjects(tail, [payload subdataWithRange:NSMakeRange(99950, 50)]);
+    [blob close];
+
+    XCTAssertEqualObjects([_db dataForQuery:@"SELECT body FROM attachment WHERE id = ?", @(rowid)], payload);
+}
+
+- (void)testBlobHandleStreamAdapters
+{
+    XCTAssertTrue([_db executeUpdate:@"CREATE TABLE attachment (id INTEGER PRIMARY KEY, body BLOB)"]);
+    XCTAssertTrue([_db executeUpdate:@"INSERT INTO attachment (id, body) VALUES (1, ?)", [YFZeroBlob zeroBlobWithLength:10]]);
+
+    YFBlobHandle *blob = [_db openBlobInTable:@"attachment" column:@"body" row:1 writable:YES error:nil];
+    NSOutputStream *output = [blob outputStream];
+    [output open];
+    XCTAssertEqual([output write:(const uint8_t *)"0123456789abc" maxLength:13], 10);
+    XCTAssertEqual([output write:(const uint8_t *)"d" maxLength:1], 0);
+    [output close];
+
+    NSInputStream *input = [blob inputStream];
+    [input open];
+    uint8_t buffer[4];
+    NSMutableData *read = [NSMutableData data];
+    NSInteger count;
+    while ((count = [input read:buffer maxLength:sizeof(buffer)]) > 0) {
+        [read appendBytes:buffer length:(NSUInteger)count];
+    }
+    [input close];
+    XCTAssertEqual(count, 0);
+    XCTAssertEqualObjects(read, [@"0123456789" dataUsingEncoding:NSUTF8StringEncoding]);
+
+    [blob close];
+}
+
+- (void)testBlobHandleRejectsBadWritesAndMovesBetweenRows
+{
+    XCTAssertTrue([_db executeUpdate:@"CREATE TABLE attachment (id INTEGER PRIMARY KEY, body BLOB)"]);
+    XCTAssertTrue([_db executeUpdate:@"INSERT INTO attachment (id, body) VALUES (1, X'0102'), (2, X'030405')"]);
+
+    NSError *error = nil;
+    YFBlobHandle *blob = [_db openBlobInTable:@"attachment" column:@"body" row:1 writable:NO error:&error];
+    XCTAssertNotNil(blob, @"%@", error);
+    XCTAssertFalse([blob isWritable]);
+    XCTAssertFalse([blob writeBytes:"x" length:1 atOffset:0 error:&error]);
+    XCTAssertNotNil(error);
+
+    uint8_t bytes[3];
+    error = nil;
+    XCTAssertFalse([blob readBytes:bytes length:3 atOffset:0 error:&error]);
+    XCTAssertNotNil(error);
+
+    XCTAssertTrue([blob moveToRow:2 error:&error], @"%@", error);
+    XCTAssertEqual([blob rowid], 2);
+    XCTAssertEqual([blob length], 3u);
+    XCTAssertTrue([blob readBytes:bytes length:3 atOffset:0 error:&error]);
+    XCTAssertEqual(bytes[2], 0x05);
+
+    // changing the row expires the handle
+    XCTAssertTrue([_db executeUpdate:@"UPDATE attachment SET body = X'06' WHERE id = 2"]);
+    error = nil;
+    XCTAssertFalse([blob readBytes:bytes length:1 atOffset:0 error:&error]);
+    XCTAssertEqual([error code], SQLITE_ABORT);
+    [blob close];
+
+    XCTAssertNil([_db openBlobInTable:@"attachment" column:@"body" row:3 writable:NO error:&error]);
+}
+
+#pragma mark Borrowed bytes
+
+- (void)testBorrowedTextComparesAndHashesInPlace
+{
+    [_db executeBatch:@"INSERT INTO person (id, name) VALUES (?, ?)" rows:@[@[@1, @"Ann"], @[@2, @"Zoë"], @[@3, @"Ann"]] error:nil];
+
+    YFResultSet *rs = [_db executeQuery:@"SELECT a.name, b.name, NULL, '', x'00ff' FROM person a JOIN person b ON b.id = a.id + 2"];
+    XCTAssertTrue([rs next]);
+
+    YFBorrowedBytes first = [rs borrowedTextForColumnIndex:0];
+    YFBorrowedBytes third = [rs borrowedTextForColumnIndex:1];
+    XCTAssertEqual(first.length, 3u);
+    XCTAssertTrue(YFBorrowedBytesEqualToUTF8String(first, "Ann"));
+    XCTAssertTrue(YFBorrowedBytesEqualToString(first, @"Ann"));
+    XCTAssertFalse(YFBorrowedBytesEqualToString(first, @"An"));
+    XCTAssertTrue(YFBorrowedBytesEqual(first, third));
+    XCTAssertEqual(YFBorrowedBytesHash(first), YFBorrowedBytesHash(third));
+    XCTAssertEqualObjects(YFBorrowedBytesCopyString(first), @"Ann");
+
+    YFBorrowedBytes null = [rs borrowedTextForColumnIndex:2];
+    YFBorrowedBytes empty = [rs borrowedTextForColumnIndex:3];
+    XCTAssertTrue(YFBorrowedBytesIsNull(null));
+    XCTAssertFalse(YFBorrowedBytesIsNull(empty));
+    XCTAssertEqual(empty.length, 0u);
+    XCTAssertFalse(YFBorrowedBytesEqual(null, empty));
+    XCTAssertEqual(YFBorrowedBytesCompare(null, empty), NSOrderedAscending);
+    XCTAssertEqual(YFBorrowedBytesCompare(empty, first), NSOrderedAscending);
+    XCTAssertNil(YFBorrowedBytesCopyString(null));
+
+    YFBorrowedBytes blob = [rs borrowedBlobForColumnIndex:4];
+    XCTAssertEqualObjects(YFBorrowedBytesCopyData(blob), [NSData dataWithBytes:"\x00\xff" length:2]);
+
+    [rs close];
+}
+
+- (void)testBorrowedTextOrdersLikeBinaryCollation
+{
+    [_db executeBatch:@"INSERT INTO person (id, name) VALUES (?, ?)" rows:@[@[@1, @"ab"], @[@2, @"abc"], @[@3, @"b"], @[@4, @"Zoë"]] error:nil];
+
+    // every pair of rows, with SQLite's own answer next to them
+    YFResultSet *rs = [_db executeQuery:@"SELECT a.name, b.name, (a.name > b.name) - (a.name < b.name) FROM person a, person b"];
+    int pairs = 0;
+    while ([rs next]) {
+        NSComparisonResult expected = (NSComparisonResult)[rs intForColumnIndex:2];
+        YFBorrowedBytes a = [rs borrowedTextForColumnIndex:0];
+        YFBorrowedBytes b = [rs borrowedTextForColumnIndex:1];
+        XCTAssertEqual(YFBorrowedBytesCompare(a, b), expected);
+        pairs++;
+    }
+    [rs close];
+
+    XCTAssertEqual(pairs, 16);
+}
+
+- (void)testBorrowedViewGoesStaleWhenTheRowAdvances
+{
+    [_db executeBatch:@"INSERT INTO person (id, name) VALUES (?, ?)" rows:@[@[@1, @"Ann"], @[@2, @"Bob"]] error:nil];
+
+    YFResultSet *rs = [_db executeQuery:@"SELECT name FROM person ORDER BY id"];
+    XCTAssertTrue([rs next]);
+    YFBorrowedBytes view = [rs borrowedTextForColumnIndex:0];
+    XCTAssertTrue(YFBorrowedBytesIsValid(view));
+
+    XCTAssertTrue([rs next]);
+    YFBorrowedBytes next = [rs borrowedTextForColumnIndex:0];
+    XCTAssertTrue(YFBorrowedBytesIsValid(next));
+    XCTAssertTrue(YFBorrowedBytesEqualToUTF8String(next, "Bob"));
+
+    [rs close];
+
+    // rows are only tracked in debug builds
+#if defined(DEBUG) && DEBUG
+    XCTAssertFalse(YFBorrowedBytesIsValid(view));
+    XCTAssertFalse(YFBorrowedBytesIsValid(next));
+#endif
+
+    // a bad column index gives a NULL view instead of reading out of bounds
+    rs = [_db executeQuery:@"SELECT name FROM person"];
+    XCTAssertTrue([rs next]);
+    XCTAssertTrue(YFBorrowedBytesIsNull([rs borrowedTextForColumnIndex:5]));
+    [rs close];
+}
+
+#pragma mark Date codec
+
+- (void)testDateCodecFormatsAndParsesISO8601
+{
+    char buffer[YFDateISO8601Length + 1];
+    XCTAssertEqual(YFDateFormatISO8601(1698798600.25, buffer), (NSUInteger)YFDateISO8601Length);
+    XCTAssertEqual(strcmp(buffer, "2023-11-01T00:30:00.250Z"), 0);
+
+    NSTimeInterval interval = 0;
+    const char *offset = "2023-11-01T08:30:00+08:00";
+    XCTAssertTrue(YFDateParseISO8601(offset, strlen(offset), &interval));
+    XCTAssertEqualWithAccuracy(interval, 1698798600, 0.0001);
+
+    const char *sqlite = "2023-11-01 00:30:00";
+    XCTAssertTrue(YFDateParseISO8601(sqlite, strlen(sqlite), &interval));
+    XCTAssertEqualWithAccuracy(interval, 1698798600, 0.0001);
+
+    const char *garbage = "2023-13-01";
+    interval = 42;
+    XCTAssertFalse(YFDateParseISO8601(garbage, strlen(garbage), &interval));
+    XCTAssertEqual(interval, 42);
+}
+
+- (void)testDateStorageRoundTrips
+{
+    NSDate *date = [NSDate dateWithTimeIntervalSince1970:1698798600];
+    XCTAssertTrue([_db executeUpdate:@"CREATE TABLE event (at)"]);
+
+    [_db setDateStorage:YFDateStorageISO8601];
+    XCTAssertTrue([_db executeUpdate:@"INSERT INTO event (at) VALUES (?)", date]);
+    XCTAssertEqualObjects([_db stringForQuery:@"SELECT at FROM event"], @"2023-11-01T00:30:00.000Z");
+    XCTAssertEqualObjects([_db dateForQuery:@"SELECT at FROM event"], date);
+
+    [_db executeUpdate:@"DELETE FROM event"];
+
+    [_db setDateStorage:YFDateStorageEpochMilliseconds];
+    XCTAssertTrue([_db executeUpdate:@"INSERT INTO event (at) VALUES (?)", date]);
+    XCTAssertEqual([_db longForQuery:@"SELECT at FROM event"], 1698798600000L);
+    XCTAssertEqualObjects([_db dateForQuery:@"SELECT at FROM event"], date);
+}
+
+- (void)testDateCodecHandlesDatesBefore1970
+{
+    char buffer[YFDateISO8601Length + 1];
+    XCTAssertEqual(YFDateFormatISO8601(-0.5, buffer), (NSUInteger)YFDateISO8601Length);
+    XCTAssertEqual(strcmp(buffer, "1969-12-31T23:59:59.500Z"), 0);
+
+    NSTimeInterval interval = 0;
+    XCTAssertTrue(YFDateParseISO8601(buffer, strlen(buffer), &interval));
+    XCTAssertEqualWithAccuracy(interval, -0.5, 0.0001);
+
+    XCTAssertEqual(YFDateEpochMillisecondsFromTimeInterval(-0.0004), 0);
+    XCTAssertEqual(YFDateEpochMillisecondsFromTimeInterval(1.0006), 1001);
+    XCTAssertEqualWithAccuracy(YFDateTimeIntervalFromEpochMilliseconds(-1500), -1.5, 0.0001);
+}
+
+- (void)testDateStorageReadsRowsStoredInOtherModes
+{
+    NSDate *date = [NSDate dateWithTimeIntervalSince1970:1698798600];
+    XCTAssertTrue([_db executeUpdate:@"CREATE TABLE event (id INTEGER PRIMARY KEY, at)"]);
+
+    // a REAL timestamp from the default mode, SQLite's own text, and milliseconds
+    XCTAssertTrue([_db executeUpdate:@"INSERT INTO event (id, at) VALUES (1, ?)", date]);
+    XCTAssertTrue([_db executeUpdate:@"INSERT INTO event (id, at) VALUES (2, datetime(1698798600, 'unixepoch'))"]);
+    XCTAssertTrue([_db executeUpdate:@"INSERT INTO event (id, at) VALUES (3, 'not a date')"]);
+
+    [_db setDateStorage:YFDateStorageEpochMilliseconds];
+    XCTAssertTrue([_db executeUpdate:@"INSERT INTO event (id, at) VALUES (4, ?)", date]);
+
+    for (NSNumber *storage in @[@(YFDateStorageISO8601), @(YFDateStorageEpochMilliseconds)]) {
+        [_db setDateStorage:[storage integerValue]];
+        XCTAssertEqualObjects([_db dateForQuery:@"SELECT at FROM event WHERE id = 1"], date);
+        XCTAssertEqualObjects([_db dateForQuery:@"SELECT at FROM event WHERE id = 2"], date);
+        XCTAssertNil([_db dateForQuery:@"SELECT at FROM event WHERE id = 3"]);
+    }
+
+    [_db setDateStorage:YFDateStorageEpochMilliseconds];
+    XCTAssertEqualObjects([_db dateForQuery:@"SELECT at FROM event WHERE id = 4"], date);
+}
+
+#pragma mark Scripts
+
+- (int)countOfLiveStatements
+{
+    int count = 0;
+    sqlite3 *handle = [_db sqliteHandle];
+    for (sqlite3_stmt *pStmt = sqlite3_next_stmt(handle, 0x00); pStmt; pStmt = sqlite3_next_stmt(handle, pStmt)) {
+        count++;
+    }
+    return count;
+}
+
+- (void)testScriptBindsParametersAndDeliversTypedRows
+{
+    NSString *script = @"CREATE TABLE tag (name TEXT, weight INTEGER);"
+                       @"INSERT INTO tag VALUES (:name, :weight), ('other', ?3);"
+                       @"SELECT name, weight FROM tag ORDER BY name;";
+
+    NSMutableArray *rows = [NSMutableArray array];
+    NSError *error = nil;
+    BOOL ok = [_db executeScript:script withParameterDictionary:@{@"name": @"alpha", @"weight": @3, @"3": @7} rowBlock:^BOOL(YFPreparedStatement *statement, NSUInteger statementIndex) {
+        [rows addObject:@[@(statementIndex), [statement stringForColumnIndex:0], @([statement int64ForColumnIndex:1])]];
+        return YES;
+    } error:&error];
+
+    XCTAssertTrue(ok, @"%@", error);
+    NSArray *expected = @[@[@2, @"alpha", @3], @[@2, @"other", @7]];
+    XCTAssertEqualObjects(rows, expected);
+}
+
+- (void)testScriptKeepsItsPreparedStatementsWithoutTheStatementCache
+{
+    XCTAssertFalse([_db shouldCacheStatements]);
+    int baseline = [self countOfLiveStatements];
+
+    NSString *script = @"INSERT INTO person (name) VALUES (:name); UPDATE person SET score = 1 WHERE name = :name; -- done";
+    XCTAssertTrue([_db executeScript:script withParameterDictionary:@{@"name": @"Ann"} rowBlock:nil error:nil]);
+    XCTAssertEqual([self countOfLiveStatements], baseline + 2);
+
+    // the second run reuses those two statements instead of preparing new ones
+    XCTAssertTrue([_db executeScript:script withParameterDictionary:@{@"name": @"Bob"} rowBlock:nil error:nil]);
+    XCTAssertEqual([self countOfLiveStatements], baseline + 2);
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM person WHERE score = 1"], 2);
+
+    [_db clearCachedStatements];
+    XCTAssertEqual([self countOfLiveStatements], baseline);
+}
+
+- (void)testScriptStopsWhenTheRowBlockSaysSo
+{
+    NSString *script = @"SELECT 1 UNION ALL SELECT 2; INSERT INTO person (name) VALUES ('Ann');";
+
+    __block int rows = 0;
+    NSError *error = nil;
+    BOOL ok = [_db executeScript:script withParameterDictionary:nil rowBlock:^BOOL(YFPreparedStatement *statement, NSUInteger statementIndex) {
+        rows++;
+        return NO;
+    } error:&error];
+
+    XCTAssertFalse(ok);
+    XCTAssertEqual([error code], SQLITE_ABORT);
+    XCTAssertEqual(rows, 1);
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM person"], 0);
+}
+
+- (void)testScriptRunsAgainFromInsideItsOwnRowBlock
+{
+    NSString *script = @"SELECT count(*) FROM person; INSERT INTO person (name) VALUES ('Ann');";
+
+    // cache the script, then run it again while its first statement is stepping
+    XCTAssertTrue([_db executeScript:script error:nil]);
+
+    __block BOOL nested = NO;
+    __block BOOL nestedOK = NO;
+    BOOL ok = [_db executeScript:script withParameterDictionary:nil rowBlock:^BOOL(YFPreparedStatement *statement, NSUInteger statementIndex) {
+        if (!nested) {
+            nested = YES;
+            nestedOK = [self->_db executeScript:script error:nil];
+        }
+        return YES;
+    } error:nil];
+
+    XCTAssertTrue(ok);
+    XCTAssertTrue(nestedOK);
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM person"], 3);
+}
+
+#pragma mark Format templates
+
+- (void)testFormatBindsEachArgumentType
+{
+    NSString *name = nil;
+    YFResultSet *rs = [_db executeQueryWithFormat:@"SELECT %d, %ld, %lld, %qu, %hi, %u, %f, %g, %s, %c, %@, %@",
+                       -1, 2L, 3000000000LL, 4ULL, (short)5, 6u, 0.25, 1.5f, "seven", 'e', @"nine", name];
+    XCTAssertTrue([rs next]);
+
+    XCTAssertEqual([rs intForColumnIndex:0], -1);
+    XCTAssertEqual([rs longForColumnIndex:1], 2);
+    XCTAssertEqual([rs longLongIntForColumnIndex:2], 3000000000LL);
+    XCTAssertEqual([rs longLongIntForColumnIndex:3], 4);
+    XCTAssertEqual([rs intForColumnIndex:4], 5);
+    XCTAssertEqual([rs intForColumnIndex:5], 6);
+    XCTAssertEqual([rs doubleForColumnIndex:6], 0.25);
+    XCTAssertEqual([rs doubleForColumnIndex:7], 1.5);
+    XCTAssertEqualObjects([rs stringForColumnIndex:8], @"seven");
+    XCTAssertEqualObjects([rs stringForColumnIndex:9], @"e");
+    XCTAssertEqualObjects([rs stringForColumnIndex:10], @"nine");
+    XCTAssertTrue([rs columnIndexIsNull:11]);
+    [rs close];
+}
+
+- (void)testFormatKeepsLiteralPercentSigns
+{
+    XCTAssertTrue([_db executeUpdateWithFormat:@"INSERT INTO person (id, name) VALUES (%d, %@)", 1, @"Ann"]);
+    XCTAssertTrue([_db executeUpdateWithFormat:@"INSERT INTO person (id, name) VALUES (%d, %@)", 2, @"Bob"]);
+
+    YFResultSet *rs = [_db executeQueryWithFormat:@"SELECT id FROM person WHERE name LIKE 'A%%' AND id > %d", 0];
+    XCTAssertTrue([rs next]);
+    XCTAssertEqual([rs intForColumnIndex:0], 1);
+    XCTAssertFalse([rs next]);
+    [rs close];
+}
+
+- (void)testFormatSharesOneCachedStatement
+{
+    [_db setShouldCacheStatements:YES];
+
+    for (int i = 0; i < 3; i++) {
+        XCTAssertTrue([_db executeUpdateWithFormat:@"INSERT INTO person (id, name, score) VALUES (%d, %@, %f)", i, @"Ann", i * 0.5]);
+    }
+
+    YFStatementCache *cache = [_db statementCache];
+    XCTAssertEqual([cache missCount], 1u);
+    XCTAssertEqual([cache hitCount], 2u);
+    XCTAssertEqual([_db doubleForQuery:@"SELECT sum(score) FROM person"], 1.5);
+}
+
+#pragma mark Functions
+
+- (void)testScalarFunction
+{
+    NSError *error = nil;
+    BOOL made = [_db makeScalarFunctionNamed:@"twice" arguments:1 options:YFFunctionOptionsDeterministic block:^(YFFunctionContext *context) {
+        if ([context isNullAtIndex:0]) {
+            return;
+        }
+        [context resultInt64:[context int64AtIndex:0] * 2];
+    } error:&error];
+
+    XCTAssertTrue(made, @"%@", error);
+    XCTAssertEqual([_db intForQuery:@"SELECT twice(21)"], 42);
+    XCTAssertNil([_db stringForQuery:@"SELECT twice(NULL)"]);
+}
+
+- (void)testAggregateFunction
+{
+    [_db executeBatch:@"INSERT INTO person (id, name, score) VALUES (?, ?, ?)" rows:@[@[@1, @"Ann", @2], @[@2, @"Bob", @3], @[@3, @"Cid", @4]] error:nil];
+
+    NSError *error = nil;
+    BOOL made = [_db makeAggregateFunctionNamed:@"product" arguments:1 options:YFFunctionOptionsDeterministic step:^(YFFunctionContext *context, id __strong *state) {
+        double value = [context doubleAtIndex:0];
+        *state = @(*state ? [*state doubleValue] * value : value);
+    } final:^(YFFunctionContext *context, NSNumber *state) {
+        [context resultObject:state];
+    } error:&error];
+
+    XCTAssertTrue(made, @"%@", error);
+    XCTAssertEqualWithAccuracy([_db doubleForQuery:@"SELECT product(score) FROM person"], 24, 0.0001);
+    XCTAssertNil([_db stringForQuery:@"SELECT product(score) FROM person WHERE id > 3"]);
+}
+
+- (void)testWindowFunctionSlidesItsFrame
+{
+#if SQLITE_VERSION_NUMBER >= 3025000
+    [_db executeBatch:@"INSERT INTO person (id, name, score) VALUES (?, ?, ?)" rows:@[@[@1, @"Ann", @1], @[@2, @"Bob", @2], @[@3, @"Cid", @3], @[@4, @"Dee", @4]] error:nil];
+
+    // a running sum over the current and previous row, kept by step and inverse
+    NSError *error = nil;
+    BOOL made = [_db makeWindowFunctionNamed:@"pair_sum" arguments:1 options:YFFunctionOptionsDeterministic step:^(YFFunctionContext *context, id __strong *state) {
+        *state = @([*state longLongValue] + [context int64AtIndex:0]);
+    } inverse:^(YFFunctionContext *context, id __strong *state) {
+        *state = @([*state longLongValue] - [context int64AtIndex:0]);
+    } value:^(YFFunctionContext *context, NSNumber *state) {
+        [context resultInt64:[state longLongValue]];
+    } final:^(YFFunctionContext *context, NSNumber *state) {
+        [context resultInt64:[state longLongValue]];
+    } error:&error];
+    XCTAssertTrue(made, @"%@", error);
+
+    NSMutableArray *sums = [NSMutableArray array];
+    YFResultSet *rs = [_db executeQuery:@"SELECT pair_sum(score) OVER (ORDER BY id ROWS BETWEEN 1 PRECEDING AND CURRENT ROW) FROM person ORDER BY id"];
+    while ([rs next]) {
+        [sums addObject:@([rs longLongIntForColumnIndex:0])];
+    }
+    [rs close];
+
+    NSArray *expected = @[@1, @3, @5, @7];
+    XCTAssertEqualObjects(sums, expected);
+
+    // the same function as a plain aggregate
+    XCTAssertEqual([_db intForQuery:@"SELECT pair_sum(score) FROM person"], 10);
+#endif
+}
+
+- (void)testOnlyDeterministicFunctionsCanBeIndexed
+{
+    XCTAssertTrue([_db makeScalarFunctionNamed:@"stable_half" arguments:1 options:YFFunctionOptionsDeterministic block:^(YFFunctionContext *context) {
+        [context resultDouble:[context doubleAtIndex:0] / 2];
+    } error:nil]);
+    XCTAssertTrue([_db makeScalarFunctionNamed:@"loose_half" arguments:1 options:YFFunctionOptionsNone block:^(YFFunctionContext *context) {
+        [context resultDouble:[context doubleAtIndex:0] / 2];
+    } error:nil]);
+
+    XCTAssertTrue([_db executeUpdate:@"CREATE INDEX person_half ON person (stable_half(score))"]);
+    XCTAssertFalse([_db executeUpdate:@"CREATE INDEX person_loose ON person (loose_half(score))"]);
+
+    XCTAssertTrue([_db executeUpdate:@"INSERT INTO person (id, name, score) VALUES (1, 'Ann', 8)"]);
+    XCTAssertEqual([_db intForQuery:@"SELECT id FROM person WHERE stable_half(score) = 4"], 1);
+}
+
+- (void)testFunctionErrorsReachTheCaller
+{
+    XCTAssertTrue([_db makeScalarFunctionNamed:@"fail" arguments:0 options:YFFunctionOptionsNone block:^(YFFunctionContext *context) {
+        [context resultError:@"no thanks"];
+    } error:nil]);
+
+    NSError *error = nil;
+    YFResultSet *rs = [_db executeQuery:@"SELECT fail()" values:nil error:&error];
+    XCTAssertFalse([rs nextWithError:&error]);
+    XCTAssertTrue([[error localizedDescription] containsString:@"no thanks"]);
+    [rs close];
+}
+
+#pragma mark Virtual tables
+
+- (void)testArrayTableJoinsOnIndexedColumn
+{
+    [_db executeBatch:@"INSERT INTO person (id, name) VALUES (?, ?)" rows:@[@[@1, @"Ann"], @[@2, @"Bob"]] error:nil];
+
+    // the ids are text, as a CSV import would leave them; the join compares them with INTEGER affinity
+    YFArrayTableProvider *orders = [YFArrayTableProvider providerWithColumnNames:@[@"person_id", @"total"] rows:@[@[@"1", @10], @[@"2", @20], @[@"2", @5]]];
+
+    NSError *error = nil;
+    XCTAssertTrue([_db makeVirtualTableNamed:@"orders" provider:orders error:&error], @"%@", error);
+
+    XCTAssertEqual([_db intForQuery:@"SELECT sum(o.total) FROM person p JOIN orders o ON o.person_id = p.id WHERE p.name = 'Bob'"], 25);
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM orders WHERE person_id = '2'"], 2);
+
+    XCTAssertTrue([_db removeVirtualTableNamed:@"orders"]);
+}
+
+- (void)testArrayTableHonoursCollation
+{
+#if SQLITE_VERSION_NUMBER >= 3022000
+    YFArrayTableProvider *names = [YFArrayTableProvider providerWithColumnNames:@[@"name"] rows:@[@{@"name" : @"Ann"}, @{@"name" : @"Bob"}]];
+    XCTAssertTrue([_db makeVirtualTableNamed:@"names" provider:names error:nil]);
+
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM names WHERE name = 'ann' COLLATE NOCASE"], 1);
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM names WHERE name = 'ann'"], 0);
+#endif
+}
+
+- (void)testFileTableReadsCSV
+{
+    NSString *path = [_poolPath stringByAppendingString:@".csv"];
+    NSString *csv = @"person_id,note\r\n1,\"plain\"\r\n2,\"with, comma and \"\"quotes\"\"\nover two lines\"\r\n2,short\n";
+    XCTAssertTrue([csv writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+
+    [_db executeBatch:@"INSERT INTO person (id, name) VALUES (?, ?)" rows:@[@[@1, @"Ann"], @[@2, @"Bob"]] error:nil];
+
+    YFFileTableProvider *notes = [YFFileTableProvider providerWithPath:path format:YFFileTableFormatCSV columnNames:nil];
+    XCTAssertNotNil(notes);
+    NSError *error = nil;
+    XCTAssertTrue([_db makeVirtualTableNamed:@"notes" provider:notes error:&error], @"%@", error);
+
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM notes n JOIN person p ON p.id = n.person_id WHERE p.name = 'Bob'"], 2);
+    XCTAssertEqualObjects([_db stringForQuery:@"SELECT note FROM notes WHERE person_id = '2' AND note LIKE 'with%'"], @"with, comma and \"quotes\"\nover two lines");
+
+    XCTAssertTrue([_db removeVirtualTableNamed:@"notes"]);
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
+- (void)testFileTableReadsNDJSON
+{
+    NSString *path = [_poolPath stringByAppendingString:@".ndjson"];
+    NSString *ndjson = @"{\"id\": 1, \"score\": 2.5, \"tags\": [\"a\"]}\n{\"id\": 2, \"score\": null}\n";
+    XCTAssertTrue([ndjson writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil]);
+
+    YFFileTableProvider *events = [YFFileTableProvider providerWithPath:path format:YFFileTableFormatNDJSON columnNames:nil];
+    XCTAssertTrue([_db makeVirtualTableNamed:@"events" provider:events error:nil]);
+
+    XCTAssertEqualWithAccuracy([_db doubleForQuery:@"SELECT score FROM events WHERE id = 1"], 2.5, 0.0001);
+    XCTAssertEqualObjects([_db stringForQuery:@"SELECT typeof(score) FROM events WHERE id = 2"], @"null");
+    XCTAssertEqualObjects([_db stringForQuery:@"SELECT typeof(id) FROM events WHERE id = 1"], @"integer");
+    XCTAssertEqualObjects([_db stringForQuery:@"SELECT json_extract(tags, '$[0]') FROM events WHERE id = 1"], @"a");
+
+    XCTAssertTrue([_db removeVirtualTableNamed:@"events"]);
+    [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+}
+
+#pragma mark Array parameters
+
+- (void)testArrayParameterInList
+{
+    [_db setShouldCacheStatements:YES];
+    [_db executeBatch:@"INSERT INTO person (id, name) VALUES (?, ?)" rows:@[@[@1, @"Ann"], @[@2, @"Bob"], @[@3, @"Cid"]] error:nil];
+
+    int64_t ids[] = { 1, 3, 5 };
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM person WHERE id IN yfdb_carray(?)", [YFArrayParameter parameterWithInt64s:ids count:3]], 2);
+
+    // the same cached statement with a list of another length
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM person WHERE id IN yfdb_carray(?)", [YFArrayParameter parameterWithArray:@[@2]]], 1);
+
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM person WHERE name IN yfdb_carray(?)", [YFArrayParameter parameterWithStrings:@[@"Bob", @"Cid", @"Dan"]]], 2);
+
+    XCTAssertNil([YFArrayParameter parameterWithArray:@[@1, @"two"]]);
+}
+
+- (void)testArrayParameterIsReleasedByIdleStatement
+{
+    [_db setShouldCacheStatements:YES];
+
+    __weak YFArrayParameter *weakParameter = nil;
+
+    @autoreleasepool {
+        YFArrayParameter *parameter = [YFArrayParameter parameterWithArray:@[@1, @2]];
+        weakParameter = parameter;
+        XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM yfdb_carray(?)", parameter], 2);
+    }
+
+    XCTAssertNil(weakParameter);
+    XCTAssertEqual([[_db statementCache] count], 1u);
+}
+
+- (void)testArrayParameterOfDoublesAndEmptyLists
+{
+    [_db executeBatch:@"INSERT INTO person (id, name, score) VALUES (?, ?, ?)" rows:@[@[@1, @"Ann", @0.5], @[@2, @"Bob", @1.5]] error:nil];
+
+    double scores[] = { 1.5, 2.5 };
+    XCTAssertEqualObjects([_db stringForQuery:@"SELECT name FROM person WHERE score IN yfdb_carray(?)", [YFArrayParameter parameterWithDoubles:scores count:2]], @"Bob");
+    XCTAssertEqual([_db intForQuery:@"SELECT count(*) FROM person WHERE id IN yfdb_carray(?)", [YFArrayParameter parameterWithArray:@[]]], 0);
+
+    YFArrayParameter *mixed = [YFArrayParameter parameterWithArray:@[@1, @2.5]];
+    XCTAssertNotNil(mixed);
+    XCTAssertEqual([mixed type], YFArrayParameterTypeDouble);
+}
+
+- (void)testArrayParameterRebindsOnAPreparedStatement
+{
+    [_db executeBatch:@"INSERT INTO person (id, name) VALUES (?, ?)" rows:@[@[@1, @"Ann"], @[@2, @"Bob"], @[@3, @"Cid"]] error:nil];
+
+    NSError *error = nil;
+    YFPreparedStatement *lookup = [_db prepareStatement:@"SELECT count(*) FROM person WHERE id IN yfdb_carray(?)" error:&error];
+    XCTAssertNotNil(lookup, @"%@", error);
+
+    NSArray *lists = @[@[@1], @[@1, @2, @3], @[@4, @5]];
+    NSArray *expected = @[@1, @3, @0];
+    for (NSUInteger i = 0; i < [lists count]; i++) {
+        XCTAssertTrue([lookup bindObject:[YFArrayParameter parameterWithArray:lists[i]] atIndex:1]);
+        XCTAssertTrue([lookup next]);
+        XCTAssertEqual([lookup intForColumnIndex:0], [expected[i] intValue]);
+        [lookup reset];
+    }
+
+    [lookup close];
+}
+
+@end
@@ -0,0 +1,84 @@
+//
+//  YFArrayParameter.h
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Element type of a @c YFArrayParameter . */
+
+typedef NS_ENUM(int, YFArrayParameterType) {
+    YFArrayParameterTypeInt64,
+    YFArrayParameterTypeDouble,
+    YFArrayParameterTypeText,
+};
+
+/** A list of values bound to a single @c ?  and read back as a table with @c yfdb_carray(?) , in the manner of SQLite's carray extension.
+
+ Building @c IN (?, ?, ...)  for each list gives SQL of a different length for every list size, and each one misses the statement cache and is prepared again. With an array parameter the SQL never changes:
+
+@code
+YFArrayParameter *ids = [YFArrayParameter parameterWithArray:identifiers];
+YFResultSet *rs = [db executeQuery:@"SELECT * FROM person WHERE id IN yfdb_carray(?)", ids];
+@endcode
+
+ Every connection YFDB opens provides the @c yfdb_carray  table-valued function, with a single @c value  column; its argument must be bound to a @c YFArrayParameter  (through @c executeQuery: , @c executeUpdate:  or any @c bindObject: ). Any other argument gives an empty table. The name is YFDB's own, so SQLite's carray extension can be loaded alongside it; the two do not accept each other's bindings. A failure to register it is logged when @c logsErrors  is set. Requires SQLite 3.20.
+
+ The values are copied when the parameter is created, so one parameter may be bound to several statements at once, on any thread.
+ */
+
+@interface YFArrayParameter : NSObject
+
+/** Type of every element. */
+
+@property (nonatomic, readonly) YFArrayParameterType type;
+
+/** Number of elements. */
+
+@property (nonatomic, readonly) NSUInteger count;
+
+/** Create a parameter from an array of numbers or of strings.
+
+ @param values @c NSNumber  or @c NSString  elements. Numbers give 64-bit integers, or doubles if any of them is a floating point number. @c NSNull  elements are left out, since @c NULL  is never @c IN  anything.
+
+ @return The parameter; @c nil  if the array mixes numbers and strings, or holds other objects.
+ */
+
++ (nullable instancetype)parameterWithArray:(NSArray *)values;
+
+/** Create a parameter of 64-bit integers.
+
+ @param values The integers; copied.
+ @param count Number of integers.
+
+ @return The parameter.
+ */
+
++ (instancetype)parameterWithInt64s:(const int64_t *)values count:(NSUInteger)count;
+
+/** Create a parameter of doubles.
+
+ @param values The doubles; copied.
+ @param count Number of doubles.
+
+ @return The parameter.
+ */
+
++ (instancetype)parameterWithDoubles:(const double *)values count:(NSUInteger)count;
+
+/** Create a parameter of text.
+
+ @param strings The strings.
+
+ @return The parameter.
+ */
+
++ (instancetype)parameterWithStrings:(NSArray<NSString *> *)strings;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,335 @@
+//
+//  YFArrayParameter.m
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import "YFArrayParameter.h"
+#import <sqlite3.h>
+#import <stdlib.h>
+#import <string.h>
+
+// checked by sqlite3_value_pointer, so only our own bindings are ever dereferenced
+static const char YFArrayParameterPointerType[] = "yfdb-array";
+
+// MARK: - YFArrayParameter Private Extension
+
+@interface YFArrayParameter () {
+@public
+    YFArrayParameterType    _type;
+    NSUInteger              _count;
+
+    // int64_t or double elements; for text, the UTF-8 of every string back to back
+    void                    *_values;
+    size_t                  *_textOffsets;
+    int                     *_textLengths;
+}
+@end
+
+// MARK: - yfdb_carray module
+
+#if SQLITE_VERSION_NUMBER >= 3020000
+
+enum {
+    YFArrayColumnValue,
+    YFArrayColumnPointer,
+};
+
+// sqlite3_vtab_cursor must come first: SQLite hands back pointers to it
+typedef struct YFArrayCursor {
+    sqlite3_vtab_cursor base;
+    void                *parameter;     // kept alive by the binding while the statement runs
+    NSUInteger          index;
+} YFArrayCursor;
+
+static int YFArrayConnect(sqlite3 *db, void *pAux, int argc, const char *const *argv, sqlite3_vtab **ppVtab, char **pzErr) {
+    int rc = sqlite3_declare_vtab(db, "CREATE TABLE x(value, pointer HIDDEN)");
+    if (rc != SQLITE_OK) {
+        return rc;
+    }
+
+    sqlite3_vtab *table = sqlite3_malloc((int)sizeof(sqlite3_vtab));
+    if (!table) {
+        return SQLITE_NOMEM;
+    }
+    memset(table, 0, sizeof(sqlite3_vtab));
+
+    *ppVtab = table;
+    return SQLITE_OK;
+}
+
+static int YFArrayDisconnect(sqlite3_vtab *vtab) {
+    sqlite3_free(vtab);
+    return SQLITE_OK;
+}
+
+// yfdb_carray(?) is an equality term on the hidden column; without one there is nothing to scan
+static int YFArrayBestIndex(sqlite3_vtab *vtab, sqlite3_index_info *info) {
+    for (int i = 0; i < info->nConstraint; i++) {
+        const struct sqlite3_index_constraint *constraint = &info->aConstraint[i];
+
+        if (constraint->iColumn != YFArrayColumnPointer || constraint->op != SQLITE_INDEX_CONSTRAINT_EQ) {
+            continue;
+        }
+        if (!constraint->usable) {
+            continue;
+        }
+
+        info->aConstraintUsage[i].argvIndex = 1;
+        info->aConstraintUsage[i].omit = 1;
+        info->idxNum = 1;
+        info->estimatedCost = 1;
+        info->estimatedRows = 100;
+        return SQLITE_OK;
+    }
+
+    info->idxNum = 0;
+    info->estimatedCost = 2147483647;
+    info->estimatedRows = 2147483647;
+    return SQLITE_OK;
+}
+
+static int YFArrayOpen(sqlite3_vtab *vtab, sqlite3_vtab_cursor **ppCursor) {
+    YFArrayCursor *cursor = sqlite3_malloc((int)sizeof(YFArrayCursor));
+    if (!cursor) {
+        return SQLITE_NOMEM;
+    }
+    memset(cursor, 0, sizeof(YFArrayCursor));
+
+    *ppCursor = &cursor->base;
+    return SQLITE_OK;
+}
+
+static int YFArrayClose(sqlite3_vtab_cursor *cur) {
+    sqlite3_free(cur);
+    return SQLITE_OK;
+}
+
+static int YFArrayFilter(sqlite3_vtab_cursor *cur, int idxNum, const char *idxStr, int argc, sqlite3_value **argv) {
+    YFArrayCursor *cursor = (YFArrayCursor *)cur;
+
+    cursor->parameter = (idxNum && argc) ? sqlite3_value_pointer(argv[0], YFArrayParameterPointerType) : 0x00;
+    cursor->index = 0;
+
+    return SQLITE_OK;
+}
+
+static int YFArrayNext(sqlite3_vtab_cursor *cur) {
+    ((YFArrayCursor *)cur)->index++;
+    return SQLITE_OK;
+}
+
+static int YFArrayEof(sqlite3_vtab_cursor *cur) {
+    YFArrayCursor *cursor = (YFArrayCursor *)cur;
+    YFArrayParameter *parameter = (__bridge YFArrayParameter *)cursor->parameter;
+
+    return !parameter || cursor->index >= parameter->_count;
+}
+
+static int YFArrayColumn(sqlite3_vtab_cursor *cur, sqlite3_context *ctx, int column) {
+    YFArrayCursor *cursor = (YFArrayCursor *)cur;
+    YFArrayParameter *parameter = (__bridge YFArrayParameter *)cursor->parameter;
+    NSUInteger idx = cursor->index;
+
+    if (column != YFArrayColumnValue) {
+        sqlite3_result_null(ctx);
+        return SQLITE_OK;
+    }
+
+    switch (parameter->_type) {
+        case YFArrayParameterTypeInt64:
+            sqlite3_result_int64(ctx, ((const int64_t *)parameter->_values)[idx]);
+            break;
+        case YFArrayParameterTypeDouble:
+            sqlite3_result_double(ctx, ((const double *)parameter->_values)[idx]);
+            break;
+        case YFArrayParameterTypeText:
+            sqlite3_result_text(ctx, (const char *)parameter->_values + parameter->_textOffsets[idx], parameter->_textLengths[idx], SQLITE_TRANSIENT);
+            break;
+    }
+
+    return SQLITE_OK;
+}
+
+static int YFArrayRowid(sqlite3_vtab_cursor *cur, sqlite3_int64 *pRowid) {
+    *pRowid = (sqlite3_int64)((YFArrayCursor *)cur)->index + 1;
+    return SQLITE_OK;
+}
+
+// no xCreate: eponymous only, usable as soon as it is registered
+static const sqlite3_module YFArrayModule = {
+    .iVersion       = 0,
+    .xCreate        = 0x00,
+    .xConnect       = YFArrayConnect,
+    .xBestIndex     = YFArrayBestIndex,
+    .xDisconnect    = YFArrayDisconnect,
+    .xDestroy       = 0x00,
+    .xOpen          = YFArrayOpen,
+    .xClose         = YFArrayClose,
+    .xFilter        = YFArrayFilter,
+    .xNext          = YFArrayNext,
+    .xEof           = YFArrayEof,
+    .xColumn        = YFArrayColumn,
+    .xRowid         = YFArrayRowid,
+};
+
+#endif
+
+// MARK: - YFArrayParameter
+
+#if SQLITE_VERSION_NUMBER >= 3020000
+static void YFArrayParameterRelease(void *pointer) {
+    (void)(__bridge_transfer YFArrayParameter *)pointer;
+}
+#endif
+
+@implementation YFArrayParameter
+
+- (void)dealloc {
+    free(_values);
+    free(_textOffsets);
+    free(_textLengths);
+}
+
++ (instancetype)parameterWithValues:(const void *)values size:(size_t)size count:(NSUInteger)count type:(YFArrayParameterType)type {
+    YFArrayParameter *parameter = [[self alloc] init];
+    parameter->_type = type;
+    parameter->_count = count;
+    parameter->_values = malloc(size * count + 1);
+
+    if (count) {
+        memcpy(parameter->_values, values, size * count);
+    }
+
+    return parameter;
+}
+
++ (instancetype)parameterWithInt64s:(const int64_t *)values count:(NSUInteger)count {
+    return [self parameterWithValues:values size:sizeof(int64_t) count:count type:YFArrayParameterTypeInt64];
+}
+
++ (instancetype)parameterWithDoubles:(const double *)values count:(NSUInteger)count {
+    return [self parameterWithValues:values size:sizeof(double) count:count type:YFArrayParameterTypeDouble];
+}
+
++ (instancetype)parameterWithStrings:(NSArray<NSString *> *)strings {
+    NSUInteger count = [strings count];
+    NSUInteger capacity = 0;
+
+    for (NSString *string in strings) {
+        capacity += [string maximumLengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    }
+
+    YFArrayParameter *parameter = [[self alloc] init];
+    parameter->_type = YFArrayParameterTypeText;
+    parameter->_count = count;
+    parameter->_values = malloc(capacity + 1);
+    parameter->_textOffsets = malloc(sizeof(size_t) * count + 1);
+    parameter->_textLengths = malloc(sizeof(int) * count + 1);
+
+    char *text = parameter->_values;
+    size_t offset = 0;
+    NSUInteger idx = 0;
+
+    for (NSString *string in strings) {
+        NSUInteger length = 0;
+        [string getBytes:text + offset maxLength:capacity - offset usedLength:&length encoding:NSUTF8StringEncoding options:0 range:NSMakeRange(0, [string length]) remainingRange:NULL];
+
+        parameter->_textOffsets[idx] = offset;
+        parameter->_textLengths[idx] = (int)length;
+        offset += length;
+        idx++;
+    }
+
+    return parameter;
+}
+
++ (instancetype)parameterWithArray:(NSArray *)values {
+    NSUInteger numbers = 0, strings = 0;
+    BOOL floating = NO;
+
+    for (id value in values) {
+        if ([value isKindOfClass:[NSNumber class]]) {
+            const char *objCType = [(NSNumber *)value objCType];
+            floating = floating || objCType[0] == 'd' || objCType[0] == 'f';
+            numbers++;
+        }
+        else if ([value isKindOfClass:[NSString class]]) {
+            strings++;
+        }
+        else if ((NSNull *)value != [NSNull null]) {
+            return nil;
+        }
+    }
+
+    if (numbers && strings) {
+        return nil;
+    }
+
+    if (strings) {
+        NSMutableArray<NSString *> *text = [NSMutableArray arrayWithCapacity:strings];
+        for (id value in values) {
+            if ([value isKindOfClass:[NSString class]]) {
+                [text addObject:value];
+            }
+        }
+        return [self parameterWithStrings:text];
+    }
+
+    YFArrayParameter *parameter = [[self alloc] init];
+    parameter->_type = floating ? YFArrayParameterTypeDouble : YFArrayParameterTypeInt64;
+    parameter->_values = malloc(sizeof(int64_t) * numbers + 1);
+
+    NSUInteger count = 0;
+
+    for (id value in values) {
+        if (![value isKindOfClass:[NSNumber class]]) {
+            continue;
+        }
+        if (floating) {
+            ((double *)parameter->_values)[count++] = [value doubleValue];
+        }
+        else {
+            // as YFDBBindNumber binds them
+            ((int64_t *)parameter->_values)[count++] = ([value objCType][0] == 'Q') ? (int64_t)[value unsignedLongLongValue] : [value longLongValue];
+        }
+    }
+    parameter->_count = count;
+
+    return parameter;
+}
+
+- (YFArrayParameterType)type {
+    return _type;
+}
+
+- (NSUInteger)count {
+    return _count;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p> %lu values of type %d", [self class], self, (unsigned long)_count, _type];
+}
+
+// MARK: Private
+
+- (int)bindToStatement:(sqlite3_stmt *)pStmt index:(int)idx {
+#if SQLITE_VERSION_NUMBER >= 3020000
+    // the binding keeps the parameter alive; on failure SQLite releases it at once
+    return sqlite3_bind_pointer(pStmt, idx, (__bridge_retained void *)self, YFArrayParameterPointerType, &YFArrayParameterRelease);
+#else
+    return SQLITE_MISUSE;
+#endif
+}
+
++ (int)installOnDatabase:(sqlite3 *)db {
+#if SQLITE_VERSION_NUMBER >= 3020000
+    // a name of our own, so SQLite's carray extension and anything else registered as carray are left alone
+    return sqlite3_create_module_v2(db, "yfdb_carray", &YFArrayModule, 0x00, 0x00);
+#else
+    return SQLITE_OK;
+#endif
+}
+
+@end
@@ -0,0 +1,188 @@
+//
+//  YFBlobHandle.h
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class YFDatabase;
+
+/** Buffer size used by the stream copy methods when none is given: 64 KiB. */
+
+extern const NSUInteger YFBlobHandleDefaultBufferSize;
+
+/** A blob of zeros, bound in place of an @c NSData  to reserve space.
+
+ Binding one (with @c executeUpdate:  or any @c bindObject: ) uses @c sqlite3_bind_zeroblob , so no bytes are allocated; fill the space afterwards through a @c YFBlobHandle .
+ */
+
+@interface YFZeroBlob : NSObject
+
+/** Number of bytes to reserve. */
+
+@property (nonatomic, readonly) NSUInteger length;
+
+/** Create a zero blob marker.
+
+ @param length Number of bytes to reserve.
+
+ @return The marker, to pass as a statement argument.
+ */
+
++ (instancetype)zeroBlobWithLength:(NSUInteger)length;
+
+@end
+
+/** Incremental access to one blob value, over @c sqlite3_blob_open .
+
+ Large values can be read and written in pieces, at any offset, without ever holding the whole value in memory, unlike @c -[YFResultSet dataForColumnIndex:]  and binding an @c NSData . A handle cannot change the blob's size: reserve the space first with a @c YFZeroBlob .
+
+@code
+[db executeUpdate:@"INSERT INTO attachment (name, body) VALUES (?, ?)", name, [YFZeroBlob zeroBlobWithLength:fileSize]];
+
+YFBlobHandle *blob = [db openBlobInTable:@"attachment" column:@"body" row:[db lastInsertRowId] writable:YES error:&error];
+BOOL ok = [blob copyFromInputStream:[NSInputStream inputStreamWithFileAtPath:path] toOffset:0 bufferSize:0 error:&error];
+[blob close];
+@endcode
+
+ If the row is changed or deleted while the handle is open, the handle expires and every further read or write fails with @c SQLITE_ABORT ; @c moveToRow:error:  revives it. Like the database itself, a handle must only be used from one thread at a time, and closing the database closes its handles.
+
+ Offsets and lengths are limited to what @c sqlite3_blob_read  takes, 2 GB.
+ */
+
+@interface YFBlobHandle : NSObject
+
+/** The database the blob was opened on; @c nil  once closed. */
+
+@property (nonatomic, retain, readonly, nullable) YFDatabase *parentDB;
+
+/** The attached database name, such as @c main . */
+
+@property (nonatomic, copy, readonly) NSString *databaseName;
+
+/** The table name. */
+
+@property (nonatomic, copy, readonly) NSString *tableName;
+
+/** The column name. */
+
+@property (nonatomic, copy, readonly) NSString *columnName;
+
+/** The rowid of the current row. */
+
+@property (nonatomic, readonly) int64_t rowid;
+
+/** Whether the blob was opened for writing. */
+
+@property (nonatomic, readonly, getter=isWritable) BOOL writable;
+
+/** Size of the blob in bytes; @c 0  once closed. */
+
+@property (nonatomic, readonly) NSUInteger length;
+
+/** Read bytes into a buffer.
+
+ @param buffer Where to put the bytes; at least @c length  bytes long.
+ @param length Number of bytes to read.
+ @param offset Where to start reading in the blob. @c offset + length  must not pass the end of the blob.
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)readBytes:(void *)buffer length:(NSUInteger)length atOffset:(NSUInteger)offset error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Read part of the blob into a new @c NSData .
+
+ @param length Number of bytes to read; clipped to the end of the blob.
+ @param offset Where to start reading in the blob.
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return The bytes; @c nil  on error.
+ */
+
+- (NSData * _Nullable)readDataOfLength:(NSUInteger)length atOffset:(NSUInteger)offset error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Overwrite bytes of the blob.
+
+ @param bytes The bytes to write.
+ @param length Number of bytes to write.
+ @param offset Where to start writing in the blob. @c offset + length  must not pass the end of the blob.
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)writeBytes:(const void *)bytes length:(NSUInteger)length atOffset:(NSUInteger)offset error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Overwrite bytes of the blob with the contents of an @c NSData .
+
+ @param data The bytes to write.
+ @param offset Where to start writing in the blob.
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)writeData:(NSData *)data atOffset:(NSUInteger)offset error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Point the handle at the same column of another row, with @c sqlite3_blob_reopen .
+
+ This is much cheaper than opening a new handle, and also revives an expired one.
+
+ @param rowid The rowid of the new row.
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES on success; @c NO on failure, after which the handle is unusable until moved again.
+ */
+
+- (BOOL)moveToRow:(int64_t)rowid error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Write everything a stream produces into the blob, through a fixed size buffer.
+
+ @param stream The source; opened if needed, and closed when done.
+ @param offset Where to start writing in the blob.
+ @param bufferSize Size of the copy buffer; @c 0  means @c YFBlobHandleDefaultBufferSize .
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES once the stream is exhausted; @c NO on a read or write error, or if the stream holds more than fits in the blob.
+ */
+
+- (BOOL)copyFromInputStream:(NSInputStream *)stream toOffset:(NSUInteger)offset bufferSize:(NSUInteger)bufferSize error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Write the whole blob to a stream, through a fixed size buffer.
+
+ @param stream The destination; opened if needed, and closed when done.
+ @param bufferSize Size of the copy buffer; @c 0  means @c YFBlobHandleDefaultBufferSize .
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)copyToOutputStream:(NSOutputStream *)stream bufferSize:(NSUInteger)bufferSize error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** A stream reading the blob from the start.
+
+ The stream is synchronous: call @c read:maxLength:  directly; run loop scheduling is accepted but never produces events. It keeps the handle alive, but does not close it.
+ */
+
+- (NSInputStream *)inputStream;
+
+/** A stream overwriting the blob from the start.
+
+ Writes past the end of the blob are cut short; once the blob is full, @c write:maxLength:  returns @c 0 . The same notes as for @c inputStream  apply.
+ */
+
+- (NSOutputStream *)outputStream;
+
+/** Release the handle. Closing the database does this too. */
+
+- (void)close;
+
+@end
+
+NS_ASSUME_NONNULL_END
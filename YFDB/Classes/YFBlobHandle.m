@@ -0,0 +1,511 @@
+//
+//  YFBlobHandle.m
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import "YFBlobHandle.h"
+#import "YFDatabase.h"
+#import <sqlite3.h>
+
+const NSUInteger YFBlobHandleDefaultBufferSize = 64 * 1024;
+
+// MARK: - YFDatabase Private Extension
+
+@interface YFDatabase ()
+- (void)blobHandleDidClose:(YFBlobHandle *)blobHandle;
+@end
+
+// MARK: - YFZeroBlob
+
+@implementation YFZeroBlob
+
++ (instancetype)zeroBlobWithLength:(NSUInteger)length {
+    YFZeroBlob *zeroBlob = [[YFZeroBlob alloc] init];
+    zeroBlob->_length = length;
+    return zeroBlob;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"zeroblob(%lu)", (unsigned long)_length];
+}
+
+@end
+
+// MARK: - Streams
+
+@interface YFBlobInputStream : NSInputStream
+- (instancetype)initWithBlobHandle:(YFBlobHandle *)blobHandle;
+@end
+
+@interface YFBlobOutputStream : NSOutputStream
+- (instancetype)initWithBlobHandle:(YFBlobHandle *)blobHandle;
+@end
+
+// MARK: - YFBlobHandle
+
+static NSError *YFDBBlobError(int rc, NSString *message) {
+    if (!message) {
+#if SQLITE_VERSION_NUMBER >= 3007015
+        message = [NSString stringWithUTF8String:sqlite3_errstr(rc)];
+#else
+        message = [NSString stringWithFormat:@"SQLite error %d", rc];
+#endif
+    }
+    return [NSError errorWithDomain:@"YFDatabase" code:rc userInfo:@{NSLocalizedDescriptionKey: message}];
+}
+
+@interface YFBlobHandle () {
+    sqlite3_blob *_blob;
+}
+@property (nonatomic, retain, nullable) YFDatabase *parentDB;
+@end
+
+@implementation YFBlobHandle
+
++ (instancetype)blobHandleWithBlob:(sqlite3_blob *)blob databaseName:(NSString *)databaseName tableName:(NSString *)tableName columnName:(NSString *)columnName rowid:(int64_t)rowid writable:(BOOL)writable usingParentDatabase:(YFDatabase *)aDB {
+    YFBlobHandle *handle = [[YFBlobHandle alloc] init];
+
+    handle->_blob = blob;
+    handle->_databaseName = [databaseName copy];
+    handle->_tableName = [tableName copy];
+    handle->_columnName = [columnName copy];
+    handle->_rowid = rowid;
+    handle->_writable = writable;
+    [handle setParentDB:aDB];
+
+    return handle;
+}
+
+- (void)dealloc {
+    [self close];
+}
+
+- (void)close {
+    if (_blob) {
+        sqlite3_blob_close(_blob);
+        _blob = 0x00;
+    }
+
+    [_parentDB blobHandleDidClose:self];
+    _parentDB = nil;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ %@.%@.%@ row %lld (%lu bytes)", [super description], _databaseName, _tableName, _columnName, (long long)_rowid, (unsigned long)[self length]];
+}
+
+- (NSUInteger)length {
+    return _blob ? (NSUInteger)sqlite3_blob_bytes(_blob) : 0;
+}
+
+/** Check a request against the blob before handing it to SQLite, which takes ints. */
+
+- (BOOL)checkRangeWithLength:(NSUInteger)length offset:(NSUInteger)offset error:(NSError * __autoreleasing *)outErr {
+
+    if (!_blob) {
+        if (outErr) {
+            *outErr = YFDBBlobError(SQLITE_MISUSE, @"The blob handle is closed");
+        }
+        return NO;
+    }
+
+    NSUInteger blobLength = [self length];
+    if (offset > blobLength || length > blobLength - offset) {
+        if (outErr) {
+            *outErr = YFDBBlobError(SQLITE_RANGE, [NSString stringWithFormat:@"%lu bytes at offset %lu is past the end of a %lu byte blob", (unsigned long)length, (unsigned long)offset, (unsigned long)blobLength]);
+        }
+        return NO;
+    }
+
+    return YES;
+}
+
+- (BOOL)checkResult:(int)rc error:(NSError * __autoreleasing *)outErr {
+
+    if (rc == SQLITE_OK) {
+        return YES;
+    }
+
+    NSString *message = nil;
+    sqlite3 *db = [_parentDB sqliteHandle];
+    if (db && sqlite3_errcode(db) == rc) {
+        message = [NSString stringWithUTF8String:sqlite3_errmsg(db)];
+    }
+
+    if ([_parentDB logsErrors]) {
+        NSLog(@"Error: blob access failed for %@.%@ row %lld (%d, %@)", _tableName, _columnName, (long long)_rowid, rc, message);
+    }
+
+    if (outErr) {
+        *outErr = YFDBBlobError(rc, message);
+    }
+
+    return NO;
+}
+
+// MARK: Read and write
+
+- (BOOL)readBytes:(void *)buffer length:(NSUInteger)length atOffset:(NSUInteger)offset error:(NSError * __autoreleasing *)outErr {
+
+    if (![self checkRangeWithLength:length offset:offset error:outErr]) {
+        return NO;
+    }
+
+    return [self checkResult:sqlite3_blob_read(_blob, buffer, (int)length, (int)offset) error:outErr];
+}
+
+- (NSData *)readDataOfLength:(NSUInteger)length atOffset:(NSUInteger)offset error:(NSError * __autoreleasing *)outErr {
+
+    NSUInteger blobLength = [self length];
+    if (offset <= blobLength) {
+        length = MIN(length, blobLength - offset);
+    }
+
+    NSMutableData *data = [NSMutableData dataWithLength:length];
+    if (![self readBytes:[data mutableBytes] length:length atOffset:offset error:outErr]) {
+        return nil;
+    }
+
+    return data;
+}
+
+- (BOOL)writeBytes:(const void *)bytes length:(NSUInteger)length atOffset:(NSUInteger)offset error:(NSError * __autoreleasing *)outErr {
+
+    if (![self checkRangeWithLength:length offset:offset error:outErr]) {
+        return NO;
+    }
+
+    if (!_writable) {
+        if (outErr) {
+            *outErr = YFDBBlobError(SQLITE_READONLY, @"The blob was opened read-only");
+        }
+        return NO;
+    }
+
+    return [self checkResult:sqlite3_blob_write(_blob, bytes, (int)length, (int)offset) error:outErr];
+}
+
+- (BOOL)writeData:(NSData *)data atOffset:(NSUInteger)offset error:(NSError * __autoreleasing *)outErr {
+    return [self writeBytes:[data bytes] length:[data length] atOffset:offset error:outErr];
+}
+
+- (BOOL)moveToRow:(int64_t)rowid error:(NSError * __autoreleasing *)outErr {
+
+    if (!_blob) {
+        if (outErr) {
+            *outErr = YFDBBlobError(SQLITE_MISUSE, @"The blob handle is closed");
+        }
+        return NO;
+    }
+
+    _rowid = rowid;
+
+    return [self checkResult:sqlite3_blob_reopen(_blob, rowid) error:outErr];
+}
+
+// MARK: Streams
+
+static NSError *YFDBBlobStreamError(NSStream *stream) {
+    NSError *error = [stream streamError];
+    return error ? error : YFDBBlobError(SQLITE_IOERR, @"The stream failed without an error");
+}
+
+- (BOOL)copyFromInputStream:(NSInputStream *)stream toOffset:(NSUInteger)offset bufferSize:(NSUInteger)bufferSize error:(NSError * __autoreleasing *)outErr {
+
+    if (![self checkRangeWithLength:0 offset:offset error:outErr]) {
+        return NO;
+    }
+
+    bufferSize = bufferSize ? bufferSize : YFBlobHandleDefaultBufferSize;
+    uint8_t *buffer = malloc(bufferSize);
+    BOOL ok = YES;
+
+    if ([stream streamStatus] == NSStreamStatusNotOpen) {
+        [stream open];
+    }
+
+    while (ok) {
+        NSInteger count = [stream read:buffer maxLength:bufferSize];
+
+        if (count < 0) {
+            if (outErr) {
+                *outErr = YFDBBlobStreamError(stream);
+            }
+            ok = NO;
+        }
+        else if (count == 0) {
+            break;
+        }
+        else if ((ok = [self writeBytes:buffer length:(NSUInteger)count atOffset:offset error:outErr])) {
+            offset += (NSUInteger)count;
+        }
+    }
+
+    free(buffer);
+    [stream close];
+
+    return ok;
+}
+
+- (BOOL)copyToOutputStream:(NSOutputStream *)stream bufferSize:(NSUInteger)bufferSize error:(NSError * __autoreleasing *)outErr {
+
+    if (![self checkRangeWithLength:0 offset:0 error:outErr]) {
+        return NO;
+    }
+
+    bufferSize = bufferSize ? bufferSize : YFBlobHandleDefaultBufferSize;
+    uint8_t *buffer = malloc(bufferSize);
+    NSUInteger length = [self length];
+    NSUInteger offset = 0;
+    BOOL ok = YES;
+
+    if ([stream streamStatus] == NSStreamStatusNotOpen) {
+        [stream open];
+    }
+
+    while (ok && offset < length) {
+        NSUInteger chunk = MIN(bufferSize, length - offset);
+
+        if (!(ok = [self readBytes:buffer length:chunk atOffset:offset error:outErr])) {
+            break;
+        }
+        offset += chunk;
+
+        // a stream may take less than it is given
+        NSUInteger written = 0;
+        while (ok && written < chunk) {
+            NSInteger count = [stream write:buffer + written maxLength:chunk - written];
+            if (count <= 0) {
+                if (outErr) {
+                    *outErr = YFDBBlobStreamError(stream);
+                }
+                ok = NO;
+            }
+            else {
+                written += (NSUInteger)count;
+            }
+        }
+    }
+
+    free(buffer);
+    [stream close];
+
+    return ok;
+}
+
+- (NSInputStream *)inputStream {
+    return [[YFBlobInputStream alloc] initWithBlobHandle:self];
+}
+
+- (NSOutputStream *)outputStream {
+    return [[YFBlobOutputStream alloc] initWithBlobHandle:self];
+}
+
+@end
+
+// MARK: - YFBlobInputStream
+
+@implementation YFBlobInputStream {
+    YFBlobHandle        *_blobHandle;
+    NSUInteger          _offset;
+    NSStreamStatus      _status;
+    NSError             *_error;
+    __weak id<NSStreamDelegate> _delegate;
+}
+
+- (instancetype)initWithBlobHandle:(YFBlobHandle *)blobHandle {
+    self = [super init];
+
+    if (self) {
+        _blobHandle = blobHandle;
+        _status = NSStreamStatusNotOpen;
+    }
+
+    return self;
+}
+
+- (void)open {
+    if (_status == NSStreamStatusNotOpen) {
+        _status = NSStreamStatusOpen;
+    }
+}
+
+- (void)close {
+    _status = NSStreamStatusClosed;
+}
+
+- (NSStreamStatus)streamStatus {
+    return _status;
+}
+
+- (NSError *)streamError {
+    return _error;
+}
+
+- (id<NSStreamDelegate>)delegate {
+    return _delegate;
+}
+
+- (void)setDelegate:(id<NSStreamDelegate>)delegate {
+    _delegate = delegate;
+}
+
+- (void)scheduleInRunLoop:(NSRunLoop *)aRunLoop forMode:(NSString *)mode {
+}
+
+- (void)removeFromRunLoop:(NSRunLoop *)aRunLoop forMode:(NSString *)mode {
+}
+
+- (id)propertyForKey:(NSString *)key {
+    if ([key isEqualToString:NSStreamFileCurrentOffsetKey]) {
+        return @(_offset);
+    }
+    return nil;
+}
+
+- (BOOL)setProperty:(id)property forKey:(NSString *)key {
+    if ([key isEqualToString:NSStreamFileCurrentOffsetKey] && [property isKindOfClass:[NSNumber class]]) {
+        _offset = [property unsignedIntegerValue];
+        return YES;
+    }
+    return NO;
+}
+
+- (NSInteger)read:(uint8_t *)buffer maxLength:(NSUInteger)len {
+
+    if (_status != NSStreamStatusOpen) {
+        return _status == NSStreamStatusAtEnd ? 0 : -1;
+    }
+
+    NSUInteger length = [_blobHandle length];
+    if (_offset >= length) {
+        _status = NSStreamStatusAtEnd;
+        return 0;
+    }
+
+    NSUInteger count = MIN(len, length - _offset);
+    NSError *error = nil;
+
+    if (![_blobHandle readBytes:buffer length:count atOffset:_offset error:&error]) {
+        _error = error;
+        _status = NSStreamStatusError;
+        return -1;
+    }
+
+    _offset += count;
+
+    return (NSInteger)count;
+}
+
+- (BOOL)getBuffer:(uint8_t * _Nullable *)buffer length:(NSUInteger *)len {
+    return NO;
+}
+
+- (BOOL)hasBytesAvailable {
+    return _status == NSStreamStatusOpen && _offset < [_blobHandle length];
+}
+
+@end
+
+// MARK: - YFBlobOutputStream
+
+@implementation YFBlobOutputStream {
+    YFBlobHandle        *_blobHandle;
+    NSUInteger          _offset;
+    NSStreamStatus      _status;
+    NSError             *_error;
+    __weak id<NSStreamDelegate> _delegate;
+}
+
+- (instancetype)initWithBlobHandle:(YFBlobHandle *)blobHandle {
+    self = [super init];
+
+    if (self) {
+        _blobHandle = blobHandle;
+        _status = NSStreamStatusNotOpen;
+    }
+
+    return self;
+}
+
+- (void)open {
+    if (_status == NSStreamStatusNotOpen) {
+        _status = NSStreamStatusOpen;
+    }
+}
+
+- (void)close {
+    _status = NSStreamStatusClosed;
+}
+
+- (NSStreamStatus)streamStatus {
+    return _status;
+}
+
+- (NSError *)streamError {
+    return _error;
+}
+
+- (id<NSStreamDelegate>)delegate {
+    return _delegate;
+}
+
+- (void)setDelegate:(id<NSStreamDelegate>)delegate {
+    _delegate = delegate;
+}
+
+- (void)scheduleInRunLoop:(NSRunLoop *)aRunLoop forMode:(NSString *)mode {
+}
+
+- (void)removeFromRunLoop:(NSRunLoop *)aRunLoop forMode:(NSString *)mode {
+}
+
+- (id)propertyForKey:(NSString *)key {
+    if ([key isEqualToString:NSStreamFileCurrentOffsetKey]) {
+        return @(_offset);
+    }
+    return nil;
+}
+
+- (BOOL)setProperty:(id)property forKey:(NSString *)key {
+    if ([key isEqualToString:NSStreamFileCurrentOffsetKey] && [property isKindOfClass:[NSNumber class]]) {
+        _offset = [property unsignedIntegerValue];
+        return YES;
+    }
+    return NO;
+}
+
+- (NSInteger)write:(const uint8_t *)buffer maxLength:(NSUInteger)len {
+
+    if (_status != NSStreamStatusOpen) {
+        return _status == NSStreamStatusAtEnd ? 0 : -1;
+    }
+
+    NSUInteger length = [_blobHandle length];
+    if (_offset >= length) {
+        // a blob cannot grow
+        _status = NSStreamStatusAtEnd;
+        return 0;
+    }
+
+    NSUInteger count = MIN(len, length - _offset);
+    NSError *error = nil;
+
+    if (![_blobHandle writeBytes:buffer length:count atOffset:_offset error:&error]) {
+        _error = error;
+        _status = NSStreamStatusError;
+        return -1;
+    }
+
+    _offset += count;
+
+    return (NSInteger)count;
+}
+
+- (BOOL)hasSpaceAvailable {
+    return _status == NSStreamStatusOpen && _offset < [_blobHandle length];
+}
+
+@end
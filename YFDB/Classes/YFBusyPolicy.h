@@ -0,0 +1,57 @@
+//
+//  YFBusyPolicy.h
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Decides how long a connection waits before retrying a locked database.
+
+ SQLite calls the busy handler of a @c YFDatabase  each time a lock it needs is held by another connection. The database asks its policy how long to wait before the next try, and gives up once @c maxBusyRetryTimeInterval  has passed.
+
+ The default policy retries a few times straight away, yielding the CPU in between, since most locks are held for microseconds. After that it backs off exponentially, with jitter, from @c initialBackoff  up to @c maximumBackoff . Subclass and override @c delayForRetry:elapsed:  for a different strategy.
+ */
+
+@interface YFBusyPolicy : NSObject
+
+/** Number of retries that only yield the CPU instead of sleeping. Defaults to @c 3 . */
+
+@property (nonatomic) int spinCount;
+
+/** First sleep, in seconds, after the spins. Defaults to 100 microseconds. */
+
+@property (nonatomic) NSTimeInterval initialBackoff;
+
+/** Longest single sleep, in seconds. Defaults to 10 milliseconds. */
+
+@property (nonatomic) NSTimeInterval maximumBackoff;
+
+/** Factor applied to the sleep after each retry. Defaults to @c 2 . */
+
+@property (nonatomic) double backoffMultiplier;
+
+/** A policy with the default settings. */
+
++ (instancetype)defaultPolicy;
+
+/** A policy that sleeps a random 50 to 100 milliseconds between retries, as YFDB did before busy policies existed. */
+
++ (instancetype)legacyPolicy;
+
+/** How long to wait before the next retry.
+
+ @param retry Number of retries so far, starting at @c 0 .
+ @param elapsed Seconds since the database was first found busy.
+
+ @return Seconds to sleep; @c 0  to yield the CPU and retry at once.
+ */
+
+- (NSTimeInterval)delayForRetry:(int)retry elapsed:(NSTimeInterval)elapsed;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,67 @@
+//
+//  YFBusyPolicy.m
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import "YFBusyPolicy.h"
+
+// MARK: - YFLegacyBusyPolicy
+
+@interface YFLegacyBusyPolicy : YFBusyPolicy
+@end
+
+@implementation YFLegacyBusyPolicy
+
+- (NSTimeInterval)delayForRetry:(int)retry elapsed:(NSTimeInterval)elapsed {
+    return (arc4random_uniform(50) + 50) / 1000.0;
+}
+
+@end
+
+// MARK: - YFBusyPolicy
+
+@implementation YFBusyPolicy
+
++ (instancetype)defaultPolicy {
+    return [[YFBusyPolicy alloc] init];
+}
+
++ (instancetype)legacyPolicy {
+    return [[YFLegacyBusyPolicy alloc] init];
+}
+
+- (instancetype)init {
+    self = [super init];
+    
+    if (self) {
+        _spinCount          = 3;
+        _initialBackoff     = 0.0001;
+        _maximumBackoff     = 0.01;
+        _backoffMultiplier  = 2;
+    }
+    
+    return self;
+}
+
+- (NSTimeInterval)delayForRetry:(int)retry elapsed:(NSTimeInterval)elapsed {
+    
+    if (retry < _spinCount) {
+        return 0;
+    }
+    
+    NSTimeInterval delay = _initialBackoff * pow(_backoffMultiplier, retry - _spinCount);
+    if (delay > _maximumBackoff || isnan(delay)) {
+        delay = _maximumBackoff;
+    }
+    
+    // anywhere from half to all of it, so that connections woken together don't retry in lock step
+    return delay * (0.5 + arc4random_uniform(1000) / 2000.0);
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ %d spin(s), backoff %g-%gs x%g", [super description], _spinCount, _initialBackoff, _maximumBackoff, _backoffMultiplier];
+}
+
+@end
@@ -17,6 +17,17 @@ FOUNDATION_EXPORT const unsigned char YFDBVersionString[];
 
 #import "YFDatabase.h"
 #import "YFResultSet.h"
+#import "YFPreparedStatement.h"
+#import "YFBlobHandle.h"
+#import "YFArrayParameter.h"
+#import "YFDateCodec.h"
+#import "YFFunctionContext.h"
+#import "YFVirtualTable.h"
+#import "YFRowMapper.h"
+#import "YFBusyPolicy.h"
+#import "YFDatabaseProfiler.h"
+#import "YFQueryResultCache.h"
 #import "YFDatabaseAdditions.h"
 #import "YFDatabaseQueue.h"
 #import "YFDatabasePool.h"
+#import "YFDatabaseReadWritePool.h"
@@ -10,8 +10,25 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class YFStatementCache;
+@class YFPreparedStatement;
+@class YFBatchResult;
+@class YFBusyPolicy;
+@class YFDatabaseProfiler;
+@class YFQueryResultCache;
+@class YFBlobHandle;
+
 typedef int(^YFDBExecuteStatementsCallbackBlock)(NSDictionary *resultsDictionary);
 
+/** Receives each row of a script run by @c executeScript:withParameterDictionary:rowBlock:error: .
+
+ @param statement The statement, positioned on the row. Read the cells by index with its accessors such as @c int64ForColumnIndex:  and @c stringForColumnIndex: ; do not step, reset or close it, or keep it past the call.
+ @param statementIndex Zero-based position in the script of the statement producing the row.
+
+ @return @c YES to go on; @c NO to stop the script.
+ */
+typedef BOOL(^YFScriptRowBlock)(YFPreparedStatement *statement, NSUInteger statementIndex);
+
 /**
  Enumeration used in checkpoint methods.
  */
@@ -22,6 +39,16 @@ typedef NS_ENUM(int, YFDBCheckpointMode) {
     YFDBCheckpointModeTruncate = 3  // SQLITE_CHECKPOINT_TRUNCATE
 };
 
+/**
+ How @c NSDate  values are bound, and how @c -[YFResultSet dateForColumnIndex:]  reads them back.
+ */
+typedef NS_ENUM(NSInteger, YFDateStorage) {
+    YFDateStorageTimestamp          = 0, // REAL seconds since 1970; the default
+    YFDateStorageFormatter          = 1, // TEXT through the formatter given to setDateFormat:
+    YFDateStorageISO8601            = 2, // TEXT such as 2023-11-01T08:30:00.000Z, in UTC
+    YFDateStorageEpochMilliseconds  = 3  // INTEGER milliseconds since 1970
+};
+
 @interface YFDatabase : NSObject
 
 ///-----------------
@@ -32,6 +59,13 @@ typedef NS_ENUM(int, YFDBCheckpointMode) {
 
 @property (atomic, assign) BOOL traceExecution;
 
+/** Profiler recording per statement statistics; @c nil , the default, turns profiling off.
+
+ @see YFDatabaseProfiler
+ */
+
+@property (nonatomic, strong, nullable) YFDatabaseProfiler *profiler;
+
 /** Whether checked out or not */
 
 @property (atomic, assign) BOOL checkedOut;
@@ -44,9 +78,12 @@ typedef NS_ENUM(int, YFDBCheckpointMode) {
 
 @property (atomic, assign) BOOL logsErrors;
 
-/** Dictionary of cached statements */
+/** Dictionary of cached statements
+ 
+ @warning **Deprecated**: statements now live in `<statementCache>`. Reading this returns a new mutable snapshot, mapping each query to a mutable set of its cached statements; changing the snapshot does not change the cache, so assign it back to apply the changes. Assigning replaces the cache contents with the given statements, and assigning @c nil  clears it, as @c clearCachedStatements  does.
+ */
 
-@property (atomic, retain, nullable) NSMutableDictionary *cachedStatements;
+@property (atomic, retain, nullable) NSMutableDictionary *cachedStatements __deprecated_msg("Use statementCache instead");
 
 ///---------------------
 /// @name Initialization
@@ -172,10 +209,48 @@ YFDatabase *db = [YFDatabase databaseWithPath:fileURL.path];
 
 /** Execute multiple SQL statements with callback handler
  
+ Each row reaches @c block  as a dictionary from column name to the value's text, or @c NSNull . The names are built once per statement, and a value only becomes a string when it is looked up, so a block reading a few columns of a wide row pays for those alone. A row the block keeps is copied when the block returns.
  */
 
 - (BOOL)executeStatements:(NSString *)sql withResultBlock:(__attribute__((noescape)) YFDBExecuteStatementsCallbackBlock _Nullable)block;
 
+/** Execute multiple SQL statements, with bound parameters and typed rows.
+
+ Unlike @c executeStatements:withResultBlock: , which goes through @c sqlite3_exec , each statement is prepared in turn with @c sqlite3_prepare_v2  and run before the next is prepared, so a statement may use a table created earlier in the script. Named parameters (@c :name , @c @name , @c $name ) in any statement are bound from @c arguments  by name without the prefix, and numbered ones (@c ?3 ) by their number as a string; parameters without a value, and plain @c ? , bind @c NULL .
+
+@code
+[db executeScript:@"CREATE TABLE IF NOT EXISTS sync (key TEXT PRIMARY KEY, at INTEGER);"
+                  @"INSERT OR REPLACE INTO sync VALUES ('last', :now);"
+                  @"DELETE FROM log WHERE at < :now - 86400;"
+    withParameterDictionary:@{@"now": @(time(NULL))}
+                   rowBlock:nil
+                      error:&error];
+@endcode
+
+ The prepared statements the script splits into are kept, keyed by the script text, until @c clearCachedStatements  or @c close , so later runs of the same script neither split nor prepare it again. This does not depend on @c shouldCacheStatements , and the statements are not part of the statement cache; up to 32 scripts are kept, after which the kept ones are dropped. The script is not wrapped in a transaction: begin one first if it must be atomic.
+
+ @param sql The SQL statements, separated by semicolons.
+ @param arguments Values for the named parameters of all statements.
+ @param rowBlock Receives the rows of every statement that returns any; @c nil  to discard them.
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES if every statement ran; @c NO if one failed, in which case the later ones do not run, or if @c rowBlock  stopped the script (@c SQLITE_ABORT ).
+ */
+
+- (BOOL)executeScript:(NSString *)sql withParameterDictionary:(NSDictionary<NSString *, id> * _Nullable)arguments rowBlock:(__attribute__((noescape)) YFScriptRowBlock _Nullable)rowBlock error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Execute multiple SQL statements without parameters, discarding any rows.
+
+ @param sql The SQL statements, separated by semicolons.
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES if every statement ran; @c NO otherwise.
+
+ @see executeScript:withParameterDictionary:rowBlock:error:
+ */
+
+- (BOOL)executeScript:(NSString *)sql error:(NSError * _Nullable __autoreleasing *)outErr;
+
 /** Last insert rowid
 
  */
@@ -188,6 +263,46 @@ YFDatabase *db = [YFDatabase databaseWithPath:fileURL.path];
 
 @property (nonatomic, readonly) int changes;
 
+///---------------------
+/// @name Batch updates
+///---------------------
+
+/** Run one statement for every row of a collection.
+ 
+ The SQL is prepared once and each row is bound, stepped and reset on the same statement. Rows are either @c NSArray  values, bound to the `?` placeholders in order, or @c NSDictionary  values, bound to the `:name` placeholders by key; missing keys bind @c NULL .
+ 
+ The whole batch runs in one transaction, or in a save point if a transaction is already open. It stops at the first failing row and rolls everything back.
+ 
+@code
+YFBatchResult *result = [db executeBatch:@"INSERT INTO people (name, age) VALUES (?, ?)"
+                                    rows:@[@[@"Ann", @31], @[@"Bob", @42]]
+                                   error:&error];
+@endcode
+ 
+ @param sql The SQL statement to run for each row.
+ @param rows The rows to bind.
+ @param outErr A @c NSError  object to receive the error of the failing row (if any).
+ 
+ @return The outcome of the batch.
+ */
+
+- (YFBatchResult *)executeBatch:(NSString *)sql rows:(id<NSFastEnumeration>)rows error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Run one statement for rows bound by a block.
+ 
+ Like @c executeBatch:rows:error: , but the block binds each row straight into the prepared statement, so no row objects are needed at all. It returns @c NO  when there are no more rows.
+ 
+ If any bind of a row fails, whether or not the block checks its result, the row is not run and the batch stops and rolls back with that bind's error, as it does for a failing step.
+ 
+ @param sql The SQL statement to run for each row.
+ @param binder Binds row @c rowIndex  and returns @c YES , or returns @c NO  when done.
+ @param outErr A @c NSError  object to receive the error of the failing row (if any).
+ 
+ @return The outcome of the batch.
+ */
+
+- (YFBatchResult *)executeBatch:(NSString *)sql withRowBinder:(__attribute__((noescape)) BOOL (^)(YFPreparedStatement *statement, NSUInteger rowIndex))binder error:(NSError * _Nullable __autoreleasing *)outErr;
+
 
 ///-------------------------
 /// @name Retrieving results
@@ -233,6 +348,20 @@ YFDatabase *db = [YFDatabase databaseWithPath:fileURL.path];
 
 - (YFResultSet *)prepare:(NSString *)sql;
 
+/** Prepare a reusable statement handle.
+ 
+ Use this for statements that run many times, such as an INSERT in an import loop. The handle is bound, stepped and reset directly, without a @c YFResultSet  per execution. Close it when done; closing the database closes it too.
+ 
+ @param sql SQL statement to prepare, generally with `?` placeholders.
+ @param outErr A @c NSError  object to receive any error object (if any).
+ 
+ @return The prepared statement; @c nil  on error.
+ 
+ @see YFPreparedStatement
+ */
+
+- (YFPreparedStatement * _Nullable)prepareStatement:(NSString *)sql error:(NSError * _Nullable __autoreleasing *)outErr;
+
 ///-------------------
 /// @name Transactions
 ///-------------------
@@ -285,7 +414,7 @@ YFDatabase *db = [YFDatabase databaseWithPath:fileURL.path];
 /// @name Cached statements and result sets
 ///----------------------------------------
 
-/** Clear cached statements */
+/** Clear cached statements, and the statements kept by @c executeScript:withParameterDictionary:rowBlock:error: */
 
 - (void)clearCachedStatements;
 
@@ -305,6 +434,42 @@ YFDatabase *db = [YFDatabase databaseWithPath:fileURL.path];
 
 @property (nonatomic) BOOL shouldCacheStatements;
 
+/** The statement cache used when @c shouldCacheStatements  is @c YES ; @c nil  otherwise.
+ 
+ Use it to inspect the hit, miss and eviction counters.
+ */
+
+@property (nonatomic, readonly, nullable) YFStatementCache *statementCache;
+
+/** Maximum number of prepared statements kept in the statement cache.
+ 
+ When the limit is exceeded the least recently used idle statements are finalized. Statements held by open result sets are never evicted. @c 0  means unlimited. Defaults to 128.
+ */
+
+@property (nonatomic) NSUInteger maximumCachedStatementCount;
+
+/** Cache of query results read through @c executeCachedQuery:withArgumentsInArray:error: ; @c nil , the default, turns result caching off.
+ 
+ Setting it installs the cache's @c sqlite3_update_hook  on this connection.
+ 
+ @see YFQueryResultCache
+ */
+
+@property (nonatomic, strong, nullable) YFQueryResultCache *resultCache;
+
+/** Run a read-only query and return all of its rows, from @c resultCache  when it can.
+ 
+ Without a @c resultCache  the query simply runs. Rows are dictionaries like @c -[YFResultSet resultDictionary] ; the returned array may be shared with later calls, so treat it as immutable.
+ 
+ @param sql The SELECT statement, generally with `?` placeholders.
+ @param arguments Values for the placeholders; strings, numbers, data, dates and @c NSNull  make cacheable keys.
+ @param outErr A @c NSError  object to receive any error object (if any).
+ 
+ @return The rows, possibly empty; @c nil  on error.
+ */
+
+- (NSArray<NSDictionary *> * _Nullable)executeCachedQuery:(NSString *)sql withArgumentsInArray:(NSArray * _Nullable)arguments error:(NSError * _Nullable __autoreleasing *)outErr;
+
 /** Interupt pending database operation
  
  This method causes any pending database operation to abort and return at its earliest opportunity
@@ -350,6 +515,42 @@ YFDatabase *db = [YFDatabase databaseWithPath:fileURL.path];
 - (BOOL)rekeyWithData:(NSData *)keyData;
 
 
+///-----------------------------
+/// @name Incremental blob I/O
+///-----------------------------
+
+/** Open one blob value for reading or writing in pieces.
+ 
+ @param table The table holding the blob.
+ @param column The column holding the blob.
+ @param rowid The rowid of the row.
+ @param writable Whether to open the blob for writing too.
+ @param outErr A @c NSError  object to receive any error object (if any).
+ 
+ @return The handle; @c nil  on error, for instance when the row does not exist or the value is not a blob or text.
+ 
+ @see YFBlobHandle
+ @see openBlobInDatabase:table:column:row:writable:error:
+ */
+
+- (YFBlobHandle * _Nullable)openBlobInTable:(NSString *)table column:(NSString *)column row:(int64_t)rowid writable:(BOOL)writable error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Open one blob value of an attached database for reading or writing in pieces.
+ 
+ @param databaseName The attached database name, such as @c main  or @c temp .
+ @param table The table holding the blob.
+ @param column The column holding the blob.
+ @param rowid The rowid of the row.
+ @param writable Whether to open the blob for writing too.
+ @param outErr A @c NSError  object to receive any error object (if any).
+ 
+ @return The handle; @c nil  on error.
+ 
+ @see YFBlobHandle
+ */
+
+- (YFBlobHandle * _Nullable)openBlobInDatabase:(NSString *)databaseName table:(NSString *)table column:(NSString *)column row:(int64_t)rowid writable:(BOOL)writable error:(NSError * _Nullable __autoreleasing *)outErr;
+
 ///------------------------------
 /// @name General inquiry methods
 ///------------------------------
@@ -422,6 +623,45 @@ YFDatabase *db = [YFDatabase databaseWithPath:fileURL.path];
 // description forthcoming
 @property (nonatomic) NSTimeInterval maxBusyRetryTimeInterval;
 
+/** How long to wait between retries when the database is busy. Defaults to @c +[YFBusyPolicy defaultPolicy] .
+
+ @see YFBusyPolicy
+ */
+
+@property (nonatomic, strong) YFBusyPolicy *busyPolicy;
+
+///-------------------------
+/// @name Busy statistics
+///-------------------------
+
+/** Number of times a statement found the database locked and the busy handler started waiting */
+
+@property (nonatomic, readonly) NSUInteger busyEventCount;
+
+/** Number of retries made by the busy handler */
+
+@property (nonatomic, readonly) NSUInteger busyRetryCount;
+
+/** Number of times the busy handler gave up after @c maxBusyRetryTimeInterval */
+
+@property (nonatomic, readonly) NSUInteger busyTimeoutCount;
+
+/** Number of statements that failed with @c SQLITE_BUSY_SNAPSHOT : a WAL read transaction tried to write after another connection had committed. Only rolling back and running the transaction again helps. */
+
+@property (nonatomic, readonly) NSUInteger busySnapshotCount;
+
+/** Total time, in seconds, spent waiting in the busy handler */
+
+@property (nonatomic, readonly) NSTimeInterval totalBusyWaitTime;
+
+/** Longest time, in seconds, a single statement waited in the busy handler */
+
+@property (nonatomic, readonly) NSTimeInterval longestBusyWait;
+
+/** Reset the busy statistics */
+
+- (void)resetBusyStatistics;
+
 
 ///------------------
 /// @name Save points
@@ -603,6 +843,7 @@ NSAssert(rs, @"Error %@", [db lastErrorMessage]);
  @param block The block of code for the function.
 
  @see [sqlite3_create_function()](https://sqlite.org/c3ref/create_function.html)
+ @see makeScalarFunctionNamed:arguments:options:block:error: for typed arguments, deterministic functions, aggregates and window functions
  */
 
 - (void)makeFunctionNamed:(NSString *)name arguments:(int)arguments block:(void (^)(void *context, int argc, void * _Nonnull * _Nonnull argv))block;
@@ -762,6 +1003,19 @@ NSAssert(rs, @"Error %@", [db lastErrorMessage]);
 /// @name Date formatter
 ///---------------------
 
+/** How dates are stored. Defaults to @c YFDateStorageTimestamp .
+
+ @c YFDateStorageISO8601  and @c YFDateStorageEpochMilliseconds  are converted by hand written code (see @c YFDateCodec.h ) rather than @c NSDateFormatter , at about the cost of binding a number. ISO-8601 text sorts and compares correctly as text and works with SQLite's date functions; milliseconds are the most compact.
+
+ Reading is lenient so a column can change storage without rewriting old rows: in either mode, text columns are parsed as ISO-8601 (including SQLite's own @c YYYY-MM-DD @c HH:MM:SS ), integers are read as the mode's unit, and real numbers as seconds, as @c YFDateStorageTimestamp  stored them. Text that does not parse reads as @c nil .
+
+ Setting @c setDateFormat:  to a formatter switches to @c YFDateStorageFormatter , and setting it to @c nil  switches back to @c YFDateStorageTimestamp . Choosing @c YFDateStorageFormatter  while no formatter is set stores timestamps.
+
+ @see setDateFormat:
+ */
+
+@property (nonatomic) YFDateStorage dateStorage;
+
 /** Generate an @c NSDateFormatter  that won't be broken by permutations of timezones or locales.
  
  Use this method to generate values to set the dateFormat property.
@@ -803,7 +1057,7 @@ myDB.dateFormat = [YFDatabase storeableDateFormat:@"yyyy-MM-dd HH:mm:ss"];
 
 /** Set to a date formatter to use string dates with sqlite instead of the default UNIX timestamps.
  
- @param format Set to nil to use UNIX timestamps. Defaults to nil. Should be set using a formatter generated using @c YFDatabase:storeableDateFormat .
+ @param format Set to nil to use UNIX timestamps. Defaults to nil. Should be set using a formatter generated using @c YFDatabase:storeableDateFormat . Also sets @c dateStorage .
  
  @see hasDateFormatter
  @see setDateFormat:
@@ -890,6 +1144,47 @@ myDB.dateFormat = [YFDatabase storeableDateFormat:@"yyyy-MM-dd HH:mm:ss"];
 
 @property (atomic, assign) BOOL inUse;
 
+/** Lowercased column names mapped to their index.
+
+ Built the first time a column is looked up by name and kept while the statement lives, so every result set run on a cached statement shares it. It is built again when SQLite has had to prepare the statement anew after a schema change, since its columns may have changed.
+ */
+
+@property (nonatomic, readonly, nullable) NSDictionary<NSString *, NSNumber *> *columnNameToIndexMap;
+
+/** Column index for column name
+
+ Tries the name as written first, then falls back to a case-insensitive match, so a name spelled like in the query costs one hash lookup and no allocation.
+
+ @param columnName @c NSString  value of the name of the column.
+
+ @return Zero-based index for column, or @c -1  if there is no such column.
+ */
+
+- (int)columnIndexForName:(NSString *)columnName;
+
+/** Column index for a column name spelled exactly as SQLite reports it.
+
+ @param columnName @c NSString  value of the name of the column.
+
+ @return Zero-based index for column, or @c -1  if there is no such column.
+ */
+
+- (int)columnIndexForExactName:(NSString *)columnName;
+
+/** Column names in column order, as SQLite reports them.
+
+ Built once per statement, and again after a schema change, so row dictionaries keyed by column name reuse these strings instead of creating new ones for every row.
+ */
+
+@property (nonatomic, readonly, nullable) NSArray<NSString *> *columnNames;
+
+/** An empty mutable dictionary ready to take one row keyed by @c columnNames .
+
+ Where Foundation offers shared key sets, the dictionary is created from one computed once for the statement, which makes filling it cheaper than a plain dictionary.
+ */
+
+- (NSMutableDictionary *)emptyRowDictionary;
+
 ///----------------------------
 /// @name Closing and Resetting
 ///----------------------------
@@ -898,10 +1193,106 @@ myDB.dateFormat = [YFDatabase storeableDateFormat:@"yyyy-MM-dd HH:mm:ss"];
 
 - (void)close;
 
-/** Reset statement */
+/** Reset statement
+ 
+ If the statement was in use and belongs to a @c YFStatementCache , it is handed back to the cache's free list.
+ */
 
 - (void)reset;
 
 @end
 
+/** Outcome of @c -[YFDatabase executeBatch:rows:error:] . */
+
+@interface YFBatchResult : NSObject
+
+/** Whether every row was executed and the batch committed. */
+
+@property (nonatomic, readonly) BOOL succeeded;
+
+/** Number of rows executed. If the batch failed, these were rolled back. */
+
+@property (nonatomic, readonly) NSUInteger rowCount;
+
+/** Total number of database rows changed, as reported by @c sqlite3_changes  after each row. */
+
+@property (nonatomic, readonly) long long changes;
+
+/** Index of the row that failed, or @c NSNotFound . */
+
+@property (nonatomic, readonly) NSUInteger failedRowIndex;
+
+/** Error of the failed row, if any. */
+
+@property (nonatomic, readonly, nullable) NSError *error;
+
+@end
+
+/** Bounded LRU cache of @c YFStatement  objects, keyed by SQL text.
+ 
+ Each SQL text owns a free list of idle statements, so fetching a cached statement is one dictionary lookup and one pop. Idle statements are also kept on a least-recently-used list; once the cache holds more than @c maximumCount  statements, the least recently used idle ones are finalized.
+ 
+ Statements checked out by a result set are never evicted. They rejoin their free list when they are reset.
+ 
+ Like @c YFDatabase , a statement cache is not thread safe.
+ */
+
+@interface YFStatementCache : NSObject
+
+/** Maximum number of statements to keep. @c 0  means unlimited. */
+
+@property (nonatomic) NSUInteger maximumCount;
+
+/** Number of statements currently owned by the cache, idle or in use. */
+
+@property (nonatomic, readonly) NSUInteger count;
+
+/** Number of lookups that found an idle statement. */
+
+@property (nonatomic, readonly) NSUInteger hitCount;
+
+/** Number of lookups that found no idle statement. */
+
+@property (nonatomic, readonly) NSUInteger missCount;
+
+/** Number of idle statements finalized to stay within @c maximumCount . */
+
+@property (nonatomic, readonly) NSUInteger evictionCount;
+
+/** Take an idle statement for the query out of the cache.
+ 
+ @param query The SQL text.
+ 
+ @return An idle statement, or @c nil  if there is none.
+ */
+
+- (YFStatement * _Nullable)checkoutStatementForQuery:(NSString *)query;
+
+/** Add a newly prepared statement to the cache.
+ 
+ The statement is assumed to be in use; it becomes available to @c checkoutStatementForQuery:  once it is reset.
+ 
+ @param statement The statement.
+ @param query The SQL text the statement was prepared from.
+ */
+
+- (void)addStatement:(YFStatement *)statement forQuery:(NSString *)query;
+
+/** Remove a statement from the cache without finalizing it.
+ 
+ @param statement The statement.
+ */
+
+- (void)removeStatement:(YFStatement *)statement;
+
+/** Close and remove every statement. */
+
+- (void)removeAllStatements;
+
+/** Reset the hit, miss and eviction counters. */
+
+- (void)resetStatistics;
+
+@end
+
 NS_ASSUME_NONNULL_END
@@ -6,24 +6,85 @@
 //
 
 #import "YFDatabase.h"
+#import "YFPreparedStatement.h"
+#import "YFBusyPolicy.h"
+#import "YFDatabaseProfiler.h"
+#import "YFQueryResultCache.h"
+#import "YFBlobHandle.h"
+#import "YFDateCodec.h"
+#import "YFArrayParameter.h"
 #import <sqlite3.h>
+#import <sched.h>
+#import <pthread.h>
+#import <unistd.h>
 
 @interface YFDatabase () {
     void*               _db;
     BOOL                _isExecutingStatement;
     NSTimeInterval      _startBusyRetryTime;
     
+    YFBusyPolicy        *_busyPolicy;
+    YFDatabaseProfiler  *_profiler;
+    YFQueryResultCache  *_resultCache;
+    NSUInteger          _busyEventCount;
+    NSUInteger          _busyRetryCount;
+    NSUInteger          _busyTimeoutCount;
+    NSUInteger          _busySnapshotCount;
+    NSTimeInterval      _totalBusyWaitTime;
+    NSTimeInterval      _longestBusyWait;
+    
     NSMutableSet        *_openResultSets;
+    NSMutableSet        *_openPreparedStatements;
+    NSMutableSet        *_openBlobHandles;
     NSMutableSet        *_openFunctions;
     
+    // lowercased function name -> whether it was registered as deterministic, for the result cache
+    NSMutableDictionary<NSString *, NSNumber *> *_registeredFunctions;
+    
     NSDateFormatter     *_dateFormat;
+    
+    YFStatementCache    *_statementCache;
+    
+    // script text -> the prepared statements it splits into, owned here rather than by the statement cache
+    NSMutableDictionary<NSString *, NSArray<YFStatement *> *> *_cachedScripts;
 }
 
 - (YFResultSet * _Nullable)executeQuery:(NSString *)sql withArgumentsInArray:(NSArray * _Nullable)arrayArgs orDictionary:(NSDictionary * _Nullable)dictionaryArgs orVAList:(va_list)args shouldBind:(BOOL)shouldBind;
+- (YFResultSet * _Nullable)executeQuery:(NSString *)sql withArgumentsInArray:(NSArray * _Nullable)arrayArgs orDictionary:(NSDictionary * _Nullable)dictionaryArgs orVAList:(va_list)args shouldBind:(BOOL)shouldBind copyBindings:(BOOL)copyBindings;
+- (BOOL)bindStatement:(sqlite3_stmt *)pStmt WithArgumentsInArray:(NSArray * _Nullable)arrayArgs orDictionary:(NSDictionary * _Nullable)dictionaryArgs orVAList:(va_list)args copyBindings:(BOOL)copyBindings;
 - (BOOL)executeUpdate:(NSString *)sql error:(NSError * _Nullable __autoreleasing *)outErr withArgumentsInArray:(NSArray * _Nullable)arrayArgs orDictionary:(NSDictionary * _Nullable)dictionaryArgs orVAList:(va_list)args;
 
 @end
 
+// MARK: - YFStatement Private Extension
+
+@interface YFStatement () {
+@public
+    __weak YFStatementCache     *_cache;
+    
+    // Links in the cache's LRU list of idle statements; the cache owns the statements.
+    __unsafe_unretained YFStatement *_lruNewer;
+    __unsafe_unretained YFStatement *_lruOlder;
+    BOOL                        _idleInCache;
+    
+    // column names as SQLite reports them, next to the lowercased columnNameToIndexMap
+    NSDictionary                *_exactColumnNameToIndexMap;
+    NSDictionary                *_columnNameToIndexMap;
+    NSArray                     *_columnNames;
+    id                          _columnKeySet;
+    
+    // SQLite prepares the statement again after a schema change, which may change its columns
+    int                         _columnMapsPrepareCount;
+}
+@end
+
+// MARK: - YFStatementCache Private Extension
+
+@interface YFStatementCache ()
+- (void)statementDidBecomeIdle:(YFStatement *)statement;
+- (NSDictionary *)statementsByQuery;
+@end
+
 // MARK: - YFResultSet Private Extension
 
 @interface YFResultSet ()
@@ -33,6 +94,57 @@
 
 @end
 
+// MARK: - YFBatchResult Private Extension
+
+@interface YFBatchResult ()
+@property (nonatomic) BOOL succeeded;
+@property (nonatomic) NSUInteger rowCount;
+@property (nonatomic) long long changes;
+@property (nonatomic) NSUInteger failedRowIndex;
+@property (nonatomic, nullable) NSError *error;
+@end
+
+// MARK: - YFDatabaseProfiler Private Extension
+
+@interface YFDatabaseProfiler ()
+- (void)installOnDatabase:(sqlite3 *)db;
+- (void)uninstallFromDatabase:(sqlite3 *)db;
+@end
+
+// MARK: - YFQueryResultCache Private Extension
+
+@interface YFQueryResultCache ()
+- (void)installOnDatabase:(sqlite3 *)db;
+- (void)uninstallFromDatabase:(sqlite3 *)db;
+- (NSArray<NSDictionary *> * _Nullable)rowsForQuery:(NSString *)sql arguments:(NSArray * _Nullable)arguments database:(YFDatabase *)db error:(NSError * _Nullable __autoreleasing *)outErr;
+- (void)functionsDidChange;
+@end
+
+// MARK: - YFArrayParameter Private Extension
+
+@interface YFArrayParameter ()
++ (int)installOnDatabase:(sqlite3 *)db;
+- (int)bindToStatement:(sqlite3_stmt *)pStmt index:(int)idx;
+@end
+
+// MARK: - YFBlobHandle Private Extension
+
+@interface YFBlobHandle ()
+
++ (instancetype)blobHandleWithBlob:(sqlite3_blob *)blob databaseName:(NSString *)databaseName tableName:(NSString *)tableName columnName:(NSString *)columnName rowid:(int64_t)rowid writable:(BOOL)writable usingParentDatabase:(YFDatabase *)aDB;
+
+@end
+
+// MARK: - YFPreparedStatement Private Extension
+
+@interface YFPreparedStatement ()
+
++ (instancetype)preparedStatementWithStatement:(YFStatement *)statement query:(NSString *)query usingParentDatabase:(YFDatabase *)aDB;
+- (int)internalStepWithError:(NSError * _Nullable __autoreleasing *)outErr;
+- (NSError * _Nullable)bindError;
+
+@end
+
 @implementation YFDatabase
 @synthesize shouldCacheStatements = _shouldCacheStatements;
 @synthesize maxBusyRetryTimeInterval = _maxBusyRetryTimeInterval;
@@ -64,11 +176,15 @@
     if (self) {
         _databasePath               = [path copy];
         _openResultSets             = [[NSMutableSet alloc] init];
+        _openPreparedStatements     = [[NSMutableSet alloc] init];
+        _openBlobHandles            = [[NSMutableSet alloc] init];
         _db                         = nil;
         _logsErrors                 = YES;
         _crashOnErrors              = NO;
         _maxBusyRetryTimeInterval   = 2;
         _isOpen                     = NO;
+        _maximumCachedStatementCount = 128;
+        _busyPolicy                 = [YFBusyPolicy defaultPolicy];
     }
     
     return self;
@@ -149,6 +265,16 @@
 
 #pragma mark Open and close database
 
+/** Register @c yfdb_carray(?) , for @c YFArrayParameter , on a freshly opened handle. */
+
+- (void)installArrayModule {
+    int rc = [YFArrayParameter installOnDatabase:_db];
+    
+    if (rc != SQLITE_OK && _logsErrors) {
+        NSLog(@"Could not register yfdb_carray: %d \"%s\"", rc, sqlite3_errmsg(_db));
+    }
+}
+
 - (BOOL)open {
     if (_isOpen) {
         return YES;
@@ -168,11 +294,21 @@
         return NO;
     }
     
+    [self installArrayModule];
+    
     if (_maxBusyRetryTimeInterval > 0.0) {
         // set the handler
         [self setMaxBusyRetryTimeInterval:_maxBusyRetryTimeInterval];
     }
     
+    if (_profiler) {
+        [_profiler installOnDatabase:_db];
+    }
+    
+    if (_resultCache) {
+        [_resultCache installOnDatabase:_db];
+    }
+    
     _isOpen = YES;
     
     return YES;
@@ -202,11 +338,21 @@
         return NO;
     }
     
+    [self installArrayModule];
+    
     if (_maxBusyRetryTimeInterval > 0.0) {
         // set the handler
         [self setMaxBusyRetryTimeInterval:_maxBusyRetryTimeInterval];
     }
     
+    if (_profiler) {
+        [_profiler installOnDatabase:_db];
+    }
+    
+    if (_resultCache) {
+        [_resultCache installOnDatabase:_db];
+    }
+    
     _isOpen = YES;
     
     return YES;
@@ -218,6 +364,8 @@
 
 - (BOOL)close {
     
+    [self closeOpenPreparedStatements];
+    [self closeOpenBlobHandles];
     [self clearCachedStatements];
     [self closeOpenResultSets];
     
@@ -225,6 +373,10 @@
         return YES;
     }
     
+    if (_resultCache) {
+        [_resultCache uninstallFromDatabase:_db];
+    }
+    
     int  rc;
     BOOL retry;
     BOOL triedFinalizingOpenStatements = NO;
@@ -253,6 +405,9 @@
     _db = nil;
     _isOpen = false;
     
+    // functions go with the handle
+    [_registeredFunctions removeAllObjects];
+    
     return YES;
 }
 
@@ -271,23 +426,108 @@
 static int YFDBDatabaseBusyHandler(void *f, int count) {
     YFDatabase *self = (__bridge YFDatabase*)f;
     
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    
     if (count == 0) {
-        self->_startBusyRetryTime = [NSDate timeIntervalSinceReferenceDate];
-        return 1;
+        self->_startBusyRetryTime = now;
+        self->_busyEventCount++;
     }
     
-    NSTimeInterval delta = [NSDate timeIntervalSinceReferenceDate] - (self->_startBusyRetryTime);
+    NSTimeInterval delta = now - (self->_startBusyRetryTime);
+    self->_longestBusyWait = MAX(self->_longestBusyWait, delta);
     
-    if (delta < [self maxBusyRetryTimeInterval]) {
-        int requestedSleepInMillseconds = (int) arc4random_uniform(50) + 50;
-        int actualSleepInMilliseconds = sqlite3_sleep(requestedSleepInMillseconds);
-        if (actualSleepInMilliseconds != requestedSleepInMillseconds) {
-            NSLog(@"WARNING: Requested sleep of %i milliseconds, but SQLite returned %i. Maybe SQLite wasn't built with HAVE_USLEEP=1?", requestedSleepInMillseconds, actualSleepInMilliseconds);
-        }
-        return 1;
+    if (delta >= [self maxBusyRetryTimeInterval]) {
+        self->_busyTimeoutCount++;
+        return 0;
+    }
+    
+    NSTimeInterval delay = [self->_busyPolicy delayForRetry:count elapsed:delta];
+    
+    // never sleep past the deadline
+    delay = MIN(delay, [self maxBusyRetryTimeInterval] - delta);
+    
+    if (delay > 0) {
+        usleep((useconds_t)(delay * USEC_PER_SEC));
+    }
+    else {
+        sched_yield();
     }
     
-    return 0;
+    self->_busyRetryCount++;
+    self->_totalBusyWaitTime += [NSDate timeIntervalSinceReferenceDate] - now;
+    
+    return 1;
+}
+
+- (void)stepDidFailWithResult:(int)rc {
+#ifdef SQLITE_BUSY_SNAPSHOT
+    if ((rc & 0xff) == SQLITE_BUSY && sqlite3_extended_errcode(_db) == SQLITE_BUSY_SNAPSHOT) {
+        _busySnapshotCount++;
+    }
+#endif
+}
+
+- (NSUInteger)busyEventCount {
+    return _busyEventCount;
+}
+
+- (NSUInteger)busyRetryCount {
+    return _busyRetryCount;
+}
+
+- (NSUInteger)busyTimeoutCount {
+    return _busyTimeoutCount;
+}
+
+- (NSUInteger)busySnapshotCount {
+    return _busySnapshotCount;
+}
+
+- (NSTimeInterval)totalBusyWaitTime {
+    return _totalBusyWaitTime;
+}
+
+- (NSTimeInterval)longestBusyWait {
+    return _longestBusyWait;
+}
+
+- (void)resetBusyStatistics {
+    _busyEventCount     = 0;
+    _busyRetryCount     = 0;
+    _busyTimeoutCount   = 0;
+    _busySnapshotCount  = 0;
+    _totalBusyWaitTime  = 0;
+    _longestBusyWait    = 0;
+}
+
+- (void)setProfiler:(YFDatabaseProfiler *)profiler {
+    
+    if (_db && _profiler) {
+        [_profiler uninstallFromDatabase:_db];
+    }
+    
+    _profiler = profiler;
+    
+    if (_db && _profiler) {
+        [_profiler installOnDatabase:_db];
+    }
+}
+
+- (void)setResultCache:(YFQueryResultCache *)resultCache {
+    
+    if (_db && _resultCache) {
+        [_resultCache uninstallFromDatabase:_db];
+    }
+    
+    _resultCache = resultCache;
+    
+    if (_db && _resultCache) {
+        [_resultCache installOnDatabase:_db];
+    }
+}
+
+- (void)setBusyPolicy:(YFBusyPolicy *)busyPolicy {
+    _busyPolicy = busyPolicy ? busyPolicy : [YFBusyPolicy defaultPolicy];
 }
 
 - (void)setMaxBusyRetryTimeInterval:(NSTimeInterval)timeout {
@@ -353,31 +593,56 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
     [_openResultSets removeObject:setValue];
 }
 
-#pragma mark Cached statements
-
-- (void)clearCachedStatements {
+- (void)closeOpenPreparedStatements {
     
-    for (NSMutableSet *statements in [_cachedStatements objectEnumerator]) {
-        for (YFStatement *statement in [statements allObjects]) {
-            [statement close];
-        }
+    NSSet *openSetCopy = [_openPreparedStatements copy];
+    for (NSValue *wrappedStatement in openSetCopy) {
+        YFPreparedStatement *ps = (YFPreparedStatement *)[wrappedStatement pointerValue];
+        
+        [ps close];
+        
+        [_openPreparedStatements removeObject:wrappedStatement];
     }
-    
-    [_cachedStatements removeAllObjects];
 }
 
-- (YFStatement*)cachedStatementForQuery:(NSString*)query {
-    
-    NSMutableSet* statements = [_cachedStatements objectForKey:query];
+- (void)preparedStatementDidClose:(YFPreparedStatement *)preparedStatement {
+    [_openPreparedStatements removeObject:[NSValue valueWithNonretainedObject:preparedStatement]];
+}
+
+- (void)closeOpenBlobHandles {
     
-    return [[statements objectsPassingTest:^BOOL(YFStatement* statement, BOOL *stop) {
+    NSSet *openSetCopy = [_openBlobHandles copy];
+    for (NSValue *wrappedHandle in openSetCopy) {
+        YFBlobHandle *handle = (YFBlobHandle *)[wrappedHandle pointerValue];
         
-        *stop = ![statement inUse];
-        return *stop;
+        [handle close];
         
-    }] anyObject];
+        [_openBlobHandles removeObject:wrappedHandle];
+    }
 }
 
+- (void)blobHandleDidClose:(YFBlobHandle *)blobHandle {
+    [_openBlobHandles removeObject:[NSValue valueWithNonretainedObject:blobHandle]];
+}
+
+#pragma mark Cached statements
+
+- (void)clearCachedStatements {
+    [_statementCache removeAllStatements];
+    [self clearCachedScripts];
+}
+
+- (void)clearCachedScripts {
+    // finalize now rather than whenever the objects go away, which may be after the handle is closed
+    for (NSArray<YFStatement *> *statements in [_cachedScripts objectEnumerator]) {
+        [statements makeObjectsPerformSelector:@selector(close)];
+    }
+    [_cachedScripts removeAllObjects];
+}
+
+- (YFStatement*)cachedStatementForQuery:(NSString*)query {
+    return [_statementCache checkoutStatementForQuery:query];
+}
 
 - (void)setCachedStatement:(YFStatement*)statement forQuery:(NSString*)query {
     NSParameterAssert(query);
@@ -386,17 +651,66 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
         return;
     }
     
-    query = [query copy]; // in case we got handed in a mutable string...
-    [statement setQuery:query];
+    [_statementCache addStatement:statement forQuery:query];
+}
+
+- (YFStatementCache *)statementCache {
+    return _statementCache;
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-implementations"
+
+- (NSMutableDictionary *)cachedStatements {
+    NSDictionary *statementsByQuery = [_statementCache statementsByQuery];
+    NSMutableDictionary *snapshot = [NSMutableDictionary dictionaryWithCapacity:[statementsByQuery count]];
+    
+    for (NSString *query in statementsByQuery) {
+        [snapshot setObject:[[statementsByQuery objectForKey:query] mutableCopy] forKey:query];
+    }
+    
+    return snapshot;
+}
+
+// Kept for code that assigns the dictionary, as it could before the statement cache existed.
+- (void)setCachedStatements:(NSMutableDictionary *)cachedStatements {
+    
+    if (![cachedStatements count]) {
+        [self clearCachedStatements];
+        return;
+    }
     
-    NSMutableSet* statements = [_cachedStatements objectForKey:query];
-    if (!statements) {
-        statements = [NSMutableSet set];
+    if (!_statementCache) {
+        _statementCache = [[YFStatementCache alloc] init];
+        [_statementCache setMaximumCount:_maximumCachedStatementCount];
     }
     
-    [statements addObject:statement];
+    // detach the statements being handed back first, so clearing the cache does not close them
+    for (NSString *query in cachedStatements) {
+        for (YFStatement *statement in [cachedStatements objectForKey:query]) {
+            [_statementCache removeStatement:statement];
+        }
+    }
+    [self clearCachedStatements];
     
-    [_cachedStatements setObject:statements forKey:query];
+    for (NSString *query in cachedStatements) {
+        for (YFStatement *statement in [cachedStatements objectForKey:query]) {
+            if (![statement statement]) {
+                continue;
+            }
+            [_statementCache addStatement:statement forQuery:query];
+            if (![statement inUse]) {
+                [_statementCache statementDidBecomeIdle:statement];
+            }
+        }
+    }
+}
+
+#pragma clang diagnostic pop
+
+- (void)setMaximumCachedStatementCount:(NSUInteger)count {
+    _maximumCachedStatementCount = count;
+    [_statementCache setMaximumCount:count];
 }
 
 #pragma mark Key routines
@@ -466,6 +780,13 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
 
 - (void)setDateFormat:(NSDateFormatter *)format {
     _dateFormat = format;
+    
+    if (format) {
+        _dateStorage = YFDateStorageFormatter;
+    }
+    else if (_dateStorage == YFDateStorageFormatter) {
+        _dateStorage = YFDateStorageTimestamp;
+    }
 }
 
 - (NSDate *)dateFromString:(NSString *)s {
@@ -476,6 +797,46 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
     return [_dateFormat stringFromDate:date];
 }
 
+- (NSDate *)dateForColumn:(int)columnIdx inStatement:(sqlite3_stmt *)pStmt {
+    
+    int type = sqlite3_column_type(pStmt, columnIdx);
+    
+    if (type == SQLITE_NULL) {
+        return nil;
+    }
+    
+    switch (_dateStorage) {
+        case YFDateStorageISO8601:
+        case YFDateStorageEpochMilliseconds: {
+            if (type == SQLITE_TEXT || type == SQLITE_BLOB) {
+                // parsed straight from SQLite's buffer, no NSString in between
+                const char *text = (const char *)sqlite3_column_text(pStmt, columnIdx);
+                int length = sqlite3_column_bytes(pStmt, columnIdx);
+                NSTimeInterval timeInterval;
+                
+                if (!YFDateParseISO8601(text, (NSUInteger)length, &timeInterval)) {
+                    return nil;
+                }
+                return [NSDate dateWithTimeIntervalSince1970:timeInterval];
+            }
+            if (type == SQLITE_INTEGER && _dateStorage == YFDateStorageEpochMilliseconds) {
+                return [NSDate dateWithTimeIntervalSince1970:YFDateTimeIntervalFromEpochMilliseconds(sqlite3_column_int64(pStmt, columnIdx))];
+            }
+            break;
+        }
+        case YFDateStorageFormatter:
+            if (_dateFormat) {
+                const char *text = (const char *)sqlite3_column_text(pStmt, columnIdx);
+                return text ? [self dateFromString:[NSString stringWithUTF8String:text]] : nil;
+            }
+            break;
+        case YFDateStorageTimestamp:
+            break;
+    }
+    
+    return [NSDate dateWithTimeIntervalSince1970:sqlite3_column_double(pStmt, columnIdx)];
+}
+
 #pragma mark State of database
 
 - (BOOL)goodConnection {
@@ -606,13 +967,63 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
 
 #pragma mark SQL manipulation
 
+// Bind a string without going through -description. CFStringGetCStringPtr hands back the
+// string's own storage when it is already UTF-8 compatible, so nothing is converted.
+static int YFDBBindString(sqlite3_stmt *pStmt, int idx, NSString *string, sqlite3_destructor_type destructor) {
+#ifdef __APPLE__
+    const char *bytes = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingUTF8);
+    if (bytes) {
+        return sqlite3_bind_text(pStmt, idx, bytes, -1, destructor);
+    }
+#endif
+    return sqlite3_bind_text(pStmt, idx, [string UTF8String], -1, destructor);
+}
+
+static int YFDBBindNumber(sqlite3_stmt *pStmt, int idx, NSNumber *number) {
+    const char *objCType = [number objCType];
+    
+    // every NSNumber encoding we know about is a single character, so dispatch on it once
+    if (objCType[0] != '\0' && objCType[1] == '\0') {
+        switch (objCType[0]) {
+            case 'c': return sqlite3_bind_int(pStmt, idx, [number charValue]);
+            case 'C': return sqlite3_bind_int(pStmt, idx, [number unsignedCharValue]);
+            case 'B': return sqlite3_bind_int(pStmt, idx, ([number boolValue] ? 1 : 0));
+            case 's': return sqlite3_bind_int(pStmt, idx, [number shortValue]);
+            case 'S': return sqlite3_bind_int(pStmt, idx, [number unsignedShortValue]);
+            case 'i': return sqlite3_bind_int(pStmt, idx, [number intValue]);
+            case 'I': return sqlite3_bind_int64(pStmt, idx, (long long)[number unsignedIntValue]);
+            case 'l': return sqlite3_bind_int64(pStmt, idx, [number longValue]);
+            case 'L': return sqlite3_bind_int64(pStmt, idx, (long long)[number unsignedLongValue]);
+            case 'q': return sqlite3_bind_int64(pStmt, idx, [number longLongValue]);
+            case 'Q': return sqlite3_bind_int64(pStmt, idx, (long long)[number unsignedLongLongValue]);
+            case 'f': return sqlite3_bind_double(pStmt, idx, [number floatValue]);
+            case 'd': return sqlite3_bind_double(pStmt, idx, [number doubleValue]);
+            default: break;
+        }
+    }
+    
+    return sqlite3_bind_text(pStmt, idx, [[number description] UTF8String], -1, SQLITE_TRANSIENT);
+}
+
 - (int)bindObject:(id)obj toColumn:(int)idx inStatement:(sqlite3_stmt*)pStmt {
+    return [self bindObject:obj toColumn:idx inStatement:pStmt copyBytes:YES];
+}
+
+// When copyBytes is NO, string and blob bytes are bound with SQLITE_STATIC; the caller must keep
+// obj alive until the statement has been stepped (e.g. executeUpdate:, which steps before returning).
+- (int)bindObject:(id)obj toColumn:(int)idx inStatement:(sqlite3_stmt*)pStmt copyBytes:(BOOL)copyBytes {
+    
+    sqlite3_destructor_type destructor = copyBytes ? SQLITE_TRANSIENT : SQLITE_STATIC;
     
     if ((!obj) || ((NSNull *)obj == [NSNull null])) {
         return sqlite3_bind_null(pStmt, idx);
     }
-    
-    // FIXME - someday check the return codes on these binds.
+    else if ([obj isKindOfClass:[NSString class]]) {
+        return YFDBBindString(pStmt, idx, obj, destructor);
+    }
+    else if ([obj isKindOfClass:[NSNumber class]]) {
+        return YFDBBindNumber(pStmt, idx, obj);
+    }
     else if ([obj isKindOfClass:[NSData class]]) {
         const void *bytes = [obj bytes];
         if (!bytes) {
@@ -620,138 +1031,175 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
             // Don't pass a NULL pointer, or sqlite will bind a SQL null instead of a blob.
             bytes = "";
         }
-        return sqlite3_bind_blob(pStmt, idx, bytes, (int)[obj length], SQLITE_TRANSIENT);
+        return sqlite3_bind_blob(pStmt, idx, bytes, (int)[obj length], destructor);
     }
     else if ([obj isKindOfClass:[NSDate class]]) {
-        if (self.hasDateFormatter)
-            return sqlite3_bind_text(pStmt, idx, [[self stringFromDate:obj] UTF8String], -1, SQLITE_TRANSIENT);
-        else
-            return sqlite3_bind_double(pStmt, idx, [obj timeIntervalSince1970]);
-    }
-    else if ([obj isKindOfClass:[NSNumber class]]) {
+        NSTimeInterval timeInterval = [obj timeIntervalSince1970];
         
-        if (strcmp([obj objCType], @encode(char)) == 0) {
-            return sqlite3_bind_int(pStmt, idx, [obj charValue]);
-        }
-        else if (strcmp([obj objCType], @encode(unsigned char)) == 0) {
-            return sqlite3_bind_int(pStmt, idx, [obj unsignedCharValue]);
-        }
-        else if (strcmp([obj objCType], @encode(short)) == 0) {
-            return sqlite3_bind_int(pStmt, idx, [obj shortValue]);
-        }
-        else if (strcmp([obj objCType], @encode(unsigned short)) == 0) {
-            return sqlite3_bind_int(pStmt, idx, [obj unsignedShortValue]);
-        }
-        else if (strcmp([obj objCType], @encode(int)) == 0) {
-            return sqlite3_bind_int(pStmt, idx, [obj intValue]);
-        }
-        else if (strcmp([obj objCType], @encode(unsigned int)) == 0) {
-            return sqlite3_bind_int64(pStmt, idx, (long long)[obj unsignedIntValue]);
-        }
-        else if (strcmp([obj objCType], @encode(long)) == 0) {
-            return sqlite3_bind_int64(pStmt, idx, [obj longValue]);
-        }
-        else if (strcmp([obj objCType], @encode(unsigned long)) == 0) {
-            return sqlite3_bind_int64(pStmt, idx, (long long)[obj unsignedLongValue]);
-        }
-        else if (strcmp([obj objCType], @encode(long long)) == 0) {
-            return sqlite3_bind_int64(pStmt, idx, [obj longLongValue]);
-        }
-        else if (strcmp([obj objCType], @encode(unsigned long long)) == 0) {
-            return sqlite3_bind_int64(pStmt, idx, (long long)[obj unsignedLongLongValue]);
-        }
-        else if (strcmp([obj objCType], @encode(float)) == 0) {
-            return sqlite3_bind_double(pStmt, idx, [obj floatValue]);
-        }
-        else if (strcmp([obj objCType], @encode(double)) == 0) {
-            return sqlite3_bind_double(pStmt, idx, [obj doubleValue]);
-        }
-        else if (strcmp([obj objCType], @encode(BOOL)) == 0) {
-            return sqlite3_bind_int(pStmt, idx, ([obj boolValue] ? 1 : 0));
-        }
-        else {
-            return sqlite3_bind_text(pStmt, idx, [[obj description] UTF8String], -1, SQLITE_TRANSIENT);
+        switch (_dateStorage) {
+            case YFDateStorageFormatter:
+                if (_dateFormat) {
+                    return sqlite3_bind_text(pStmt, idx, [[self stringFromDate:obj] UTF8String], -1, SQLITE_TRANSIENT);
+                }
+                break;
+            case YFDateStorageISO8601: {
+                char text[YFDateISO8601Length + 1];
+                NSUInteger length = YFDateFormatISO8601(timeInterval, text);
+                if (length) {
+                    return sqlite3_bind_text(pStmt, idx, text, (int)length, SQLITE_TRANSIENT);
+                }
+                // years ISO-8601 text cannot hold are stored as timestamps
+                break;
+            }
+            case YFDateStorageEpochMilliseconds:
+                return sqlite3_bind_int64(pStmt, idx, YFDateEpochMillisecondsFromTimeInterval(timeInterval));
+            case YFDateStorageTimestamp:
+                break;
         }
+        
+        return sqlite3_bind_double(pStmt, idx, timeInterval);
+    }
+    else if ([obj isKindOfClass:[YFZeroBlob class]]) {
+#if SQLITE_VERSION_NUMBER >= 3008011
+        return sqlite3_bind_zeroblob64(pStmt, idx, (sqlite3_uint64)[(YFZeroBlob *)obj length]);
+#else
+        return sqlite3_bind_zeroblob(pStmt, idx, (int)[(YFZeroBlob *)obj length]);
+#endif
+    }
+    else if ([obj isKindOfClass:[YFArrayParameter class]]) {
+        return [(YFArrayParameter *)obj bindToStatement:pStmt index:idx];
     }
 
     return sqlite3_bind_text(pStmt, idx, [[obj description] UTF8String], -1, SQLITE_TRANSIENT);
 }
 
-- (void)extractSQL:(NSString *)sql argumentsList:(va_list)args intoString:(NSMutableString *)cleanedSQL arguments:(NSMutableArray *)arguments {
+#pragma mark Format plans
+
+/** What a placeholder of a @c ...WithFormat:  template pulls off the @c va_list . */
+
+typedef NS_ENUM(uint8_t, YFFormatArgument) {
+    YFFormatArgumentObject,             // %@
+    YFFormatArgumentChar,               // %c
+    YFFormatArgumentCString,            // %s
+    YFFormatArgumentInt,                // %d %D %i
+    YFFormatArgumentUnsignedInt,        // %u %U
+    YFFormatArgumentShort,              // %hi
+    YFFormatArgumentUnsignedShort,      // %hu
+    YFFormatArgumentLong,               // %ld
+    YFFormatArgumentUnsignedLong,       // %lu
+    YFFormatArgumentLongLong,           // %lld %qi
+    YFFormatArgumentUnsignedLongLong,   // %llu %qu
+    YFFormatArgumentDouble,             // %f
+    YFFormatArgumentFloat               // %g
+};
+
+/** A @c ...WithFormat:  template compiled once: the SQL with a @c ?  per placeholder, and what each one binds. Immutable, so shared by every database. */
+
+@interface YFFormatPlan : NSObject {
+@public
+    NSString            *_sql;
+    NSUInteger          _count;
+    YFFormatArgument    *_arguments;
+}
+@end
+
+@implementation YFFormatPlan
+
+- (void)dealloc {
+    free(_arguments);
+}
+
+@end
+
+static const NSUInteger YFFormatPlanMaximumCachedCount = 256;
+
+// Same scan as it has always been, quirks included (a "%%" still leaves the next character a
+// conversion), but run once per template instead of once per call.
+static YFFormatPlan *YFFormatPlanCompile(NSString *format) {
+    
+    NSUInteger length = [format length];
+    unichar *chars = malloc(sizeof(unichar) * (length + 1));
+    unichar *cleaned = malloc(sizeof(unichar) * (length + 1));
+    YFFormatArgument *arguments = malloc(sizeof(YFFormatArgument) * (length / 2 + 1));
+    NSUInteger cleanedLength = 0;
+    NSUInteger count = 0;
+    
+    [format getCharacters:chars range:NSMakeRange(0, length)];
     
-    NSUInteger length = [sql length];
     unichar last = '\0';
     for (NSUInteger i = 0; i < length; ++i) {
-        id arg = nil;
-        unichar current = [sql characterAtIndex:i];
+        BOOL hasArgument = YES;
+        YFFormatArgument argument = YFFormatArgumentObject;
+        unichar current = chars[i];
         unichar add = current;
         if (last == '%') {
             switch (current) {
                 case '@':
-                    arg = va_arg(args, id);
+                    argument = YFFormatArgumentObject;
                     break;
                 case 'c':
-                    // warning: second argument to 'va_arg' is of promotable type 'char'; this va_arg has undefined behavior because arguments will be promoted to 'int'
-                    arg = [NSString stringWithFormat:@"%c", va_arg(args, int)];
+                    argument = YFFormatArgumentChar;
                     break;
                 case 's':
-                    arg = [NSString stringWithUTF8String:va_arg(args, char*)];
+                    argument = YFFormatArgumentCString;
                     break;
                 case 'd':
                 case 'D':
                 case 'i':
-                    arg = [NSNumber numberWithInt:va_arg(args, int)];
+                    argument = YFFormatArgumentInt;
                     break;
                 case 'u':
                 case 'U':
-                    arg = [NSNumber numberWithUnsignedInt:va_arg(args, unsigned int)];
+                    argument = YFFormatArgumentUnsignedInt;
                     break;
                 case 'h':
                     i++;
-                    if (i < length && [sql characterAtIndex:i] == 'i') {
-                        //  warning: second argument to 'va_arg' is of promotable type 'short'; this va_arg has undefined behavior because arguments will be promoted to 'int'
-                        arg = [NSNumber numberWithShort:(short)(va_arg(args, int))];
+                    if (i < length && chars[i] == 'i') {
+                        argument = YFFormatArgumentShort;
                     }
-                    else if (i < length && [sql characterAtIndex:i] == 'u') {
-                        // warning: second argument to 'va_arg' is of promotable type 'unsigned short'; this va_arg has undefined behavior because arguments will be promoted to 'int'
-                        arg = [NSNumber numberWithUnsignedShort:(unsigned short)(va_arg(args, uint))];
+                    else if (i < length && chars[i] == 'u') {
+                        argument = YFFormatArgumentUnsignedShort;
                     }
                     else {
                         i--;
+                        hasArgument = NO;
                     }
                     break;
                 case 'q':
                     i++;
-                    if (i < length && [sql characterAtIndex:i] == 'i') {
-                        arg = [NSNumber numberWithLongLong:va_arg(args, long long)];
+                    if (i < length && chars[i] == 'i') {
+                        argument = YFFormatArgumentLongLong;
                     }
-                    else if (i < length && [sql characterAtIndex:i] == 'u') {
-                        arg = [NSNumber numberWithUnsignedLongLong:va_arg(args, unsigned long long)];
+                    else if (i < length && chars[i] == 'u') {
+                        argument = YFFormatArgumentUnsignedLongLong;
                     }
                     else {
                         i--;
+                        hasArgument = NO;
                     }
                     break;
                 case 'f':
-                    arg = [NSNumber numberWithDouble:va_arg(args, double)];
+                    argument = YFFormatArgumentDouble;
                     break;
                 case 'g':
-                    // warning: second argument to 'va_arg' is of promotable type 'float'; this va_arg has undefined behavior because arguments will be promoted to 'double'
-                    arg = [NSNumber numberWithFloat:(float)(va_arg(args, double))];
+                    argument = YFFormatArgumentFloat;
                     break;
                 case 'l':
                     i++;
+                    hasArgument = NO;
                     if (i < length) {
-                        unichar next = [sql characterAtIndex:i];
+                        unichar next = chars[i];
                         if (next == 'l') {
                             i++;
-                            if (i < length && [sql characterAtIndex:i] == 'd') {
+                            if (i < length && chars[i] == 'd') {
                                 //%lld
-                                arg = [NSNumber numberWithLongLong:va_arg(args, long long)];
+                                argument = YFFormatArgumentLongLong;
+                                hasArgument = YES;
                             }
-                            else if (i < length && [sql characterAtIndex:i] == 'u') {
+                            else if (i < length && chars[i] == 'u') {
                                 //%llu
-                                arg = [NSNumber numberWithUnsignedLongLong:va_arg(args, unsigned long long)];
+                                argument = YFFormatArgumentUnsignedLongLong;
+                                hasArgument = YES;
                             }
                             else {
                                 i--;
@@ -759,11 +1207,13 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
                         }
                         else if (next == 'd') {
                             //%ld
-                            arg = [NSNumber numberWithLong:va_arg(args, long)];
+                            argument = YFFormatArgumentLong;
+                            hasArgument = YES;
                         }
                         else if (next == 'u') {
                             //%lu
-                            arg = [NSNumber numberWithUnsignedLong:va_arg(args, unsigned long)];
+                            argument = YFFormatArgumentUnsignedLong;
+                            hasArgument = YES;
                         }
                         else {
                             i--;
@@ -775,56 +1225,185 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
                     break;
                 default:
                     // something else that we can't interpret. just pass it on through like normal
+                    hasArgument = NO;
                     break;
             }
         }
-        else if (current == '%') {
-            // percent sign; skip this character
-            add = '\0';
+        else {
+            hasArgument = NO;
+            if (current == '%') {
+                // percent sign; skip this character
+                add = '\0';
+            }
         }
         
-        if (arg != nil) {
-            [cleanedSQL appendString:@"?"];
-            [arguments addObject:arg];
-        }
-        else if (add == (unichar)'@' && last == (unichar) '%') {
-            [cleanedSQL appendFormat:@"NULL"];
+        if (hasArgument) {
+            // a nil %@ used to be written into the SQL as NULL; binding NULL comes to the same thing
+            cleaned[cleanedLength++] = '?';
+            arguments[count++] = argument;
         }
         else if (add != '\0') {
-            [cleanedSQL appendFormat:@"%C", add];
+            cleaned[cleanedLength++] = add;
         }
         last = current;
     }
+    
+    YFFormatPlan *plan = [[YFFormatPlan alloc] init];
+    plan->_sql = [[NSString alloc] initWithCharacters:cleaned length:cleanedLength];
+    plan->_count = count;
+    plan->_arguments = arguments;
+    
+    free(chars);
+    free(cleaned);
+    
+    return plan;
 }
 
-#pragma mark Execute queries
-
-- (YFResultSet *)executeQuery:(NSString *)sql withParameterDictionary:(NSDictionary *)arguments {
-    return [self executeQuery:sql withArgumentsInArray:nil orDictionary:arguments orVAList:nil shouldBind:true];
-}
-
-- (YFResultSet *)executeQuery:(NSString *)sql withArgumentsInArray:(NSArray*)arrayArgs orDictionary:(NSDictionary *)dictionaryArgs orVAList:(va_list)args shouldBind:(BOOL)shouldBind {
-    if (![self databaseExists]) {
-        return 0x00;
-    }
+static YFFormatPlan *YFFormatPlanForFormat(NSString *format) {
     
-    if (_isExecutingStatement) {
-        [self warnInUse];
-        return 0x00;
-    }
+    static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    static NSMutableDictionary<NSString *, YFFormatPlan *> *plans = 0x00;
     
-    _isExecutingStatement = YES;
+    pthread_mutex_lock(&lock);
+    YFFormatPlan *plan = [plans objectForKey:format];
+    pthread_mutex_unlock(&lock);
     
-    int rc                  = 0x00;
-    sqlite3_stmt *pStmt     = 0x00;
-    YFStatement *statement  = 0x00;
-    YFResultSet *rs         = 0x00;
+    if (plan) {
+        return plan;
+    }
     
-    if (_traceExecution && sql) {
-        NSLog(@"%@ executeQuery: %@", self, sql);
+    plan = YFFormatPlanCompile(format);
+    
+    pthread_mutex_lock(&lock);
+    if (!plans) {
+        plans = [NSMutableDictionary dictionary];
     }
+    else if ([plans count] >= YFFormatPlanMaximumCachedCount) {
+        // templates are string literals in practice; anything generating them should not grow this forever
+        [plans removeAllObjects];
+    }
+    [plans setObject:plan forKey:[format copy]];
+    pthread_mutex_unlock(&lock);
     
-    if (_shouldCacheStatements) {
+    return plan;
+}
+
+// Binds straight from the va_list, without boxing anything into NSNumber or NSString.
+- (BOOL)bindStatement:(sqlite3_stmt *)pStmt withFormatPlan:(YFFormatPlan *)plan arguments:(va_list)args copyBindings:(BOOL)copyBindings {
+    
+    sqlite3_destructor_type destructor = copyBindings ? SQLITE_TRANSIENT : SQLITE_STATIC;
+    
+    if ((int)plan->_count != sqlite3_bind_parameter_count(pStmt)) {
+        NSLog(@"Error: the bind count is not correct for the # of variables (executeQuery)");
+        return false;
+    }
+    
+    for (NSUInteger i = 0; i < plan->_count; i++) {
+        int idx = (int)i + 1;
+        int rc;
+        
+        switch (plan->_arguments[i]) {
+            case YFFormatArgumentObject:
+                rc = [self bindObject:va_arg(args, id) toColumn:idx inStatement:pStmt copyBytes:copyBindings];
+                break;
+            case YFFormatArgumentChar: {
+                // the same text %c used to produce: bytes past ASCII are Latin-1, so they take two UTF-8 bytes
+                unsigned char c = (unsigned char)va_arg(args, int);
+                char text[2];
+                int textLength = 1;
+                if (c < 0x80) {
+                    text[0] = (char)c;
+                }
+                else {
+                    text[0] = (char)(0xC0 | (c >> 6));
+                    text[1] = (char)(0x80 | (c & 0x3F));
+                    textLength = 2;
+                }
+                rc = sqlite3_bind_text(pStmt, idx, text, textLength, SQLITE_TRANSIENT);
+                break;
+            }
+            case YFFormatArgumentCString: {
+                const char *text = va_arg(args, const char *);
+                rc = text ? sqlite3_bind_text(pStmt, idx, text, -1, destructor) : sqlite3_bind_null(pStmt, idx);
+                break;
+            }
+            case YFFormatArgumentInt:
+                rc = sqlite3_bind_int(pStmt, idx, va_arg(args, int));
+                break;
+            case YFFormatArgumentUnsignedInt:
+                rc = sqlite3_bind_int64(pStmt, idx, (long long)va_arg(args, unsigned int));
+                break;
+            case YFFormatArgumentShort:
+                rc = sqlite3_bind_int(pStmt, idx, (short)va_arg(args, int));
+                break;
+            case YFFormatArgumentUnsignedShort:
+                rc = sqlite3_bind_int(pStmt, idx, (unsigned short)va_arg(args, int));
+                break;
+            case YFFormatArgumentLong:
+                rc = sqlite3_bind_int64(pStmt, idx, va_arg(args, long));
+                break;
+            case YFFormatArgumentUnsignedLong:
+                rc = sqlite3_bind_int64(pStmt, idx, (long long)va_arg(args, unsigned long));
+                break;
+            case YFFormatArgumentLongLong:
+                rc = sqlite3_bind_int64(pStmt, idx, va_arg(args, long long));
+                break;
+            case YFFormatArgumentUnsignedLongLong:
+                rc = sqlite3_bind_int64(pStmt, idx, (long long)va_arg(args, unsigned long long));
+                break;
+            case YFFormatArgumentDouble:
+                rc = sqlite3_bind_double(pStmt, idx, va_arg(args, double));
+                break;
+            case YFFormatArgumentFloat:
+                rc = sqlite3_bind_double(pStmt, idx, (float)va_arg(args, double));
+                break;
+        }
+        
+        if (rc != SQLITE_OK) {
+            NSLog(@"Error: unable to bind (%d, %s", rc, sqlite3_errmsg(_db));
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+#pragma mark Execute queries
+
+- (YFResultSet *)executeQuery:(NSString *)sql withParameterDictionary:(NSDictionary *)arguments {
+    return [self executeQuery:sql withArgumentsInArray:nil orDictionary:arguments orVAList:nil shouldBind:true];
+}
+
+- (YFResultSet *)executeQuery:(NSString *)sql withArgumentsInArray:(NSArray*)arrayArgs orDictionary:(NSDictionary *)dictionaryArgs orVAList:(va_list)args shouldBind:(BOOL)shouldBind {
+    return [self executeQuery:sql withArgumentsInArray:arrayArgs orDictionary:dictionaryArgs orVAList:args shouldBind:shouldBind copyBindings:YES];
+}
+
+- (YFResultSet *)executeQuery:(NSString *)sql withArgumentsInArray:(NSArray*)arrayArgs orDictionary:(NSDictionary *)dictionaryArgs orVAList:(va_list)args shouldBind:(BOOL)shouldBind copyBindings:(BOOL)copyBindings {
+    return [self executeQuery:sql withArgumentsInArray:arrayArgs orDictionary:dictionaryArgs orVAList:args shouldBind:shouldBind copyBindings:copyBindings formatPlan:nil];
+}
+
+- (YFResultSet *)executeQuery:(NSString *)sql withArgumentsInArray:(NSArray*)arrayArgs orDictionary:(NSDictionary *)dictionaryArgs orVAList:(va_list)args shouldBind:(BOOL)shouldBind copyBindings:(BOOL)copyBindings formatPlan:(YFFormatPlan *)plan {
+    if (![self databaseExists]) {
+        return 0x00;
+    }
+    
+    if (_isExecutingStatement) {
+        [self warnInUse];
+        return 0x00;
+    }
+    
+    _isExecutingStatement = YES;
+    
+    int rc                  = 0x00;
+    sqlite3_stmt *pStmt     = 0x00;
+    YFStatement *statement  = 0x00;
+    YFResultSet *rs         = 0x00;
+    
+    if (_traceExecution && sql) {
+        NSLog(@"%@ executeQuery: %@", self, sql);
+    }
+    
+    if (_shouldCacheStatements) {
         statement = [self cachedStatementForQuery:sql];
         pStmt = statement ? [statement statement] : 0x00;
         [statement reset];
@@ -853,8 +1432,18 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
     }
 
     if (shouldBind) {
-        BOOL success = [self bindStatement:pStmt WithArgumentsInArray:arrayArgs orDictionary:dictionaryArgs orVAList:args];
+        BOOL success = plan ? [self bindStatement:pStmt withFormatPlan:plan arguments:args copyBindings:copyBindings] : [self bindStatement:pStmt WithArgumentsInArray:arrayArgs orDictionary:dictionaryArgs orVAList:args copyBindings:copyBindings];
         if (!success) {
+            if (statement) {
+                // a cached statement we failed to bind is dropped rather than handed back half bound
+                [_statementCache removeStatement:statement];
+                [statement close];
+            }
+            else {
+                sqlite3_finalize(pStmt);
+            }
+            pStmt = 0x00;
+            _isExecutingStatement = NO;
             return nil;
         }
     }
@@ -884,6 +1473,10 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
 }
 
 - (BOOL)bindStatement:(sqlite3_stmt *)pStmt WithArgumentsInArray:(NSArray*)arrayArgs orDictionary:(NSDictionary *)dictionaryArgs orVAList:(va_list)args {
+    return [self bindStatement:pStmt WithArgumentsInArray:arrayArgs orDictionary:dictionaryArgs orVAList:args copyBindings:YES];
+}
+
+- (BOOL)bindStatement:(sqlite3_stmt *)pStmt WithArgumentsInArray:(NSArray*)arrayArgs orDictionary:(NSDictionary *)dictionaryArgs orVAList:(va_list)args copyBindings:(BOOL)copyBindings {
     id obj;
     int idx = 0;
     int queryCount = sqlite3_bind_parameter_count(pStmt); // pointed out by Dominic Yu (thanks!)
@@ -905,12 +1498,9 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
 
             if (namedIdx > 0) {
                 // Standard binding from here.
-                int rc = [self bindObject:[dictionaryArgs objectForKey:dictionaryKey] toColumn:namedIdx inStatement:pStmt];
+                int rc = [self bindObject:[dictionaryArgs objectForKey:dictionaryKey] toColumn:namedIdx inStatement:pStmt copyBytes:copyBindings];
                 if (rc != SQLITE_OK) {
                     NSLog(@"Error: unable to bind (%d, %s", rc, sqlite3_errmsg(_db));
-                    sqlite3_finalize(pStmt);
-                    pStmt = 0x00;
-                    _isExecutingStatement = NO;
                     return false;
                 }
                 // increment the binding count, so our check below works out
@@ -945,12 +1535,9 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
 
             idx++;
 
-            int rc = [self bindObject:obj toColumn:idx inStatement:pStmt];
+            int rc = [self bindObject:obj toColumn:idx inStatement:pStmt copyBytes:copyBindings];
             if (rc != SQLITE_OK) {
                 NSLog(@"Error: unable to bind (%d, %s", rc, sqlite3_errmsg(_db));
-                sqlite3_finalize(pStmt);
-                pStmt = 0x00;
-                _isExecutingStatement = NO;
                 return false;
             }
         }
@@ -958,9 +1545,6 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
 
     if (idx != queryCount) {
         NSLog(@"Error: the bind count is not correct for the # of variables (executeQuery)");
-        sqlite3_finalize(pStmt);
-        pStmt = 0x00;
-        _isExecutingStatement = NO;
         return false;
     }
 
@@ -981,13 +1565,11 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
     va_list args;
     va_start(args, format);
     
-    NSMutableString *sql = [NSMutableString stringWithCapacity:[format length]];
-    NSMutableArray *arguments = [NSMutableArray array];
-    [self extractSQL:format argumentsList:args intoString:sql arguments:arguments];
+    YFFormatPlan *plan = YFFormatPlanForFormat(format);
+    id result = [self executeQuery:plan->_sql withArgumentsInArray:nil orDictionary:nil orVAList:args shouldBind:true copyBindings:YES formatPlan:plan];
     
     va_end(args);
-    
-    return [self executeQuery:sql withArgumentsInArray:arguments];
+    return result;
 }
 
 - (YFResultSet *)executeQuery:(NSString *)sql withArgumentsInArray:(NSArray *)arguments {
@@ -1006,10 +1588,65 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
     return [self executeQuery:sql withArgumentsInArray:nil orDictionary:nil orVAList:args shouldBind:true];
 }
 
+#pragma mark Cached queries
+
+- (NSArray<NSDictionary *> *)executeCachedQuery:(NSString *)sql withArgumentsInArray:(NSArray *)arguments error:(NSError * __autoreleasing *)outErr {
+    
+    if (_resultCache) {
+        return [_resultCache rowsForQuery:sql arguments:arguments database:self error:outErr];
+    }
+    
+    return [self uncachedRowsForQuery:sql arguments:arguments error:outErr];
+}
+
+- (NSDictionary<NSString *, NSNumber *> *)registeredFunctions {
+    return _registeredFunctions;
+}
+
+- (void)didRegisterFunctionNamed:(NSString *)name deterministic:(BOOL)deterministic {
+    
+    if (!_registeredFunctions) {
+        _registeredFunctions = [NSMutableDictionary dictionary];
+    }
+    
+    [_registeredFunctions setObject:@(deterministic) forKey:[name lowercaseString]];
+    
+    // kept results, and which queries may be kept, can depend on the function this replaces
+    [_resultCache functionsDidChange];
+}
+
+- (NSArray<NSDictionary *> *)uncachedRowsForQuery:(NSString *)sql arguments:(NSArray *)arguments error:(NSError * __autoreleasing *)outErr {
+    
+    YFResultSet *rs = [self executeQuery:sql values:arguments error:outErr];
+    if (!rs) {
+        return nil;
+    }
+    
+    NSMutableArray *rows = [NSMutableArray array];
+    NSError *error = nil;
+    
+    // immutable copies, since cached rows are handed to every later caller
+    while ([rs nextWithError:&error]) {
+        [rows addObject:[[rs resultDictionary] copy]];
+    }
+    
+    [rs close];
+    
+    if (error) {
+        if (outErr) {
+            *outErr = error;
+        }
+        return nil;
+    }
+    
+    return [rows copy];
+}
+
 #pragma mark Execute updates
 
 - (BOOL)executeUpdate:(NSString*)sql error:(NSError * _Nullable __autoreleasing *)outErr withArgumentsInArray:(NSArray*)arrayArgs orDictionary:(NSDictionary *)dictionaryArgs orVAList:(va_list)args {
-    YFResultSet *rs = [self executeQuery:sql withArgumentsInArray:arrayArgs orDictionary:dictionaryArgs orVAList:args shouldBind:true];
+    // the statement is stepped before we return, while the caller still owns the arguments, so skip the copies
+    YFResultSet *rs = [self executeQuery:sql withArgumentsInArray:arrayArgs orDictionary:dictionaryArgs orVAList:args shouldBind:true copyBindings:NO];
     if (!rs) {
         if (outErr) {
             *outErr = [self lastError];
@@ -1017,7 +1654,11 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
         return false;
     }
 
-    return [rs internalStepWithError:outErr] == SQLITE_DONE;
+    int rc = [rs internalStepWithError:outErr];
+    // a statement returning rows is not closed by the step; release the bindings either way
+    [rs close];
+    
+    return rc == SQLITE_DONE;
 }
 
 - (BOOL)executeUpdate:(NSString*)sql, ... {
@@ -1050,36 +1691,158 @@ static int YFDBDatabaseBusyHandler(void *f, int count) {
     va_list args;
     va_start(args, format);
     
-    NSMutableString *sql      = [NSMutableString stringWithCapacity:[format length]];
-    NSMutableArray *arguments = [NSMutableArray array];
-    
-    [self extractSQL:format argumentsList:args intoString:sql arguments:arguments];
+    // stepped before we return, while the arguments are still alive, so nothing is copied
+    YFFormatPlan *plan = YFFormatPlanForFormat(format);
+    YFResultSet *rs = [self executeQuery:plan->_sql withArgumentsInArray:nil orDictionary:nil orVAList:args shouldBind:true copyBindings:NO formatPlan:plan];
     
     va_end(args);
     
-    return [self executeUpdate:sql withArgumentsInArray:arguments];
+    if (!rs) {
+        return NO;
+    }
+    
+    int rc = [rs internalStepWithError:nil];
+    [rs close];
+    
+    return rc == SQLITE_DONE;
 }
 
 
-int YFDBExecuteBulkSQLCallback(void *theBlockAsVoid, int columns, char **values, char **names); // shhh clang.
-int YFDBExecuteBulkSQLCallback(void *theBlockAsVoid, int columns, char **values, char **names) {
+/** State carried across the rows of @c executeStatements:withResultBlock: . */
+
+@interface YFDBExecuteStatementsContext : NSObject {
+@public
+    YFDBExecuteStatementsCallbackBlock  _block;
     
-    if (!theBlockAsVoid) {
+    // copies of the column names of the statement sqlite3_exec is on, so a row is checked against them without touching _keyIndexes
+    char                                **_names;
+    int                                 _columnCount;
+    NSDictionary                        *_keyIndexes;
+}
+@end
+
+@implementation YFDBExecuteStatementsContext
+
+- (void)dealloc {
+    for (int i = 0; i < _columnCount; i++) {
+        free(_names[i]);
+    }
+    free(_names);
+}
+
+@end
+
+/** Read-only dictionary view of one row handed to the @c executeStatements:withResultBlock:  block; values become strings only when they are looked up. */
+
+@interface YFDBExecuteStatementsRow : NSDictionary {
+@public
+    NSDictionary    *_keyIndexes;
+    char            **_values;          // sqlite3_exec's, valid only while the block runs
+    NSArray         *_detachedValues;   // taken when the block keeps the row
+}
+@end
+
+@implementation YFDBExecuteStatementsRow
+
+// NSDictionary's -init lands here, the class cluster's primitive initializer; the row holds no objects of its own, so there is nothing to take
+- (instancetype)initWithObjects:(const id _Nonnull __unsafe_unretained *)objects forKeys:(const id<NSCopying> _Nonnull __unsafe_unretained *)keys count:(NSUInteger)cnt {
+    return self;
+}
+
+- (NSUInteger)count {
+    return [_keyIndexes count];
+}
+
+- (id)objectForKey:(id)aKey {
+    NSNumber *index = [_keyIndexes objectForKey:aKey];
+    if (index == nil) {
+        return nil;
+    }
+    
+    NSUInteger idx = [index unsignedIntegerValue];
+    
+    if (_detachedValues) {
+        return [_detachedValues objectAtIndex:idx];
+    }
+    
+    char *value = _values ? _values[idx] : 0x00;
+    id object = value ? [NSString stringWithUTF8String:value] : nil;
+    
+    return object ? object : [NSNull null];
+}
+
+- (NSEnumerator *)keyEnumerator {
+    return [_keyIndexes keyEnumerator];
+}
+
+/** Copy every value out of sqlite3_exec's buffers, which go away once the block returns. */
+
+- (void)detachWithColumnCount:(int)columns {
+    NSMutableArray *values = [NSMutableArray arrayWithCapacity:(NSUInteger)columns];
+    
+    for (int i = 0; i < columns; i++) {
+        id object = _values[i] ? [NSString stringWithUTF8String:_values[i]] : nil;
+        [values addObject:object ? object : [NSNull null]];
+    }
+    
+    _detachedValues = values;
+    _values = 0x00;
+}
+
+@end
+
+int YFDBExecuteBulkSQLCallback(void *theContextAsVoid, int columns, char **values, char **names); // shhh clang.
+int YFDBExecuteBulkSQLCallback(void *theContextAsVoid, int columns, char **values, char **names) {
+    
+    if (!theContextAsVoid) {
         return SQLITE_OK;
     }
     
-    int (^execCallbackBlock)(NSDictionary *resultsDictionary) = (__bridge int (^)(NSDictionary *__strong))(theBlockAsVoid);
+    YFDBExecuteStatementsContext *context = (__bridge YFDBExecuteStatementsContext *)theContextAsVoid;
     
-    NSMutableDictionary *dictionary = [NSMutableDictionary dictionaryWithCapacity:(NSUInteger)columns];
+    // only build the keys again when sqlite3_exec moves on to a statement with other columns
+    BOOL sameColumns = (context->_names && columns == context->_columnCount);
+    for (int i = 0; sameColumns && i < columns; i++) {
+        sameColumns = strcmp(names[i], context->_names[i]) == 0;
+    }
     
-    for (NSInteger i = 0; i < columns; i++) {
-        NSString *key = [NSString stringWithUTF8String:names[i]];
-        id value = values[i] ? [NSString stringWithUTF8String:values[i]] : [NSNull null];
-        value = value ? value : [NSNull null];
-        [dictionary setObject:value forKey:key];
+    if (!sameColumns) {
+        for (int i = 0; i < context->_columnCount; i++) {
+            free(context->_names[i]);
+        }
+        free(context->_names);
+        
+        // a later column of the same name wins, as it did when each row was set into a dictionary
+        NSMutableDictionary *keyIndexes = [NSMutableDictionary dictionaryWithCapacity:(NSUInteger)columns];
+        context->_names = malloc(sizeof(char *) * (size_t)columns);
+        for (int i = 0; i < columns; i++) {
+            context->_names[i] = strdup(names[i]);
+            [keyIndexes setObject:[NSNumber numberWithInt:i] forKey:[NSString stringWithUTF8String:names[i]]];
+        }
+        
+        context->_columnCount = columns;
+        context->_keyIndexes = [keyIndexes copy];
     }
     
-    return execCallbackBlock(dictionary);
+    int rc;
+    __weak YFDBExecuteStatementsRow *keptRow = nil;
+    
+    @autoreleasepool {
+        YFDBExecuteStatementsRow *row = [[YFDBExecuteStatementsRow alloc] init];
+        row->_keyIndexes = context->_keyIndexes;
+        row->_values = values;
+        keptRow = row;
+        
+        rc = context->_block(row);
+    }
+    
+    // still alive once the block's references are gone means the block kept it: copy the values before sqlite3_exec reuses them
+    YFDBExecuteStatementsRow *row = keptRow;
+    if (row) {
+        [row detachWithColumnCount:columns];
+    }
+    
+    return rc;
 }
 
 - (BOOL)executeStatements:(NSString *)sql {
@@ -1088,33 +1851,401 @@ int YFDBExecuteBulkSQLCallback(void *theBlockAsVoid, int columns, char **values,
 
 - (BOOL)executeStatements:(NSString *)sql withResultBlock:(__attribute__((noescape)) YFDBExecuteStatementsCallbackBlock)block {
     
-    int rc;
-    char *errmsg = nil;
+    int rc;
+    char *errmsg = nil;
+    
+    YFDBExecuteStatementsContext *context = 0x00;
+    if (block) {
+        context = [[YFDBExecuteStatementsContext alloc] init];
+        context->_block = block;
+    }
+    
+    rc = sqlite3_exec([self sqliteHandle], [sql UTF8String], block ? YFDBExecuteBulkSQLCallback : nil, (__bridge void *)(context), &errmsg);
+    
+    if (errmsg && [self logsErrors]) {
+        NSLog(@"Error inserting batch: %s", errmsg);
+    }
+    if (errmsg) {
+        sqlite3_free(errmsg);
+    }
+    
+    return (rc == SQLITE_OK);
+}
+
+#pragma mark Scripts
+
+static const NSUInteger YFDatabaseMaximumCachedScriptCount = 32;
+
+- (BOOL)executeScript:(NSString *)sql error:(NSError * _Nullable __autoreleasing *)outErr {
+    return [self executeScript:sql withParameterDictionary:nil rowBlock:nil error:outErr];
+}
+
+- (BOOL)executeScript:(NSString *)sql withParameterDictionary:(NSDictionary<NSString *, id> *)arguments rowBlock:(__attribute__((noescape)) YFScriptRowBlock)rowBlock error:(NSError * _Nullable __autoreleasing *)outErr {
+    
+    if (![self databaseExists]) {
+        return NO;
+    }
+    
+    if (_isExecutingStatement) {
+        [self warnInUse];
+        return NO;
+    }
+    
+    NSArray<YFStatement *> *statements = [_cachedScripts objectForKey:sql];
+    
+    if (statements) {
+        NSUInteger statementIndex = 0;
+        
+        for (YFStatement *statement in statements) {
+            YFPreparedStatement *ps = 0x00;
+            
+            if ([statement inUse]) {
+                // the same script run again from inside its own row block
+                ps = [self prepareStatement:[statement query] error:outErr];
+                if (!ps) {
+                    return NO;
+                }
+            }
+            else {
+                ps = [self preparedStatementWithStatement:statement query:[statement query]];
+            }
+            
+            BOOL success = [self runScriptStatement:ps index:statementIndex++ arguments:arguments rowBlock:rowBlock error:outErr];
+            [ps close];
+            
+            if (!success) {
+                return NO;
+            }
+        }
+        
+        return YES;
+    }
+    
+    if (_traceExecution) {
+        NSLog(@"%@ executeScript: %@", self, sql);
+    }
+    
+    // First run: walk the script with prepare_v2's tail pointer. Each statement runs before the next one
+    // is prepared, since it may create a table the next one uses.
+    NSMutableArray<YFStatement *> *split = [NSMutableArray array];
+    const char *zSql = [sql UTF8String];
+    
+    while (zSql && *zSql) {
+        sqlite3_stmt *pStmt = 0x00;
+        const char *zTail = 0x00;
+        
+        int rc = sqlite3_prepare_v2(_db, zSql, -1, &pStmt, &zTail);
+        
+        if (SQLITE_OK != rc) {
+            if (_logsErrors) {
+                NSLog(@"DB Error: %d \"%@\"", [self lastErrorCode], [self lastErrorMessage]);
+                NSLog(@"DB Query: %s", zSql);
+                NSLog(@"DB Path: %@", _databasePath);
+            }
+            
+            if (outErr) {
+                *outErr = [self lastError];
+            }
+            
+            sqlite3_finalize(pStmt);
+            [split makeObjectsPerformSelector:@selector(close)];
+            return NO;
+        }
+        
+        if (!pStmt) {
+            // nothing but whitespace or a comment left
+            zSql = zTail;
+            continue;
+        }
+        
+        NSString *statementSQL = [[NSString alloc] initWithBytes:zSql length:(NSUInteger)(zTail - zSql) encoding:NSUTF8StringEncoding];
+        statementSQL = [statementSQL stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+        zSql = zTail;
+        
+        YFStatement *statement = [[YFStatement alloc] init];
+        [statement setStatement:pStmt];
+        [statement setQuery:statementSQL];
+        
+        YFPreparedStatement *ps = [self preparedStatementWithStatement:statement query:statementSQL];
+        
+        BOOL success = [self runScriptStatement:ps index:[split count] arguments:arguments rowBlock:rowBlock error:outErr];
+        [ps close];
+        
+        if (!success) {
+            [split makeObjectsPerformSelector:@selector(close)];
+            [statement close];
+            return NO;
+        }
+        
+        [split addObject:statement];
+    }
+    
+    if (!_cachedScripts) {
+        _cachedScripts = [NSMutableDictionary dictionary];
+    }
+    else if ([_cachedScripts count] >= YFDatabaseMaximumCachedScriptCount) {
+        // scripts are few and fixed in practice; a program generating them should not grow this forever
+        [self clearCachedScripts];
+    }
+    [_cachedScripts setObject:[split copy] forKey:[sql copy]];
+    
+    return YES;
+}
+
+- (BOOL)runScriptStatement:(YFPreparedStatement *)ps index:(NSUInteger)statementIndex arguments:(NSDictionary<NSString *, id> *)arguments rowBlock:(YFScriptRowBlock)rowBlock error:(NSError * _Nullable __autoreleasing *)outErr {
+    
+    sqlite3_stmt *pStmt = [[ps statement] statement];
+    
+    if (arguments) {
+        int count = sqlite3_bind_parameter_count(pStmt);
+        
+        for (int idx = 1; idx <= count; idx++) {
+            const char *name = sqlite3_bind_parameter_name(pStmt, idx);
+            if (!name) {
+                // a plain ?, left NULL
+                continue;
+            }
+            
+            // skip the :, @, $ or ? prefix
+            id value = [arguments objectForKey:[NSString stringWithUTF8String:name + 1]];
+            if (value && ![ps bindObject:value atIndex:idx]) {
+                if (outErr) {
+                    *outErr = [self lastError];
+                }
+                return NO;
+            }
+        }
+    }
+    
+    while (YES) {
+        int rc = [ps internalStepWithError:outErr];
+        
+        if (SQLITE_ROW != rc) {
+            return SQLITE_DONE == rc;
+        }
+        
+        if (rowBlock && !rowBlock(ps, statementIndex)) {
+            if (outErr) {
+                NSDictionary* errorMessage = [NSDictionary dictionaryWithObject:@"script stopped by the row block" forKey:NSLocalizedDescriptionKey];
+                *outErr = [NSError errorWithDomain:@"YFDatabase" code:SQLITE_ABORT userInfo:errorMessage];
+            }
+            return NO;
+        }
+    }
+}
+
+- (BOOL)executeUpdate:(NSString*)sql withErrorAndBindings:(NSError * _Nullable __autoreleasing *)outErr, ... {
+    
+    va_list args;
+    va_start(args, outErr);
+    
+    BOOL result = [self executeUpdate:sql error:outErr withArgumentsInArray:nil orDictionary:nil orVAList:args];
+    
+    va_end(args);
+    return result;
+}
+
+
+#pragma mark Batch updates
+
+- (YFPreparedStatement *)beginBatch:(NSString *)sql result:(YFBatchResult *)result savePointName:(NSString * __autoreleasing *)savePointName {
+    
+    static unsigned long batchIdx = 0;
+    NSError *err = 0x00;
+    
+    YFPreparedStatement *ps = [self prepareStatement:sql error:&err];
+    if (!ps) {
+        result.error = err;
+        return nil;
+    }
+    
+    // inside somebody else's transaction, a save point lets us undo just our rows
+    if (_isInTransaction) {
+        *savePointName = [NSString stringWithFormat:@"dbBatch%lu", batchIdx++];
+        if (![self startSavePointWithName:*savePointName error:&err]) {
+            [ps close];
+            result.error = err;
+            return nil;
+        }
+    }
+    else if (![self beginImmediateTransaction]) {
+        [ps close];
+        result.error = [self lastError];
+        return nil;
+    }
+    
+    return ps;
+}
+
+- (BOOL)stepBatchRow:(NSUInteger)rowIndex statement:(YFPreparedStatement *)ps result:(YFBatchResult *)result {
+    
+    NSError *err = 0x00;
+    
+    if (![ps stepWithError:&err]) {
+        result.failedRowIndex = rowIndex;
+        result.error = err ? err : [self lastError];
+        return NO;
+    }
+    
+    result.changes += sqlite3_changes(_db);
+    result.rowCount += 1;
+    
+    [ps reset];
+    
+    return YES;
+}
+
+- (YFBatchResult *)finishBatch:(YFPreparedStatement *)ps result:(YFBatchResult *)result savePointName:(NSString *)savePointName error:(NSError * _Nullable __autoreleasing *)outErr {
+    
+    [ps close];
+    
+    BOOL failed = result.error != nil;
+    
+    if (savePointName) {
+        if (failed) {
+            [self rollbackToSavePointWithName:savePointName error:nil];
+        }
+        [self releaseSavePointWithName:savePointName error:nil];
+    }
+    else if (failed) {
+        [self rollback];
+    }
+    else if (![self commit]) {
+        result.error = [self lastError];
+        [self rollback];
+    }
+    
+    result.succeeded = result.error == nil;
+    
+    if (outErr && result.error) {
+        *outErr = result.error;
+    }
+    
+    return result;
+}
+
+- (BOOL)bindBatchRow:(id)row parameterNames:(NSArray *)parameterNames statement:(YFPreparedStatement *)ps rowIndex:(NSUInteger)rowIndex result:(YFBatchResult *)result {
+    
+    sqlite3_stmt *pStmt = [[ps statement] statement];
+    int queryCount = (int)[parameterNames count];
+    int rc = SQLITE_OK;
+    
+    if ([row isKindOfClass:[NSArray class]]) {
+        if ((int)[row count] != queryCount) {
+            NSString *message = [NSString stringWithFormat:@"The bind count is not correct for the # of variables (row %lu)", (unsigned long)rowIndex];
+            result.failedRowIndex = rowIndex;
+            result.error = [NSError errorWithDomain:@"YFDatabase" code:SQLITE_RANGE userInfo:@{NSLocalizedDescriptionKey : message}];
+            if (_logsErrors) NSLog(@"Error: %@", message);
+            return NO;
+        }
+        
+        int idx = 0;
+        for (id obj in row) {
+            idx++;
+            // the row outlives the step, so SQLite can borrow its bytes
+            rc = [self bindObject:obj toColumn:idx inStatement:pStmt copyBytes:NO];
+            if (rc != SQLITE_OK) {
+                break;
+            }
+        }
+    }
+    else if ([row isKindOfClass:[NSDictionary class]]) {
+        for (int idx = 0; idx < queryCount && rc == SQLITE_OK; idx++) {
+            id name = [parameterNames objectAtIndex:(NSUInteger)idx];
+            id obj = (name != [NSNull null]) ? [row objectForKey:name] : nil;
+            rc = [self bindObject:obj toColumn:idx + 1 inStatement:pStmt copyBytes:NO];
+        }
+    }
+    else {
+        NSString *message = [NSString stringWithFormat:@"Batch row %lu is neither an NSArray nor an NSDictionary", (unsigned long)rowIndex];
+        result.failedRowIndex = rowIndex;
+        result.error = [NSError errorWithDomain:@"YFDatabase" code:SQLITE_MISUSE userInfo:@{NSLocalizedDescriptionKey : message}];
+        if (_logsErrors) NSLog(@"Error: %@", message);
+        return NO;
+    }
+    
+    if (rc != SQLITE_OK) {
+        NSLog(@"Error: unable to bind (%d, %s", rc, sqlite3_errmsg(_db));
+        result.failedRowIndex = rowIndex;
+        result.error = [self lastError];
+        return NO;
+    }
+    
+    return YES;
+}
+
+- (YFBatchResult *)executeBatch:(NSString *)sql rows:(id<NSFastEnumeration>)rows error:(NSError * _Nullable __autoreleasing *)outErr {
+    
+    YFBatchResult *result = [[YFBatchResult alloc] init];
+    result.failedRowIndex = NSNotFound;
     
-    rc = sqlite3_exec([self sqliteHandle], [sql UTF8String], block ? YFDBExecuteBulkSQLCallback : nil, (__bridge void *)(block), &errmsg);
+    NSString *savePointName = 0x00;
+    YFPreparedStatement *ps = [self beginBatch:sql result:result savePointName:&savePointName];
+    if (!ps) {
+        // nothing was started, so there is nothing to roll back
+        if (outErr) {
+            *outErr = result.error;
+        }
+        return result;
+    }
     
-    if (errmsg && [self logsErrors]) {
-        NSLog(@"Error inserting batch: %s", errmsg);
+    // resolve the parameter names once rather than formatting ":key" for every row
+    sqlite3_stmt *pStmt = [[ps statement] statement];
+    int queryCount = sqlite3_bind_parameter_count(pStmt);
+    NSMutableArray *parameterNames = [NSMutableArray arrayWithCapacity:(NSUInteger)queryCount];
+    for (int idx = 1; idx <= queryCount; idx++) {
+        const char *name = sqlite3_bind_parameter_name(pStmt, idx);
+        [parameterNames addObject:name ? (id)[NSString stringWithUTF8String:name + 1] : (id)[NSNull null]];
     }
-    if (errmsg) {
-        sqlite3_free(errmsg);
+    
+    NSUInteger rowIndex = 0;
+    for (id row in rows) {
+        if (![self bindBatchRow:row parameterNames:parameterNames statement:ps rowIndex:rowIndex result:result]) {
+            break;
+        }
+        if (![self stepBatchRow:rowIndex statement:ps result:result]) {
+            break;
+        }
+        rowIndex++;
     }
     
-    return (rc == SQLITE_OK);
+    return [self finishBatch:ps result:result savePointName:savePointName error:outErr];
 }
 
-- (BOOL)executeUpdate:(NSString*)sql withErrorAndBindings:(NSError * _Nullable __autoreleasing *)outErr, ... {
+- (YFBatchResult *)executeBatch:(NSString *)sql withRowBinder:(__attribute__((noescape)) BOOL (^)(YFPreparedStatement *statement, NSUInteger rowIndex))binder error:(NSError * _Nullable __autoreleasing *)outErr {
     
-    va_list args;
-    va_start(args, outErr);
+    YFBatchResult *result = [[YFBatchResult alloc] init];
+    result.failedRowIndex = NSNotFound;
     
-    BOOL result = [self executeUpdate:sql error:outErr withArgumentsInArray:nil orDictionary:nil orVAList:args];
+    NSString *savePointName = 0x00;
+    YFPreparedStatement *ps = [self beginBatch:sql result:result savePointName:&savePointName];
+    if (!ps) {
+        // nothing was started, so there is nothing to roll back
+        if (outErr) {
+            *outErr = result.error;
+        }
+        return result;
+    }
+    
+    NSUInteger rowIndex = 0;
+    while (binder(ps, rowIndex)) {
+        // a bind the block did not check leaves the row half bound; stepping it would store the wrong values
+        NSError *bindError = [ps bindError];
+        if (bindError) {
+            if (_logsErrors) NSLog(@"Error: %@ (row %lu)", [bindError localizedDescription], (unsigned long)rowIndex);
+            result.failedRowIndex = rowIndex;
+            result.error = bindError;
+            break;
+        }
+        if (![self stepBatchRow:rowIndex statement:ps result:result]) {
+            break;
+        }
+        rowIndex++;
+    }
     
-    va_end(args);
-    return result;
+    return [self finishBatch:ps result:result savePointName:savePointName error:outErr];
 }
 
-
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wdeprecated-implementations"
 - (BOOL)update:(NSString*)sql withErrorAndBindings:(NSError * _Nullable __autoreleasing *)outErr, ... {
@@ -1135,6 +2266,110 @@ int YFDBExecuteBulkSQLCallback(void *theBlockAsVoid, int columns, char **values,
     return [self executeQuery:sql withArgumentsInArray:nil orDictionary:nil orVAList:nil shouldBind:false];
 }
 
+- (YFPreparedStatement *)prepareStatement:(NSString *)sql error:(NSError * _Nullable __autoreleasing *)outErr {
+    if (![self databaseExists]) {
+        return 0x00;
+    }
+    
+    if (_isExecutingStatement) {
+        [self warnInUse];
+        return 0x00;
+    }
+    
+    if (_traceExecution && sql) {
+        NSLog(@"%@ prepareStatement: %@", self, sql);
+    }
+    
+    YFStatement *statement = 0x00;
+    
+    if (_shouldCacheStatements) {
+        statement = [self cachedStatementForQuery:sql];
+        [statement reset];
+    }
+    
+    if (!statement) {
+        sqlite3_stmt *pStmt = 0x00;
+        int rc = sqlite3_prepare_v2(_db, [sql UTF8String], -1, &pStmt, 0);
+        
+        if (SQLITE_OK != rc) {
+            if (_logsErrors) {
+                NSLog(@"DB Error: %d \"%@\"", [self lastErrorCode], [self lastErrorMessage]);
+                NSLog(@"DB Query: %@", sql);
+                NSLog(@"DB Path: %@", _databasePath);
+            }
+            
+            if (outErr) {
+                *outErr = [self lastError];
+            }
+            
+            if (_crashOnErrors) {
+                NSAssert(false, @"DB Error: %d \"%@\"", [self lastErrorCode], [self lastErrorMessage]);
+                abort();
+            }
+            
+            sqlite3_finalize(pStmt);
+            return nil;
+        }
+        
+        statement = [[YFStatement alloc] init];
+        [statement setStatement:pStmt];
+        
+        if (_shouldCacheStatements && sql) {
+            [self setCachedStatement:statement forQuery:sql];
+        }
+    }
+    
+    return [self preparedStatementWithStatement:statement query:sql];
+}
+
+- (YFPreparedStatement *)preparedStatementWithStatement:(YFStatement *)statement query:(NSString *)sql {
+    YFPreparedStatement *ps = [YFPreparedStatement preparedStatementWithStatement:statement query:sql usingParentDatabase:self];
+    [_openPreparedStatements addObject:[NSValue valueWithNonretainedObject:ps]];
+    
+    [statement setUseCount:[statement useCount] + 1];
+    
+    return ps;
+}
+
+#pragma mark Incremental blob I/O
+
+- (YFBlobHandle *)openBlobInTable:(NSString *)table column:(NSString *)column row:(int64_t)rowid writable:(BOOL)writable error:(NSError * _Nullable __autoreleasing *)outErr {
+    return [self openBlobInDatabase:@"main" table:table column:column row:rowid writable:writable error:outErr];
+}
+
+- (YFBlobHandle *)openBlobInDatabase:(NSString *)databaseName table:(NSString *)table column:(NSString *)column row:(int64_t)rowid writable:(BOOL)writable error:(NSError * _Nullable __autoreleasing *)outErr {
+    if (![self databaseExists]) {
+        return 0x00;
+    }
+    
+    if (_traceExecution) {
+        NSLog(@"%@ openBlob: %@.%@.%@ row %lld", self, databaseName, table, column, (long long)rowid);
+    }
+    
+    sqlite3_blob *blob = 0x00;
+    int rc = sqlite3_blob_open(_db, [databaseName UTF8String], [table UTF8String], [column UTF8String], rowid, writable ? 1 : 0, &blob);
+    
+    if (SQLITE_OK != rc) {
+        if (_logsErrors) {
+            NSLog(@"DB Error: %d \"%@\"", [self lastErrorCode], [self lastErrorMessage]);
+            NSLog(@"DB Blob: %@.%@.%@ row %lld", databaseName, table, column, (long long)rowid);
+            NSLog(@"DB Path: %@", _databasePath);
+        }
+        
+        if (outErr) {
+            *outErr = [self lastError];
+        }
+        
+        sqlite3_blob_close(blob);
+        return nil;
+    }
+    
+    YFBlobHandle *handle = [YFBlobHandle blobHandleWithBlob:blob databaseName:databaseName tableName:table columnName:column rowid:rowid writable:writable usingParentDatabase:self];
+    [_openBlobHandles addObject:[NSValue valueWithNonretainedObject:handle]];
+    
+    return handle;
+}
+
 #pragma mark Transactions
 
 - (BOOL)rollback {
@@ -1330,12 +2565,13 @@ static NSString *YFDBEscapeSavePointName(NSString *savepointName) {
     
     _shouldCacheStatements = value;
     
-    if (_shouldCacheStatements && !_cachedStatements) {
-        [self setCachedStatements:[NSMutableDictionary dictionary]];
+    if (_shouldCacheStatements && !_statementCache) {
+        _statementCache = [[YFStatementCache alloc] init];
+        [_statementCache setMaximumCount:_maximumCachedStatementCount];
     }
     
     if (!_shouldCacheStatements) {
-        [self setCachedStatements:nil];
+        _statementCache = nil;
     }
 }
 
@@ -1377,6 +2613,8 @@ void YFDBBlockSQLiteCallBackFunction(sqlite3_context *context, int argc, sqlite3
 #else
     sqlite3_create_function([self sqliteHandle], [name UTF8String], arguments, SQLITE_UTF8, (__bridge void*)b, &YFDBBlockSQLiteCallBackFunction, 0x00, 0x00);
 #endif
+    
+    [self didRegisterFunctionNamed:name deterministic:NO];
 }
 
 - (YFSqliteValueType)valueType:(void *)value {
@@ -1470,14 +2708,114 @@ void YFDBBlockSQLiteCallBackFunction(sqlite3_context *context, int argc, sqlite3
     }
     
     _inUse = NO;
+    
+    _exactColumnNameToIndexMap = nil;
+    _columnNameToIndexMap = nil;
+    _columnNames = nil;
+    _columnKeySet = nil;
+}
+
+/** How many times SQLite has prepared the statement again; changes whenever its columns may have. */
+
+- (int)prepareCount {
+#if SQLITE_VERSION_NUMBER >= 3020000
+    return sqlite3_stmt_status(_statement, SQLITE_STMTSTATUS_REPREPARE, 0);
+#else
+    // without the counter, a change in the number of columns is the best we can see
+    return sqlite3_column_count(_statement);
+#endif
+}
+
+- (void)buildColumnMaps {
+    if (_columnNameToIndexMap && _columnMapsPrepareCount != [self prepareCount]) {
+        _exactColumnNameToIndexMap = nil;
+        _columnNameToIndexMap = nil;
+        _columnNames = nil;
+        _columnKeySet = nil;
+    }
+    
+    if (_columnNameToIndexMap || !_statement) {
+        return;
+    }
+    
+    int columnCount = sqlite3_column_count(_statement);
+    NSMutableDictionary *exactMap = [[NSMutableDictionary alloc] initWithCapacity:(NSUInteger)columnCount];
+    NSMutableDictionary *map = [[NSMutableDictionary alloc] initWithCapacity:(NSUInteger)columnCount];
+    NSMutableArray *columnNames = [[NSMutableArray alloc] initWithCapacity:(NSUInteger)columnCount];
+    
+    for (int columnIdx = 0; columnIdx < columnCount; columnIdx++) {
+        NSString *columnName = [NSString stringWithUTF8String:sqlite3_column_name(_statement, columnIdx)];
+        NSNumber *index = [NSNumber numberWithInt:columnIdx];
+        
+        [columnNames addObject:columnName];
+        [exactMap setObject:index forKey:columnName];
+        [map setObject:index forKey:[columnName lowercaseString]];
+    }
+    
+    _exactColumnNameToIndexMap = [exactMap copy];
+    _columnNameToIndexMap = [map copy];
+    _columnNames = [columnNames copy];
+#ifdef __APPLE__
+    _columnKeySet = [NSMutableDictionary sharedKeySetForKeys:_columnNames];
+#endif
+    _columnMapsPrepareCount = [self prepareCount];
+}
+
+- (NSDictionary *)columnNameToIndexMap {
+    [self buildColumnMaps];
+    return _columnNameToIndexMap;
+}
+
+- (int)columnIndexForName:(NSString *)columnName {
+    [self buildColumnMaps];
+    
+    NSNumber *n = [_exactColumnNameToIndexMap objectForKey:columnName];
+    
+    if (n == nil) {
+        n = [_columnNameToIndexMap objectForKey:[columnName lowercaseString]];
+    }
+    
+    return n != nil ? [n intValue] : -1;
+}
+
+- (int)columnIndexForExactName:(NSString *)columnName {
+    [self buildColumnMaps];
+    
+    NSNumber *n = [_exactColumnNameToIndexMap objectForKey:columnName];
+    
+    return n != nil ? [n intValue] : -1;
+}
+
+- (NSArray *)columnNames {
+    [self buildColumnMaps];
+    return _columnNames;
+}
+
+- (NSMutableDictionary *)emptyRowDictionary {
+    [self buildColumnMaps];
+    
+#ifdef __APPLE__
+    if (_columnKeySet) {
+        return [NSMutableDictionary dictionaryWithSharedKeySet:_columnKeySet];
+    }
+#endif
+    
+    return [NSMutableDictionary dictionaryWithCapacity:[_columnNames count]];
 }
 
 - (void)reset {
     if (_statement) {
         sqlite3_reset(_statement);
+        // a cached statement must not keep the caller's buffers, or an array parameter, bound while it sits idle
+        sqlite3_clear_bindings(_statement);
     }
     
+    BOOL wasInUse = _inUse;
     _inUse = NO;
+    
+    if (wasInUse) {
+        [_cache statementDidBecomeIdle:self];
+    }
 }
 
 - (NSString*)description {
@@ -1485,3 +2823,232 @@ void YFDBBlockSQLiteCallBackFunction(sqlite3_context *context, int argc, sqlite3
 }
 
 @end
+
+// MARK: - YFBatchResult
+
+@implementation YFBatchResult
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ %lu row(s), %lld change(s), failed row %ld, error %@", [super description], (unsigned long)_rowCount, _changes, (long)(_failedRowIndex == NSNotFound ? -1 : (long)_failedRowIndex), _error];
+}
+
+@end
+
+// MARK: - YFStatementCache
+
+@interface YFStatementCacheEntry : NSObject
+@property (nonatomic, strong) NSMutableSet *statements;
+@property (nonatomic, strong) NSMutableArray *idleStatements;
+@end
+
+@implementation YFStatementCacheEntry
+@end
+
+@implementation YFStatementCache {
+    NSMutableDictionary *_entries;
+    
+    // most and least recently used idle statements
+    __unsafe_unretained YFStatement *_lruNewest;
+    __unsafe_unretained YFStatement *_lruOldest;
+}
+
+- (instancetype)init {
+    self = [super init];
+    
+    if (self) {
+        _entries = [[NSMutableDictionary alloc] init];
+    }
+    
+    return self;
+}
+
+- (void)dealloc {
+    for (YFStatementCacheEntry *entry in [_entries objectEnumerator]) {
+        for (YFStatement *statement in entry.statements) {
+            statement->_cache = nil;
+        }
+    }
+}
+
+- (void)setMaximumCount:(NSUInteger)maximumCount {
+    _maximumCount = maximumCount;
+    [self evictIfNeeded];
+}
+
+- (void)linkIdleStatement:(YFStatement *)statement {
+    statement->_lruOlder = _lruNewest;
+    statement->_lruNewer = nil;
+    
+    if (_lruNewest) {
+        _lruNewest->_lruNewer = statement;
+    }
+    _lruNewest = statement;
+    
+    if (!_lruOldest) {
+        _lruOldest = statement;
+    }
+    
+    statement->_idleInCache = YES;
+}
+
+- (void)unlinkIdleStatement:(YFStatement *)statement {
+    if (!statement->_idleInCache) {
+        return;
+    }
+    
+    if (statement->_lruNewer) {
+        statement->_lruNewer->_lruOlder = statement->_lruOlder;
+    }
+    else {
+        _lruNewest = statement->_lruOlder;
+    }
+    
+    if (statement->_lruOlder) {
+        statement->_lruOlder->_lruNewer = statement->_lruNewer;
+    }
+    else {
+        _lruOldest = statement->_lruNewer;
+    }
+    
+    statement->_lruNewer = nil;
+    statement->_lruOlder = nil;
+    statement->_idleInCache = NO;
+}
+
+- (YFStatement *)checkoutStatementForQuery:(NSString *)query {
+    
+    YFStatementCacheEntry *entry = [_entries objectForKey:query];
+    YFStatement *statement;
+    
+    while ((statement = [entry.idleStatements lastObject])) {
+        
+        if ([statement statement]) {
+            [entry.idleStatements removeLastObject];
+            [self unlinkIdleStatement:statement];
+            _hitCount++;
+            
+            return statement;
+        }
+        
+        // somebody closed it behind our back
+        [self removeStatement:statement];
+    }
+    
+    _missCount++;
+    
+    return nil;
+}
+
+- (void)addStatement:(YFStatement *)statement forQuery:(NSString *)query {
+    
+    query = [query copy]; // in case we got handed in a mutable string...
+    [statement setQuery:query];
+    
+    YFStatementCacheEntry *entry = [_entries objectForKey:query];
+    if (!entry) {
+        entry = [[YFStatementCacheEntry alloc] init];
+        entry.statements = [NSMutableSet set];
+        entry.idleStatements = [NSMutableArray array];
+        [_entries setObject:entry forKey:query];
+    }
+    
+    [entry.statements addObject:statement];
+    statement->_cache = self;
+    _count++;
+    
+    [self evictIfNeeded];
+}
+
+- (void)statementDidBecomeIdle:(YFStatement *)statement {
+    
+    YFStatementCacheEntry *entry = [_entries objectForKey:[statement query]];
+    if (!entry || statement->_idleInCache || ![statement statement]) {
+        return;
+    }
+    
+    [entry.idleStatements addObject:statement];
+    [self linkIdleStatement:statement];
+    
+    [self evictIfNeeded];
+}
+
+- (void)removeStatement:(YFStatement *)statement {
+    
+    if (statement->_cache != self) {
+        return;
+    }
+    
+    NSString *query = [statement query];
+    YFStatementCacheEntry *entry = [_entries objectForKey:query];
+    
+    if (statement->_idleInCache) {
+        [self unlinkIdleStatement:statement];
+        [entry.idleStatements removeObjectIdenticalTo:statement];
+    }
+    
+    statement->_cache = nil;
+    
+    if ([entry.statements containsObject:statement]) {
+        _count--;
+        [entry.statements removeObject:statement]; // may release the statement
+    }
+    
+    if (entry && [entry.statements count] == 0) {
+        [_entries removeObjectForKey:query];
+    }
+}
+
+- (void)evictIfNeeded {
+    
+    while (_maximumCount && _count > _maximumCount && _lruOldest) {
+        YFStatement *statement = _lruOldest;
+        
+        [self removeStatement:statement];
+        [statement close];
+        
+        _evictionCount++;
+    }
+}
+
+- (void)removeAllStatements {
+    
+    NSDictionary *entries = _entries;
+    _entries = [[NSMutableDictionary alloc] init];
+    _lruNewest = nil;
+    _lruOldest = nil;
+    _count = 0;
+    
+    for (YFStatementCacheEntry *entry in [entries objectEnumerator]) {
+        for (YFStatement *statement in entry.statements) {
+            statement->_cache = nil;
+            statement->_idleInCache = NO;
+            statement->_lruNewer = nil;
+            statement->_lruOlder = nil;
+            [statement close];
+        }
+    }
+}
+
+- (void)resetStatistics {
+    _hitCount = 0;
+    _missCount = 0;
+    _evictionCount = 0;
+}
+
+- (NSDictionary *)statementsByQuery {
+    
+    NSMutableDictionary *result = [NSMutableDictionary dictionaryWithCapacity:[_entries count]];
+    
+    for (NSString *query in _entries) {
+        YFStatementCacheEntry *entry = [_entries objectForKey:query];
+        [result setObject:[entry.statements copy] forKey:query];
+    }
+    
+    return result;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ %lu statement(s), %lu hit(s), %lu miss(es), %lu eviction(s)", [super description], (unsigned long)_count, (unsigned long)_hitCount, (unsigned long)_missCount, (unsigned long)_evictionCount];
+}
+
+@end
@@ -7,7 +7,9 @@
 
 #import "YFDatabaseAdditions.h"
 #import "YFDatabaseAdditions.h"
+#ifdef __APPLE__
 #import "TargetConditionals.h"
+#endif
 
 #import <sqlite3.h>
 
@@ -22,10 +22,22 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property (atomic, unsafe_unretained, nullable) id delegate;
 
-/** Maximum number of databases to create */
+/** Maximum number of databases to create
+
+ Once this many databases are checked out, further callers wait in line for one to be checked back in, see @c checkoutTimeout . @c 0  means no limit.
+ */
 
 @property (atomic, assign) NSUInteger maximumNumberOfDatabasesToCreate;
 
+/** How long, in seconds, a caller waits for a database when the pool is at @c maximumNumberOfDatabasesToCreate .
+
+ Waiting callers are served in the order they arrived. If the timeout elapses, the @c inDatabase: , transaction and save point methods do not run their block and log the timeout instead. @c 0 , the default, waits indefinitely.
+
+ A nested call, made from inside the block of another on the same thread, never waits: the database that thread holds can't be checked back in until it returns. When every database is checked out, the nested block is not run and the checkout is logged.
+ */
+
+@property (atomic, assign) NSTimeInterval checkoutTimeout;
+
 /** Open flags */
 
 @property (atomic, readonly) int openFlags;
@@ -165,6 +177,44 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property (nonatomic, readonly) NSUInteger countOfOpenDatabases;
 
+///-------------------------
+/// @name Checkout statistics
+///-------------------------
+
+/** Number of callers currently waiting for a database
+ */
+
+@property (nonatomic, readonly) NSUInteger countOfWaitingCallers;
+
+/** Largest number of callers that were ever waiting at the same time
+ */
+
+@property (nonatomic, readonly) NSUInteger maximumWaitQueueDepth;
+
+/** Largest number of databases that were ever checked out at the same time
+ */
+
+@property (nonatomic, readonly) NSUInteger highWaterMarkOfCheckedOutDatabases;
+
+/** Number of checkouts that had to wait for a database
+ */
+
+@property (nonatomic, readonly) NSUInteger countOfWaits;
+
+/** Number of checkouts that gave up after @c checkoutTimeout
+ */
+
+@property (nonatomic, readonly) NSUInteger countOfCheckoutTimeouts;
+
+/** Total time, in seconds, spent by callers waiting for a database
+ */
+
+@property (nonatomic, readonly) NSTimeInterval totalWaitTime;
+
+/** Reset the checkout statistics */
+
+- (void)resetCheckoutStatistics;
+
 /** Release all databases in pool */
 
 - (void)releaseAllDatabases;
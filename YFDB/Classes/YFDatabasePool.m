@@ -17,11 +17,55 @@ typedef NS_ENUM(NSInteger, YFDBTransaction) {
     YFDBTransactionImmediate,
 };
 
+/** A caller parked until a database is checked back in. */
+
+@interface YFDatabasePoolWaiter : NSObject
+#if OS_OBJECT_USE_OBJC
+@property (nonatomic, strong) dispatch_semaphore_t semaphore;
+#else
+@property (nonatomic, assign) dispatch_semaphore_t semaphore;
+#endif
+@property (nonatomic, strong) YFDatabase *db;
+@property (nonatomic) BOOL shouldOpenDatabase;
+@end
+
+@implementation YFDatabasePoolWaiter
+
+- (instancetype)init {
+    self = [super init];
+    
+    if (self) {
+        _semaphore = dispatch_semaphore_create(0);
+    }
+    
+    return self;
+}
+
+#if !OS_OBJECT_USE_OBJC
+- (void)dealloc {
+    dispatch_release(_semaphore);
+}
+#endif
+
+@end
+
 @interface YFDatabasePool () {
     dispatch_queue_t    _lockQueue;
     
     NSMutableArray      *_databaseInPool;
-    NSMutableArray      *_databaseOutPool;
+    NSMutableSet        *_databaseOutPool;
+    NSUInteger          _countOfPendingDatabases;
+    
+    NSMutableArray      *_waiters;
+    
+    // key of the current thread's count of checked out databases, in its threadDictionary
+    NSString            *_threadCheckoutKey;
+    
+    NSUInteger          _maximumWaitQueueDepth;
+    NSUInteger          _highWaterMarkOfCheckedOutDatabases;
+    NSUInteger          _countOfWaits;
+    NSUInteger          _countOfCheckoutTimeouts;
+    NSTimeInterval      _totalWaitTime;
 }
 
 - (void)pushDatabaseBackInPool:(YFDatabase*)db;
@@ -34,6 +78,7 @@ typedef NS_ENUM(NSInteger, YFDBTransaction) {
 @synthesize delegate=_delegate;
 @synthesize maximumNumberOfDatabasesToCreate=_maximumNumberOfDatabasesToCreate;
 @synthesize openFlags=_openFlags;
+@synthesize checkoutTimeout=_checkoutTimeout;
 
 
 + (instancetype)databasePoolWithPath:(NSString *)aPath {
@@ -64,7 +109,9 @@ typedef NS_ENUM(NSInteger, YFDBTransaction) {
         _path               = [aPath copy];
         _lockQueue          = dispatch_queue_create([[NSString stringWithFormat:@"yfdb.%@", self] UTF8String], NULL);
         _databaseInPool     = [NSMutableArray array];
-        _databaseOutPool    = [NSMutableArray array];
+        _databaseOutPool    = [NSMutableSet set];
+        _waiters            = [NSMutableArray array];
+        _threadCheckoutKey  = [NSString stringWithFormat:@"yfdb.pool.checkouts.%p", self];
         _openFlags          = openFlags;
         _vfsName            = [vfsName copy];
     }
@@ -116,78 +163,258 @@ typedef NS_ENUM(NSInteger, YFDBTransaction) {
         return;
     }
     
+    [self threadDidCheckOut:-1];
+    
     [self executeLocked:^() {
         
-        if ([self->_databaseInPool containsObject:db]) {
+        if (![db checkedOut]) {
             [[NSException exceptionWithName:@"Database already in pool" reason:@"The YFDatabase being put back into the pool is already present in the pool" userInfo:nil] raise];
         }
         
+        // hand the database straight to the longest waiting caller, so that a newcomer can't jump the line
+        YFDatabasePoolWaiter *waiter = [self->_waiters firstObject];
+        if (waiter) {
+            [self->_waiters removeObjectAtIndex:0];
+            [self->_databaseOutPool addObject:db];
+            
+            waiter.db = db;
+            dispatch_semaphore_signal(waiter.semaphore);
+            return;
+        }
+        
+        [db setCheckedOut:NO];
         [self->_databaseInPool addObject:db];
         [self->_databaseOutPool removeObject:db];
         
     }];
 }
 
+/** Hand the slot that just became free to the longest waiting caller, which opens a database in it. Call while locked.
+
+ @return @c YES if a caller was waiting.
+ */
+
+- (BOOL)releaseSlotToWaiter {
+    
+    YFDatabasePoolWaiter *waiter = [_waiters firstObject];
+    
+    if (!waiter) {
+        return NO;
+    }
+    
+    [_waiters removeObjectAtIndex:0];
+    
+    // reserved here rather than by the waiter, so a newcomer can't take the slot before it wakes up
+    _countOfPendingDatabases++;
+    waiter.shouldOpenDatabase = YES;
+    dispatch_semaphore_signal(waiter.semaphore);
+    
+    return YES;
+}
+
+/** Count databases checked out or in on the current thread, so a nested checkout can be told apart from a fresh one. */
+
+- (NSUInteger)threadDidCheckOut:(NSInteger)delta {
+    
+    NSMutableDictionary *threadDictionary = [[NSThread currentThread] threadDictionary];
+    NSInteger count = [[threadDictionary objectForKey:_threadCheckoutKey] integerValue] + delta;
+    
+    if (count > 0) {
+        [threadDictionary setObject:@(count) forKey:_threadCheckoutKey];
+    }
+    else {
+        [threadDictionary removeObjectForKey:_threadCheckoutKey];
+        count = 0;
+    }
+    
+    return (NSUInteger)count;
+}
+
 - (YFDatabase*)db {
     
+    YFDatabase *db = [self checkOutDatabase];
+    
+    if (db) {
+        [self threadDidCheckOut:1];
+    }
+    
+    return db;
+}
+
+- (YFDatabase*)checkOutDatabase {
+    
     __block YFDatabase *db;
+    __block YFDatabasePoolWaiter *waiter = 0x00;
+    __block BOOL shouldCreate = NO;
+    __block BOOL wouldDeadlock = NO;
     
+    // the databases this thread holds can't be checked back in while it waits, so a nested checkout must not wait for them
+    BOOL isNested = [self threadDidCheckOut:0] > 0;
     
+    // the lock only moves databases between the lists; opening happens outside of it
     [self executeLocked:^() {
         db = [self->_databaseInPool lastObject];
         
-        BOOL shouldNotifyDelegate = NO;
-        
         if (db) {
-            [self->_databaseOutPool addObject:db];
             [self->_databaseInPool removeLastObject];
         }
         else {
             
             if (self->_maximumNumberOfDatabasesToCreate) {
-                NSUInteger currentCount = [self->_databaseOutPool count] + [self->_databaseInPool count];
+                NSUInteger currentCount = [self->_databaseOutPool count] + [self->_databaseInPool count] + self->_countOfPendingDatabases;
                 
                 if (currentCount >= self->_maximumNumberOfDatabasesToCreate) {
-                    NSLog(@"Maximum number of databases (%ld) has already been reached!", (long)currentCount);
+                    if (isNested) {
+                        wouldDeadlock = YES;
+                        return;
+                    }
+                    
+                    waiter = [[YFDatabasePoolWaiter alloc] init];
+                    [self->_waiters addObject:waiter];
+                    
+                    self->_countOfWaits++;
+                    self->_maximumWaitQueueDepth = MAX(self->_maximumWaitQueueDepth, [self->_waiters count]);
                     return;
                 }
             }
             
-            db = [[[self class] databaseClass] databaseWithPath:self->_path];
-            shouldNotifyDelegate = YES;
+            // reserve the slot so concurrent callers can't overshoot the maximum while we open
+            self->_countOfPendingDatabases++;
+            shouldCreate = YES;
+            return;
         }
         
-        //This ensures that the db is opened before returning
+        [db setCheckedOut:YES];
+        [self->_databaseOutPool addObject:db];
+        self->_highWaterMarkOfCheckedOutDatabases = MAX(self->_highWaterMarkOfCheckedOutDatabases, [self->_databaseOutPool count]);
+    }];
+    
+    if (wouldDeadlock) {
+        NSLog(@"%@: all %lu databases are checked out and this thread already holds one; a nested checkout would wait forever", self, (unsigned long)_maximumNumberOfDatabasesToCreate);
+        return nil;
+    }
+    
+    if (waiter) {
+        return [self waitForDatabase:waiter];
+    }
+    
+    if (shouldCreate) {
+        return [self openNewDatabase];
+    }
+    
+    // somebody may have closed a pooled database behind our back
+    if (![db isOpen] && ![self openDatabase:db]) {
+        [self discardCheckedOutDatabase:db];
+        return nil;
+    }
+    
+    return db;
+}
+
+- (BOOL)openDatabase:(YFDatabase*)db {
+    
+    //This ensures that the db is opened before returning
 #if SQLITE_VERSION_NUMBER >= 3005000
-        BOOL success = [db openWithFlags:self->_openFlags vfs:self->_vfsName];
+    BOOL success = [db openWithFlags:_openFlags vfs:_vfsName];
 #else
-        BOOL success = [db open];
+    BOOL success = [db open];
 #endif
+    if (!success) {
+        NSLog(@"Could not open up the database at path %@", _path);
+    }
+    
+    return success;
+}
+
+- (YFDatabase*)openNewDatabase {
+    
+    YFDatabase *db = [[[self class] databaseClass] databaseWithPath:_path];
+    
+    BOOL success = [self openDatabase:db];
+    
+    if (success && [_delegate respondsToSelector:@selector(databasePool:shouldAddDatabaseToPool:)] && ![_delegate databasePool:self shouldAddDatabaseToPool:db]) {
+        [db close];
+        success = NO;
+    }
+    
+    [self executeLocked:^() {
+        self->_countOfPendingDatabases--;
+        
         if (success) {
-            if ([self->_delegate respondsToSelector:@selector(databasePool:shouldAddDatabaseToPool:)] && ![self->_delegate databasePool:self shouldAddDatabaseToPool:db]) {
-                [db close];
-                db = 0x00;
-            }
-            else {
-                //It should not get added in the pool twice if lastObject was found
-                if (![self->_databaseOutPool containsObject:db]) {
-                    [self->_databaseOutPool addObject:db];
-                    
-                    if (shouldNotifyDelegate && [self->_delegate respondsToSelector:@selector(databasePool:didAddDatabase:)]) {
-                        [self->_delegate databasePool:self didAddDatabase:db];
-                    }
-                }
-            }
+            [db setCheckedOut:YES];
+            [self->_databaseOutPool addObject:db];
+            self->_highWaterMarkOfCheckedOutDatabases = MAX(self->_highWaterMarkOfCheckedOutDatabases, [self->_databaseOutPool count]);
         }
         else {
-            NSLog(@"Could not open up the database at path %@", self->_path);
-            db = 0x00;
+            [self releaseSlotToWaiter];
+        }
+    }];
+    
+    if (!success) {
+        return nil;
+    }
+    
+    if ([_delegate respondsToSelector:@selector(databasePool:didAddDatabase:)]) {
+        [_delegate databasePool:self didAddDatabase:db];
+    }
+    
+    return db;
+}
+
+- (void)discardCheckedOutDatabase:(YFDatabase*)db {
+    
+    [self executeLocked:^() {
+        [db setCheckedOut:NO];
+        [self->_databaseOutPool removeObject:db];
+        [self releaseSlotToWaiter];
+    }];
+}
+
+- (YFDatabase*)waitForDatabase:(YFDatabasePoolWaiter *)waiter {
+    
+    NSTimeInterval timeout = [self checkoutTimeout];
+    NSTimeInterval start = [NSDate timeIntervalSinceReferenceDate];
+    
+    dispatch_time_t deadline = DISPATCH_TIME_FOREVER;
+    if (timeout > 0) {
+        deadline = dispatch_time(DISPATCH_TIME_NOW, (int64_t)(timeout * NSEC_PER_SEC));
+    }
+    
+    dispatch_semaphore_wait(waiter.semaphore, deadline);
+    
+    __block YFDatabase *db;
+    __block BOOL shouldOpenDatabase = NO;
+    
+    [self executeLocked:^() {
+        self->_totalWaitTime += [NSDate timeIntervalSinceReferenceDate] - start;
+        
+        // a checkin may have handed us a database or a slot right as the wait timed out, so look before giving up
+        db = waiter.db;
+        shouldOpenDatabase = waiter.shouldOpenDatabase;
+        
+        if (!db && !shouldOpenDatabase) {
+            [self->_waiters removeObjectIdenticalTo:waiter];
+            self->_countOfCheckoutTimeouts++;
         }
     }];
     
+    if (shouldOpenDatabase) {
+        // the slot is already counted in _countOfPendingDatabases
+        return [self openNewDatabase];
+    }
+    
+    if (!db) {
+        NSLog(@"Timed out after %g seconds waiting for a database from the pool", timeout);
+    }
+    
     return db;
 }
 
+- (NSError*)checkoutFailedError {
+    NSString *errorMessage = NSLocalizedStringFromTable(@"Could not check out a database from the pool", @"YFDB", nil);
+    return [NSError errorWithDomain:@"YFDatabase" code:SQLITE_BUSY userInfo:@{NSLocalizedDescriptionKey : errorMessage}];
+}
+
 - (NSUInteger)countOfCheckedInDatabases {
     
     __block NSUInteger count;
@@ -220,10 +447,87 @@ typedef NS_ENUM(NSInteger, YFDBTransaction) {
     return count;
 }
 
+- (NSUInteger)countOfWaitingCallers {
+    __block NSUInteger count;
+    
+    [self executeLocked:^() {
+        count = [self->_waiters count];
+    }];
+    
+    return count;
+}
+
+- (NSUInteger)maximumWaitQueueDepth {
+    __block NSUInteger count;
+    
+    [self executeLocked:^() {
+        count = self->_maximumWaitQueueDepth;
+    }];
+    
+    return count;
+}
+
+- (NSUInteger)highWaterMarkOfCheckedOutDatabases {
+    __block NSUInteger count;
+    
+    [self executeLocked:^() {
+        count = self->_highWaterMarkOfCheckedOutDatabases;
+    }];
+    
+    return count;
+}
+
+- (NSUInteger)countOfWaits {
+    __block NSUInteger count;
+    
+    [self executeLocked:^() {
+        count = self->_countOfWaits;
+    }];
+    
+    return count;
+}
+
+- (NSUInteger)countOfCheckoutTimeouts {
+    __block NSUInteger count;
+    
+    [self executeLocked:^() {
+        count = self->_countOfCheckoutTimeouts;
+    }];
+    
+    return count;
+}
+
+- (NSTimeInterval)totalWaitTime {
+    __block NSTimeInterval time;
+    
+    [self executeLocked:^() {
+        time = self->_totalWaitTime;
+    }];
+    
+    return time;
+}
+
+- (void)resetCheckoutStatistics {
+    [self executeLocked:^() {
+        self->_maximumWaitQueueDepth                = [self->_waiters count];
+        self->_highWaterMarkOfCheckedOutDatabases   = [self->_databaseOutPool count];
+        self->_countOfWaits                         = 0;
+        self->_countOfCheckoutTimeouts              = 0;
+        self->_totalWaitTime                        = 0;
+    }];
+}
+
 - (void)releaseAllDatabases {
     [self executeLocked:^() {
         [self->_databaseOutPool removeAllObjects];
         [self->_databaseInPool removeAllObjects];
+        
+        // the pool is empty again, so as many waiters as there are free slots may open a database of their own
+        NSUInteger maximum = self->_maximumNumberOfDatabasesToCreate;
+        BOOL woke = YES;
+        while (woke && (!maximum || self->_countOfPendingDatabases < maximum)) {
+            woke = [self releaseSlotToWaiter];
+        }
     }];
 }
 
@@ -231,6 +535,11 @@ typedef NS_ENUM(NSInteger, YFDBTransaction) {
     
     YFDatabase *db = [self db];
     
+    if (!db) {
+        NSLog(@"%@: no database available, block not run", self);
+        return;
+    }
+    
     block(db);
     
     [self pushDatabaseBackInPool:db];
@@ -242,6 +551,11 @@ typedef NS_ENUM(NSInteger, YFDBTransaction) {
     
     YFDatabase *db = [self db];
     
+    if (!db) {
+        NSLog(@"%@: no database available, transaction not run", self);
+        return;
+    }
+    
     switch (transaction) {
         case YFDBTransactionExclusive:
             [db beginTransaction];
@@ -293,6 +607,10 @@ typedef NS_ENUM(NSInteger, YFDBTransaction) {
     
     YFDatabase *db = [self db];
     
+    if (!db) {
+        return [self checkoutFailedError];
+    }
+    
     NSError *err = 0x00;
     
     if (![db startSavePointWithName:name error:&err]) {
@@ -0,0 +1,153 @@
+//
+//  YFDatabaseProfiler.h
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Execution statistics for one distinct SQL text. */
+
+@interface YFQueryStatistics : NSObject
+
+/** The SQL text as prepared, with parameters unbound */
+
+@property (nonatomic, copy, readonly) NSString *query;
+
+/** Number of times the statement ran to completion or was reset */
+
+@property (nonatomic, readonly) NSUInteger callCount;
+
+/** Total wall time, in seconds */
+
+@property (nonatomic, readonly) NSTimeInterval totalTime;
+
+/** Median wall time, in seconds, estimated from a sample of runs */
+
+@property (nonatomic, readonly) NSTimeInterval medianTime;
+
+/** 99th percentile wall time, in seconds, estimated from a sample of runs */
+
+@property (nonatomic, readonly) NSTimeInterval p99Time;
+
+/** Slowest run, in seconds */
+
+@property (nonatomic, readonly) NSTimeInterval maximumTime;
+
+/** Rows returned, over all runs */
+
+@property (nonatomic, readonly) unsigned long long rowCount;
+
+/** Full table scan steps (@c SQLITE_STMTSTATUS_FULLSCAN_STEP ), over all runs */
+
+@property (nonatomic, readonly) unsigned long long fullScanStepCount;
+
+/** Sorts (@c SQLITE_STMTSTATUS_SORT ), over all runs */
+
+@property (nonatomic, readonly) unsigned long long sortCount;
+
+/** Rows inserted into automatic indexes (@c SQLITE_STMTSTATUS_AUTOINDEX ), over all runs */
+
+@property (nonatomic, readonly) unsigned long long autoIndexCount;
+
+/** Plist and JSON friendly form of the statistics */
+
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
+
+/** One run that took longer than @c slowQueryThreshold . */
+
+@interface YFSlowQuery : NSObject
+
+/** The SQL text; with bound values expanded when @c logsExpandedSQL  is set */
+
+@property (nonatomic, copy, readonly) NSString *query;
+
+/** Wall time, in seconds */
+
+@property (nonatomic, readonly) NSTimeInterval duration;
+
+/** When the run finished */
+
+@property (nonatomic, strong, readonly) NSDate *date;
+
+/** Plist and JSON friendly form of the entry */
+
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
+
+/** Point-in-time copy of a profiler's data. */
+
+@interface YFProfilerSnapshot : NSObject
+
+/** Per query statistics, slowest total time first */
+
+@property (nonatomic, copy, readonly) NSArray<YFQueryStatistics *> *queries;
+
+/** The most recent slow runs, oldest first */
+
+@property (nonatomic, copy, readonly) NSArray<YFSlowQuery *> *slowQueries;
+
+/** When the profiler started collecting, or was last reset */
+
+@property (nonatomic, strong, readonly) NSDate *startDate;
+
+/** Plist and JSON friendly form of the snapshot */
+
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
+
+/** Records per statement execution statistics for one or more databases.
+
+ Attach it with @c -[YFDatabase setProfiler:] . It uses @c sqlite3_trace_v2  to time every statement and count its rows, and @c sqlite3_stmt_status  to count full scan steps, sorts and automatic index rows. It also keeps a log of the most recent runs slower than @c slowQueryThreshold .
+
+@code
+YFDatabaseProfiler *profiler = [[YFDatabaseProfiler alloc] init];
+profiler.slowQueryThreshold = 0.05;
+db.profiler = profiler;
+...
+NSLog(@"%@", [[profiler snapshot] dictionaryRepresentation]);
+@endcode
+
+ Recording is thread safe, so one profiler can watch several connections of a pool or queue, and @c snapshot  can be taken from any thread. Requires SQLite 3.14.
+ */
+
+@interface YFDatabaseProfiler : NSObject
+
+/** Runs at least this long, in seconds, go to the slow query log. Defaults to @c 0.1 ; @c 0  turns the log off. */
+
+@property (atomic) NSTimeInterval slowQueryThreshold;
+
+/** Number of slow runs kept. Defaults to @c 100 . */
+
+@property (atomic) NSUInteger maximumSlowQueryCount;
+
+/** Whether slow runs record the SQL with bound values filled in. Off by default, since values may be sensitive. */
+
+@property (atomic) BOOL logsExpandedSQL;
+
+/** Whether slow runs are also written to the console. Defaults to @c NO . */
+
+@property (atomic) BOOL logsSlowQueries;
+
+/** Called on the database's thread for every slow run, if set. */
+
+@property (atomic, copy, nullable) void (^slowQueryHandler)(YFSlowQuery *slowQuery);
+
+/** Copy out the statistics gathered so far. */
+
+- (YFProfilerSnapshot *)snapshot;
+
+/** Forget everything gathered so far. */
+
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,375 @@
+//
+//  YFDatabaseProfiler.m
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import "YFDatabaseProfiler.h"
+#import <sqlite3.h>
+#import <pthread.h>
+
+// runs kept per query for the percentile estimates
+#define YFDBProfilerSampleCount 256
+
+// MARK: - YFQueryStatistics
+
+@interface YFQueryStatistics () {
+@public
+    NSString            *_query;
+    NSUInteger          _callCount;
+    NSTimeInterval      _totalTime;
+    NSTimeInterval      _medianTime;
+    NSTimeInterval      _p99Time;
+    NSTimeInterval      _maximumTime;
+    unsigned long long  _rowCount;
+    unsigned long long  _fullScanStepCount;
+    unsigned long long  _sortCount;
+    unsigned long long  _autoIndexCount;
+
+    // reservoir of run times; only touched by the profiler, under its lock
+    double              _samples[YFDBProfilerSampleCount];
+    NSUInteger          _sampleCount;
+}
+@end
+
+@implementation YFQueryStatistics
+
+- (void)addSample:(double)seconds {
+
+    // reservoir sampling keeps a uniform sample however many runs there are
+    if (_sampleCount < YFDBProfilerSampleCount) {
+        _samples[_sampleCount++] = seconds;
+    }
+    else {
+        uint32_t slot = arc4random_uniform((uint32_t)MIN(_callCount, (NSUInteger)UINT32_MAX));
+        if (slot < YFDBProfilerSampleCount) {
+            _samples[slot] = seconds;
+        }
+    }
+}
+
+static int YFDBCompareDoubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+- (YFQueryStatistics *)snapshotCopy {
+
+    YFQueryStatistics *copy = [[YFQueryStatistics alloc] init];
+    copy->_query                = _query;
+    copy->_callCount            = _callCount;
+    copy->_totalTime            = _totalTime;
+    copy->_maximumTime          = _maximumTime;
+    copy->_rowCount             = _rowCount;
+    copy->_fullScanStepCount    = _fullScanStepCount;
+    copy->_sortCount            = _sortCount;
+    copy->_autoIndexCount       = _autoIndexCount;
+
+    if (_sampleCount) {
+        double sorted[YFDBProfilerSampleCount];
+        memcpy(sorted, _samples, _sampleCount * sizeof(double));
+        qsort(sorted, _sampleCount, sizeof(double), YFDBCompareDoubles);
+
+        copy->_medianTime   = sorted[(_sampleCount - 1) / 2];
+        copy->_p99Time      = sorted[(NSUInteger)((_sampleCount - 1) * 0.99)];
+    }
+
+    return copy;
+}
+
+- (NSDictionary *)dictionaryRepresentation {
+    return @{
+        @"query"            : _query,
+        @"callCount"        : @(_callCount),
+        @"totalTime"        : @(_totalTime),
+        @"medianTime"       : @(_medianTime),
+        @"p99Time"          : @(_p99Time),
+        @"maximumTime"      : @(_maximumTime),
+        @"rowCount"         : @(_rowCount),
+        @"fullScanSteps"    : @(_fullScanStepCount),
+        @"sorts"            : @(_sortCount),
+        @"autoIndexRows"    : @(_autoIndexCount),
+    };
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ %lu call(s), total %.6fs, p50 %.6fs, p99 %.6fs: %@", [super description], (unsigned long)_callCount, _totalTime, _medianTime, _p99Time, _query];
+}
+
+@end
+
+// MARK: - YFSlowQuery
+
+@interface YFSlowQuery ()
+@property (nonatomic, copy) NSString *query;
+@property (nonatomic) NSTimeInterval duration;
+@property (nonatomic, strong) NSDate *date;
+@end
+
+@implementation YFSlowQuery
+
+- (NSDictionary *)dictionaryRepresentation {
+    return @{
+        @"query"    : _query,
+        @"duration" : @(_duration),
+        @"date"     : @([_date timeIntervalSince1970]),
+    };
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ %.6fs: %@", [super description], _duration, _query];
+}
+
+@end
+
+// MARK: - YFProfilerSnapshot
+
+@interface YFProfilerSnapshot ()
+@property (nonatomic, copy) NSArray *queries;
+@property (nonatomic, copy) NSArray *slowQueries;
+@property (nonatomic, strong) NSDate *startDate;
+@end
+
+@implementation YFProfilerSnapshot
+
+- (NSDictionary *)dictionaryRepresentation {
+    return @{
+        @"startDate"    : @([_startDate timeIntervalSince1970]),
+        @"queries"      : [_queries valueForKey:@"dictionaryRepresentation"],
+        @"slowQueries"  : [_slowQueries valueForKey:@"dictionaryRepresentation"],
+    };
+}
+
+@end
+
+// MARK: - YFDatabaseProfiler
+
+/** Rows seen so far by a statement that hasn't finished yet. */
+
+typedef struct YFDBProfilerRowCounter {
+    sqlite3_stmt        *statement;
+    unsigned long long  rows;
+} YFDBProfilerRowCounter;
+
+@interface YFDatabaseProfiler () {
+    pthread_mutex_t         _lock;
+
+    NSMutableDictionary     *_statisticsByQuery;
+    NSMutableArray          *_slowQueries;
+    NSDate                  *_startDate;
+
+    // a connection rarely has more than a couple of statements stepping at once, so a short array beats a hash
+    YFDBProfilerRowCounter  *_rowCounters;
+    NSUInteger              _rowCounterCount;
+    NSUInteger              _rowCounterCapacity;
+}
+@end
+
+@implementation YFDatabaseProfiler
+
+- (instancetype)init {
+    self = [super init];
+
+    if (self) {
+        pthread_mutex_init(&_lock, NULL);
+        _statisticsByQuery      = [NSMutableDictionary dictionary];
+        _slowQueries            = [NSMutableArray array];
+        _startDate              = [NSDate date];
+        _slowQueryThreshold     = 0.1;
+        _maximumSlowQueryCount  = 100;
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    free(_rowCounters);
+    pthread_mutex_destroy(&_lock);
+}
+
+#if SQLITE_VERSION_NUMBER >= 3014000
+
+static int YFDBProfilerTraceCallback(unsigned mask, void *context, void *p, void *x) {
+
+    YFDatabaseProfiler *profiler = (__bridge YFDatabaseProfiler *)context;
+
+    if (mask == SQLITE_TRACE_ROW) {
+        [profiler statementDidReturnRow:(sqlite3_stmt *)p];
+    }
+    else if (mask == SQLITE_TRACE_PROFILE) {
+        [profiler statement:(sqlite3_stmt *)p didFinishInNanoseconds:*(sqlite3_int64 *)x];
+    }
+
+    return 0;
+}
+
+#endif
+
+- (void)installOnDatabase:(sqlite3 *)db {
+#if SQLITE_VERSION_NUMBER >= 3014000
+    sqlite3_trace_v2(db, SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW, YFDBProfilerTraceCallback, (__bridge void *)self);
+#else
+    NSLog(@"YFDatabaseProfiler requires SQLite 3.14");
+#endif
+}
+
+- (void)uninstallFromDatabase:(sqlite3 *)db {
+#if SQLITE_VERSION_NUMBER >= 3014000
+    sqlite3_trace_v2(db, 0, NULL, NULL);
+#endif
+}
+
+- (YFDBProfilerRowCounter *)rowCounterForStatement:(sqlite3_stmt *)pStmt create:(BOOL)create {
+
+    for (NSUInteger i = 0; i < _rowCounterCount; i++) {
+        if (_rowCounters[i].statement == pStmt) {
+            return &_rowCounters[i];
+        }
+    }
+
+    if (!create) {
+        return NULL;
+    }
+
+    if (_rowCounterCount == _rowCounterCapacity) {
+        _rowCounterCapacity = _rowCounterCapacity ? _rowCounterCapacity * 2 : 4;
+        _rowCounters = realloc(_rowCounters, _rowCounterCapacity * sizeof(YFDBProfilerRowCounter));
+    }
+
+    YFDBProfilerRowCounter *counter = &_rowCounters[_rowCounterCount++];
+    counter->statement = pStmt;
+    counter->rows = 0;
+
+    return counter;
+}
+
+- (void)statementDidReturnRow:(sqlite3_stmt *)pStmt {
+    pthread_mutex_lock(&_lock);
+    [self rowCounterForStatement:pStmt create:YES]->rows++;
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)statement:(sqlite3_stmt *)pStmt didFinishInNanoseconds:(sqlite3_int64)nanoseconds {
+
+    NSTimeInterval seconds = nanoseconds / 1e9;
+
+    // reset the counters as we read them, so each run only reports its own work
+    int fullScanSteps   = sqlite3_stmt_status(pStmt, SQLITE_STMTSTATUS_FULLSCAN_STEP, 1);
+    int sorts           = sqlite3_stmt_status(pStmt, SQLITE_STMTSTATUS_SORT, 1);
+    int autoIndexRows   = sqlite3_stmt_status(pStmt, SQLITE_STMTSTATUS_AUTOINDEX, 1);
+
+    const char *sql = sqlite3_sql(pStmt);
+    if (!sql) {
+        return;
+    }
+
+    YFSlowQuery *slowQuery = 0x00;
+    NSTimeInterval threshold = [self slowQueryThreshold];
+
+    if (threshold > 0 && seconds >= threshold) {
+        NSString *query = 0x00;
+
+#if SQLITE_VERSION_NUMBER >= 3014000
+        if ([self logsExpandedSQL]) {
+            char *expanded = sqlite3_expanded_sql(pStmt);
+            if (expanded) {
+                query = [NSString stringWithUTF8String:expanded];
+                sqlite3_free(expanded);
+            }
+        }
+#endif
+
+        slowQuery = [[YFSlowQuery alloc] init];
+        slowQuery.query = query ? query : [NSString stringWithUTF8String:sql];
+        slowQuery.duration = seconds;
+        slowQuery.date = [NSDate date];
+    }
+
+    // look up without copying the text; only a first sighting pays for a real key
+    NSString *lookupKey = [[NSString alloc] initWithBytesNoCopy:(void *)sql length:strlen(sql) encoding:NSUTF8StringEncoding freeWhenDone:NO];
+
+    pthread_mutex_lock(&_lock);
+
+    YFQueryStatistics *statistics = [_statisticsByQuery objectForKey:lookupKey];
+    if (!statistics) {
+        statistics = [[YFQueryStatistics alloc] init];
+        statistics->_query = [NSString stringWithUTF8String:sql];
+        [_statisticsByQuery setObject:statistics forKey:statistics->_query];
+    }
+
+    statistics->_callCount++;
+    statistics->_totalTime += seconds;
+    statistics->_maximumTime = MAX(statistics->_maximumTime, seconds);
+    statistics->_fullScanStepCount += (unsigned long long)fullScanSteps;
+    statistics->_sortCount += (unsigned long long)sorts;
+    statistics->_autoIndexCount += (unsigned long long)autoIndexRows;
+    [statistics addSample:seconds];
+
+    YFDBProfilerRowCounter *counter = [self rowCounterForStatement:pStmt create:NO];
+    if (counter) {
+        statistics->_rowCount += counter->rows;
+        *counter = _rowCounters[--_rowCounterCount];
+    }
+
+    if (slowQuery) {
+        [_slowQueries addObject:slowQuery];
+
+        NSUInteger maximum = [self maximumSlowQueryCount];
+        if ([_slowQueries count] > maximum) {
+            [_slowQueries removeObjectsInRange:NSMakeRange(0, [_slowQueries count] - maximum)];
+        }
+    }
+
+    pthread_mutex_unlock(&_lock);
+
+    if (slowQuery) {
+        if ([self logsSlowQueries]) {
+            NSLog(@"Slow query (%.6fs): %@", seconds, slowQuery.query);
+        }
+
+        void (^handler)(YFSlowQuery *) = [self slowQueryHandler];
+        if (handler) {
+            handler(slowQuery);
+        }
+    }
+}
+
+- (YFProfilerSnapshot *)snapshot {
+
+    YFProfilerSnapshot *snapshot = [[YFProfilerSnapshot alloc] init];
+    NSMutableArray *queries = [NSMutableArray array];
+
+    pthread_mutex_lock(&_lock);
+
+    for (YFQueryStatistics *statistics in [_statisticsByQuery objectEnumerator]) {
+        [queries addObject:[statistics snapshotCopy]];
+    }
+    snapshot.slowQueries = _slowQueries;
+    snapshot.startDate = _startDate;
+
+    pthread_mutex_unlock(&_lock);
+
+    [queries sortUsingComparator:^NSComparisonResult(YFQueryStatistics *a, YFQueryStatistics *b) {
+        if (a.totalTime == b.totalTime) {
+            return NSOrderedSame;
+        }
+        return a.totalTime > b.totalTime ? NSOrderedAscending : NSOrderedDescending;
+    }];
+    snapshot.queries = queries;
+
+    return snapshot;
+}
+
+- (void)reset {
+    pthread_mutex_lock(&_lock);
+
+    [_statisticsByQuery removeAllObjects];
+    [_slowQueries removeAllObjects];
+    _startDate = [NSDate date];
+
+    pthread_mutex_unlock(&_lock);
+}
+
+@end
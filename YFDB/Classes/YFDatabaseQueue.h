@@ -24,6 +24,24 @@ NS_ASSUME_NONNULL_BEGIN
 
 @property (atomic, copy, nullable) NSString *vfsName;
 
+/** How many times a transaction is run again after failing with @c SQLITE_BUSY_SNAPSHOT .
+
+ In WAL mode, a transaction that started by reading and then tries to write fails with @c SQLITE_BUSY_SNAPSHOT  if another connection committed in between. Waiting doesn't help; the transaction has to start over. With a non-zero value, @c inTransaction:  and friends roll back and call the block again; once the retries run out, the last attempt is rolled back rather than committed without the writes that failed. @c 0 , the default, never retries: the transaction is committed or rolled back as the block decides, as if retries did not exist, and the stale snapshot is only logged.
+
+ @warning Only turn this on if the transaction blocks can safely run more than once.
+ */
+
+@property (atomic, assign) NSUInteger maximumTransactionRetries;
+
+/** Result cache given to the queue's database, picked up by the next block that runs. @c nil  by default.
+
+ Read through it with @c -[YFDatabase executeCachedQuery:withArgumentsInArray:error:]  inside @c inDatabase:  and friends.
+
+ @see YFQueryResultCache
+ */
+
+@property (atomic, strong, nullable) YFQueryResultCache *resultCache;
+
 ///----------------------------------------------------
 /// @name Initialization, opening, and closing of queue
 ///----------------------------------------------------
@@ -202,6 +220,75 @@ NS_ASSUME_NONNULL_BEGIN
 // If you need to nest, use YFDatabase's startSavePointWithName:error: instead.
 - (NSError * _Nullable)inSavePoint:(__attribute__((noescape)) void (^)(YFDatabase *db, BOOL *rollback))block;
 
+///-----------------------------------------------------
+/// @name Dispatching asynchronous operations to queue
+///-----------------------------------------------------
+
+/** Asynchronously perform database operations on queue.
+
+ The calling thread does not wait for the queue.
+
+ @param block The code to be run on the queue of @c YFDatabaseQueue
+ @param completionQueue The queue to call @c completion  on; @c nil  uses the main queue.
+ @param completion Called once @c block  has run. May be @c nil .
+ */
+
+- (void)inDatabaseAsync:(void (^)(YFDatabase *db))block completionQueue:(dispatch_queue_t _Nullable)completionQueue completion:(void (^ _Nullable)(void))completion;
+
+/** Asynchronously perform database operations on queue, using an immediate transaction.
+
+ @param block The code to be run on the queue of @c YFDatabaseQueue
+ @param completionQueue The queue to call @c completion  on; @c nil  uses the main queue.
+ @param completion Called with @c YES  if the transaction was committed, or @c NO  and the error if it was rolled back or failed. May be @c nil .
+ */
+
+- (void)inTransactionAsync:(void (^)(YFDatabase *db, BOOL *rollback))block completionQueue:(dispatch_queue_t _Nullable)completionQueue completion:(void (^ _Nullable)(BOOL committed, NSError * _Nullable error))completion;
+
+/** Asynchronously perform database operations on queue, using save point.
+
+ @param block The code to be run on the queue of @c YFDatabaseQueue
+ @param completionQueue The queue to call @c completion  on; @c nil  uses the main queue.
+ @param completion Called with the error, or @c nil  on success. May be @c nil .
+ */
+
+- (void)inSavePointAsync:(void (^)(YFDatabase *db, BOOL *rollback))block completionQueue:(dispatch_queue_t _Nullable)completionQueue completion:(void (^ _Nullable)(NSError * _Nullable error))completion;
+
+///----------------------------
+/// @name Coalescing writes
+///----------------------------
+
+/** How long, in seconds, a coalesced write waits for more writes to join its transaction.
+
+ @c 0 , the default, commits with whatever writes are already queued when the first one runs.
+ */
+
+@property (atomic, assign) NSTimeInterval writeCoalescingInterval;
+
+/** Maximum number of writes committed in one coalesced transaction. @c 0 , the default, means no limit. */
+
+@property (atomic, assign) NSUInteger maximumCoalescedWrites;
+
+/** Asynchronously perform a write that may share its transaction with other coalesced writes.
+
+ Writes submitted with this method, from any thread, are gathered and run one after another inside a single immediate transaction, so several small writes cost one commit (and one fsync) instead of one each. Each write runs inside its own save point: setting @c *rollback  undoes that write only.
+
+@code
+[queue inCoalescedWrite:^(YFDatabase *db, BOOL *rollback) {
+    *rollback = ![db executeUpdate:@"INSERT INTO log (message) VALUES (?)", message];
+} completionQueue:nil completion:^(BOOL committed, NSError *error) {
+    ...
+}];
+@endcode
+
+ @param block The code to be run on the queue of @c YFDatabaseQueue
+ @param completionQueue The queue to call @c completion  on; @c nil  uses the main queue.
+ @param completion Called with @c YES  once the shared transaction containing the write has committed. Called with @c NO  if the write was rolled back, with a @c nil  error when the block asked for it, or if the commit failed. May be @c nil .
+
+ @warning A failed commit loses every write in the group, each of which is told so through its completion.
+ */
+
+- (void)inCoalescedWrite:(void (^)(YFDatabase *db, BOOL *rollback))block completionQueue:(dispatch_queue_t _Nullable)completionQueue completion:(void (^ _Nullable)(BOOL committed, NSError * _Nullable error))completion;
+
 ///-----------------
 /// @name Checkpoint
 ///-----------------
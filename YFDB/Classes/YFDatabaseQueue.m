@@ -6,6 +6,7 @@
 //
 
 #import "YFDatabaseQueue.h"
+#import "YFQueryResultCache.h"
 #import "YFDatabase.h"
 
 #import <sqlite3.h>
@@ -17,9 +18,51 @@ typedef NS_ENUM(NSInteger, YFDBTransaction) {
 };
 static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey;
 
+/** A write waiting to join the next coalesced transaction. */
+
+@interface YFDatabaseQueueCoalescedWrite : NSObject
+@property (nonatomic, copy) void (^block)(YFDatabase *db, BOOL *rollback);
+#if OS_OBJECT_USE_OBJC
+@property (nonatomic, strong) dispatch_queue_t completionQueue;
+#else
+@property (nonatomic, assign) dispatch_queue_t completionQueue;
+#endif
+@property (nonatomic, copy) void (^completion)(BOOL committed, NSError *error);
+@property (nonatomic) BOOL applied;
+@property (nonatomic, strong) NSError *error;
+@end
+
+@implementation YFDatabaseQueueCoalescedWrite
+
+#if !OS_OBJECT_USE_OBJC
+// without ObjC dispatch objects (GNUstep) the queue is retained by hand
+
+- (void)setCompletionQueue:(dispatch_queue_t)completionQueue {
+    if (completionQueue) {
+        dispatch_retain(completionQueue);
+    }
+    if (_completionQueue) {
+        dispatch_release(_completionQueue);
+    }
+    _completionQueue = completionQueue;
+}
+
+- (void)dealloc {
+    if (_completionQueue) {
+        dispatch_release(_completionQueue);
+    }
+}
+#endif
+
+@end
+
 @interface YFDatabaseQueue () {
     dispatch_queue_t    _queue;
     YFDatabase          *_db;
+    
+    // only touched on _queue
+    NSMutableArray      *_pendingWrites;
+    BOOL                _isFlushScheduled;
 }
 @end
 
@@ -76,6 +119,7 @@ static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey
         dispatch_queue_set_specific(_queue, kDispatchQueueSpecificKey, (__bridge void *)self, NULL);
         _openFlags = openFlags;
         _vfsName = [vfsName copy];
+        _pendingWrites = [NSMutableArray array];
     }
     
     return self;
@@ -137,6 +181,11 @@ static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey
         }
     }
     
+    YFQueryResultCache *resultCache = [self resultCache];
+    if ([_db resultCache] != resultCache) {
+        [_db setResultCache:resultCache];
+    }
+    
     return _db;
 }
 
@@ -171,27 +220,49 @@ static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey
 - (void)beginTransaction:(YFDBTransaction)transaction withBlock:(void (^)(YFDatabase *db, BOOL *rollback))block {
     dispatch_sync(_queue, ^() {
         
-        BOOL shouldRollback = NO;
-
-        switch (transaction) {
-            case YFDBTransactionExclusive:
-                [[self database] beginTransaction];
-                break;
-            case YFDBTransactionDeferred:
-                [[self database] beginDeferredTransaction];
-                break;
-            case YFDBTransactionImmediate:
-                [[self database] beginImmediateTransaction];
-                break;
-        }
-        
-        block([self database], &shouldRollback);
+        NSUInteger retries = [self maximumTransactionRetries];
         
-        if (shouldRollback) {
-            [[self database] rollback];
-        }
-        else {
-            [[self database] commit];
+        for (NSUInteger attempt = 0; ; attempt++) {
+            
+            BOOL shouldRollback = NO;
+            NSUInteger busySnapshots = [[self database] busySnapshotCount];
+            
+            switch (transaction) {
+                case YFDBTransactionExclusive:
+                    [[self database] beginTransaction];
+                    break;
+                case YFDBTransactionDeferred:
+                    [[self database] beginDeferredTransaction];
+                    break;
+                case YFDBTransactionImmediate:
+                    [[self database] beginImmediateTransaction];
+                    break;
+            }
+            
+            block([self database], &shouldRollback);
+            
+            BOOL hitStaleSnapshot = [[self database] busySnapshotCount] != busySnapshots;
+            
+            if (hitStaleSnapshot && !retries) {
+                // without retries the block decides, as it always has; it saw the failed statements' errors
+                if ([[self database] logsErrors]) {
+                    NSLog(@"%@: a statement of the transaction failed with SQLITE_BUSY_SNAPSHOT; set maximumTransactionRetries to run it again instead", self);
+                }
+                hitStaleSnapshot = NO;
+            }
+            
+            // with retries, a stale snapshot means some of the block's writes never happened, so don't commit the rest
+            if (shouldRollback || hitStaleSnapshot) {
+                [[self database] rollback];
+            }
+            else if (![[self database] commit] && retries && [[self database] busySnapshotCount] != busySnapshots) {
+                [[self database] rollback];
+                hitStaleSnapshot = YES;
+            }
+            
+            if (!hitStaleSnapshot || shouldRollback || attempt >= retries) {
+                break;
+            }
         }
     });
     
@@ -215,32 +286,232 @@ static const void * const kDispatchQueueSpecificKey = &kDispatchQueueSpecificKey
 
 - (NSError*)inSavePoint:(__attribute__((noescape)) void (^)(YFDatabase *db, BOOL *rollback))block {
 #if SQLITE_VERSION_NUMBER >= 3007000
-    static unsigned long savePointIdx = 0;
     __block NSError *err = 0x00;
     dispatch_sync(_queue, ^() {
+        err = [self performSavePoint:block];
+    });
+    return err;
+#else
+    NSString *errorMessage = NSLocalizedStringFromTable(@"Save point functions require SQLite 3.7", @"YFDB", nil);
+    if (_db.logsErrors) NSLog(@"%@", errorMessage);
+    return [NSError errorWithDomain:@"YFDatabase" code:0 userInfo:@{NSLocalizedDescriptionKey : errorMessage}];
+#endif
+}
+
+/** Run @c block  in a save point. Call on @c _queue . */
+
+- (NSError*)performSavePoint:(__attribute__((noescape)) void (^)(YFDatabase *db, BOOL *rollback))block {
+    static unsigned long savePointIdx = 0;
+    NSError *err = 0x00;
+    
+    NSString *name = [NSString stringWithFormat:@"savePoint%ld", savePointIdx++];
+    
+    BOOL shouldRollback = NO;
+    
+    if ([[self database] startSavePointWithName:name error:&err]) {
+        
+        block([self database], &shouldRollback);
+        
+        if (shouldRollback) {
+            // We need to rollback and release this savepoint to remove it
+            [[self database] rollbackToSavePointWithName:name error:&err];
+        }
+        [[self database] releaseSavePointWithName:name error:&err];
+        
+    }
+    
+    return err;
+}
+
+#pragma mark Asynchronous operations
+
+static dispatch_queue_t YFDBCompletionQueue(dispatch_queue_t queue) {
+    return queue ? queue : dispatch_get_main_queue();
+}
+
+- (void)inDatabaseAsync:(void (^)(YFDatabase *db))block completionQueue:(dispatch_queue_t)completionQueue completion:(void (^)(void))completion {
+    dispatch_async(_queue, ^() {
+        
+        YFDatabase *db = [self database];
         
-        NSString *name = [NSString stringWithFormat:@"savePoint%ld", savePointIdx++];
+        block(db);
+        
+        if ([db hasOpenResultSets]) {
+            NSLog(@"Warning: there is at least one open result set around after performing [YFDatabaseQueue inDatabaseAsync:]");
+        }
+        
+        if (completion) {
+            dispatch_async(YFDBCompletionQueue(completionQueue), completion);
+        }
+    });
+}
+
+- (void)inTransactionAsync:(void (^)(YFDatabase *db, BOOL *rollback))block completionQueue:(dispatch_queue_t)completionQueue completion:(void (^)(BOOL committed, NSError *error))completion {
+    dispatch_async(_queue, ^() {
         
-        BOOL shouldRollback = NO;
+        YFDatabase *db = [self database];
+        BOOL committed = NO;
+        NSError *err = 0x00;
         
-        if ([[self database] startSavePointWithName:name error:&err]) {
+        if ([db beginImmediateTransaction]) {
+            BOOL shouldRollback = NO;
             
-            block([self database], &shouldRollback);
+            block(db, &shouldRollback);
             
             if (shouldRollback) {
-                // We need to rollback and release this savepoint to remove it
-                [[self database] rollbackToSavePointWithName:name error:&err];
+                [db rollback];
+            }
+            else if ([db commit]) {
+                committed = YES;
+            }
+            else {
+                err = [db lastError];
+                [db rollback];
             }
-            [[self database] releaseSavePointWithName:name error:&err];
-            
+        }
+        else {
+            err = [db lastError];
+        }
+        
+        if (completion) {
+            dispatch_async(YFDBCompletionQueue(completionQueue), ^() {
+                completion(committed, err);
+            });
         }
     });
-    return err;
+}
+
+- (void)inSavePointAsync:(void (^)(YFDatabase *db, BOOL *rollback))block completionQueue:(dispatch_queue_t)completionQueue completion:(void (^)(NSError *error))completion {
+    dispatch_async(_queue, ^() {
+#if SQLITE_VERSION_NUMBER >= 3007000
+        NSError *err = [self performSavePoint:block];
 #else
-    NSString *errorMessage = NSLocalizedStringFromTable(@"Save point functions require SQLite 3.7", @"YFDB", nil);
-    if (_db.logsErrors) NSLog(@"%@", errorMessage);
-    return [NSError errorWithDomain:@"YFDatabase" code:0 userInfo:@{NSLocalizedDescriptionKey : errorMessage}];
+        NSString *errorMessage = NSLocalizedStringFromTable(@"Save point functions require SQLite 3.7", @"YFDB", nil);
+        NSError *err = [NSError errorWithDomain:@"YFDatabase" code:0 userInfo:@{NSLocalizedDescriptionKey : errorMessage}];
 #endif
+        if (completion) {
+            dispatch_async(YFDBCompletionQueue(completionQueue), ^() {
+                completion(err);
+            });
+        }
+    });
+}
+
+#pragma mark Coalescing writes
+
+- (void)inCoalescedWrite:(void (^)(YFDatabase *db, BOOL *rollback))block completionQueue:(dispatch_queue_t)completionQueue completion:(void (^)(BOOL committed, NSError *error))completion {
+    
+    YFDatabaseQueueCoalescedWrite *write = [[YFDatabaseQueueCoalescedWrite alloc] init];
+    write.block = block;
+    write.completionQueue = YFDBCompletionQueue(completionQueue);
+    write.completion = completion;
+    
+    dispatch_async(_queue, ^() {
+        [self->_pendingWrites addObject:write];
+        [self scheduleCoalescedWrites];
+    });
+}
+
+/** Make sure a flush of the pending writes is on its way. Call on @c _queue . */
+
+- (void)scheduleCoalescedWrites {
+    
+    if (_isFlushScheduled || ![_pendingWrites count]) {
+        return;
+    }
+    
+    _isFlushScheduled = YES;
+    
+    NSTimeInterval interval = [self writeCoalescingInterval];
+    
+    // with an interval, the flush only joins the queue once the interval is over, so writes submitted meanwhile are added before it runs;
+    // without one, it joins now: writes already queued ahead of it share its transaction, later ones land behind it and go in the next
+    if (interval > 0) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)), _queue, ^() {
+            [self flushCoalescedWrites];
+        });
+    }
+    else {
+        dispatch_async(_queue, ^() {
+            [self flushCoalescedWrites];
+        });
+    }
+}
+
+/** Commit the pending writes in one transaction. Call on @c _queue . */
+
+- (void)flushCoalescedWrites {
+    
+    _isFlushScheduled = NO;
+    
+    NSUInteger count = [_pendingWrites count];
+    NSUInteger maximum = [self maximumCoalescedWrites];
+    if (maximum && count > maximum) {
+        count = maximum;
+    }
+    
+    NSArray *writes = [_pendingWrites subarrayWithRange:NSMakeRange(0, count)];
+    [_pendingWrites removeObjectsInRange:NSMakeRange(0, count)];
+    
+    YFDatabase *db = [self database];
+    
+    if ([db beginImmediateTransaction]) {
+        
+        NSUInteger idx = 0;
+        for (YFDatabaseQueueCoalescedWrite *write in writes) {
+            
+            // each write gets a save point so one failure doesn't take the whole group down
+            NSString *name = [NSString stringWithFormat:@"coalescedWrite%lu", (unsigned long)idx++];
+            NSError *err = 0x00;
+            
+            if (![db startSavePointWithName:name error:&err]) {
+                write.error = err;
+                continue;
+            }
+            
+            BOOL shouldRollback = NO;
+            
+            write.block(db, &shouldRollback);
+            
+            if (shouldRollback) {
+                [db rollbackToSavePointWithName:name error:&err];
+                write.error = err;
+            }
+            else {
+                write.applied = YES;
+            }
+            
+            [db releaseSavePointWithName:name error:&err];
+        }
+        
+        if (![db commit]) {
+            NSError *err = [db lastError];
+            [db rollback];
+            
+            for (YFDatabaseQueueCoalescedWrite *write in writes) {
+                write.applied = NO;
+                write.error = err;
+            }
+        }
+    }
+    else {
+        NSError *err = [db lastError];
+        
+        for (YFDatabaseQueueCoalescedWrite *write in writes) {
+            write.error = err;
+        }
+    }
+    
+    for (YFDatabaseQueueCoalescedWrite *write in writes) {
+        if (write.completion) {
+            dispatch_async(write.completionQueue, ^() {
+                write.completion(write.applied, write.error);
+            });
+        }
+    }
+    
+    // anything over maximumCoalescedWrites goes in the next transaction
+    [self scheduleCoalescedWrites];
 }
 
 - (BOOL)checkpoint:(YFDBCheckpointMode)mode error:(NSError * __autoreleasing *)error
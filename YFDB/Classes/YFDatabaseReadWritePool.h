@@ -0,0 +1,154 @@
+//
+//  YFDatabaseReadWritePool.h
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class YFDatabase;
+@class YFDatabaseQueue;
+@class YFDatabasePool;
+
+/** Pool with one writer connection and several reader connections on a WAL database.
+
+ In WAL mode SQLite lets readers run alongside a single writer. The writer is a @c YFDatabaseQueue , so all writes are serialized on one connection. Readers come from a @c YFDatabasePool  whose connections are opened with @c SQLITE_OPEN_READONLY  and @c PRAGMA query_only=1 , so reads scale with the number of readers instead of waiting behind writes.
+
+@code
+YFDatabaseReadWritePool *pool = [YFDatabaseReadWritePool databaseReadWritePoolWithPath:path];
+
+[pool inWriteTransaction:^(YFDatabase *db, BOOL *rollback) {
+    [db executeUpdate:@"INSERT INTO t (name) VALUES (?)", name];
+}];
+
+[pool inReadDatabase:^(YFDatabase *db) {
+    YFResultSet *rs = [db executeQuery:@"SELECT name FROM t"];
+    ...
+}];
+@endcode
+
+ The writer switches the database to WAL when it opens it. A reader sees the last transaction committed when its read started; use @c inReadTransaction:  to see one snapshot across several queries.
+
+ @warning Don't nest a write call inside a write block or a read call inside a read block when all readers may be in use: the inner call waits for a connection that the outer call is holding.
+ */
+
+@interface YFDatabaseReadWritePool : NSObject
+
+/** Database path */
+
+@property (atomic, copy, readonly, nullable) NSString *path;
+
+/**  Custom virtual file system name */
+
+@property (atomic, copy, readonly, nullable) NSString *vfsName;
+
+/** The queue wrapping the writer connection */
+
+@property (nonatomic, readonly, nullable) YFDatabaseQueue *writerQueue;
+
+/** The pool of reader connections */
+
+@property (nonatomic, readonly) YFDatabasePool *readerPool;
+
+/** Maximum number of reader connections; further readers wait for one to be returned. */
+
+@property (atomic, assign) NSUInteger maximumNumberOfReaders;
+
+///---------------------
+/// @name Initialization
+///---------------------
+
+/** Create pool using path.
+
+ @param aPath The file path of the database.
+
+ @return The @c YFDatabaseReadWritePool  object. @c nil  on error.
+ */
+
++ (nullable instancetype)databaseReadWritePoolWithPath:(NSString *)aPath;
+
+/** Create pool using file URL.
+
+ @param url The file @c NSURL  of the database.
+
+ @return The @c YFDatabaseReadWritePool  object. @c nil  on error.
+ */
+
++ (nullable instancetype)databaseReadWritePoolWithURL:(NSURL *)url;
+
+/** Create pool using path.
+
+ @param aPath The file path of the database.
+
+ @return The @c YFDatabaseReadWritePool  object. @c nil  on error.
+ */
+
+- (nullable instancetype)initWithPath:(NSString *)aPath;
+
+/** Create pool using path and a reader limit.
+
+ @param aPath The file path of the database.
+ @param maximumNumberOfReaders Maximum number of reader connections; @c 0  uses the number of active processors.
+
+ @return The @c YFDatabaseReadWritePool  object. @c nil  on error.
+ */
+
+- (nullable instancetype)initWithPath:(NSString *)aPath maximumNumberOfReaders:(NSUInteger)maximumNumberOfReaders;
+
+/** Create pool using path, a reader limit and a custom virtual file system.
+
+ @param aPath The file path of the database. Every connection opens this file, so it may be neither empty nor @c :memory: .
+ @param maximumNumberOfReaders Maximum number of reader connections; @c 0  uses the number of active processors.
+ @param vfsName The name of a custom virtual file system, used by the writer and the readers alike.
+
+ @return The @c YFDatabaseReadWritePool  object. @c nil  if the path is not a file, or if the writer could not open the database or enable WAL.
+ */
+
+- (nullable instancetype)initWithPath:(NSString *)aPath maximumNumberOfReaders:(NSUInteger)maximumNumberOfReaders vfs:(NSString * _Nullable)vfsName;
+
+/** Close the writer and release all reader connections. */
+
+- (void)close;
+
+///----------------
+/// @name Reading
+///----------------
+
+/** Synchronously perform read-only operations on a reader connection.
+
+ @param block The code to be run on a reader connection.
+ */
+
+- (void)inReadDatabase:(__attribute__((noescape)) void (^)(YFDatabase *db))block;
+
+/** Synchronously perform read-only operations on one snapshot of the database, using a deferred transaction.
+
+ @param block The code to be run on a reader connection.
+ */
+
+- (void)inReadTransaction:(__attribute__((noescape)) void (^)(YFDatabase *db))block;
+
+///----------------
+/// @name Writing
+///----------------
+
+/** Synchronously perform operations on the writer connection.
+
+ @param block The code to be run on the writer connection.
+ */
+
+- (void)inWriteDatabase:(__attribute__((noescape)) void (^)(YFDatabase *db))block;
+
+/** Synchronously perform operations on the writer connection, using an immediate transaction.
+
+ @param block The code to be run on the writer connection.
+ */
+
+- (void)inWriteTransaction:(__attribute__((noescape)) void (^)(YFDatabase *db, BOOL *rollback))block;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,147 @@
+//
+//  YFDatabaseReadWritePool.m
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import "YFDatabaseReadWritePool.h"
+#import "YFDatabase.h"
+#import "YFDatabaseQueue.h"
+#import "YFDatabasePool.h"
+
+#import <sqlite3.h>
+
+@interface YFDatabaseReadWritePool () {
+    YFDatabaseQueue     *_writerQueue;
+    YFDatabasePool      *_readerPool;
+}
+@end
+
+@implementation YFDatabaseReadWritePool
+
++ (instancetype)databaseReadWritePoolWithPath:(NSString *)aPath {
+    return [[self alloc] initWithPath:aPath];
+}
+
++ (instancetype)databaseReadWritePoolWithURL:(NSURL *)url {
+    return [[self alloc] initWithPath:url.path];
+}
+
+- (instancetype)initWithPath:(NSString *)aPath {
+    return [self initWithPath:aPath maximumNumberOfReaders:0 vfs:nil];
+}
+
+- (instancetype)initWithPath:(NSString *)aPath maximumNumberOfReaders:(NSUInteger)maximumNumberOfReaders {
+    return [self initWithPath:aPath maximumNumberOfReaders:maximumNumberOfReaders vfs:nil];
+}
+
+- (instancetype)initWithPath:(NSString *)aPath maximumNumberOfReaders:(NSUInteger)maximumNumberOfReaders vfs:(NSString *)vfsName {
+    
+    // every connection must open the same file: an in-memory or temporary database would give each one its own
+    if (![aPath length] || [aPath isEqualToString:@":memory:"]) {
+        NSLog(@"A read/write pool needs a database file, not %@", aPath ? [NSString stringWithFormat:@"\"%@\"", aPath] : @"a nil path");
+        return 0x00;
+    }
+    
+    self = [super init];
+    
+    if (self != nil) {
+        _path       = [aPath copy];
+        _vfsName    = [vfsName copy];
+        
+        // the writer goes first: it creates the file and the WAL index the read-only connections rely on
+        _writerQueue = [[YFDatabaseQueue alloc] initWithPath:aPath flags:SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE vfs:vfsName];
+        if (!_writerQueue) {
+            return 0x00;
+        }
+        
+        __block BOOL isWAL = NO;
+        [_writerQueue inDatabase:^(YFDatabase *db) {
+            YFResultSet *rs = [db executeQuery:@"PRAGMA journal_mode=WAL"];
+            if ([rs next]) {
+                isWAL = [[[rs stringForColumnIndex:0] lowercaseString] isEqualToString:@"wal"];
+            }
+            [rs close];
+        }];
+        
+        if (!isWAL) {
+            NSLog(@"Could not switch the database at path %@ to WAL", aPath);
+            [_writerQueue close];
+            return 0x00;
+        }
+        
+        if (!maximumNumberOfReaders) {
+            maximumNumberOfReaders = [[NSProcessInfo processInfo] activeProcessorCount];
+        }
+        
+        _readerPool = [[YFDatabasePool alloc] initWithPath:aPath flags:SQLITE_OPEN_READONLY vfs:vfsName];
+        [_readerPool setMaximumNumberOfDatabasesToCreate:maximumNumberOfReaders];
+        [_readerPool setDelegate:self];
+    }
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_readerPool setDelegate:0x00];
+}
+
+- (NSUInteger)maximumNumberOfReaders {
+    return [_readerPool maximumNumberOfDatabasesToCreate];
+}
+
+- (void)setMaximumNumberOfReaders:(NSUInteger)maximumNumberOfReaders {
+    [_readerPool setMaximumNumberOfDatabasesToCreate:maximumNumberOfReaders];
+}
+
+- (void)close {
+    [_writerQueue close];
+    [_readerPool releaseAllDatabases];
+}
+
+#pragma mark YFDatabasePool delegate
+
+- (BOOL)databasePool:(YFDatabasePool*)pool shouldAddDatabaseToPool:(YFDatabase*)database {
+    
+    // belt and braces: SQLITE_OPEN_READONLY already refuses writes, query_only also refuses them for ATTACHed files
+    if (![database executeStatements:@"PRAGMA query_only=1"]) {
+        NSLog(@"Could not make reader connection query-only for path %@", _path);
+        return NO;
+    }
+    
+    return YES;
+}
+
+#pragma mark Reading
+
+- (void)inReadDatabase:(__attribute__((noescape)) void (^)(YFDatabase *db))block {
+    [_readerPool inDatabase:block];
+}
+
+- (void)inReadTransaction:(__attribute__((noescape)) void (^)(YFDatabase *db))block {
+    [_readerPool inDatabase:^(YFDatabase *db) {
+        [db beginDeferredTransaction];
+        
+        block(db);
+        
+        // nothing to keep, a rollback just ends the snapshot
+        [db rollback];
+    }];
+}
+
+#pragma mark Writing
+
+- (void)inWriteDatabase:(__attribute__((noescape)) void (^)(YFDatabase *db))block {
+    [_writerQueue inDatabase:block];
+}
+
+- (void)inWriteTransaction:(__attribute__((noescape)) void (^)(YFDatabase *db, BOOL *rollback))block {
+    [_writerQueue inImmediateTransaction:block];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p> %@ (%lu readers)", [self class], self, _path, (unsigned long)[self maximumNumberOfReaders]];
+}
+
+@end
@@ -0,0 +1,53 @@
+//
+//  YFDateCodec.h
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Hand written conversions between dates and their stored forms, used by @c YFDateStorageISO8601  and @c YFDateStorageEpochMilliseconds .
+
+ They never allocate, lock or consult the locale, calendar or time zone settings, so they cost a small fraction of an @c NSDateFormatter  round trip. Dates are always in UTC and proleptic Gregorian.
+ */
+
+enum {
+    /** Characters written by @c YFDateFormatISO8601 , not counting the terminating NUL: @c 2023-11-01T08:30:00.000Z  */
+    YFDateISO8601Length = 24
+};
+
+/** Write a date as ISO-8601 text, @c YYYY-MM-DDTHH:MM:SS.sssZ , rounded to the millisecond.
+
+ @param timeIntervalSince1970 The date, as seconds since 1970 UTC.
+ @param buffer Where to write; at least @c YFDateISO8601Length+1  bytes. The text is NUL terminated.
+
+ @return @c YFDateISO8601Length ; @c 0  if the year falls outside 0000 to 9999, or the date is not finite.
+ */
+
+FOUNDATION_EXPORT NSUInteger YFDateFormatISO8601(NSTimeInterval timeIntervalSince1970, char *buffer);
+
+/** Read ISO-8601 text.
+
+ Accepts @c YYYY-MM-DD , optionally followed by @c T  or a space and @c HH:MM , @c HH:MM:SS  or @c HH:MM:SS.fff  with any number of fraction digits, optionally followed by @c Z  or an offset such as @c +08:00 , @c +0800  or @c +08 . Without an offset the time is taken as UTC, as SQLite's own date functions do, so their output reads back unchanged.
+
+ @param bytes The text; need not be NUL terminated.
+ @param length Number of bytes of text.
+ @param outTimeIntervalSince1970 Receives the date, as seconds since 1970 UTC.
+
+ @return @c YES if the whole text is a valid date; @c NO otherwise, leaving @c outTimeIntervalSince1970  untouched.
+ */
+
+FOUNDATION_EXPORT BOOL YFDateParseISO8601(const char *bytes, NSUInteger length, NSTimeInterval *outTimeIntervalSince1970);
+
+/** A date as whole milliseconds since 1970 UTC, rounded to the nearest millisecond. */
+
+FOUNDATION_EXPORT int64_t YFDateEpochMillisecondsFromTimeInterval(NSTimeInterval timeIntervalSince1970);
+
+/** Milliseconds since 1970 UTC as seconds since 1970 UTC. */
+
+FOUNDATION_EXPORT NSTimeInterval YFDateTimeIntervalFromEpochMilliseconds(int64_t milliseconds);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,248 @@
+//
+//  YFDateCodec.m
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import "YFDateCodec.h"
+#import <math.h>
+
+// MARK: - Calendar
+
+// days since 1970-01-01 for a proleptic Gregorian date, and back.
+// after Howard Hinnant's days_from_civil / civil_from_days; exact for any year, no tables, no loops.
+
+static int64_t YFDateDaysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);                                  // [0, 399]
+    unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;           // [0, 365]
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;                      // [0, 146096]
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+static void YFDateCivilFromDays(int64_t z, int64_t *outYear, unsigned *outMonth, unsigned *outDay) {
+    z += 719468;
+    int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    unsigned doe = (unsigned)(z - era * 146097);                               // [0, 146096]
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;      // [0, 399]
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);                    // [0, 365]
+    unsigned mp = (5 * doy + 2) / 153;                                         // [0, 11]
+    unsigned m = mp < 10 ? mp + 3 : mp - 9;
+
+    *outYear = (int64_t)yoe + era * 400 + (m <= 2);
+    *outMonth = m;
+    *outDay = doy - (153 * mp + 2) / 5 + 1;
+}
+
+static unsigned YFDateDaysInMonth(int64_t year, unsigned month) {
+    static const unsigned char days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2 && (year % 4 == 0) && (year % 100 != 0 || year % 400 == 0)) {
+        return 29;
+    }
+    return days[month - 1];
+}
+
+// MARK: - Milliseconds
+
+int64_t YFDateEpochMillisecondsFromTimeInterval(NSTimeInterval timeIntervalSince1970) {
+    double milliseconds = round(timeIntervalSince1970 * 1000.0);
+
+    if (milliseconds != milliseconds) {
+        return 0;
+    }
+    // 2^63 is exactly representable; anything at or past it would overflow the conversion
+    if (milliseconds >= 9223372036854775808.0) {
+        return INT64_MAX;
+    }
+    if (milliseconds < -9223372036854775808.0) {
+        return INT64_MIN;
+    }
+
+    return (int64_t)milliseconds;
+}
+
+NSTimeInterval YFDateTimeIntervalFromEpochMilliseconds(int64_t milliseconds) {
+    // split first, so whole seconds stay exact past 2^53 milliseconds
+    int64_t seconds = milliseconds / 1000;
+    int64_t remainder = milliseconds % 1000;
+    return (NSTimeInterval)seconds + (NSTimeInterval)remainder / 1000.0;
+}
+
+// MARK: - ISO-8601
+
+static inline void YFDatePutDigits(char *p, unsigned value, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        p[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+}
+
+NSUInteger YFDateFormatISO8601(NSTimeInterval timeIntervalSince1970, char *buffer) {
+
+    if (!isfinite(timeIntervalSince1970) || fabs(timeIntervalSince1970) > 1e12) {
+        return 0;
+    }
+
+    int64_t milliseconds = YFDateEpochMillisecondsFromTimeInterval(timeIntervalSince1970);
+
+    // floor division, so dates before 1970 land on the right day
+    int64_t days = milliseconds / 86400000;
+    int64_t msOfDay = milliseconds % 86400000;
+    if (msOfDay < 0) {
+        msOfDay += 86400000;
+        days -= 1;
+    }
+
+    int64_t year;
+    unsigned month, day;
+    YFDateCivilFromDays(days, &year, &month, &day);
+
+    if (year < 0 || year > 9999) {
+        return 0;
+    }
+
+    unsigned ms = (unsigned)msOfDay;
+
+    YFDatePutDigits(buffer, (unsigned)year, 4);
+    buffer[4] = '-';
+    YFDatePutDigits(buffer + 5, month, 2);
+    buffer[7] = '-';
+    YFDatePutDigits(buffer + 8, day, 2);
+    buffer[10] = 'T';
+    YFDatePutDigits(buffer + 11, ms / 3600000, 2);
+    buffer[13] = ':';
+    YFDatePutDigits(buffer + 14, (ms / 60000) % 60, 2);
+    buffer[16] = ':';
+    YFDatePutDigits(buffer + 17, (ms / 1000) % 60, 2);
+    buffer[19] = '.';
+    YFDatePutDigits(buffer + 20, ms % 1000, 3);
+    buffer[23] = 'Z';
+    buffer[24] = '\0';
+
+    return YFDateISO8601Length;
+}
+
+// reads exactly `count` digits at *p, advancing p
+static inline BOOL YFDateGetDigits(const char **p, const char *end, int count, unsigned *outValue) {
+    if (end - *p < count) {
+        return NO;
+    }
+
+    unsigned value = 0;
+    for (int i = 0; i < count; i++) {
+        unsigned digit = (unsigned)((*p)[i] - '0');
+        if (digit > 9) {
+            return NO;
+        }
+        value = value * 10 + digit;
+    }
+
+    *p += count;
+    *outValue = value;
+    return YES;
+}
+
+static inline BOOL YFDateGetChar(const char **p, const char *end, char c) {
+    if (*p < end && **p == c) {
+        (*p)++;
+        return YES;
+    }
+    return NO;
+}
+
+BOOL YFDateParseISO8601(const char *bytes, NSUInteger length, NSTimeInterval *outTimeIntervalSince1970) {
+
+    if (!bytes) {
+        return NO;
+    }
+
+    const char *p = bytes;
+    const char *end = bytes + length;
+
+    unsigned year, month, day;
+    unsigned hour = 0, minute = 0, second = 0;
+    double fraction = 0;
+    int offsetMinutes = 0;
+
+    if (!YFDateGetDigits(&p, end, 4, &year) || !YFDateGetChar(&p, end, '-') ||
+        !YFDateGetDigits(&p, end, 2, &month) || !YFDateGetChar(&p, end, '-') ||
+        !YFDateGetDigits(&p, end, 2, &day)) {
+        return NO;
+    }
+
+    if (month < 1 || month > 12 || day < 1 || day > YFDateDaysInMonth(year, month)) {
+        return NO;
+    }
+
+    if (YFDateGetChar(&p, end, 'T') || YFDateGetChar(&p, end, 't') || YFDateGetChar(&p, end, ' ')) {
+
+        if (!YFDateGetDigits(&p, end, 2, &hour) || !YFDateGetChar(&p, end, ':') ||
+            !YFDateGetDigits(&p, end, 2, &minute)) {
+            return NO;
+        }
+
+        if (YFDateGetChar(&p, end, ':')) {
+            if (!YFDateGetDigits(&p, end, 2, &second)) {
+                return NO;
+            }
+
+            if (YFDateGetChar(&p, end, '.')) {
+                // integer nanoseconds, so .123 comes out as close to 0.123 as a double gets; digits past nine are ignored
+                const char *digits = p;
+                unsigned nanoseconds = 0, scale = 1000000000;
+                while (p < end && *p >= '0' && *p <= '9') {
+                    if (scale > 1) {
+                        scale /= 10;
+                        nanoseconds += (unsigned)(*p - '0') * scale;
+                    }
+                    p++;
+                }
+                if (p == digits) {
+                    return NO;
+                }
+                fraction = nanoseconds / 1e9;
+            }
+        }
+
+        // 60 allows for a leap second
+        if (hour > 23 || minute > 59 || second > 60) {
+            return NO;
+        }
+
+        if (YFDateGetChar(&p, end, 'Z') || YFDateGetChar(&p, end, 'z')) {
+            // UTC
+        }
+        else if (p < end && (*p == '+' || *p == '-')) {
+            int sign = (*p == '-') ? -1 : 1;
+            p++;
+
+            unsigned offsetHours, offsetMins = 0;
+            if (!YFDateGetDigits(&p, end, 2, &offsetHours)) {
+                return NO;
+            }
+            if (p < end) {
+                YFDateGetChar(&p, end, ':');
+                if (!YFDateGetDigits(&p, end, 2, &offsetMins)) {
+                    return NO;
+                }
+            }
+            if (offsetHours > 23 || offsetMins > 59) {
+                return NO;
+            }
+
+            offsetMinutes = sign * (int)(offsetHours * 60 + offsetMins);
+        }
+    }
+
+    if (p != end) {
+        return NO;
+    }
+
+    int64_t days = YFDateDaysFromCivil(year, month, day);
+    int64_t seconds = days * 86400 + hour * 3600 + minute * 60 + second - offsetMinutes * 60;
+
+    *outTimeIntervalSince1970 = (NSTimeInterval)seconds + fraction;
+    return YES;
+}
@@ -0,0 +1,229 @@
+//
+//  YFFunctionContext.h
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import <Foundation/Foundation.h>
+#import "YFDatabase.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Flags for the functions registered with @c -[YFDatabase makeScalarFunctionNamed:arguments:options:block:]  and its aggregate and window siblings. */
+
+typedef NS_OPTIONS(int, YFFunctionOptions) {
+    YFFunctionOptionsNone           = 0,
+    /** Same arguments, same result (@c SQLITE_DETERMINISTIC ). Lets the function appear in indexes on expressions, partial index conditions and generated columns, and lets the planner evaluate it once for constant arguments. */
+    YFFunctionOptionsDeterministic  = 1 << 0,
+    /** No side effects and reads nothing but its arguments (@c SQLITE_INNOCUOUS ), so it stays usable in schemas and triggers when untrusted schemas are disallowed. Requires SQLite 3.31. */
+    YFFunctionOptionsInnocuous      = 1 << 1,
+    /** Only callable from top-level SQL, never from views, triggers or schema structures (@c SQLITE_DIRECTONLY ). Requires SQLite 3.30. */
+    YFFunctionOptionsDirectOnly     = 1 << 2,
+};
+
+/** The arguments of one call of a function registered with @c YFDatabase , and where its result goes.
+
+ A context is only valid during the block it is passed to. Read arguments by index with the typed accessors; they go straight to @c sqlite3_value_*  without creating objects, except for the ones returning objects. Set the result with one of the @c result  methods; a call that sets none returns @c NULL .
+
+ Blocks run inside @c sqlite3_step , on the thread using the database, and must not use the database themselves.
+ */
+
+@interface YFFunctionContext : NSObject
+
+/** Number of arguments of this call. */
+
+@property (nonatomic, readonly) int argumentCount;
+
+///-----------------------------
+/// @name Arguments
+///-----------------------------
+
+/** The storage class of an argument.
+
+ @param idx Zero-based argument index.
+
+ @return The type, as @c sqlite3_value_type  reports it.
+ */
+
+- (YFSqliteValueType)typeOfArgumentAtIndex:(int)idx;
+
+/** Whether an argument is @c NULL . */
+
+- (BOOL)isNullAtIndex:(int)idx;
+
+/** An argument as an @c int , converted as SQLite converts. */
+
+- (int)intAtIndex:(int)idx;
+
+/** An argument as a 64-bit integer, converted as SQLite converts. */
+
+- (int64_t)int64AtIndex:(int)idx;
+
+/** An argument as a @c double , converted as SQLite converts. */
+
+- (double)doubleAtIndex:(int)idx;
+
+/** An argument as a new @c NSString ; @c nil  for @c NULL . */
+
+- (NSString * _Nullable)stringAtIndex:(int)idx;
+
+/** An argument as a new @c NSData ; @c nil  for @c NULL . */
+
+- (NSData * _Nullable)dataAtIndex:(int)idx;
+
+/** An argument as UTF-8 text, without copying; valid until the block returns. Compare and hash it with the @c YFBorrowedBytes  functions. */
+
+- (YFBorrowedBytes)borrowedTextAtIndex:(int)idx;
+
+/** An argument as bytes, without copying; valid until the block returns. */
+
+- (YFBorrowedBytes)borrowedBlobAtIndex:(int)idx;
+
+/** An argument as @c NSNumber , @c NSString  or @c NSData  according to its type; @c nil  for @c NULL . */
+
+- (id _Nullable)objectAtIndex:(int)idx;
+
+///-----------------------------
+/// @name Result
+///-----------------------------
+
+/** Return @c NULL . */
+
+- (void)resultNull;
+
+/** Return an integer. */
+
+- (void)resultInt64:(int64_t)value;
+
+/** Return a floating point number. */
+
+- (void)resultDouble:(double)value;
+
+/** Return text; @c nil  returns @c NULL . */
+
+- (void)resultString:(NSString * _Nullable)value;
+
+/** Return UTF-8 text, copied. */
+
+- (void)resultUTF8String:(const char *)bytes length:(NSUInteger)length;
+
+/** Return a blob; @c nil  returns @c NULL . */
+
+- (void)resultData:(NSData * _Nullable)value;
+
+/** Return an @c NSNumber , @c NSString , @c NSData  or @c NSNull  (or @c nil ) as the matching SQL value; other objects return their @c description . */
+
+- (void)resultObject:(id _Nullable)value;
+
+/** Fail the statement with a message. */
+
+- (void)resultError:(NSString *)message;
+
+/** Fail the statement with an SQLite error code, such as @c SQLITE_TOOBIG . */
+
+- (void)resultErrorCode:(int)errorCode;
+
+@end
+
+/** Computes one value of a scalar function. */
+
+typedef void(^YFScalarFunctionBlock)(YFFunctionContext *context);
+
+/** Folds one row into an aggregate's state.
+
+ @c state  starts out @c nil  for each group; store whatever accumulator object the function needs in it. It is kept alive by the aggregate until @c final .
+ */
+
+typedef void(^YFAggregateStepBlock)(YFFunctionContext *context, id _Nullable __strong * _Nonnull state);
+
+/** Sets the result of an aggregate from its state; @c state  is @c nil  when the group had no rows. */
+
+typedef void(^YFAggregateResultBlock)(YFFunctionContext *context, id _Nullable state);
+
+@interface YFDatabase (YFFunctions)
+
+///-----------------------------
+/// @name Typed SQL functions
+///-----------------------------
+
+/** Add or replace a scalar SQL function.
+
+ Unlike @c makeFunctionNamed:arguments:block: , arguments are read through a @c YFFunctionContext  instead of raw @c sqlite3_value  pointers, and the function can be declared deterministic so SQLite may use it in indexes on expressions and evaluate it once for constant arguments.
+
+@code
+[db makeScalarFunctionNamed:@"fold" arguments:1 options:YFFunctionOptionsDeterministic | YFFunctionOptionsInnocuous block:^(YFFunctionContext *context) {
+    NSString *string = [context stringAtIndex:0];
+    [context resultString:[string stringByFoldingWithOptions:NSDiacriticInsensitiveSearch | NSCaseInsensitiveSearch locale:nil]];
+} error:&error];
+
+[db executeUpdate:@"CREATE INDEX person_folded_name ON person (fold(name))"];
+@endcode
+
+ Functions belong to the connection: register them again after reopening.
+
+ @param name Name of the function.
+ @param arguments Number of arguments; @c -1  for any number.
+ @param options Determinism and trust flags.
+ @param block Computes the result.
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES on success; @c NO on failure.
+
+ @see [sqlite3_create_function_v2()](https://sqlite.org/c3ref/create_function.html)
+ */
+
+- (BOOL)makeScalarFunctionNamed:(NSString *)name arguments:(int)arguments options:(YFFunctionOptions)options block:(YFScalarFunctionBlock)block error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Add or replace an aggregate SQL function, computed inside the query instead of over fetched rows.
+
+@code
+[db makeAggregateFunctionNamed:@"median" arguments:1 options:YFFunctionOptionsDeterministic step:^(YFFunctionContext *context, id __strong *state) {
+    if ([context isNullAtIndex:0]) {
+        return;
+    }
+    if (!*state) {
+        *state = [NSMutableArray array];
+    }
+    [(NSMutableArray *)*state addObject:@([context doubleAtIndex:0])];
+} final:^(YFFunctionContext *context, NSMutableArray *values) {
+    [values sortUsingSelector:@selector(compare:)];
+    [context resultObject:[values count] ? values[[values count] / 2] : nil];
+} error:&error];
+@endcode
+
+ @param name Name of the function.
+ @param arguments Number of arguments; @c -1  for any number.
+ @param options Determinism and trust flags.
+ @param step Folds each row of a group into the group's state.
+ @param final Sets the result from the state.
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)makeAggregateFunctionNamed:(NSString *)name arguments:(int)arguments options:(YFFunctionOptions)options step:(YFAggregateStepBlock)step final:(YFAggregateResultBlock)final error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Add or replace an aggregate window function, usable both as an aggregate and with @c OVER .
+
+ With an @c inverse  block a sliding frame is maintained in place, rather than recomputed for every row. Requires SQLite 3.25.
+
+ @param name Name of the function.
+ @param arguments Number of arguments; @c -1  for any number.
+ @param options Determinism and trust flags.
+ @param step Adds a row entering the frame to the state.
+ @param inverse Removes a row leaving the frame from the state.
+ @param value Sets the result for the current frame; the state stays alive.
+ @param final Sets the result for the last frame.
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES on success; @c NO on failure.
+
+ @see [sqlite3_create_window_function()](https://sqlite.org/c3ref/create_function.html)
+ */
+
+- (BOOL)makeWindowFunctionNamed:(NSString *)name arguments:(int)arguments options:(YFFunctionOptions)options step:(YFAggregateStepBlock)step inverse:(YFAggregateStepBlock)inverse value:(YFAggregateResultBlock)value final:(YFAggregateResultBlock)final error:(NSError * _Nullable __autoreleasing *)outErr;
+
+@end
+
+NS_ASSUME_NONNULL_END
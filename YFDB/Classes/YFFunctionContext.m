@@ -0,0 +1,466 @@
+//
+//  YFFunctionContext.m
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import "YFFunctionContext.h"
+#import "YFDatabase.h"
+#import <sqlite3.h>
+
+// MARK: - YFDatabase Private Extension
+
+@interface YFDatabase (YFFunctionsPrivate)
+- (void)didRegisterFunctionNamed:(NSString *)name deterministic:(BOOL)deterministic;
+@end
+
+// MARK: - YFFunctionContext Private Extension
+
+@interface YFFunctionContext () {
+@public
+    sqlite3_context     *_context;
+    int                 _argc;
+    sqlite3_value       **_argv;
+}
+@end
+
+// MARK: - YFFunctionContext
+
+@implementation YFFunctionContext
+
+- (int)argumentCount {
+    return _argc;
+}
+
+- (sqlite3_value *)valueAtIndex:(int)idx {
+    return (idx >= 0 && idx < _argc) ? _argv[idx] : 0x00;
+}
+
+// MARK: Arguments
+
+- (YFSqliteValueType)typeOfArgumentAtIndex:(int)idx {
+    sqlite3_value *value = [self valueAtIndex:idx];
+    return value ? sqlite3_value_type(value) : SQLITE_NULL;
+}
+
+- (BOOL)isNullAtIndex:(int)idx {
+    return [self typeOfArgumentAtIndex:idx] == SQLITE_NULL;
+}
+
+- (int)intAtIndex:(int)idx {
+    sqlite3_value *value = [self valueAtIndex:idx];
+    return value ? sqlite3_value_int(value) : 0;
+}
+
+- (int64_t)int64AtIndex:(int)idx {
+    sqlite3_value *value = [self valueAtIndex:idx];
+    return value ? sqlite3_value_int64(value) : 0;
+}
+
+- (double)doubleAtIndex:(int)idx {
+    sqlite3_value *value = [self valueAtIndex:idx];
+    return value ? sqlite3_value_double(value) : 0;
+}
+
+- (NSString *)stringAtIndex:(int)idx {
+    sqlite3_value *value = [self valueAtIndex:idx];
+
+    if (!value || sqlite3_value_type(value) == SQLITE_NULL) {
+        return nil;
+    }
+
+    const unsigned char *text = sqlite3_value_text(value);
+    int length = sqlite3_value_bytes(value);
+
+    return text ? [[NSString alloc] initWithBytes:text length:(NSUInteger)length encoding:NSUTF8StringEncoding] : nil;
+}
+
+- (NSData *)dataAtIndex:(int)idx {
+    sqlite3_value *value = [self valueAtIndex:idx];
+
+    if (!value || sqlite3_value_type(value) == SQLITE_NULL) {
+        return nil;
+    }
+
+    const void *bytes = sqlite3_value_blob(value);
+    int length = sqlite3_value_bytes(value);
+
+    return bytes ? [NSData dataWithBytes:bytes length:(NSUInteger)length] : [NSData data];
+}
+
+- (YFBorrowedBytes)borrowedBytesAtIndex:(int)idx text:(BOOL)text {
+    // no owner: the views are not tracked, they simply end with the call
+    YFBorrowedBytes view = { 0x00, 0, 0x00, 0 };
+    sqlite3_value *value = [self valueAtIndex:idx];
+
+    if (!value || sqlite3_value_type(value) == SQLITE_NULL) {
+        return view;
+    }
+
+    view.bytes = text ? (const void *)sqlite3_value_text(value) : sqlite3_value_blob(value);
+    view.length = (NSUInteger)sqlite3_value_bytes(value);
+
+    if (!view.bytes && !text) {
+        view.bytes = "";
+    }
+
+    return view;
+}
+
+- (YFBorrowedBytes)borrowedTextAtIndex:(int)idx {
+    return [self borrowedBytesAtIndex:idx text:YES];
+}
+
+- (YFBorrowedBytes)borrowedBlobAtIndex:(int)idx {
+    return [self borrowedBytesAtIndex:idx text:NO];
+}
+
+- (id)objectAtIndex:(int)idx {
+    sqlite3_value *value = [self valueAtIndex:idx];
+
+    switch (value ? sqlite3_value_type(value) : SQLITE_NULL) {
+        case SQLITE_INTEGER:
+            return [NSNumber numberWithLongLong:sqlite3_value_int64(value)];
+        case SQLITE_FLOAT:
+            return [NSNumber numberWithDouble:sqlite3_value_double(value)];
+        case SQLITE_TEXT:
+            return [self stringAtIndex:idx];
+        case SQLITE_BLOB:
+            return [self dataAtIndex:idx];
+        default:
+            return nil;
+    }
+}
+
+// MARK: Result
+
+- (void)resultNull {
+    sqlite3_result_null(_context);
+}
+
+- (void)resultInt64:(int64_t)value {
+    sqlite3_result_int64(_context, value);
+}
+
+- (void)resultDouble:(double)value {
+    sqlite3_result_double(_context, value);
+}
+
+- (void)resultString:(NSString *)value {
+    if (!value) {
+        sqlite3_result_null(_context);
+        return;
+    }
+    sqlite3_result_text(_context, [value UTF8String], -1, SQLITE_TRANSIENT);
+}
+
+- (void)resultUTF8String:(const char *)bytes length:(NSUInteger)length {
+    sqlite3_result_text(_context, bytes, (int)length, SQLITE_TRANSIENT);
+}
+
+- (void)resultData:(NSData *)value {
+    if (!value) {
+        sqlite3_result_null(_context);
+        return;
+    }
+    // a NULL pointer would return NULL rather than an empty blob
+    const void *bytes = [value bytes] ? [value bytes] : "";
+    sqlite3_result_blob(_context, bytes, (int)[value length], SQLITE_TRANSIENT);
+}
+
+- (void)resultObject:(id)value {
+    if (!value || (NSNull *)value == [NSNull null]) {
+        sqlite3_result_null(_context);
+    }
+    else if ([value isKindOfClass:[NSString class]]) {
+        [self resultString:value];
+    }
+    else if ([value isKindOfClass:[NSNumber class]]) {
+        const char *objCType = [(NSNumber *)value objCType];
+        if (objCType[0] == 'd' || objCType[0] == 'f') {
+            sqlite3_result_double(_context, [value doubleValue]);
+        }
+        else if (objCType[0] == 'Q') {
+            sqlite3_result_int64(_context, (long long)[value unsignedLongLongValue]);
+        }
+        else {
+            sqlite3_result_int64(_context, [value longLongValue]);
+        }
+    }
+    else if ([value isKindOfClass:[NSData class]]) {
+        [self resultData:value];
+    }
+    else {
+        [self resultString:[value description]];
+    }
+}
+
+- (void)resultError:(NSString *)message {
+    sqlite3_result_error(_context, [message UTF8String], -1);
+}
+
+- (void)resultErrorCode:(int)errorCode {
+    sqlite3_result_error_code(_context, errorCode);
+}
+
+// MARK: Private
+
+- (void)setSqliteContext:(sqlite3_context *)context argumentCount:(int)argc values:(sqlite3_value **)argv {
+    _context = context;
+    _argc = argc;
+    _argv = argv;
+}
+
+@end
+
+// MARK: - YFFunction
+
+/** One registered function: its blocks, owned by SQLite through @c xDestroy . */
+
+@interface YFFunction : NSObject {
+@public
+    YFScalarFunctionBlock   _scalar;
+    YFAggregateStepBlock    _step;
+    YFAggregateStepBlock    _inverse;
+    YFAggregateResultBlock  _value;
+    YFAggregateResultBlock  _final;
+
+    // reused from call to call; a nested call of the same function gets a fresh one
+    YFFunctionContext       *_idleContext;
+}
+- (int)registerOnDatabase:(sqlite3 *)db name:(NSString *)name arguments:(int)arguments options:(YFFunctionOptions)options;
+@end
+
+static inline YFFunctionContext *YFFunctionEnter(YFFunction *function, sqlite3_context *ctx, int argc, sqlite3_value **argv) {
+    YFFunctionContext *context = function->_idleContext;
+
+    if (context) {
+        function->_idleContext = nil;
+    }
+    else {
+        context = [[YFFunctionContext alloc] init];
+    }
+
+    context->_context = ctx;
+    context->_argc = argc;
+    context->_argv = argv;
+
+    return context;
+}
+
+static inline void YFFunctionLeave(YFFunction *function, YFFunctionContext *context) {
+    context->_context = 0x00;
+    context->_argc = 0;
+    context->_argv = 0x00;
+
+    function->_idleContext = context;
+}
+
+// exceptions must not unwind through sqlite3_step
+#define YF_FUNCTION_CALL(ctx, call)                                                             \
+    @try {                                                                                      \
+        call;                                                                                   \
+    }                                                                                           \
+    @catch (NSException *exception) {                                                           \
+        NSString *reason = [exception reason] ? [exception reason] : [exception name];          \
+        sqlite3_result_error(ctx, [reason UTF8String], -1);                                     \
+    }
+
+static void YFFunctionScalar(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
+    YFFunction *function = (__bridge YFFunction *)sqlite3_user_data(ctx);
+
+    @autoreleasepool {
+        YFFunctionContext *context = YFFunctionEnter(function, ctx, argc, argv);
+        YF_FUNCTION_CALL(ctx, function->_scalar(context));
+        YFFunctionLeave(function, context);
+    }
+}
+
+// The aggregate state lives in sqlite3_aggregate_context as a retained pointer, one per group
+// (or window), until xFinal hands it back.
+
+static void YFFunctionFold(sqlite3_context *ctx, int argc, sqlite3_value **argv, BOOL inverse) {
+    YFFunction *function = (__bridge YFFunction *)sqlite3_user_data(ctx);
+    void **slot = sqlite3_aggregate_context(ctx, (int)sizeof(void *));
+
+    if (!slot) {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+
+    @autoreleasepool {
+        YFFunctionContext *context = YFFunctionEnter(function, ctx, argc, argv);
+
+        id oldState = (__bridge id)*slot;
+        id state = oldState;
+        YFAggregateStepBlock block = inverse ? function->_inverse : function->_step;
+
+        YF_FUNCTION_CALL(ctx, block(context, &state));
+
+        if (state != oldState) {
+            if (*slot) {
+                (void)(__bridge_transfer id)*slot;
+            }
+            *slot = state ? (__bridge_retained void *)state : 0x00;
+        }
+
+        YFFunctionLeave(function, context);
+    }
+}
+
+static void YFFunctionStep(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
+    YFFunctionFold(ctx, argc, argv, NO);
+}
+
+static void YFFunctionInverse(sqlite3_context *ctx, int argc, sqlite3_value **argv) {
+    YFFunctionFold(ctx, argc, argv, YES);
+}
+
+static void YFFunctionValue(sqlite3_context *ctx) {
+    YFFunction *function = (__bridge YFFunction *)sqlite3_user_data(ctx);
+    void **slot = sqlite3_aggregate_context(ctx, 0);
+
+    @autoreleasepool {
+        YFFunctionContext *context = YFFunctionEnter(function, ctx, 0, 0x00);
+        id state = (slot && *slot) ? (__bridge id)*slot : nil;
+
+        YF_FUNCTION_CALL(ctx, function->_value(context, state));
+
+        YFFunctionLeave(function, context);
+    }
+}
+
+static void YFFunctionFinal(sqlite3_context *ctx) {
+    YFFunction *function = (__bridge YFFunction *)sqlite3_user_data(ctx);
+
+    // asking for zero bytes does not allocate when no row ever reached the step
+    void **slot = sqlite3_aggregate_context(ctx, 0);
+
+    @autoreleasepool {
+        YFFunctionContext *context = YFFunctionEnter(function, ctx, 0, 0x00);
+        id state = nil;
+
+        if (slot && *slot) {
+            state = (__bridge_transfer id)*slot;
+            *slot = 0x00;
+        }
+
+        YF_FUNCTION_CALL(ctx, function->_final(context, state));
+
+        YFFunctionLeave(function, context);
+    }
+}
+
+static void YFFunctionDestroy(void *pApp) {
+    (void)(__bridge_transfer YFFunction *)pApp;
+}
+
+@implementation YFFunction
+
+- (int)registerOnDatabase:(sqlite3 *)db name:(NSString *)name arguments:(int)arguments options:(YFFunctionOptions)options {
+
+    int flags = SQLITE_UTF8;
+
+#ifdef SQLITE_DETERMINISTIC
+    if (options & YFFunctionOptionsDeterministic) {
+        flags |= SQLITE_DETERMINISTIC;
+    }
+#endif
+#ifdef SQLITE_INNOCUOUS
+    if (options & YFFunctionOptionsInnocuous) {
+        flags |= SQLITE_INNOCUOUS;
+    }
+#endif
+#ifdef SQLITE_DIRECTONLY
+    if (options & YFFunctionOptionsDirectOnly) {
+        flags |= SQLITE_DIRECTONLY;
+    }
+#endif
+
+    // released by YFFunctionDestroy: when the function is replaced, the connection closes, or registration fails
+    void *pApp = (__bridge_retained void *)self;
+
+    if (_inverse) {
+#if SQLITE_VERSION_NUMBER >= 3025000
+        return sqlite3_create_window_function(db, [name UTF8String], arguments, flags, pApp, &YFFunctionStep, &YFFunctionFinal, &YFFunctionValue, &YFFunctionInverse, &YFFunctionDestroy);
+#else
+        YFFunctionDestroy(pApp);
+        return SQLITE_ERROR;
+#endif
+    }
+
+    if (_scalar) {
+        return sqlite3_create_function_v2(db, [name UTF8String], arguments, flags, pApp, &YFFunctionScalar, 0x00, 0x00, &YFFunctionDestroy);
+    }
+
+    return sqlite3_create_function_v2(db, [name UTF8String], arguments, flags, pApp, 0x00, &YFFunctionStep, &YFFunctionFinal, &YFFunctionDestroy);
+}
+
+@end
+
+// MARK: - YFDatabase (YFFunctions)
+
+@implementation YFDatabase (YFFunctions)
+
+- (BOOL)registerFunction:(YFFunction *)function named:(NSString *)name arguments:(int)arguments options:(YFFunctionOptions)options error:(NSError * _Nullable __autoreleasing *)outErr {
+    
+    if (![self sqliteHandle]) {
+        if (outErr) {
+            NSDictionary* errorMessage = [NSDictionary dictionaryWithObject:@"database is not open" forKey:NSLocalizedDescriptionKey];
+            *outErr = [NSError errorWithDomain:@"YFDatabase" code:SQLITE_MISUSE userInfo:errorMessage];
+        }
+        return NO;
+    }
+    
+    int rc = [function registerOnDatabase:[self sqliteHandle] name:name arguments:arguments options:options];
+    
+    if (rc != SQLITE_OK) {
+        if ([self logsErrors]) {
+            NSLog(@"Error registering function %@ (%d: %@)", name, rc, [self lastErrorMessage]);
+        }
+        if (outErr) {
+            *outErr = [self lastError];
+        }
+        return NO;
+    }
+    
+    [self didRegisterFunctionNamed:name deterministic:(options & YFFunctionOptionsDeterministic) != 0];
+    
+    return YES;
+}
+
+- (BOOL)makeScalarFunctionNamed:(NSString *)name arguments:(int)arguments options:(YFFunctionOptions)options block:(YFScalarFunctionBlock)block error:(NSError * _Nullable __autoreleasing *)outErr {
+    YFFunction *function = [[YFFunction alloc] init];
+    function->_scalar = [block copy];
+    
+    return [self registerFunction:function named:name arguments:arguments options:options error:outErr];
+}
+
+- (BOOL)makeAggregateFunctionNamed:(NSString *)name arguments:(int)arguments options:(YFFunctionOptions)options step:(YFAggregateStepBlock)step final:(YFAggregateResultBlock)final error:(NSError * _Nullable __autoreleasing *)outErr {
+    YFFunction *function = [[YFFunction alloc] init];
+    function->_step = [step copy];
+    function->_final = [final copy];
+    
+    return [self registerFunction:function named:name arguments:arguments options:options error:outErr];
+}
+
+- (BOOL)makeWindowFunctionNamed:(NSString *)name arguments:(int)arguments options:(YFFunctionOptions)options step:(YFAggregateStepBlock)step inverse:(YFAggregateStepBlock)inverse value:(YFAggregateResultBlock)value final:(YFAggregateResultBlock)final error:(NSError * _Nullable __autoreleasing *)outErr {
+#if SQLITE_VERSION_NUMBER >= 3025000
+    YFFunction *function = [[YFFunction alloc] init];
+    function->_step = [step copy];
+    function->_inverse = [inverse copy];
+    function->_value = [value copy];
+    function->_final = [final copy];
+    
+    return [self registerFunction:function named:name arguments:arguments options:options error:outErr];
+#else
+    if (outErr) {
+        NSDictionary* errorMessage = [NSDictionary dictionaryWithObject:@"window functions require SQLite 3.25" forKey:NSLocalizedDescriptionKey];
+        *outErr = [NSError errorWithDomain:@"YFDatabase" code:SQLITE_ERROR userInfo:errorMessage];
+    }
+    return NO;
+#endif
+}
+
+@end
@@ -0,0 +1,202 @@
+//
+//  YFPreparedStatement.h
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import <Foundation/Foundation.h>
+#import "YFResultSet.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class YFDatabase;
+@class YFStatement;
+
+/** Reusable handle on a prepared SQL statement.
+
+ Get one from @c -[YFDatabase prepareStatement:error:] , then run it as many times as needed:
+
+@code
+YFPreparedStatement *insert = [db prepareStatement:@"INSERT INTO t (id, name) VALUES (?, ?)" error:&error];
+for (Row *row in rows) {
+    [insert bindInt64:row.identifier atIndex:1];
+    [insert bindText:row.name atIndex:2];
+    if (![insert stepWithError:&error]) break;
+    [insert reset];
+}
+[insert close];
+@endcode
+
+ Binding, stepping and resetting do not create Objective-C objects, unlike @c executeUpdate:  which builds a @c YFResultSet  for every call. When the database caches statements, the underlying @c YFStatement  comes from the cache and goes back to it on @c close .
+
+ Parameter indexes start at 1, column indexes at 0, as in SQLite.
+ */
+
+@interface YFPreparedStatement : NSObject
+
+/** The database the statement was prepared on; @c nil  once closed. */
+
+@property (nonatomic, retain, readonly, nullable) YFDatabase *parentDB;
+
+/** The SQL text. */
+
+@property (nonatomic, copy, readonly) NSString *query;
+
+/** The wrapped statement; @c nil  once closed. */
+
+@property (nonatomic, retain, readonly, nullable) YFStatement *statement;
+
+/** Number of SQL parameters. */
+
+@property (nonatomic, readonly) int parameterCount;
+
+/** Number of result columns. */
+
+@property (nonatomic, readonly) int columnCount;
+
+/** Index of a named parameter.
+
+ @param name The parameter name including its prefix, e.g. @c @":name" .
+
+ @return The one-based index, or @c 0  if there is no such parameter.
+ */
+
+- (int)parameterIndexForName:(NSString *)name;
+
+///---------------------
+/// @name Binding values
+///---------------------
+
+/** Bind @c NULL . */
+
+- (BOOL)bindNullAtIndex:(int)idx;
+
+/** Bind an @c int . */
+
+- (BOOL)bindInt:(int)value atIndex:(int)idx;
+
+/** Bind a 64-bit integer. */
+
+- (BOOL)bindInt64:(int64_t)value atIndex:(int)idx;
+
+/** Bind a @c double . */
+
+- (BOOL)bindDouble:(double)value atIndex:(int)idx;
+
+/** Bind a string. SQLite takes a copy; @c nil  binds @c NULL . */
+
+- (BOOL)bindText:(NSString * _Nullable)value atIndex:(int)idx;
+
+/** Bind a string without copying it.
+
+ @warning The string must stay alive and unmodified until the statement has been stepped and reset.
+ */
+
+- (BOOL)bindTextNoCopy:(NSString *)value atIndex:(int)idx;
+
+/** Bind UTF-8 bytes.
+
+ @param bytes The UTF-8 bytes.
+ @param length Number of bytes, or @c -1  if @c bytes  is NUL terminated.
+ @param idx The one-based parameter index.
+ @param copy If @c NO , the bytes must stay valid until the statement has been stepped and reset.
+ */
+
+- (BOOL)bindUTF8String:(const char *)bytes length:(int)length atIndex:(int)idx copy:(BOOL)copy;
+
+/** Bind a blob. SQLite takes a copy; @c nil  binds @c NULL . */
+
+- (BOOL)bindBlob:(NSData * _Nullable)value atIndex:(int)idx;
+
+/** Bind a blob without copying it.
+
+ @warning The data must stay alive until the statement has been stepped and reset.
+ */
+
+- (BOOL)bindBlobNoCopy:(NSData *)value atIndex:(int)idx;
+
+/** Bind a blob of @c length  zero bytes, to be filled later through a @c YFBlobHandle . No memory is allocated for it. */
+
+- (BOOL)bindZeroBlobOfLength:(NSUInteger)length atIndex:(int)idx;
+
+/** Bind an object using the same conversions as @c executeUpdate: . The value is copied. */
+
+- (BOOL)bindObject:(id _Nullable)value atIndex:(int)idx;
+
+/** Set every parameter back to @c NULL . */
+
+- (BOOL)clearBindings;
+
+///------------------------
+/// @name Running statement
+///------------------------
+
+/** Step to the next row.
+
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES if a row is available; @c NO when done or on error.
+ */
+
+- (BOOL)nextWithError:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Step to the next row.
+
+ @return @c YES if a row is available; @c NO when done or on error.
+ */
+
+- (BOOL)next;
+
+/** Run the statement to completion, e.g. an INSERT.
+
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES if the statement finished with @c SQLITE_DONE ; @c NO otherwise.
+ */
+
+- (BOOL)stepWithError:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Run the statement to completion, e.g. an INSERT.
+
+ @return @c YES if the statement finished with @c SQLITE_DONE ; @c NO otherwise.
+ */
+
+- (BOOL)step;
+
+/** Reset the statement so it can run again. Bindings are kept.
+
+ @return @c YES on success; @c NO if the last step failed.
+ */
+
+- (BOOL)reset;
+
+/** Release the statement, handing it back to the statement cache if there is one. */
+
+- (void)close;
+
+///----------------------------------
+/// @name Reading the current row
+///----------------------------------
+
+- (int)intForColumnIndex:(int)columnIdx;
+
+- (int64_t)int64ForColumnIndex:(int)columnIdx;
+
+- (double)doubleForColumnIndex:(int)columnIdx;
+
+/** The UTF-8 text of the column, valid until the next step or reset. */
+
+- (const unsigned char * _Nullable)UTF8StringForColumnIndex:(int)columnIdx;
+
+- (NSString * _Nullable)stringForColumnIndex:(int)columnIdx;
+
+- (NSData * _Nullable)dataForColumnIndex:(int)columnIdx;
+
+- (YFSqliteValueType)typeForColumnIndex:(int)columnIdx;
+
+- (BOOL)columnIndexIsNull:(int)columnIdx;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,263 @@
+//
+//  YFPreparedStatement.m
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import "YFPreparedStatement.h"
+#import "YFDatabase.h"
+#import <sqlite3.h>
+
+// MARK: - YFDatabase Private Extension
+
+@interface YFDatabase ()
+- (int)bindObject:(id)obj toColumn:(int)idx inStatement:(sqlite3_stmt*)pStmt copyBytes:(BOOL)copyBytes;
+- (void)preparedStatementDidClose:(YFPreparedStatement *)preparedStatement;
+- (void)stepDidFailWithResult:(int)rc;
+@end
+
+// MARK: - YFPreparedStatement
+
+@interface YFPreparedStatement () {
+    sqlite3_stmt *_pStmt;
+
+    // first bind that failed since the last reset, so a batch can tell a half bound row from a good one
+    int _bindErrorCode;
+    int _bindErrorIndex;
+}
+@property (nonatomic, retain, nullable) YFDatabase *parentDB;
+@property (nonatomic, retain, nullable) YFStatement *statement;
+@end
+
+@implementation YFPreparedStatement
+
++ (instancetype)preparedStatementWithStatement:(YFStatement *)statement query:(NSString *)query usingParentDatabase:(YFDatabase *)aDB {
+    YFPreparedStatement *ps = [[YFPreparedStatement alloc] init];
+
+    ps->_query = [query copy];
+    ps->_pStmt = [statement statement];
+    [ps setStatement:statement];
+    [ps setParentDB:aDB];
+
+    NSParameterAssert(![statement inUse]);
+    [statement setInUse:YES];
+
+    return ps;
+}
+
+- (void)dealloc {
+    [self close];
+}
+
+- (void)close {
+    _pStmt = 0x00;
+
+    [_statement reset];
+    _statement = nil;
+
+    [_parentDB preparedStatementDidClose:self];
+    _parentDB = nil;
+}
+
+- (int)parameterCount {
+    return sqlite3_bind_parameter_count(_pStmt);
+}
+
+- (int)columnCount {
+    return sqlite3_column_count(_pStmt);
+}
+
+- (int)parameterIndexForName:(NSString *)name {
+    return sqlite3_bind_parameter_index(_pStmt, [name UTF8String]);
+}
+
+// MARK: Bind
+
+- (BOOL)checkBind:(int)rc atIndex:(int)idx {
+    if (rc == SQLITE_OK) {
+        return YES;
+    }
+
+    if (!_bindErrorCode) {
+        _bindErrorCode = rc;
+        _bindErrorIndex = idx;
+    }
+
+    if ([_parentDB logsErrors]) {
+        NSLog(@"Error: unable to bind parameter %d (%d, %s)", idx, rc, sqlite3_errmsg([_parentDB sqliteHandle]));
+    }
+
+    return NO;
+}
+
+- (BOOL)bindNullAtIndex:(int)idx {
+    return [self checkBind:sqlite3_bind_null(_pStmt, idx) atIndex:idx];
+}
+
+- (BOOL)bindInt:(int)value atIndex:(int)idx {
+    return [self checkBind:sqlite3_bind_int(_pStmt, idx, value) atIndex:idx];
+}
+
+- (BOOL)bindInt64:(int64_t)value atIndex:(int)idx {
+    return [self checkBind:sqlite3_bind_int64(_pStmt, idx, value) atIndex:idx];
+}
+
+- (BOOL)bindDouble:(double)value atIndex:(int)idx {
+    return [self checkBind:sqlite3_bind_double(_pStmt, idx, value) atIndex:idx];
+}
+
+- (BOOL)bindValue:(id)value atIndex:(int)idx copyBytes:(BOOL)copyBytes {
+    int rc = _parentDB ? [_parentDB bindObject:value toColumn:idx inStatement:_pStmt copyBytes:copyBytes] : SQLITE_MISUSE;
+    return [self checkBind:rc atIndex:idx];
+}
+
+- (BOOL)bindText:(NSString *)value atIndex:(int)idx {
+    return [self bindValue:value atIndex:idx copyBytes:YES];
+}
+
+- (BOOL)bindTextNoCopy:(NSString *)value atIndex:(int)idx {
+    return [self bindValue:value atIndex:idx copyBytes:NO];
+}
+
+- (BOOL)bindUTF8String:(const char *)bytes length:(int)length atIndex:(int)idx copy:(BOOL)copy {
+    return [self checkBind:sqlite3_bind_text(_pStmt, idx, bytes, length, copy ? SQLITE_TRANSIENT : SQLITE_STATIC) atIndex:idx];
+}
+
+- (BOOL)bindBlob:(NSData *)value atIndex:(int)idx {
+    return [self bindValue:value atIndex:idx copyBytes:YES];
+}
+
+- (BOOL)bindBlobNoCopy:(NSData *)value atIndex:(int)idx {
+    return [self bindValue:value atIndex:idx copyBytes:NO];
+}
+
+- (BOOL)bindZeroBlobOfLength:(NSUInteger)length atIndex:(int)idx {
+#if SQLITE_VERSION_NUMBER >= 3008011
+    return [self checkBind:sqlite3_bind_zeroblob64(_pStmt, idx, (sqlite3_uint64)length) atIndex:idx];
+#else
+    return [self checkBind:sqlite3_bind_zeroblob(_pStmt, idx, (int)length) atIndex:idx];
+#endif
+}
+
+- (BOOL)bindObject:(id)value atIndex:(int)idx {
+    return [self bindValue:value atIndex:idx copyBytes:YES];
+}
+
+- (BOOL)clearBindings {
+    _bindErrorCode = SQLITE_OK;
+    return _pStmt && sqlite3_clear_bindings(_pStmt) == SQLITE_OK;
+}
+
+// MARK: Private
+
+- (NSError *)bindError {
+    if (!_bindErrorCode) {
+        return nil;
+    }
+
+    NSString *message = [NSString stringWithFormat:@"Unable to bind parameter %d (%s)", _bindErrorIndex, sqlite3_errstr(_bindErrorCode)];
+    return [NSError errorWithDomain:@"YFDatabase" code:_bindErrorCode userInfo:@{NSLocalizedDescriptionKey : message}];
+}
+
+// MARK: Step
+
+- (int)internalStepWithError:(NSError * _Nullable __autoreleasing *)outErr {
+
+    if (!_pStmt) {
+        if (outErr) {
+            NSDictionary* errorMessage = [NSDictionary dictionaryWithObject:@"prepared statement is closed" forKey:NSLocalizedDescriptionKey];
+            *outErr = [NSError errorWithDomain:@"YFDatabase" code:SQLITE_MISUSE userInfo:errorMessage];
+        }
+        return SQLITE_MISUSE;
+    }
+
+    int rc = sqlite3_step(_pStmt);
+
+    if (SQLITE_DONE != rc && SQLITE_ROW != rc) {
+        [_parentDB stepDidFailWithResult:rc];
+        
+        if ([_parentDB logsErrors]) {
+            NSLog(@"Error calling sqlite3_step (%d: %s) ps", rc, sqlite3_errmsg([_parentDB sqliteHandle]));
+            NSLog(@"DB Query: %@", _query);
+        }
+        if (outErr) {
+            *outErr = [_parentDB lastError];
+        }
+    }
+
+    return rc;
+}
+
+- (BOOL)nextWithError:(NSError * _Nullable __autoreleasing *)outErr {
+    return [self internalStepWithError:outErr] == SQLITE_ROW;
+}
+
+- (BOOL)next {
+    return [self nextWithError:nil];
+}
+
+- (BOOL)stepWithError:(NSError * _Nullable __autoreleasing *)outErr {
+    return [self internalStepWithError:outErr] == SQLITE_DONE;
+}
+
+- (BOOL)step {
+    return [self stepWithError:nil];
+}
+
+- (BOOL)reset {
+    _bindErrorCode = SQLITE_OK;
+    return _pStmt && sqlite3_reset(_pStmt) == SQLITE_OK;
+}
+
+// MARK: Columns
+
+- (int)intForColumnIndex:(int)columnIdx {
+    return sqlite3_column_int(_pStmt, columnIdx);
+}
+
+- (int64_t)int64ForColumnIndex:(int)columnIdx {
+    return sqlite3_column_int64(_pStmt, columnIdx);
+}
+
+- (double)doubleForColumnIndex:(int)columnIdx {
+    return sqlite3_column_double(_pStmt, columnIdx);
+}
+
+- (const unsigned char *)UTF8StringForColumnIndex:(int)columnIdx {
+    return sqlite3_column_text(_pStmt, columnIdx);
+}
+
+- (NSString *)stringForColumnIndex:(int)columnIdx {
+    const char *c = (const char *)sqlite3_column_text(_pStmt, columnIdx);
+
+    if (!c) {
+        return nil;
+    }
+
+    return [[NSString alloc] initWithBytes:c length:(NSUInteger)sqlite3_column_bytes(_pStmt, columnIdx) encoding:NSUTF8StringEncoding];
+}
+
+- (NSData *)dataForColumnIndex:(int)columnIdx {
+    const void *bytes = sqlite3_column_blob(_pStmt, columnIdx);
+
+    if (!bytes) {
+        return nil;
+    }
+
+    return [NSData dataWithBytes:bytes length:(NSUInteger)sqlite3_column_bytes(_pStmt, columnIdx)];
+}
+
+- (YFSqliteValueType)typeForColumnIndex:(int)columnIdx {
+    return sqlite3_column_type(_pStmt, columnIdx);
+}
+
+- (BOOL)columnIndexIsNull:(int)columnIdx {
+    return sqlite3_column_type(_pStmt, columnIdx) == SQLITE_NULL;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ %@", [super description], _query];
+}
+
+@end
@@ -0,0 +1,82 @@
+//
+//  YFQueryResultCache.h
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Keeps the rows of repeated read-only queries, and drops them when the tables they read change.
+
+ Attach it with @c -[YFDatabase setResultCache:]  (or @c -[YFDatabaseQueue setResultCache:] ) and read through @c -[YFDatabase executeCachedQuery:withArgumentsInArray:error:] . Results are keyed by SQL text and bound arguments.
+
+@code
+db.resultCache = [[YFQueryResultCache alloc] init];
+NSArray<NSDictionary *> *rows = [db executeCachedQuery:@"SELECT * FROM settings WHERE owner = ?" withArgumentsInArray:@[@42] error:nil];
+@endcode
+
+ The first time a query is seen, it is prepared once under @c sqlite3_set_authorizer  to learn which tables it reads. Statements that do anything but read ordinary tables, or that call a function not known to be deterministic, are never cached: that rules out @c random() , the date and time functions, functions from @c makeFunctionNamed:arguments:block:  and functions registered without @c YFFunctionOptionsDeterministic . The authorizer stays installed while the cache is attached, because setting one expires every prepared statement of the connection; do not install another authorizer on the same connection. Changes made through the connection invalidate the affected tables from @c sqlite3_update_hook . Changes the hook cannot see (@c WITHOUT @c ROWID  tables, the truncate optimization), schema changes and, when @c checksOtherConnections  is set, commits from other connections drop everything.
+
+ One cache serves one database connection at a time. Results are returned as shared immutable arrays of row dictionaries; do not rely on their identity.
+ */
+
+@interface YFQueryResultCache : NSObject
+
+/** Approximate number of bytes of results to keep; least recently used results go first. Defaults to 4 MB; @c 0  means unlimited. */
+
+@property (atomic) NSUInteger memoryBudget;
+
+/** Results with more rows than this are returned but not kept. Defaults to @c 1000 ; @c 0  means unlimited. */
+
+@property (atomic) NSUInteger maximumRowCount;
+
+/** Whether each lookup checks @c PRAGMA data_version  for commits by other connections or processes. Defaults to @c YES . Turn it off only when this connection is the database's only writer. Requires SQLite 3.16. */
+
+@property (atomic) BOOL checksOtherConnections;
+
+/** Number of results currently kept */
+
+@property (nonatomic, readonly) NSUInteger count;
+
+/** Approximate bytes currently used by kept results */
+
+@property (nonatomic, readonly) NSUInteger memoryUsage;
+
+/** Lookups answered from the cache */
+
+@property (nonatomic, readonly) NSUInteger hitCount;
+
+/** Lookups that had to run the query */
+
+@property (nonatomic, readonly) NSUInteger missCount;
+
+/** Queries run but not kept: not read-only, non-deterministic, too large, or reading tables changed by the open transaction */
+
+@property (nonatomic, readonly) NSUInteger uncacheableCount;
+
+/** Results dropped because a table they read changed */
+
+@property (nonatomic, readonly) NSUInteger invalidationCount;
+
+/** Results dropped to stay within @c memoryBudget */
+
+@property (nonatomic, readonly) NSUInteger evictionCount;
+
+/** @c hitCount  over all lookups; @c 0  before the first lookup */
+
+@property (nonatomic, readonly) double hitRate;
+
+/** Drop every kept result. */
+
+- (void)removeAllResults;
+
+/** Zero the hit, miss, uncacheable, invalidation and eviction counters. */
+
+- (void)resetStatistics;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,720 @@
+//
+//  YFQueryResultCache.m
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import "YFQueryResultCache.h"
+#import "YFDatabase.h"
+#import <sqlite3.h>
+#import <pthread.h>
+
+// distinct SQL texts whose table lists are remembered before the list is started over
+#define YFDBResultCacheMaximumQueryCount 1024
+
+@interface YFDatabase (YFQueryResultCachePrivate)
+- (NSArray<NSDictionary *> * _Nullable)uncachedRowsForQuery:(NSString *)sql arguments:(NSArray * _Nullable)arguments error:(NSError * _Nullable __autoreleasing *)outErr;
+- (NSDictionary<NSString *, NSNumber *> * _Nullable)registeredFunctions;
+@end
+
+// MARK: - YFQueryResultCacheEntry
+
+@interface YFQueryResultCacheEntry : NSObject {
+@public
+    NSArray         *_key;
+    NSArray         *_rows;
+    NSSet           *_tables;
+    NSUInteger      _cost;
+
+    // links in the LRU list; the cache owns the entries
+    __unsafe_unretained YFQueryResultCacheEntry *_newer;
+    __unsafe_unretained YFQueryResultCacheEntry *_older;
+}
+@end
+
+@implementation YFQueryResultCacheEntry
+@end
+
+// MARK: - Table discovery
+
+/** What the authorizer learned while a query was prepared. */
+
+typedef struct {
+    __unsafe_unretained NSMutableSet *tables;   // "database.table" pairs, as read
+    __unsafe_unretained NSDictionary *functions;    // registered through the database: lowercased name -> deterministic
+    BOOL readOnly;
+} YFDBResultCacheAuthorizerContext;
+
+static NSString *YFDBResultCacheTableName(const char *zDb, const char *zTable) {
+    return [[NSString stringWithFormat:@"%s.%s", zDb ? zDb : "main", zTable ? zTable : ""] lowercaseString];
+}
+
+static BOOL YFDBResultCacheFunctionIsDeterministic(const char *zFunction, NSDictionary *functions) {
+
+    if (!zFunction) {
+        return NO;
+    }
+
+    // an application defined function, which may also replace a built-in
+    NSNumber *registered = [functions objectForKey:[[NSString stringWithUTF8String:zFunction] lowercaseString]];
+    if (registered) {
+        return [registered boolValue];
+    }
+
+    // built-ins whose result only depends on their arguments (and, for aggregates and windows, on the rows);
+    // the date and time functions are left out because of 'now'. Anything else is unknown and never cached.
+    static const char * const deterministicFunctions[] = {
+        "abs", "char", "coalesce", "concat", "concat_ws", "format", "glob", "hex", "if", "ifnull", "iif", "instr",
+        "length", "like", "likelihood", "likely", "lower", "ltrim", "max", "min", "nullif", "octet_length", "printf",
+        "quote", "replace", "round", "rtrim", "sign", "soundex", "substr", "substring", "trim", "typeof", "unhex",
+        "unicode", "unlikely", "upper", "zeroblob",
+        "avg", "count", "group_concat", "string_agg", "sum", "total",
+        "row_number", "rank", "dense_rank", "percent_rank", "cume_dist", "ntile", "lag", "lead",
+        "first_value", "last_value", "nth_value",
+        "acos", "acosh", "asin", "asinh", "atan", "atan2", "atanh", "ceil", "ceiling", "cos", "cosh", "degrees",
+        "exp", "floor", "ln", "log", "log10", "log2", "mod", "pi", "pow", "power", "radians", "sin", "sinh",
+        "sqrt", "tan", "tanh", "trunc",
+        "json", "json_array", "json_array_length", "json_extract", "json_insert", "json_object", "json_patch",
+        "json_quote", "json_remove", "json_replace", "json_set", "json_type", "json_valid",
+        "json_group_array", "json_group_object",
+    };
+
+    for (size_t i = 0; i < sizeof(deterministicFunctions) / sizeof(deterministicFunctions[0]); i++) {
+        if (sqlite3_stricmp(zFunction, deterministicFunctions[i]) == 0) {
+            return YES;
+        }
+    }
+
+    return NO;
+}
+
+/** Installed for as long as the cache is attached; it only records while @c tablesReadByQuery:functions:  prepares a query. */
+
+static int YFDBResultCacheAuthorizer(void *ctx, int action, const char *arg1, const char *arg2, const char *arg3, const char *arg4) {
+    YFDBResultCacheAuthorizerContext *context = *(YFDBResultCacheAuthorizerContext **)ctx;
+
+    if (!context) {
+        return SQLITE_OK;
+    }
+
+    switch (action) {
+        case SQLITE_SELECT:
+#ifdef SQLITE_RECURSIVE
+        case SQLITE_RECURSIVE:
+#endif
+            break;
+        case SQLITE_READ:
+            [context->tables addObject:YFDBResultCacheTableName(arg3, arg1)];
+            break;
+        case SQLITE_FUNCTION:
+            if (!YFDBResultCacheFunctionIsDeterministic(arg2, context->functions)) {
+                context->readOnly = NO;
+            }
+            break;
+        default:
+            // writes, pragmas, ATTACH, transactions...
+            context->readOnly = NO;
+            break;
+    }
+
+    return SQLITE_OK;
+}
+
+// MARK: - YFQueryResultCache
+
+@interface YFQueryResultCache () {
+    pthread_mutex_t     _lock;
+
+    // everything below is guarded by _lock
+    NSMutableDictionary *_entries;              // key -> entry
+    NSMutableDictionary *_entriesByTable;       // table -> set of keys
+    NSMutableDictionary *_tablesByQuery;        // SQL -> set of tables, or NSNull when not cacheable
+    NSMutableSet        *_dirtyTables;          // changed by the open transaction
+
+    __unsafe_unretained YFQueryResultCacheEntry *_newest;
+    __unsafe_unretained YFQueryResultCacheEntry *_oldest;
+
+    NSUInteger          _count;
+    NSUInteger          _memoryUsage;
+    NSUInteger          _hitCount;
+    NSUInteger          _missCount;
+    NSUInteger          _uncacheableCount;
+    NSUInteger          _invalidationCount;
+    NSUInteger          _evictionCount;
+    NSUInteger          _generation;            // bumped whenever results are dropped
+
+    // the connection we are attached to; touched on its thread
+    sqlite3             *_database;
+    sqlite3_stmt        *_versionStatement;
+    YFDBResultCacheAuthorizerContext *_authorizerContext;   // set only while a query is probed
+    BOOL                _hasVersions;
+    sqlite3_int64       _dataVersion;
+    sqlite3_int64       _schemaVersion;
+    sqlite3_int64       _baselineChanges;
+    sqlite3_int64       _hookedChanges;
+
+    // the last table reported by the update hook, to skip repeats while rows of one table change
+    const char          *_lastChangedDatabaseName;
+    const char          *_lastChangedTableName;
+}
+@end
+
+@implementation YFQueryResultCache
+
+- (instancetype)init {
+    self = [super init];
+
+    if (self) {
+        pthread_mutex_init(&_lock, NULL);
+        _entries                = [NSMutableDictionary dictionary];
+        _entriesByTable         = [NSMutableDictionary dictionary];
+        _tablesByQuery          = [NSMutableDictionary dictionary];
+        _dirtyTables            = [NSMutableSet set];
+        _memoryBudget           = 4 * 1024 * 1024;
+        _maximumRowCount        = 1000;
+        _checksOtherConnections = YES;
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    if (_versionStatement) {
+        sqlite3_finalize(_versionStatement);
+    }
+    pthread_mutex_destroy(&_lock);
+}
+
+#pragma mark Statistics
+
+- (NSUInteger)count {
+    pthread_mutex_lock(&_lock);
+    NSUInteger count = _count;
+    pthread_mutex_unlock(&_lock);
+    return count;
+}
+
+- (NSUInteger)memoryUsage {
+    pthread_mutex_lock(&_lock);
+    NSUInteger memoryUsage = _memoryUsage;
+    pthread_mutex_unlock(&_lock);
+    return memoryUsage;
+}
+
+- (NSUInteger)hitCount {
+    pthread_mutex_lock(&_lock);
+    NSUInteger hitCount = _hitCount;
+    pthread_mutex_unlock(&_lock);
+    return hitCount;
+}
+
+- (NSUInteger)missCount {
+    pthread_mutex_lock(&_lock);
+    NSUInteger missCount = _missCount;
+    pthread_mutex_unlock(&_lock);
+    return missCount;
+}
+
+- (NSUInteger)uncacheableCount {
+    pthread_mutex_lock(&_lock);
+    NSUInteger uncacheableCount = _uncacheableCount;
+    pthread_mutex_unlock(&_lock);
+    return uncacheableCount;
+}
+
+- (NSUInteger)invalidationCount {
+    pthread_mutex_lock(&_lock);
+    NSUInteger invalidationCount = _invalidationCount;
+    pthread_mutex_unlock(&_lock);
+    return invalidationCount;
+}
+
+- (NSUInteger)evictionCount {
+    pthread_mutex_lock(&_lock);
+    NSUInteger evictionCount = _evictionCount;
+    pthread_mutex_unlock(&_lock);
+    return evictionCount;
+}
+
+- (double)hitRate {
+    pthread_mutex_lock(&_lock);
+    NSUInteger lookups = _hitCount + _missCount;
+    double hitRate = lookups ? (double)_hitCount / lookups : 0;
+    pthread_mutex_unlock(&_lock);
+    return hitRate;
+}
+
+- (void)resetStatistics {
+    pthread_mutex_lock(&_lock);
+    _hitCount           = 0;
+    _missCount          = 0;
+    _uncacheableCount   = 0;
+    _invalidationCount  = 0;
+    _evictionCount      = 0;
+    pthread_mutex_unlock(&_lock);
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ %lu results, %lu bytes, %lu hits, %lu misses", [super description], (unsigned long)[self count], (unsigned long)[self memoryUsage], (unsigned long)[self hitCount], (unsigned long)[self missCount]];
+}
+
+#pragma mark Entries (call with _lock held)
+
+- (void)unlinkEntry:(YFQueryResultCacheEntry *)entry {
+    if (entry->_newer) {
+        entry->_newer->_older = entry->_older;
+    }
+    else {
+        _newest = entry->_older;
+    }
+
+    if (entry->_older) {
+        entry->_older->_newer = entry->_newer;
+    }
+    else {
+        _oldest = entry->_newer;
+    }
+
+    entry->_newer = nil;
+    entry->_older = nil;
+}
+
+- (void)linkEntry:(YFQueryResultCacheEntry *)entry {
+    entry->_older = _newest;
+    entry->_newer = nil;
+
+    if (_newest) {
+        _newest->_newer = entry;
+    }
+    _newest = entry;
+
+    if (!_oldest) {
+        _oldest = entry;
+    }
+}
+
+- (void)removeEntry:(YFQueryResultCacheEntry *)entry {
+
+    [self unlinkEntry:entry];
+
+    for (NSString *table in entry->_tables) {
+        NSMutableSet *keys = [_entriesByTable objectForKey:table];
+        [keys removeObject:entry->_key];
+        if (![keys count]) {
+            [_entriesByTable removeObjectForKey:table];
+        }
+    }
+
+    _count--;
+    _memoryUsage -= entry->_cost;
+    _generation++;
+
+    [_entries removeObjectForKey:entry->_key];
+}
+
+- (void)invalidateTable:(NSString *)table {
+
+    NSSet *keys = [[_entriesByTable objectForKey:table] copy];
+
+    for (NSArray *key in keys) {
+        YFQueryResultCacheEntry *entry = [_entries objectForKey:key];
+        if (entry) {
+            [self removeEntry:entry];
+            _invalidationCount++;
+        }
+    }
+}
+
+- (void)invalidateAll {
+    _invalidationCount += _count;
+    [self dropAllEntries];
+}
+
+- (void)dropAllEntries {
+    [_entries removeAllObjects];
+    [_entriesByTable removeAllObjects];
+    _newest = nil;
+    _oldest = nil;
+    _count = 0;
+    _memoryUsage = 0;
+    _generation++;
+}
+
+- (void)evictIfNeeded {
+    NSUInteger budget = _memoryBudget;
+
+    while (budget && _memoryUsage > budget && _oldest) {
+        [self removeEntry:_oldest];
+        _evictionCount++;
+    }
+}
+
+- (void)functionsDidChange {
+    pthread_mutex_lock(&_lock);
+    [self dropAllEntries];
+    [_tablesByQuery removeAllObjects];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)removeAllResults {
+    pthread_mutex_lock(&_lock);
+    [self dropAllEntries];
+    pthread_mutex_unlock(&_lock);
+}
+
+- (NSUInteger)memoryBudget {
+    pthread_mutex_lock(&_lock);
+    NSUInteger memoryBudget = _memoryBudget;
+    pthread_mutex_unlock(&_lock);
+    return memoryBudget;
+}
+
+- (void)setMemoryBudget:(NSUInteger)memoryBudget {
+    pthread_mutex_lock(&_lock);
+    _memoryBudget = memoryBudget;
+    [self evictIfNeeded];
+    pthread_mutex_unlock(&_lock);
+}
+
+#pragma mark Hooks
+
+static void YFDBResultCacheUpdateHook(void *ctx, int op, const char *zDb, const char *zTable, sqlite3_int64 rowid) {
+    YFQueryResultCache *self = (__bridge YFQueryResultCache *)ctx;
+    [self tableDidChangeInDatabase:zDb table:zTable];
+}
+
+- (void)tableDidChangeInDatabase:(const char *)zDb table:(const char *)zTable {
+
+    pthread_mutex_lock(&_lock);
+
+    _hookedChanges++;
+
+    // SQLite hands us the schema's own name strings, so a pointer match means "same table as last time"
+    if (zDb != _lastChangedDatabaseName || zTable != _lastChangedTableName) {
+        _lastChangedDatabaseName = zDb;
+        _lastChangedTableName = zTable;
+
+        NSString *table = YFDBResultCacheTableName(zDb, zTable);
+        [_dirtyTables addObject:table];
+        [self invalidateTable:table];
+    }
+
+    pthread_mutex_unlock(&_lock);
+}
+
+static sqlite3_int64 YFDBResultCacheTotalChanges(sqlite3 *db) {
+#if SQLITE_VERSION_NUMBER >= 3037000
+    return sqlite3_total_changes64(db);
+#else
+    return sqlite3_total_changes(db);
+#endif
+}
+
+- (void)installOnDatabase:(sqlite3 *)db {
+
+    if (_database == db) {
+        return;
+    }
+
+    if (_database) {
+        NSLog(@"YFQueryResultCache is already attached to another database; results will not be cached for %p", db);
+        return;
+    }
+
+    _database = db;
+    _hasVersions = NO;
+    _baselineChanges = YFDBResultCacheTotalChanges(db);
+    _hookedChanges = 0;
+
+    sqlite3_update_hook(db, YFDBResultCacheUpdateHook, (__bridge void *)self);
+
+    // setting an authorizer expires every prepared statement of the connection, so it is set once here rather than per probe
+    _authorizerContext = 0x00;
+    sqlite3_set_authorizer(db, YFDBResultCacheAuthorizer, &_authorizerContext);
+
+#if SQLITE_VERSION_NUMBER >= 3016000
+    int rc = sqlite3_prepare_v2(db, "SELECT (SELECT data_version FROM pragma_data_version), (SELECT schema_version FROM pragma_schema_version)", -1, &_versionStatement, 0x00);
+    if (rc != SQLITE_OK) {
+        NSLog(@"YFQueryResultCache could not prepare its version check: %s", sqlite3_errmsg(db));
+        _versionStatement = 0x00;
+    }
+#endif
+
+    pthread_mutex_lock(&_lock);
+    [self dropAllEntries];
+    [_tablesByQuery removeAllObjects];
+    [_dirtyTables removeAllObjects];
+    _lastChangedDatabaseName = 0x00;
+    _lastChangedTableName = 0x00;
+    pthread_mutex_unlock(&_lock);
+}
+
+- (void)uninstallFromDatabase:(sqlite3 *)db {
+
+    if (!_database || _database != db) {
+        return;
+    }
+
+    sqlite3_update_hook(db, 0x00, 0x00);
+    sqlite3_set_authorizer(db, 0x00, 0x00);
+
+    if (_versionStatement) {
+        sqlite3_finalize(_versionStatement);
+        _versionStatement = 0x00;
+    }
+
+    _database = 0x00;
+
+    // nothing tells us what happens to the file while we are detached
+    pthread_mutex_lock(&_lock);
+    [self dropAllEntries];
+    [_tablesByQuery removeAllObjects];
+    [_dirtyTables removeAllObjects];
+    pthread_mutex_unlock(&_lock);
+}
+
+#pragma mark Lookups
+
+/** Drop whatever may have changed without the update hook seeing it. Call on the database's thread. */
+
+- (void)validate {
+
+    sqlite3_int64 totalChanges = YFDBResultCacheTotalChanges(_database);
+    BOOL inTransaction = !sqlite3_get_autocommit(_database);
+
+    BOOL hasVersions = NO;
+    sqlite3_int64 dataVersion = 0, schemaVersion = 0;
+
+    if (_versionStatement) {
+        if (sqlite3_step(_versionStatement) == SQLITE_ROW) {
+            dataVersion = sqlite3_column_int64(_versionStatement, 0);
+            schemaVersion = sqlite3_column_int64(_versionStatement, 1);
+            hasVersions = YES;
+        }
+        sqlite3_reset(_versionStatement);
+    }
+
+    pthread_mutex_lock(&_lock);
+
+    // rows changed that the hook never reported: WITHOUT ROWID tables, truncated tables
+    BOOL missedChanges = totalChanges - _baselineChanges > _hookedChanges;
+    _baselineChanges = totalChanges;
+    _hookedChanges = 0;
+
+    BOOL schemaChanged = _hasVersions && (!hasVersions || schemaVersion != _schemaVersion);
+    BOOL otherConnectionChanged = _hasVersions && _checksOtherConnections && (!hasVersions || dataVersion != _dataVersion);
+
+    if (missedChanges || schemaChanged || otherConnectionChanged) {
+        [self invalidateAll];
+    }
+
+    if (schemaChanged) {
+        [_tablesByQuery removeAllObjects];
+    }
+
+    _hasVersions = hasVersions;
+    _dataVersion = dataVersion;
+    _schemaVersion = schemaVersion;
+
+    if (!inTransaction) {
+        [_dirtyTables removeAllObjects];
+        _lastChangedDatabaseName = 0x00;
+        _lastChangedTableName = 0x00;
+    }
+
+    pthread_mutex_unlock(&_lock);
+}
+
+/** The ordinary tables a query reads, or @c nil  if its results must not be cached. */
+
+- (NSSet *)tablesReadByQuery:(NSString *)sql functions:(NSDictionary *)functions {
+
+    NSMutableSet *tables = [NSMutableSet set];
+    YFDBResultCacheAuthorizerContext context = { tables, functions, YES };
+
+    sqlite3_stmt *pStmt = 0x00;
+    const char *tail = 0x00;
+
+    _authorizerContext = &context;
+    int rc = sqlite3_prepare_v2(_database, [sql UTF8String], -1, &pStmt, &tail);
+    _authorizerContext = 0x00;
+
+    BOOL singleStatement = tail && strspn(tail, " \t\r\n;") == strlen(tail);
+    BOOL readOnly = rc == SQLITE_OK && pStmt && sqlite3_stmt_readonly(pStmt);
+    sqlite3_finalize(pStmt);
+
+    if (!readOnly || !context.readOnly || !singleStatement) {
+        return nil;
+    }
+
+    // virtual tables (and table-valued functions) never reach the update hook
+    for (NSString *table in tables) {
+
+        NSRange dot = [table rangeOfString:@"."];
+        NSString *schemaName = [table substringToIndex:dot.location];
+        NSString *tableName = [table substringFromIndex:NSMaxRange(dot)];
+
+        if ([tableName hasPrefix:@"sqlite_"]) {
+            // sqlite_master and friends: changes show up as schema changes
+            continue;
+        }
+
+        NSString *lookup = [NSString stringWithFormat:@"SELECT sql FROM \"%@\".sqlite_master WHERE type = 'table' AND name = ? COLLATE NOCASE", [schemaName stringByReplacingOccurrencesOfString:@"\"" withString:@"\"\""]];
+
+        BOOL ordinary = NO;
+        if (sqlite3_prepare_v2(_database, [lookup UTF8String], -1, &pStmt, 0x00) == SQLITE_OK) {
+            sqlite3_bind_text(pStmt, 1, [tableName UTF8String], -1, SQLITE_TRANSIENT);
+            if (sqlite3_step(pStmt) == SQLITE_ROW) {
+                const char *createSQL = (const char *)sqlite3_column_text(pStmt, 0);
+                ordinary = !createSQL || sqlite3_strnicmp(createSQL, "CREATE VIRTUAL", 14) != 0;
+            }
+        }
+        sqlite3_finalize(pStmt);
+
+        if (!ordinary) {
+            return nil;
+        }
+    }
+
+    return tables;
+}
+
+static BOOL YFDBResultCacheArgumentsAreKeys(NSArray *arguments) {
+    for (id obj in arguments) {
+        if (!([obj isKindOfClass:[NSString class]] || [obj isKindOfClass:[NSNumber class]] || [obj isKindOfClass:[NSData class]] ||
+              [obj isKindOfClass:[NSDate class]] || [obj isKindOfClass:[NSNull class]])) {
+            return NO;
+        }
+    }
+    return YES;
+}
+
+/** Rough retained size of a result: the point is comparing results with each other and with the budget. */
+
+static NSUInteger YFDBResultCacheCost(NSArray *key, NSArray<NSDictionary *> *rows) {
+
+    NSUInteger cost = 64 + [(NSString *)[key firstObject] length] * 2;
+
+    for (NSDictionary *row in rows) {
+        cost += 48;
+        for (id value in [row objectEnumerator]) {
+            if ([value isKindOfClass:[NSString class]]) {
+                cost += 32 + [(NSString *)value length] * 2;
+            }
+            else if ([value isKindOfClass:[NSData class]]) {
+                cost += 32 + [(NSData *)value length];
+            }
+            else {
+                cost += 32;
+            }
+        }
+    }
+
+    return cost;
+}
+
+- (NSArray<NSDictionary *> *)rowsForQuery:(NSString *)sql arguments:(NSArray *)arguments database:(YFDatabase *)db error:(NSError * __autoreleasing *)outErr {
+
+    if (!_database || _database != [db sqliteHandle] || !YFDBResultCacheArgumentsAreKeys(arguments)) {
+        pthread_mutex_lock(&_lock);
+        _uncacheableCount++;
+        pthread_mutex_unlock(&_lock);
+        return [db uncachedRowsForQuery:sql arguments:arguments error:outErr];
+    }
+
+    [self validate];
+
+    sql = [sql copy];
+    NSArray *key = @[sql, arguments ? [arguments copy] : @[]];
+
+    pthread_mutex_lock(&_lock);
+
+    YFQueryResultCacheEntry *entry = [_entries objectForKey:key];
+    if (entry) {
+        [self unlinkEntry:entry];
+        [self linkEntry:entry];
+        _hitCount++;
+
+        NSArray *rows = entry->_rows;
+        pthread_mutex_unlock(&_lock);
+
+        return rows;
+    }
+
+    _missCount++;
+    id tables = [_tablesByQuery objectForKey:sql];
+    NSUInteger generation = _generation;
+
+    pthread_mutex_unlock(&_lock);
+
+    if (!tables) {
+        tables = [self tablesReadByQuery:sql functions:[db registeredFunctions]];
+        if (!tables) {
+            tables = [NSNull null];
+        }
+
+        pthread_mutex_lock(&_lock);
+        if ([_tablesByQuery count] >= YFDBResultCacheMaximumQueryCount) {
+            [_tablesByQuery removeAllObjects];
+        }
+        [_tablesByQuery setObject:tables forKey:sql];
+        pthread_mutex_unlock(&_lock);
+    }
+
+    // the lock is not held here: a statement that is not read-only may fire the update hook
+    NSArray<NSDictionary *> *rows = [db uncachedRowsForQuery:sql arguments:arguments error:outErr];
+    if (!rows) {
+        return nil;
+    }
+
+    pthread_mutex_lock(&_lock);
+
+    NSUInteger maximumRowCount = _maximumRowCount;
+    NSUInteger cost = YFDBResultCacheCost(key, rows);
+
+    BOOL cacheable = tables != [NSNull null]
+        && (!maximumRowCount || [rows count] <= maximumRowCount)
+        && (!_memoryBudget || cost <= _memoryBudget)
+        && ![_dirtyTables intersectsSet:tables];    // uncommitted changes may still be rolled back
+
+    if (!cacheable) {
+        _uncacheableCount++;
+    }
+    else if (generation == _generation) {
+        // otherwise results were dropped while the query ran, and these rows may be among the stale ones
+
+        entry = [[YFQueryResultCacheEntry alloc] init];
+        entry->_key = key;
+        entry->_rows = rows;
+        entry->_tables = tables;
+        entry->_cost = cost;
+
+        [_entries setObject:entry forKey:key];
+        [self linkEntry:entry];
+
+        for (NSString *table in entry->_tables) {
+            NSMutableSet *keys = [_entriesByTable objectForKey:table];
+            if (!keys) {
+                keys = [NSMutableSet set];
+                [_entriesByTable setObject:keys forKey:table];
+            }
+            [keys addObject:key];
+        }
+
+        _count++;
+        _memoryUsage += cost;
+
+        // the next change to any table, even the last one reported, must find this entry
+        _lastChangedDatabaseName = 0x00;
+        _lastChangedTableName = 0x00;
+
+        [self evictIfNeeded];
+    }
+
+    pthread_mutex_unlock(&_lock);
+
+    return rows;
+}
+
+@end
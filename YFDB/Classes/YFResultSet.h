@@ -21,6 +21,46 @@ typedef NS_ENUM(int, YFSqliteValueType) {
     YFSqliteValueTypeNull    = 5
 };
 
+/** How a @c YFColumnBuffer  stores its column.
+ */
+typedef NS_ENUM(int, YFColumnBufferType) {
+    YFColumnBufferTypeInt64  = 1,
+    YFColumnBufferTypeDouble = 2,
+    YFColumnBufferTypeText   = 3,
+    YFColumnBufferTypeBlob   = 4
+};
+
+/** Caller-owned storage for one result column, filled by @c -[YFResultSet fetchColumnsInto:count:maxRows:error:] .
+
+ For @c YFColumnBufferTypeInt64  and @c YFColumnBufferTypeDouble , @c values  points at @c maxRows  @c int64_t  or @c double  slots.
+
+ For @c YFColumnBufferTypeText  and @c YFColumnBufferTypeBlob , the values of a batch are packed back to back into @c bytes , which holds @c bytesCapacity  bytes. @c offsets  needs @c maxRows+1  slots: row @c i  occupies @c bytes[offsets[i]]  up to @c bytes[offsets[i+1]] . Text is UTF-8 and is not NUL terminated.
+
+ @c nulls , if not @c NULL , gets @c maxRows  flags telling which rows were @c NULL . Numeric @c NULL s read as @c 0 , text and blob @c NULL s as empty.
+ */
+typedef struct YFColumnBuffer {
+    int                 columnIndex;
+    YFColumnBufferType  type;
+    void               * _Nullable values;
+    uint8_t            * _Nullable bytes;
+    size_t              bytesCapacity;
+    size_t             * _Nullable offsets;
+    BOOL               * _Nullable nulls;
+} YFColumnBuffer;
+
+/** A column value of the current row, borrowed from SQLite without copying.
+
+ Returned by @c -[YFResultSet borrowedTextForColumnIndex:]  and @c -[YFResultSet borrowedBlobForColumnIndex:] . @c bytes  points into the statement's own row storage and stays valid until the result set steps, is rebound or is closed; text is UTF-8 and is not guaranteed to be NUL terminated past @c length . For a @c NULL  column @c bytes  is @c NULL ; an empty value has non- @c NULL  @c bytes  and a @c length  of @c 0 .
+
+ @c owner  and @c rowGeneration  identify the row the view came from. In @c DEBUG  builds, or whenever @c YFDB_CHECK_BORROWED_BYTES  is defined as @c 1 , every @c YFBorrowedBytes  function checks them and asserts when the view is used after its row is gone.
+ */
+typedef struct YFBorrowedBytes {
+    const void         * _Nullable bytes;
+    NSUInteger          length;
+    const void         * _Nullable owner;
+    uint64_t            rowGeneration;
+} YFBorrowedBytes;
+
 @interface YFResultSet : NSObject
 
 @property (nonatomic, retain, nullable) YFDatabase *parentDB;
@@ -33,9 +73,9 @@ typedef NS_ENUM(int, YFSqliteValueType) {
 
 @property (atomic, retain, nullable) NSString *query;
 
-/** `NSMutableDictionary` mapping column names to numeric index */
+/** `NSMutableDictionary` mapping column names to numeric index; a copy of the underlying @c YFStatement 's map, made on every call. @c nil  once closed. */
 
-@property (readonly) NSMutableDictionary *columnNameToIndexMap;
+@property (readonly, nullable) NSMutableDictionary *columnNameToIndexMap;
 
 /** `YFStatement` used by result set. */
 
@@ -277,6 +317,8 @@ typedef NS_ENUM(int, YFSqliteValueType) {
 
 /** Result set @c NSDate  value for column.
 
+ The value is decoded according to the parent database's @c dateStorage .
+
  @param columnIdx Zero-based index for column.
 
  @return Date value of the result set's column.
@@ -457,6 +499,46 @@ If you don't, you're going to be in a world of hurt when you try and use the dat
 
 - (NSData * _Nullable)dataNoCopyForColumnIndex:(int)columnIdx NS_RETURNS_NOT_RETAINED;
 
+/** Borrow the text of a column without creating an @c NSString .
+
+ Meant for loops that only compare or hash values, with @c YFBorrowedBytesEqualToString , @c YFBorrowedBytesCompare  and @c YFBorrowedBytesHash ; use @c YFBorrowedBytesCopyString  to keep one.
+
+ @param columnIdx Zero-based index for column.
+
+ @return A view of the UTF-8 bytes, valid until the next @c next , bind or @c close . Out of range and @c NULL  columns give a view with @c NULL  @c bytes .
+
+ @warning Do not read the same column with another accessor (such as @c borrowedBlobForColumnIndex:  or @c intForColumnIndex: ) while holding the view: SQLite may convert the value in place and free the bytes.
+ */
+
+- (YFBorrowedBytes)borrowedTextForColumnIndex:(int)columnIdx;
+
+/** Borrow the text of a column without creating an @c NSString .
+
+ @param columnName @c NSString  value of the name of the column.
+
+ @return A view of the UTF-8 bytes; see @c borrowedTextForColumnIndex: .
+ */
+
+- (YFBorrowedBytes)borrowedTextForColumn:(NSString *)columnName;
+
+/** Borrow the bytes of a blob column without creating an @c NSData .
+
+ @param columnIdx Zero-based index for column.
+
+ @return A view of the bytes, valid until the next @c next , bind or @c close ; see @c borrowedTextForColumnIndex: .
+ */
+
+- (YFBorrowedBytes)borrowedBlobForColumnIndex:(int)columnIdx;
+
+/** Borrow the bytes of a blob column without creating an @c NSData .
+
+ @param columnName @c NSString  value of the name of the column.
+
+ @return A view of the bytes; see @c borrowedTextForColumnIndex: .
+ */
+
+- (YFBorrowedBytes)borrowedBlobForColumn:(NSString *)columnName;
+
 /** Is the column @c NULL ?
  
  @param columnIdx Zero-based index for column.
@@ -482,6 +564,20 @@ If you don't, you're going to be in a world of hurt when you try and use the dat
  */
 
 @property (nonatomic, readonly, nullable) NSDictionary *resultDictionary;
+
+/** A dictionary view of the current row that is reused for every row.
+
+ The same object is returned for the life of the result set. Nothing is copied up front: each value is read from the statement when it is looked up, so after @c next  the view shows the new row. Keys are case sensitive, as in @c resultDictionary . Use @c copy  to keep a row.
+
+@code
+NSDictionary *row = rs.resultDictionaryView;
+while ([rs next]) {
+    total += [row[@"amount"] doubleValue];
+}
+@endcode
+ */
+
+@property (nonatomic, readonly) NSDictionary *resultDictionaryView;
  
 /** Returns a dictionary of the row results
  
@@ -492,18 +588,78 @@ If you don't, you're going to be in a world of hurt when you try and use the dat
 
 - (NSDictionary * _Nullable)resultDict __deprecated_msg("Use resultDictionary instead");
 
+///-----------------------------
+/// @name Bulk columnar fetch
+///-----------------------------
+
+/** Step through up to @c maxRows  rows, copying the requested columns into caller-owned arrays.
+
+ This reads a whole batch per message instead of one message per cell, which matters when pulling many rows of numbers:
+
+@code
+int64_t ids[1024]; double prices[1024];
+YFColumnBuffer columns[2] = {
+    { .columnIndex = 0, .type = YFColumnBufferTypeInt64,  .values = ids },
+    { .columnIndex = 1, .type = YFColumnBufferTypeDouble, .values = prices },
+};
+NSInteger rows;
+while ((rows = [rs fetchColumnsInto:columns count:2 maxRows:1024 error:&error]) > 0) {
+    ...
+}
+@endcode
+
+ If a text or blob value doesn't fit in what is left of its @c bytes , the batch ends before that row and the next call starts with it. Calling @c next  afterwards also returns that row first.
+
+ Every buffer is checked before anything is stepped: @c columns  may only be @c NULL  when @c count  is @c 0 , each @c columnIndex  must be a column of the result, numeric buffers need @c values , and text and blob buffers need @c offsets , and @c bytes  unless @c bytesCapacity  is @c 0 . Otherwise the call fails with @c SQLITE_MISUSE  or @c SQLITE_RANGE  and the result set is left where it was.
+
+ If stepping fails after some rows of the batch were copied, those rows are returned and @c outErr  is set: a positive count with an error is a short batch, and the result set is closed. If a single value is too large for its empty @c bytes  buffer, the call fails with @c SQLITE_TOOBIG  and the row stays current for @c next  or a retry with larger buffers.
+
+ @param columns The column buffers to fill.
+ @param count Number of entries in @c columns .
+ @param maxRows Capacity, in rows, of every buffer; at least @c 1 , since @c 0  is the return value for an exhausted result set.
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return The number of rows copied, @c 0  once the result set is exhausted, or @c -1  on error with no rows copied.
+ */
+
+- (NSInteger)fetchColumnsInto:(YFColumnBuffer *)columns count:(int)count maxRows:(NSUInteger)maxRows error:(NSError * _Nullable __autoreleasing *)outErr;
+
 ///-----------------------------
 /// @name Key value coding magic
 ///-----------------------------
 
 /** Performs `setValue` to yield support for key value observing.
  
+ Columns matching a property of the object's class are set through its setter with a typed value, see @c YFRowMapper ; other columns are set with `setValue:forKey:` as strings.
+ 
  @param object The object for which the values will be set. This is the key-value-coding compliant object that you might, for example, observe.
 
  */
 
 - (void)kvcMagic:(id)object;
 
+/** Create an object of a class and fill it from the current row.
+
+ @param modelClass The class to instantiate with @c -init .
+
+ @return The new object.
+
+ @see YFRowMapper
+ */
+
+- (id)objectOfClass:(Class)modelClass;
+
+/** Create and fill one object per remaining row, then close the result set.
+
+ @param modelClass The class to instantiate with @c -init .
+
+ @return The objects, in row order.
+
+ @see YFRowMapper
+ */
+
+- (NSArray *)objectsOfClass:(Class)modelClass;
+
 ///-----------------------------
 /// @name Binding values
 ///-----------------------------
@@ -522,4 +678,44 @@ If you don't, you're going to be in a world of hurt when you try and use the dat
 
 @end
 
+///-----------------------------
+/// @name Borrowed values
+///-----------------------------
+
+/** Whether the view came from a @c NULL  column. */
+
+FOUNDATION_EXPORT BOOL YFBorrowedBytesIsNull(YFBorrowedBytes view);
+
+/** Whether the row the view came from is still current. Always @c YES  when rows are not tracked, which is outside @c DEBUG  builds unless @c YFDB_CHECK_BORROWED_BYTES  is defined as @c 1 . */
+
+FOUNDATION_EXPORT BOOL YFBorrowedBytesIsValid(YFBorrowedBytes view);
+
+/** Whether two views hold the same bytes. Two @c NULL  views are equal; a @c NULL  view never equals a non- @c NULL  one. */
+
+FOUNDATION_EXPORT BOOL YFBorrowedBytesEqual(YFBorrowedBytes a, YFBorrowedBytes b);
+
+/** Whether the view holds exactly the bytes of a NUL terminated UTF-8 string. */
+
+FOUNDATION_EXPORT BOOL YFBorrowedBytesEqualToUTF8String(YFBorrowedBytes view, const char *string);
+
+/** Whether the view holds the UTF-8 encoding of @c string , compared byte for byte without allocating when the string's storage allows it. */
+
+FOUNDATION_EXPORT BOOL YFBorrowedBytesEqualToString(YFBorrowedBytes view, NSString *string);
+
+/** Order two views like SQLite's @c BINARY  collation: @c memcmp , then length. @c NULL  sorts first. */
+
+FOUNDATION_EXPORT NSComparisonResult YFBorrowedBytesCompare(YFBorrowedBytes a, YFBorrowedBytes b);
+
+/** A 64-bit FNV-1a hash of the bytes, stable across runs. @c NULL  and empty views hash alike; pair it with @c YFBorrowedBytesEqual . */
+
+FOUNDATION_EXPORT uint64_t YFBorrowedBytesHash(YFBorrowedBytes view);
+
+/** Copy the view into an @c NSString ; @c nil  for @c NULL  or invalid UTF-8. */
+
+FOUNDATION_EXPORT NSString * _Nullable YFBorrowedBytesCopyString(YFBorrowedBytes view);
+
+/** Copy the view into an @c NSData ; @c nil  for @c NULL . */
+
+FOUNDATION_EXPORT NSData * _Nullable YFBorrowedBytesCopyData(YFBorrowedBytes view);
+
 NS_ASSUME_NONNULL_END
@@ -7,20 +7,120 @@
 
 #import "YFResultSet.h"
 #import "YFDatabase.h"
+#import "YFRowMapper.h"
 #import <unistd.h>
+#import <pthread.h>
 #import <sqlite3.h>
 
 // MARK: - YFDatabase Private Extension
 
 @interface YFDatabase ()
 - (void)resultSetDidClose:(YFResultSet *)resultSet;
+- (void)stepDidFailWithResult:(int)rc;
+- (NSDate *)dateForColumn:(int)columnIdx inStatement:(sqlite3_stmt *)pStmt;
 - (BOOL)bindStatement:(sqlite3_stmt *)pStmt WithArgumentsInArray:(NSArray*)arrayArgs orDictionary:(NSDictionary *)dictionaryArgs orVAList:(va_list)args;
 @end
 
+// MARK: - YFResultSetRowDictionary
+
+/** Read-only dictionary view of a result set's current row; values are read from the statement on access. */
+
+@interface YFResultSetRowDictionary : NSDictionary {
+    __weak YFResultSet *_resultSet;
+}
+- (instancetype)initWithResultSet:(YFResultSet *)resultSet;
+@end
+
+@implementation YFResultSetRowDictionary
+
+// NSDictionary's -init lands here, the class cluster's primitive initializer; the view holds no objects of its own, so there is nothing to take
+- (instancetype)initWithObjects:(const id _Nonnull __unsafe_unretained *)objects forKeys:(const id<NSCopying> _Nonnull __unsafe_unretained *)keys count:(NSUInteger)cnt {
+    return self;
+}
+
+- (instancetype)initWithResultSet:(YFResultSet *)resultSet {
+    self = [super init];
+    
+    if (self) {
+        _resultSet = resultSet;
+    }
+    
+    return self;
+}
+
+- (NSUInteger)count {
+    return [[[_resultSet statement] columnNames] count];
+}
+
+- (id)objectForKey:(id)aKey {
+    if (![aKey isKindOfClass:[NSString class]]) {
+        return nil;
+    }
+    
+    YFResultSet *resultSet = _resultSet;
+    int columnIdx = [[resultSet statement] columnIndexForExactName:aKey];
+    
+    return columnIdx >= 0 ? [resultSet objectForColumnIndex:columnIdx] : nil;
+}
+
+- (NSEnumerator *)keyEnumerator {
+    return [[[_resultSet statement] columnNames] objectEnumerator];
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    // a snapshot, since this object keeps changing as the result set steps
+    return [[NSDictionary allocWithZone:zone] initWithDictionary:self];
+}
+
+@end
+
+// MARK: - Borrowed Row Registry
+
+// the registry takes a lock on every borrow, so it is for debug builds only; define as 1 or 0 to choose explicitly
+#ifndef YFDB_CHECK_BORROWED_BYTES
+#if defined(DEBUG) && DEBUG
+#define YFDB_CHECK_BORROWED_BYTES 1
+#else
+#define YFDB_CHECK_BORROWED_BYTES 0
+#endif
+#endif
+
+#if YFDB_CHECK_BORROWED_BYTES
+// result sets whose current row has borrowed views out, mapped to that row's generation.
+// generations come from one counter, so a result set reallocated at the same address never matches an old view.
+static pthread_mutex_t YFBorrowedRowsLock = PTHREAD_MUTEX_INITIALIZER;
+static NSMutableDictionary<NSValue *, NSNumber *> *YFBorrowedRows;
+static uint64_t YFBorrowedRowsLastGeneration;
+
+static uint64_t YFBorrowedRowsRegister(const void *owner) {
+    pthread_mutex_lock(&YFBorrowedRowsLock);
+    if (!YFBorrowedRows) {
+        YFBorrowedRows = [NSMutableDictionary dictionary];
+    }
+    uint64_t generation = ++YFBorrowedRowsLastGeneration;
+    YFBorrowedRows[[NSValue valueWithPointer:owner]] = @(generation);
+    pthread_mutex_unlock(&YFBorrowedRowsLock);
+    return generation;
+}
+
+static void YFBorrowedRowsUnregister(const void *owner) {
+    pthread_mutex_lock(&YFBorrowedRowsLock);
+    [YFBorrowedRows removeObjectForKey:[NSValue valueWithPointer:owner]];
+    pthread_mutex_unlock(&YFBorrowedRowsLock);
+}
+#endif
+
 // MARK: - YFResultSet Private Extension
 
 @interface YFResultSet () {
-    NSMutableDictionary *_columnNameToIndexMap;
+    YFResultSetRowDictionary *_resultDictionaryView;
+    
+    // fetchColumnsInto: stepped onto a row it had no room for
+    BOOL                _hasPendingRow;
+    
+    // stamped on borrowed views; changes whenever the current row goes away
+    uint64_t            _rowGeneration;
+    BOOL                _hasBorrowedViews;
 }
 @property (nonatomic) BOOL shouldAutoClose;
 @end
@@ -46,13 +146,13 @@
     [self close];
     
     _query = nil;
-    
-    _columnNameToIndexMap = nil;
 }
 
 - (void)close {
     [_statement reset];
     _statement = nil;
+    _hasPendingRow = NO;
+    [self rowDidEnd];
     
     // we don't need this anymore... (i think)
     //[_parentDB setInUse:NO];
@@ -65,34 +165,20 @@
 }
 
 - (NSMutableDictionary *)columnNameToIndexMap {
-    if (!_columnNameToIndexMap) {
-        int columnCount = sqlite3_column_count([_statement statement]);
-        _columnNameToIndexMap = [[NSMutableDictionary alloc] initWithCapacity:(NSUInteger)columnCount];
-        int columnIdx = 0;
-        for (columnIdx = 0; columnIdx < columnCount; columnIdx++) {
-            [_columnNameToIndexMap setObject:[NSNumber numberWithInt:columnIdx]
-                                      forKey:[[NSString stringWithUTF8String:sqlite3_column_name([_statement statement], columnIdx)] lowercaseString]];
-        }
-    }
-    return _columnNameToIndexMap;
+    // the statement's map is shared with every other result set run on it, so hand out a copy; lookups by name go to the statement directly
+    return [[_statement columnNameToIndexMap] mutableCopy];
 }
 
 - (void)kvcMagic:(id)object {
-    
-    int columnCount = sqlite3_column_count([_statement statement]);
-    
-    int columnIdx = 0;
-    for (columnIdx = 0; columnIdx < columnCount; columnIdx++) {
-        
-        const char *c = (const char *)sqlite3_column_text([_statement statement], columnIdx);
-        
-        // check for a null row
-        if (c) {
-            NSString *s = [NSString stringWithUTF8String:c];
-            
-            [object setValue:s forKey:[NSString stringWithUTF8String:sqlite3_column_name([_statement statement], columnIdx)]];
-        }
-    }
+    [[YFRowMapper mapperForClass:[object class]] fillObject:object fromResultSet:self];
+}
+
+- (id)objectOfClass:(Class)modelClass {
+    return [[YFRowMapper mapperForClass:modelClass] objectFromResultSet:self];
+}
+
+- (NSArray *)objectsOfClass:(Class)modelClass {
+    return [[YFRowMapper mapperForClass:modelClass] objectsFromResultSet:self];
 }
 
 #pragma clang diagnostic push
@@ -105,7 +191,7 @@
     if (num_cols > 0) {
         NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithCapacity:num_cols];
         
-        NSEnumerator *columnNames = [[self columnNameToIndexMap] keyEnumerator];
+        NSEnumerator *columnNames = [[_statement columnNameToIndexMap] keyEnumerator];
         NSString *columnName = nil;
         while ((columnName = [columnNames nextObject])) {
             id objectValue = [self objectForColumnName:columnName];
@@ -128,16 +214,17 @@
     NSUInteger num_cols = (NSUInteger)sqlite3_data_count([_statement statement]);
     
     if (num_cols > 0) {
-        NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithCapacity:num_cols];
+        // the keys come from the statement, so rows share the same name strings and key set
+        NSMutableDictionary *dict = [_statement emptyRowDictionary];
+        NSArray *columnNames = [_statement columnNames];
         
-        int columnCount = sqlite3_column_count([_statement statement]);
+        int columnCount = (int)[columnNames count];
         
         int columnIdx = 0;
         for (columnIdx = 0; columnIdx < columnCount; columnIdx++) {
             
-            NSString *columnName = [NSString stringWithUTF8String:sqlite3_column_name([_statement statement], columnIdx)];
             id objectValue = [self objectForColumnIndex:columnIdx];
-            [dict setObject:objectValue forKey:columnName];
+            [dict setObject:objectValue forKey:[columnNames objectAtIndex:(NSUInteger)columnIdx]];
         }
         
         return dict;
@@ -149,11 +236,23 @@
     return nil;
 }
 
+- (NSDictionary *)resultDictionaryView {
+    if (!_resultDictionaryView) {
+        _resultDictionaryView = [[YFResultSetRowDictionary alloc] initWithResultSet:self];
+    }
+    return _resultDictionaryView;
+}
+
 - (BOOL)next {
     return [self nextWithError:nil];
 }
 
 - (BOOL)nextWithError:(NSError * _Nullable __autoreleasing *)outErr {
+    if (_hasPendingRow) {
+        _hasPendingRow = NO;
+        return YES;
+    }
+    
     int rc = [self internalStepWithError:outErr];
     return rc == SQLITE_ROW;
 }
@@ -167,12 +266,32 @@
     return rc == SQLITE_DONE;
 }
 
+- (void)rowDidEnd {
+    _rowGeneration++;
+    
+#if YFDB_CHECK_BORROWED_BYTES
+    if (_hasBorrowedViews) {
+        _hasBorrowedViews = NO;
+        YFBorrowedRowsUnregister((__bridge const void *)self);
+    }
+#endif
+}
+
 - (int)internalStepWithError:(NSError * _Nullable __autoreleasing *)outErr {
+    // whatever the outcome, views into the previous row are gone
+    [self rowDidEnd];
+    
     int rc = sqlite3_step([_statement statement]);
     
+    if (SQLITE_DONE != rc && SQLITE_ROW != rc) {
+        [_parentDB stepDidFailWithResult:rc];
+    }
+    
     if (SQLITE_BUSY == rc || SQLITE_LOCKED == rc) {
-        NSLog(@"%s:%d Database busy (%@)", __FUNCTION__, __LINE__, [_parentDB databasePath]);
-        NSLog(@"Database busy");
+        // the busy handler has already retried for maxBusyRetryTimeInterval by now
+        if ([_parentDB logsErrors]) {
+            NSLog(@"%s:%d Database busy (%d: %s) (%@)", __FUNCTION__, __LINE__, sqlite3_extended_errcode([_parentDB sqliteHandle]), sqlite3_errmsg([_parentDB sqliteHandle]), [_parentDB databasePath]);
+        }
         if (outErr) {
             *outErr = [_parentDB lastError];
         }
@@ -217,17 +336,155 @@
     return rc;
 }
 
+- (NSInteger)failFetchWithCode:(int)code message:(NSString *)message error:(NSError * _Nullable __autoreleasing *)outErr {
+    if ([_parentDB logsErrors]) {
+        NSLog(@"Error: %@", message);
+    }
+    if (outErr) {
+        *outErr = [NSError errorWithDomain:@"YFDatabase" code:code userInfo:@{NSLocalizedDescriptionKey : message}];
+    }
+    return -1;
+}
+
+- (NSInteger)fetchColumnsInto:(YFColumnBuffer *)columns count:(int)count maxRows:(NSUInteger)maxRows error:(NSError * _Nullable __autoreleasing *)outErr {
+    
+    if (!_statement) {
+        return [self failFetchWithCode:SQLITE_MISUSE message:@"result set is closed" error:outErr];
+    }
+    
+    // 0 is how the end of the rows is reported, so an empty batch can't be asked for
+    if (!maxRows) {
+        return [self failFetchWithCode:SQLITE_MISUSE message:@"fetchColumnsInto: needs a maxRows of at least 1" error:outErr];
+    }
+    
+    if (count < 0 || (count && !columns)) {
+        return [self failFetchWithCode:SQLITE_MISUSE message:@"fetchColumnsInto: was given no column buffers" error:outErr];
+    }
+    
+    sqlite3_stmt *pStmt = [_statement statement];
+    int columnCount = sqlite3_column_count(pStmt);
+    
+    // check every buffer up front, so nothing is stepped past or written when one of them is unusable
+    for (int c = 0; c < count; c++) {
+        YFColumnBuffer *col = &columns[c];
+        
+        if (col->columnIndex < 0 || col->columnIndex >= columnCount) {
+            return [self failFetchWithCode:SQLITE_RANGE message:[NSString stringWithFormat:@"Column buffer %d reads column %d of a result with %d columns", c, col->columnIndex, columnCount] error:outErr];
+        }
+        
+        BOOL isUsable = NO;
+        switch (col->type) {
+            case YFColumnBufferTypeInt64:
+            case YFColumnBufferTypeDouble:
+                isUsable = col->values != 0x00;
+                break;
+            case YFColumnBufferTypeText:
+            case YFColumnBufferTypeBlob:
+                isUsable = col->offsets != 0x00 && (col->bytes != 0x00 || !col->bytesCapacity);
+                break;
+        }
+        
+        if (!isUsable) {
+            return [self failFetchWithCode:SQLITE_MISUSE message:[NSString stringWithFormat:@"Column buffer %d has an unknown type or is missing its values, bytes or offsets", c] error:outErr];
+        }
+        
+        if (col->offsets) {
+            col->offsets[0] = 0;
+        }
+    }
+    
+    NSUInteger row = 0;
+    
+    while (row < maxRows) {
+        
+        if (_hasPendingRow) {
+            _hasPendingRow = NO;
+        }
+        else {
+            int rc = [self internalStepWithError:outErr];
+            
+            if (rc == SQLITE_DONE) {
+                break;
+            }
+            if (rc != SQLITE_ROW) {
+                // the rows already copied are good; outErr tells the caller why the batch is short
+                return row ? (NSInteger)row : -1;
+            }
+        }
+        
+        // make sure every variable length value fits before copying anything, so a row is never half written
+        for (int c = 0; c < count; c++) {
+            YFColumnBuffer *col = &columns[c];
+            
+            if (col->type != YFColumnBufferTypeText && col->type != YFColumnBufferTypeBlob) {
+                continue;
+            }
+            
+            // sqlite3_column_bytes must follow the text/blob call so it reports the converted length
+            if (col->type == YFColumnBufferTypeText) {
+                sqlite3_column_text(pStmt, col->columnIndex);
+            }
+            else {
+                sqlite3_column_blob(pStmt, col->columnIndex);
+            }
+            size_t length = (size_t)sqlite3_column_bytes(pStmt, col->columnIndex);
+            
+            if (col->offsets[row] + length > col->bytesCapacity) {
+                if (row == 0) {
+                    // left pending, so the caller can read the row some other way or with larger buffers
+                    _hasPendingRow = YES;
+                    return [self failFetchWithCode:SQLITE_TOOBIG message:[NSString stringWithFormat:@"Value of %d bytes in column %d does not fit in a buffer of %lu bytes", (int)length, col->columnIndex, (unsigned long)col->bytesCapacity] error:outErr];
+                }
+                
+                _hasPendingRow = YES;
+                return (NSInteger)row;
+            }
+        }
+        
+        for (int c = 0; c < count; c++) {
+            YFColumnBuffer *col = &columns[c];
+            BOOL isNull = sqlite3_column_type(pStmt, col->columnIndex) == SQLITE_NULL;
+            
+            if (col->nulls) {
+                col->nulls[row] = isNull;
+            }
+            
+            switch (col->type) {
+                case YFColumnBufferTypeInt64:
+                    ((int64_t *)col->values)[row] = sqlite3_column_int64(pStmt, col->columnIndex);
+                    break;
+                case YFColumnBufferTypeDouble:
+                    ((double *)col->values)[row] = sqlite3_column_double(pStmt, col->columnIndex);
+                    break;
+                case YFColumnBufferTypeText:
+                case YFColumnBufferTypeBlob: {
+                    const void *bytes = (col->type == YFColumnBufferTypeText) ? (const void *)sqlite3_column_text(pStmt, col->columnIndex) : sqlite3_column_blob(pStmt, col->columnIndex);
+                    size_t length = (size_t)sqlite3_column_bytes(pStmt, col->columnIndex);
+                    
+                    if (length) {
+                        memcpy(col->bytes + col->offsets[row], bytes, length);
+                    }
+                    col->offsets[row + 1] = col->offsets[row] + length;
+                    break;
+                }
+            }
+        }
+        
+        row++;
+    }
+    
+    return (NSInteger)row;
+}
+
 - (BOOL)hasAnotherRow {
     return sqlite3_errcode([_parentDB sqliteHandle]) == SQLITE_ROW;
 }
 
 - (int)columnIndexForName:(NSString*)columnName {
-    columnName = [columnName lowercaseString];
+    int columnIdx = [_statement columnIndexForName:columnName];
     
-    NSNumber *n = [[self columnNameToIndexMap] objectForKey:columnName];
-    
-    if (n != nil) {
-        return [n intValue];
+    if (columnIdx >= 0) {
+        return columnIdx;
     }
     
     NSLog(@"Warning: I could not find the column named '%@'.", columnName);
@@ -313,7 +570,7 @@
         return nil;
     }
     
-    return [_parentDB hasDateFormatter] ? [_parentDB dateFromString:[self stringForColumnIndex:columnIdx]] : [NSDate dateWithTimeIntervalSince1970:[self doubleForColumnIndex:columnIdx]];
+    return [_parentDB dateForColumn:columnIdx inStatement:[_statement statement]];
 }
 
 
@@ -357,6 +614,54 @@
 }
 
 
+// MARK: Borrowed Values
+
+- (YFBorrowedBytes)borrowedBytesForColumnIndex:(int)columnIdx text:(BOOL)text {
+    
+    YFBorrowedBytes view = { 0x00, 0, (__bridge const void *)self, 0 };
+    
+#if YFDB_CHECK_BORROWED_BYTES
+    if (!_hasBorrowedViews) {
+        _hasBorrowedViews = YES;
+        _rowGeneration = YFBorrowedRowsRegister(view.owner);
+    }
+#endif
+    view.rowGeneration = _rowGeneration;
+    
+    sqlite3_stmt *pStmt = [_statement statement];
+    
+    if (!pStmt || columnIdx < 0 || columnIdx >= sqlite3_column_count(pStmt) || sqlite3_column_type(pStmt, columnIdx) == SQLITE_NULL) {
+        return view;
+    }
+    
+    // fetch the pointer before the size, so any conversion has already happened
+    view.bytes = text ? (const void *)sqlite3_column_text(pStmt, columnIdx) : sqlite3_column_blob(pStmt, columnIdx);
+    view.length = (NSUInteger)sqlite3_column_bytes(pStmt, columnIdx);
+    
+    if (!view.bytes && !text) {
+        // sqlite3_column_blob gives NULL for a zero length blob
+        view.bytes = "";
+    }
+    
+    return view;
+}
+
+- (YFBorrowedBytes)borrowedTextForColumnIndex:(int)columnIdx {
+    return [self borrowedBytesForColumnIndex:columnIdx text:YES];
+}
+
+- (YFBorrowedBytes)borrowedTextForColumn:(NSString *)columnName {
+    return [self borrowedTextForColumnIndex:[self columnIndexForName:columnName]];
+}
+
+- (YFBorrowedBytes)borrowedBlobForColumnIndex:(int)columnIdx {
+    return [self borrowedBytesForColumnIndex:columnIdx text:NO];
+}
+
+- (YFBorrowedBytes)borrowedBlobForColumn:(NSString *)columnName {
+    return [self borrowedBlobForColumnIndex:[self columnIndexForName:columnName]];
+}
+
 - (BOOL)columnIndexIsNull:(int)columnIdx {
     return sqlite3_column_type([_statement statement], columnIdx) == SQLITE_NULL;
 }
@@ -444,8 +749,14 @@
 // MARK: Bind
 
 - (BOOL)bindWithArray:(NSArray*)array orDictionary:(NSDictionary *)dictionary orVAList:(va_list)args {
-    [_statement reset];
-    return [_parentDB bindStatement:_statement.statement WithArgumentsInArray:array orDictionary:dictionary orVAList:args];
+    // not -[YFStatement reset]: that hands the statement back to the cache, which may evict and finalize it under us
+    sqlite3_stmt *pStmt = [_statement statement];
+    if (pStmt) {
+        sqlite3_reset(pStmt);
+        sqlite3_clear_bindings(pStmt);
+    }
+    [self rowDidEnd];
+    return [_parentDB bindStatement:pStmt WithArgumentsInArray:array orDictionary:dictionary orVAList:args];
 }
 
 - (BOOL)bindWithArray:(NSArray*)array {
@@ -457,3 +768,150 @@
 }
 
 @end
+
+// MARK: - YFBorrowedBytes
+
+BOOL YFBorrowedBytesIsValid(YFBorrowedBytes view) {
+#if YFDB_CHECK_BORROWED_BYTES
+    if (!view.owner) {
+        // zero initialized, never came from a result set
+        return YES;
+    }
+    
+    pthread_mutex_lock(&YFBorrowedRowsLock);
+    NSNumber *generation = YFBorrowedRows[[NSValue valueWithPointer:view.owner]];
+    pthread_mutex_unlock(&YFBorrowedRowsLock);
+    
+    return generation && [generation unsignedLongLongValue] == view.rowGeneration;
+#else
+    return YES;
+#endif
+}
+
+static inline void YFBorrowedBytesCheck(YFBorrowedBytes view, const char *function) {
+#if YFDB_CHECK_BORROWED_BYTES
+    if (!YFBorrowedBytesIsValid(view)) {
+        NSLog(@"%s: borrowed bytes used after the row advanced or the result set closed", function);
+        NSCAssert(NO, @"%s: borrowed bytes used after the row advanced or the result set closed", function);
+    }
+#endif
+}
+
+BOOL YFBorrowedBytesIsNull(YFBorrowedBytes view) {
+    YFBorrowedBytesCheck(view, __FUNCTION__);
+    return view.bytes == NULL;
+}
+
+BOOL YFBorrowedBytesEqual(YFBorrowedBytes a, YFBorrowedBytes b) {
+    YFBorrowedBytesCheck(a, __FUNCTION__);
+    YFBorrowedBytesCheck(b, __FUNCTION__);
+    
+    if (!a.bytes || !b.bytes) {
+        return a.bytes == b.bytes;
+    }
+    
+    return a.length == b.length && memcmp(a.bytes, b.bytes, a.length) == 0;
+}
+
+BOOL YFBorrowedBytesEqualToUTF8String(YFBorrowedBytes view, const char *string) {
+    YFBorrowedBytesCheck(view, __FUNCTION__);
+    
+    if (!view.bytes || !string) {
+        return NO;
+    }
+    
+    return strlen(string) == view.length && memcmp(view.bytes, string, view.length) == 0;
+}
+
+BOOL YFBorrowedBytesEqualToString(YFBorrowedBytes view, NSString *string) {
+    YFBorrowedBytesCheck(view, __FUNCTION__);
+    
+    if (!view.bytes || !string) {
+        return NO;
+    }
+    
+#ifdef __APPLE__
+    // constant and most ASCII strings keep their bytes inline
+    const char *inlineBytes = CFStringGetCStringPtr((__bridge CFStringRef)string, kCFStringEncodingUTF8);
+    if (inlineBytes) {
+        return YFBorrowedBytesEqualToUTF8String(view, inlineBytes);
+    }
+#endif
+    
+    NSUInteger length = [string length];
+    
+    // every UTF-16 unit takes between one and three UTF-8 bytes
+    if (view.length < length || view.length > length * 3) {
+        return NO;
+    }
+    
+    // encode piecewise into the stack, comparing as we go
+    uint8_t buffer[256];
+    const uint8_t *bytes = view.bytes;
+    NSUInteger compared = 0;
+    NSRange remaining = NSMakeRange(0, length);
+    
+    while (remaining.length > 0) {
+        NSUInteger used = 0;
+        if (![string getBytes:buffer maxLength:sizeof(buffer) usedLength:&used encoding:NSUTF8StringEncoding options:0 range:remaining remainingRange:&remaining] || used == 0) {
+            return NO;
+        }
+        if (compared + used > view.length || memcmp(bytes + compared, buffer, used) != 0) {
+            return NO;
+        }
+        compared += used;
+    }
+    
+    return compared == view.length;
+}
+
+NSComparisonResult YFBorrowedBytesCompare(YFBorrowedBytes a, YFBorrowedBytes b) {
+    YFBorrowedBytesCheck(a, __FUNCTION__);
+    YFBorrowedBytesCheck(b, __FUNCTION__);
+    
+    if (!a.bytes || !b.bytes) {
+        return (a.bytes == b.bytes) ? NSOrderedSame : (a.bytes ? NSOrderedDescending : NSOrderedAscending);
+    }
+    
+    int result = memcmp(a.bytes, b.bytes, MIN(a.length, b.length));
+    
+    if (result == 0) {
+        return (a.length == b.length) ? NSOrderedSame : (a.length < b.length ? NSOrderedAscending : NSOrderedDescending);
+    }
+    
+    return (result < 0) ? NSOrderedAscending : NSOrderedDescending;
+}
+
+uint64_t YFBorrowedBytesHash(YFBorrowedBytes view) {
+    YFBorrowedBytesCheck(view, __FUNCTION__);
+    
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const uint8_t *bytes = view.bytes;
+    
+    for (NSUInteger i = 0; i < view.length; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    
+    return hash;
+}
+
+NSString *YFBorrowedBytesCopyString(YFBorrowedBytes view) {
+    YFBorrowedBytesCheck(view, __FUNCTION__);
+    
+    if (!view.bytes) {
+        return nil;
+    }
+    
+    return [[NSString alloc] initWithBytes:view.bytes length:view.length encoding:NSUTF8StringEncoding];
+}
+
+NSData *YFBorrowedBytesCopyData(YFBorrowedBytes view) {
+    YFBorrowedBytesCheck(view, __FUNCTION__);
+    
+    if (!view.bytes) {
+        return nil;
+    }
+    
+    return [NSData dataWithBytes:view.bytes length:view.length];
+}
@@ -0,0 +1,73 @@
+//
+//  YFRowMapper.h
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class YFResultSet;
+
+/** Fills model objects straight from result set rows.
+
+ The first time a class is mapped, its declared properties (including those of its superclasses) are inspected once: each writable property is recorded with its setter implementation and a conversion chosen from its type. Columns are matched to properties by name, exactly first and then case-insensitively, once per query. Filling a row then calls the setters directly with values read from the statement, with no string round trips and no KVC lookups.
+
+@code
+YFResultSet *rs = [db executeQuery:@"SELECT ID, name, phone, address, score FROM person"];
+NSArray<YFPersonVO *> *people = [rs objectsOfClass:[YFPersonVO class]];
+@endcode
+
+ Supported property types are the C integer and floating point types, @c BOOL , @c NSString , @c NSNumber , @c NSData  and @c NSDate  (converted like @c -[YFResultSet dateForColumnIndex:] ). Properties of type @c id  and of other object types receive the column's text as an @c NSString , as they did from @c kvcMagic:  before. Columns without a matching property are set with @c setValue:forKey: , as @c kvcMagic:  always did. @c NULL  columns leave the property untouched.
+
+ Setters are called through the object's own class, so key-value observers of the object are notified. Plans are cached for a limited number of queries, and only reused while the query's column names stay the same.
+
+ Mappers are cached per class and are safe to share between threads.
+ */
+
+@interface YFRowMapper : NSObject
+
+/** The class this mapper fills. */
+
+@property (nonatomic, readonly) Class modelClass;
+
+/** The shared mapper for a class.
+
+ @param modelClass The class of the objects to fill.
+
+ @return The mapper, created and cached on first use.
+ */
+
++ (instancetype)mapperForClass:(Class)modelClass;
+
+/** Set the properties of an object from the current row.
+
+ @param object The object to fill; should be an instance of @c modelClass .
+ @param resultSet A result set positioned on a row.
+ */
+
+- (void)fillObject:(id)object fromResultSet:(YFResultSet *)resultSet;
+
+/** Create an object with @c -init  and fill it from the current row.
+
+ @param resultSet A result set positioned on a row.
+
+ @return The new object.
+ */
+
+- (id)objectFromResultSet:(YFResultSet *)resultSet;
+
+/** Create and fill one object per remaining row, then close the result set.
+
+ @param resultSet A result set that has not stepped yet, or is positioned before the rows to read.
+
+ @return The objects, in row order.
+ */
+
+- (NSArray *)objectsFromResultSet:(YFResultSet *)resultSet;
+
+@end
+
+NS_ASSUME_NONNULL_END
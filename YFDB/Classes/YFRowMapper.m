@@ -0,0 +1,446 @@
+//
+//  YFRowMapper.m
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import "YFRowMapper.h"
+#import "YFResultSet.h"
+#import "YFDatabase.h"
+#import <objc/runtime.h>
+#import <sqlite3.h>
+
+// plans are cheap to build again, so a mapper used with many ad hoc queries forgets some rather than growing without end
+static const NSUInteger YFRowMapperMaximumPlanCount = 64;
+
+typedef NS_ENUM(int, YFRowMapperKind) {
+    YFRowMapperKindChar,
+    YFRowMapperKindUnsignedChar,
+    YFRowMapperKindShort,
+    YFRowMapperKindUnsignedShort,
+    YFRowMapperKindInt,
+    YFRowMapperKindUnsignedInt,
+    YFRowMapperKindLong,
+    YFRowMapperKindUnsignedLong,
+    YFRowMapperKindLongLong,
+    YFRowMapperKindUnsignedLongLong,
+    YFRowMapperKindFloat,
+    YFRowMapperKindDouble,
+    YFRowMapperKindBool,
+    YFRowMapperKindString,
+    YFRowMapperKindNumber,
+    YFRowMapperKindData,
+    YFRowMapperKindDate,
+    YFRowMapperKindObject,
+};
+
+/** One column feeding one property setter. */
+
+typedef struct YFRowMapperBinding {
+    int             columnIdx;
+    YFRowMapperKind kind;
+    SEL             setter;
+    IMP             imp;
+} YFRowMapperBinding;
+
+// MARK: - YFRowMapperProperty
+
+@interface YFRowMapperProperty : NSObject {
+@public
+    YFRowMapperKind _kind;
+    SEL             _setter;
+    IMP             _imp;
+}
+@end
+
+@implementation YFRowMapperProperty
+@end
+
+// MARK: - YFRowMapperPlan
+
+/** Column to setter bindings for one query's columns. */
+
+@interface YFRowMapperPlan : NSObject {
+@public
+    // the statement's columnNames; a plan is only reused for columns with the same names
+    NSArray             *_columnNames;
+    int                 _columnCount;
+    YFRowMapperBinding  *_bindings;
+    int                 _bindingCount;
+
+    // columns with no matching property, set through KVC like kvcMagic: always did
+    int                 *_kvcColumns;
+    int                 _kvcColumnCount;
+    NSArray             *_kvcKeys;
+}
+@end
+
+@implementation YFRowMapperPlan
+
+- (void)dealloc {
+    free(_bindings);
+    free(_kvcColumns);
+}
+
+@end
+
+// MARK: - YFRowMapper
+
+@interface YFRowMapper () {
+    NSDictionary        *_propertiesByName;
+    NSDictionary        *_propertiesByLowercaseName;
+    NSMutableDictionary *_plansByQuery;
+}
+@end
+
+@implementation YFRowMapper
+
++ (instancetype)mapperForClass:(Class)modelClass {
+
+    static NSMutableDictionary *mappers = 0x00;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mappers = [NSMutableDictionary dictionary];
+    });
+
+    @synchronized (mappers) {
+        YFRowMapper *mapper = [mappers objectForKey:(id<NSCopying>)modelClass];
+
+        if (!mapper) {
+            mapper = [[self alloc] initWithClass:modelClass];
+            [mappers setObject:mapper forKey:(id<NSCopying>)modelClass];
+        }
+
+        return mapper;
+    }
+}
+
+- (instancetype)initWithClass:(Class)modelClass {
+    self = [super init];
+
+    if (self) {
+        _modelClass = modelClass;
+        _plansByQuery = [NSMutableDictionary dictionary];
+        [self inspectClass];
+    }
+
+    return self;
+}
+
+static BOOL YFRowMapperKindForType(const char *type, YFRowMapperKind *kind) {
+
+    switch (type[0]) {
+        case 'c': *kind = YFRowMapperKindChar; return YES;
+        case 'C': *kind = YFRowMapperKindUnsignedChar; return YES;
+        case 's': *kind = YFRowMapperKindShort; return YES;
+        case 'S': *kind = YFRowMapperKindUnsignedShort; return YES;
+        case 'i': *kind = YFRowMapperKindInt; return YES;
+        case 'I': *kind = YFRowMapperKindUnsignedInt; return YES;
+        case 'l': *kind = YFRowMapperKindLong; return YES;
+        case 'L': *kind = YFRowMapperKindUnsignedLong; return YES;
+        case 'q': *kind = YFRowMapperKindLongLong; return YES;
+        case 'Q': *kind = YFRowMapperKindUnsignedLongLong; return YES;
+        case 'f': *kind = YFRowMapperKindFloat; return YES;
+        case 'd': *kind = YFRowMapperKindDouble; return YES;
+        case 'B': *kind = YFRowMapperKindBool; return YES;
+        case '@': {
+            *kind = YFRowMapperKindObject;
+
+            // @"ClassName"
+            if (type[1] == '"') {
+                NSString *className = [[NSString alloc] initWithBytes:type + 2 length:strcspn(type + 2, "\"<") encoding:NSUTF8StringEncoding];
+                Class cls = NSClassFromString(className);
+
+                if (cls == [NSString class]) {
+                    *kind = YFRowMapperKindString;
+                }
+                else if (cls == [NSNumber class]) {
+                    *kind = YFRowMapperKindNumber;
+                }
+                else if (cls == [NSData class]) {
+                    *kind = YFRowMapperKindData;
+                }
+                else if (cls == [NSDate class]) {
+                    *kind = YFRowMapperKindDate;
+                }
+            }
+            return YES;
+        }
+        default:
+            // structs, pointers and the like are left to KVC
+            return NO;
+    }
+}
+
+- (void)inspectClass {
+
+    NSMutableDictionary *propertiesByName = [NSMutableDictionary dictionary];
+    NSMutableDictionary *propertiesByLowercaseName = [NSMutableDictionary dictionary];
+
+    for (Class cls = _modelClass; cls && cls != [NSObject class]; cls = class_getSuperclass(cls)) {
+
+        unsigned int count = 0;
+        objc_property_t *properties = class_copyPropertyList(cls, &count);
+
+        for (unsigned int i = 0; i < count; i++) {
+
+            NSString *name = [NSString stringWithUTF8String:property_getName(properties[i])];
+
+            // a subclass redeclaring a property wins
+            if ([propertiesByName objectForKey:name]) {
+                continue;
+            }
+
+            char *readonly = property_copyAttributeValue(properties[i], "R");
+            if (readonly) {
+                free(readonly);
+                continue;
+            }
+
+            char *type = property_copyAttributeValue(properties[i], "T");
+            YFRowMapperKind kind;
+            BOOL supported = type && YFRowMapperKindForType(type, &kind);
+            free(type);
+
+            if (!supported) {
+                continue;
+            }
+
+            SEL setter;
+            char *setterName = property_copyAttributeValue(properties[i], "S");
+            if (setterName) {
+                setter = sel_registerName(setterName);
+                free(setterName);
+            }
+            else {
+                NSString *defaultSetter = [NSString stringWithFormat:@"set%@%@:", [[name substringToIndex:1] uppercaseString], [name substringFromIndex:1]];
+                setter = NSSelectorFromString(defaultSetter);
+            }
+
+            if (![_modelClass instancesRespondToSelector:setter]) {
+                continue;
+            }
+
+            YFRowMapperProperty *property = [[YFRowMapperProperty alloc] init];
+            property->_kind     = kind;
+            property->_setter   = setter;
+            property->_imp      = class_getMethodImplementation(_modelClass, setter);
+
+            [propertiesByName setObject:property forKey:name];
+
+            NSString *lowercaseName = [name lowercaseString];
+            if (![propertiesByLowercaseName objectForKey:lowercaseName]) {
+                [propertiesByLowercaseName setObject:property forKey:lowercaseName];
+            }
+        }
+
+        free(properties);
+    }
+
+    _propertiesByName = [propertiesByName copy];
+    _propertiesByLowercaseName = [propertiesByLowercaseName copy];
+}
+
+- (YFRowMapperPlan *)planForStatement:(sqlite3_stmt *)pStmt query:(NSString *)query columnNames:(NSArray *)columnNames {
+
+    int columnCount = sqlite3_column_count(pStmt);
+
+    YFRowMapperPlan *plan = 0x00;
+
+    if (query) {
+        @synchronized (self) {
+            plan = [_plansByQuery objectForKey:query];
+        }
+
+        // the same statement hands back the same array, so the comparison is only paid for once a schema change or another statement comes along
+        if (plan && plan->_columnCount == columnCount && (plan->_columnNames == columnNames || [plan->_columnNames isEqualToArray:columnNames])) {
+            return plan;
+        }
+    }
+
+    plan = [[YFRowMapperPlan alloc] init];
+    plan->_columnNames  = columnNames;
+    plan->_columnCount  = columnCount;
+    plan->_bindings     = calloc((size_t)MAX(columnCount, 1), sizeof(YFRowMapperBinding));
+    plan->_kvcColumns   = calloc((size_t)MAX(columnCount, 1), sizeof(int));
+
+    NSMutableArray *kvcKeys = [NSMutableArray array];
+
+    for (int columnIdx = 0; columnIdx < columnCount; columnIdx++) {
+
+        NSString *columnName = [NSString stringWithUTF8String:sqlite3_column_name(pStmt, columnIdx)];
+
+        YFRowMapperProperty *property = [_propertiesByName objectForKey:columnName];
+        if (!property) {
+            property = [_propertiesByLowercaseName objectForKey:[columnName lowercaseString]];
+        }
+
+        if (property) {
+            YFRowMapperBinding *binding = &plan->_bindings[plan->_bindingCount++];
+            binding->columnIdx  = columnIdx;
+            binding->kind       = property->_kind;
+            binding->setter     = property->_setter;
+            binding->imp        = property->_imp;
+        }
+        else {
+            plan->_kvcColumns[plan->_kvcColumnCount++] = columnIdx;
+            [kvcKeys addObject:columnName];
+        }
+    }
+
+    plan->_kvcKeys = [kvcKeys copy];
+
+    if (query) {
+        @synchronized (self) {
+            if ([_plansByQuery count] >= YFRowMapperMaximumPlanCount && ![_plansByQuery objectForKey:query]) {
+                [_plansByQuery removeObjectForKey:[[_plansByQuery keyEnumerator] nextObject]];
+            }
+            [_plansByQuery setObject:plan forKey:query];
+        }
+    }
+
+    return plan;
+}
+
+#define YFRowMapperSet(type, value) ((void (*)(id, SEL, type))imp)(object, binding->setter, (type)(value))
+
+- (void)fillObject:(id)object fromResultSet:(YFResultSet *)resultSet {
+
+    sqlite3_stmt *pStmt = [[resultSet statement] statement];
+
+    if (!pStmt) {
+        return;
+    }
+
+    YFRowMapperPlan *plan = [self planForStatement:pStmt query:[resultSet query] columnNames:[[resultSet statement] columnNames]];
+
+    // an observed object has been moved to a KVO subclass, and a subclass may override setters: only a plain instance can take the cached IMPs
+    Class objectClass = object_getClass(object);
+    BOOL useCachedIMPs = (objectClass == _modelClass);
+
+    for (int i = 0; i < plan->_bindingCount; i++) {
+
+        YFRowMapperBinding *binding = &plan->_bindings[i];
+        IMP imp = useCachedIMPs ? binding->imp : class_getMethodImplementation(objectClass, binding->setter);
+        int columnIdx = binding->columnIdx;
+        int columnType = sqlite3_column_type(pStmt, columnIdx);
+
+        if (columnType == SQLITE_NULL) {
+            continue;
+        }
+
+        switch (binding->kind) {
+            case YFRowMapperKindChar:
+                YFRowMapperSet(char, sqlite3_column_int64(pStmt, columnIdx));
+                break;
+            case YFRowMapperKindUnsignedChar:
+                YFRowMapperSet(unsigned char, sqlite3_column_int64(pStmt, columnIdx));
+                break;
+            case YFRowMapperKindShort:
+                YFRowMapperSet(short, sqlite3_column_int64(pStmt, columnIdx));
+                break;
+            case YFRowMapperKindUnsignedShort:
+                YFRowMapperSet(unsigned short, sqlite3_column_int64(pStmt, columnIdx));
+                break;
+            case YFRowMapperKindInt:
+                YFRowMapperSet(int, sqlite3_column_int64(pStmt, columnIdx));
+                break;
+            case YFRowMapperKindUnsignedInt:
+                YFRowMapperSet(unsigned int, sqlite3_column_int64(pStmt, columnIdx));
+                break;
+            case YFRowMapperKindLong:
+                YFRowMapperSet(long, sqlite3_column_int64(pStmt, columnIdx));
+                break;
+            case YFRowMapperKindUnsignedLong:
+                YFRowMapperSet(unsigned long, sqlite3_column_int64(pStmt, columnIdx));
+                break;
+            case YFRowMapperKindLongLong:
+                YFRowMapperSet(long long, sqlite3_column_int64(pStmt, columnIdx));
+                break;
+            case YFRowMapperKindUnsignedLongLong:
+                YFRowMapperSet(unsigned long long, sqlite3_column_int64(pStmt, columnIdx));
+                break;
+            case YFRowMapperKindFloat:
+                YFRowMapperSet(float, sqlite3_column_double(pStmt, columnIdx));
+                break;
+            case YFRowMapperKindDouble:
+                YFRowMapperSet(double, sqlite3_column_double(pStmt, columnIdx));
+                break;
+            case YFRowMapperKindBool:
+                YFRowMapperSet(BOOL, sqlite3_column_int64(pStmt, columnIdx) != 0);
+                break;
+            case YFRowMapperKindString: {
+                const char *c = (const char *)sqlite3_column_text(pStmt, columnIdx);
+                NSString *s = [[NSString alloc] initWithBytes:c length:(NSUInteger)sqlite3_column_bytes(pStmt, columnIdx) encoding:NSUTF8StringEncoding];
+                YFRowMapperSet(id, s);
+                break;
+            }
+            case YFRowMapperKindNumber: {
+                NSNumber *n = (columnType == SQLITE_INTEGER) ? [NSNumber numberWithLongLong:sqlite3_column_int64(pStmt, columnIdx)] : [NSNumber numberWithDouble:sqlite3_column_double(pStmt, columnIdx)];
+                YFRowMapperSet(id, n);
+                break;
+            }
+            case YFRowMapperKindData: {
+                const void *bytes = sqlite3_column_blob(pStmt, columnIdx);
+                NSData *d = [NSData dataWithBytes:bytes length:(NSUInteger)sqlite3_column_bytes(pStmt, columnIdx)];
+                YFRowMapperSet(id, d);
+                break;
+            }
+            case YFRowMapperKindDate:
+                YFRowMapperSet(id, [resultSet dateForColumnIndex:columnIdx]);
+                break;
+            case YFRowMapperKindObject: {
+                // id and other object types get the text, as setValue:forKey: gave them before the mapper
+                const char *c = (const char *)sqlite3_column_text(pStmt, columnIdx);
+                YFRowMapperSet(id, c ? [NSString stringWithUTF8String:c] : nil);
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < plan->_kvcColumnCount; i++) {
+
+        int columnIdx = plan->_kvcColumns[i];
+        const char *c = (const char *)sqlite3_column_text(pStmt, columnIdx);
+
+        // check for a null row
+        if (c) {
+            NSString *s = [NSString stringWithUTF8String:c];
+
+            [object setValue:s forKey:[plan->_kvcKeys objectAtIndex:(NSUInteger)i]];
+        }
+    }
+}
+
+#undef YFRowMapperSet
+
+- (id)objectFromResultSet:(YFResultSet *)resultSet {
+
+    id object = [[_modelClass alloc] init];
+
+    [self fillObject:object fromResultSet:resultSet];
+
+    return object;
+}
+
+- (NSArray *)objectsFromResultSet:(YFResultSet *)resultSet {
+
+    NSMutableArray *objects = [NSMutableArray array];
+
+    while ([resultSet next]) {
+        @autoreleasepool {
+            [objects addObject:[self objectFromResultSet:resultSet]];
+        }
+    }
+
+    [resultSet close];
+
+    return objects;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%@ %@ (%lu properties)", [super description], NSStringFromClass(_modelClass), (unsigned long)[_propertiesByName count]];
+}
+
+@end
@@ -0,0 +1,214 @@
+//
+//  YFVirtualTable.h
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import <Foundation/Foundation.h>
+#import "YFFunctionContext.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/** Comparisons a provider may filter on; the values match @c SQLITE_INDEX_CONSTRAINT_* . */
+
+typedef NS_ENUM(int, YFVirtualTableOperator) {
+    YFVirtualTableOperatorEqual             = 2,
+    YFVirtualTableOperatorGreaterThan       = 4,
+    YFVirtualTableOperatorLessOrEqual       = 8,
+    YFVirtualTableOperatorLessThan          = 16,
+    YFVirtualTableOperatorGreaterOrEqual    = 32,
+};
+
+/** One @c WHERE  or join term SQLite pushed down to a provider, such as @c column = value . */
+
+@interface YFVirtualTableConstraint : NSObject
+
+/** Zero-based index into the provider's @c columnNames . */
+
+@property (nonatomic, readonly) int column;
+
+@property (nonatomic, readonly) YFVirtualTableOperator op;
+
+/** The right-hand side, as @c NSNumber , @c NSString  or @c NSData ; @c nil  for @c NULL . */
+
+@property (nonatomic, readonly, nullable) id value;
+
+@end
+
+/** Rows of one scan of a virtual table, in whatever order the provider produces them. */
+
+@protocol YFVirtualTableCursor <NSObject>
+
+/** Move to the next row; the first call moves to the first row.
+
+ @param outErr Set when the scan fails, for instance on a malformed line.
+
+ @return @c YES on a row; @c NO at the end or on error.
+ */
+
+- (BOOL)nextRow:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Set the value of a column of the current row with one of the @c result  methods of @c context , which has no arguments. Setting none gives @c NULL . */
+
+- (void)resultForColumn:(int)column context:(YFFunctionContext *)context;
+
+@optional
+
+/** The @c rowid  of the current row; the row's position in the scan when not implemented. */
+
+- (int64_t)rowid;
+
+@end
+
+/** Supplies the columns and rows of a virtual table registered with @c makeVirtualTableNamed:provider:error: .
+
+ A provider may be asked for several cursors at once, one for each place the table appears in a statement, and for a new one each time a join re-runs the inner loop.
+ */
+
+@protocol YFVirtualTableProvider <NSObject>
+
+/** Column names, fixed for the life of the registration. */
+
+- (NSArray<NSString *> *)columnNames;
+
+/** Start a scan.
+
+ @param constraints The terms accepted by @c canFilterColumn:op: , with their values. SQLite checks every term again on the rows returned, so they only narrow the scan: returning extra rows is harmless, leaving out matching ones is not.
+ @param outErr Set when the scan cannot start.
+
+ @return A cursor before the first row; @c nil  on error.
+ */
+
+- (nullable id<YFVirtualTableCursor>)cursorWithConstraints:(NSArray<YFVirtualTableConstraint *> *)constraints error:(NSError * _Nullable __autoreleasing *)outErr;
+
+@optional
+
+/** Whether scans can use a term on a column, typically because the provider can seek instead of scanning everything. Nothing is pushed down when neither this nor @c canFilterColumn:op:collation:  is implemented.
+
+ Only asked about terms compared with the @c BINARY  collation; terms under @c NOCASE  or another collation are never pushed down to a provider implementing just this method.
+ */
+
+- (BOOL)canFilterColumn:(int)column op:(YFVirtualTableOperator)op;
+
+/** Like @c canFilterColumn:op: , for a term compared with a given collation; used instead of it when implemented.
+
+ @param column Zero-based index into @c columnNames .
+ @param op The comparison.
+ @param collation Name of the collating sequence, such as @c BINARY , @c NOCASE  or @c RTRIM . SQLite only reports it from 3.22 on; before that it is always @c BINARY .
+
+ @return @c YES  if scans can narrow on the term without leaving out rows that match under @c collation .
+ */
+
+- (BOOL)canFilterColumn:(int)column op:(YFVirtualTableOperator)op collation:(NSString *)collation;
+
+/** Rows in a full scan, for the query planner; 1,000,000 when not implemented. */
+
+- (double)estimatedRowCount;
+
+@end
+
+/** A provider over an array of rows held in memory.
+
+ Rows are @c NSArray  (values by column position), @c NSDictionary  (values by column name) or any other object (values by key-value coding). Values go to SQLite as @c -[YFFunctionContext resultObject:]  sends them.
+
+ Equality terms under the @c BINARY  collation are pushed down: the first scan filtering a column builds a hash index of it, so joining on that column looks rows up instead of scanning the array for every outer row. Text that reads as a number is indexed under the number, so a lookup finds the rows SQLite would match after converting between text and numbers for a column's affinity.
+ */
+
+@interface YFArrayTableProvider : NSObject <YFVirtualTableProvider>
+
+/** Create a provider.
+
+ @param columnNames Column names.
+ @param rows The rows; copied, so later changes to a mutable array are not seen.
+
+ @return A provider.
+ */
+
++ (instancetype)providerWithColumnNames:(NSArray<NSString *> *)columnNames rows:(NSArray *)rows;
+
+- (instancetype)initWithColumnNames:(NSArray<NSString *> *)columnNames rows:(NSArray *)rows;
+
+@end
+
+/** Formats read by @c YFFileTableProvider . */
+
+typedef NS_ENUM(int, YFFileTableFormat) {
+    /** RFC 4180 comma separated values: quoted fields may hold delimiters, @c ""  and line breaks. Every value is text, or @c NULL  for a missing trailing field. */
+    YFFileTableFormatCSV,
+    /** One JSON object per line. Values keep their JSON type; nested arrays and objects come back as JSON text. */
+    YFFileTableFormatNDJSON,
+};
+
+/** A provider streaming a file, a line at a time, from the start for each scan.
+
+ Memory use does not grow with the file, and nothing is pushed down, so SQLite puts the file in the outer loop of a join and looks the other side up by index.
+ */
+
+@interface YFFileTableProvider : NSObject <YFVirtualTableProvider>
+
+/** Create a provider.
+
+ @param path Path of the file.
+ @param format Format of the file.
+ @param columnNames Column names. When @c nil , taken from the header row of a CSV file, which scans then skip, or from the keys of the first object of an NDJSON file, in sorted order.
+
+ @return A provider; @c nil  if @c columnNames  is @c nil  and the file cannot be read.
+ */
+
++ (nullable instancetype)providerWithPath:(NSString *)path format:(YFFileTableFormat)format columnNames:(NSArray<NSString *> * _Nullable)columnNames;
+
+- (nullable instancetype)initWithPath:(NSString *)path format:(YFFileTableFormat)format columnNames:(NSArray<NSString *> * _Nullable)columnNames;
+
+@property (nonatomic, readonly) NSString *path;
+
+@property (nonatomic, readonly) YFFileTableFormat format;
+
+/** Field delimiter of CSV files; @c ','  by default, @c '\t'  for tab separated files. Set before the first scan. */
+
+@property (nonatomic) char delimiter;
+
+@end
+
+@interface YFDatabase (YFVirtualTables)
+
+///-----------------------------
+/// @name Virtual tables
+///-----------------------------
+
+/** Expose a provider as a table, without copying its rows into the database.
+
+ The table is eponymous: it is queried by name straight away, needs no @c CREATE VIRTUAL TABLE  and is not stored in the schema. It is read only.
+
+@code
+YFFileTableProvider *orders = [YFFileTableProvider providerWithPath:path format:YFFileTableFormatCSV columnNames:nil];
+[db makeVirtualTableNamed:@"orders_csv" provider:orders error:&error];
+
+YFResultSet *rs = [db executeQuery:@"SELECT c.name, o.total FROM orders_csv o JOIN customer c ON c.id = o.customer_id"];
+@endcode
+
+ Tables belong to the connection: register them again after reopening. Requires SQLite 3.9.
+
+ @param name Name of the table; must not be registered already.
+ @param provider Supplies columns and rows; retained until the table is removed or the connection closes.
+ @param outErr A @c NSError  object to receive any error object (if any).
+
+ @return @c YES on success; @c NO on failure.
+
+ @see [The Virtual Table Mechanism](https://sqlite.org/vtab.html)
+ */
+
+- (BOOL)makeVirtualTableNamed:(NSString *)name provider:(id<YFVirtualTableProvider>)provider error:(NSError * _Nullable __autoreleasing *)outErr;
+
+/** Remove a table registered with @c makeVirtualTableNamed:provider:error: , releasing its provider. Cached statements are cleared; result sets still reading the table must be closed first.
+
+ @param name Name of the table.
+
+ @return @c YES on success; @c NO on failure.
+ */
+
+- (BOOL)removeVirtualTableNamed:(NSString *)name;
+
+@end
+
+NS_ASSUME_NONNULL_END
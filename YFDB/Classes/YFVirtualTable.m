@@ -0,0 +1,980 @@
+//
+//  YFVirtualTable.m
+//  YFDBExample
+//
+//  Created by Sakya on 2023/11/1.
+//
+
+#import "YFVirtualTable.h"
+#import "YFDatabase.h"
+#import <sqlite3.h>
+#import <stdio.h>
+#import <stdlib.h>
+#import <string.h>
+#import <errno.h>
+#import <math.h>
+
+// implemented in YFFunctionContext.m
+@interface YFFunctionContext (YFVirtualTablePrivate)
+- (void)setSqliteContext:(sqlite3_context *)context argumentCount:(int)argc values:(sqlite3_value **)argv;
+@end
+
+// MARK: - YFVirtualTableConstraint
+
+@interface YFVirtualTableConstraint ()
+- (instancetype)initWithColumn:(int)column op:(YFVirtualTableOperator)op value:(id)value;
+@end
+
+@implementation YFVirtualTableConstraint
+
+- (instancetype)initWithColumn:(int)column op:(YFVirtualTableOperator)op value:(id)value {
+    self = [super init];
+    if (self) {
+        _column = column;
+        _op = op;
+        _value = value;
+    }
+    return self;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p> column %d op %d %@", [self class], self, _column, _op, _value];
+}
+
+@end
+
+// MARK: - Module
+
+// sqlite3_vtab and sqlite3_vtab_cursor must come first: SQLite hands back pointers to them
+
+typedef struct YFVirtualTableHandle {
+    sqlite3_vtab    base;
+    void            *provider;          // owned by the module, which outlives the table
+    int             columnCount;
+} YFVirtualTableHandle;
+
+typedef struct YFVirtualTableCursorHandle {
+    sqlite3_vtab_cursor base;
+    void                *cursor;        // retained id<YFVirtualTableCursor>, one per xFilter
+    void                *context;       // retained YFFunctionContext, reused for every column
+    BOOL                eof;
+    int64_t             position;
+} YFVirtualTableCursorHandle;
+
+static void YFVirtualTableSetError(sqlite3_vtab *vtab, NSString *message) {
+    sqlite3_free(vtab->zErrMsg);
+    vtab->zErrMsg = sqlite3_mprintf("%s", message ? [message UTF8String] : "virtual table error");
+}
+
+// exceptions must not unwind through sqlite3_step
+static int YFVirtualTableSetException(sqlite3_vtab *vtab, NSException *exception) {
+    YFVirtualTableSetError(vtab, [exception reason] ? [exception reason] : [exception name]);
+    return SQLITE_ERROR;
+}
+
+static int YFVirtualTableConnect(sqlite3 *db, void *pAux, int argc, const char *const *argv, sqlite3_vtab **ppVtab, char **pzErr) {
+    id<YFVirtualTableProvider> provider = (__bridge id<YFVirtualTableProvider>)pAux;
+    int rc = SQLITE_OK;
+
+    @autoreleasepool {
+        NSArray<NSString *> *columnNames = nil;
+
+        @try {
+            columnNames = [provider columnNames];
+        }
+        @catch (NSException *exception) {
+            columnNames = nil;
+        }
+
+        if (![columnNames count]) {
+            *pzErr = sqlite3_mprintf("virtual table %s has no columns", argv[2]);
+            return SQLITE_ERROR;
+        }
+
+        // no declared types: values keep the storage class the provider gives them
+        NSMutableString *sql = [NSMutableString stringWithString:@"CREATE TABLE x("];
+        [columnNames enumerateObjectsUsingBlock:^(NSString *name, NSUInteger idx, BOOL *stop) {
+            [sql appendFormat:@"%@\"%@\"", idx ? @", " : @"", [name stringByReplacingOccurrencesOfString:@"\"" withString:@"\"\""]];
+        }];
+        [sql appendString:@")"];
+
+        rc = sqlite3_declare_vtab(db, [sql UTF8String]);
+        if (rc != SQLITE_OK) {
+            return rc;
+        }
+
+        YFVirtualTableHandle *table = sqlite3_malloc((int)sizeof(YFVirtualTableHandle));
+        if (!table) {
+            return SQLITE_NOMEM;
+        }
+        memset(table, 0, sizeof(YFVirtualTableHandle));
+
+        table->provider = pAux;
+        table->columnCount = (int)[columnNames count];
+        *ppVtab = &table->base;
+    }
+
+    return rc;
+}
+
+static int YFVirtualTableDisconnect(sqlite3_vtab *vtab) {
+    sqlite3_free(vtab);
+    return SQLITE_OK;
+}
+
+static BOOL YFVirtualTableIsOperator(int op) {
+    switch (op) {
+        case SQLITE_INDEX_CONSTRAINT_EQ:
+        case SQLITE_INDEX_CONSTRAINT_GT:
+        case SQLITE_INDEX_CONSTRAINT_LE:
+        case SQLITE_INDEX_CONSTRAINT_LT:
+        case SQLITE_INDEX_CONSTRAINT_GE:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+// The terms handed to the provider travel to xFilter in idxStr, as "column:op," for each one in
+// argv order. Nothing is omitted: SQLite checks them again, so providers may over-approximate.
+
+static int YFVirtualTableBestIndex(sqlite3_vtab *vtab, sqlite3_index_info *info) {
+    YFVirtualTableHandle *table = (YFVirtualTableHandle *)vtab;
+    id<YFVirtualTableProvider> provider = (__bridge id<YFVirtualTableProvider>)table->provider;
+
+    int rc = SQLITE_OK;
+    double rows = 1000000;
+
+    @autoreleasepool {
+        @try {
+            if ([provider respondsToSelector:@selector(estimatedRowCount)]) {
+                rows = MAX([provider estimatedRowCount], 1);
+            }
+
+            BOOL canFilterWithCollation = [provider respondsToSelector:@selector(canFilterColumn:op:collation:)];
+            BOOL canFilter = canFilterWithCollation || [provider respondsToSelector:@selector(canFilterColumn:op:)];
+            NSMutableString *plan = [NSMutableString string];
+            int argvIndex = 0;
+
+            for (int i = 0; canFilter && i < info->nConstraint; i++) {
+                const struct sqlite3_index_constraint *constraint = &info->aConstraint[i];
+
+                if (!constraint->usable || constraint->iColumn < 0 || constraint->iColumn >= table->columnCount || !YFVirtualTableIsOperator(constraint->op)) {
+                    continue;
+                }
+
+#if SQLITE_VERSION_NUMBER >= 3022000
+                const char *collation = sqlite3_vtab_collation(info, i);
+#else
+                const char *collation = 0x00;
+#endif
+                BOOL isBinary = !collation || sqlite3_stricmp(collation, "BINARY") == 0;
+
+                if (canFilterWithCollation) {
+                    if (![provider canFilterColumn:constraint->iColumn op:(YFVirtualTableOperator)constraint->op collation:isBinary ? @"BINARY" : [NSString stringWithUTF8String:collation]]) {
+                        continue;
+                    }
+                }
+                // a provider that doesn't know about collations compares bytes, which could leave out rows matching under NOCASE and the like
+                else if (!isBinary || ![provider canFilterColumn:constraint->iColumn op:(YFVirtualTableOperator)constraint->op]) {
+                    continue;
+                }
+
+                info->aConstraintUsage[i].argvIndex = ++argvIndex;
+                info->aConstraintUsage[i].omit = 0;
+                [plan appendFormat:@"%d:%d,", constraint->iColumn, constraint->op];
+
+                // rough selectivity, enough for the planner to prefer lookups over scans
+                rows /= (constraint->op == SQLITE_INDEX_CONSTRAINT_EQ) ? 100 : 4;
+            }
+
+            if (argvIndex) {
+                info->idxStr = sqlite3_mprintf("%s", [plan UTF8String]);
+                if (!info->idxStr) {
+                    rc = SQLITE_NOMEM;
+                }
+                info->needToFreeIdxStr = 1;
+            }
+            info->idxNum = argvIndex;
+        }
+        @catch (NSException *exception) {
+            rc = YFVirtualTableSetException(vtab, exception);
+        }
+    }
+
+    rows = MAX(rows, 1);
+    info->estimatedCost = rows;
+#if SQLITE_VERSION_NUMBER >= 3008002
+    info->estimatedRows = (sqlite3_int64)rows;
+#endif
+
+    return rc;
+}
+
+static void YFVirtualTableCursorRelease(YFVirtualTableCursorHandle *cursor) {
+    if (cursor->cursor) {
+        (void)(__bridge_transfer id)cursor->cursor;
+        cursor->cursor = 0x00;
+    }
+}
+
+static int YFVirtualTableOpen(sqlite3_vtab *vtab, sqlite3_vtab_cursor **ppCursor) {
+    YFVirtualTableCursorHandle *cursor = sqlite3_malloc((int)sizeof(YFVirtualTableCursorHandle));
+    if (!cursor) {
+        return SQLITE_NOMEM;
+    }
+    memset(cursor, 0, sizeof(YFVirtualTableCursorHandle));
+
+    cursor->eof = YES;
+    *ppCursor = &cursor->base;
+
+    return SQLITE_OK;
+}
+
+static int YFVirtualTableClose(sqlite3_vtab_cursor *cur) {
+    YFVirtualTableCursorHandle *cursor = (YFVirtualTableCursorHandle *)cur;
+
+    YFVirtualTableCursorRelease(cursor);
+    if (cursor->context) {
+        (void)(__bridge_transfer YFFunctionContext *)cursor->context;
+    }
+    sqlite3_free(cursor);
+
+    return SQLITE_OK;
+}
+
+static int YFVirtualTableAdvance(YFVirtualTableCursorHandle *cursor) {
+    id<YFVirtualTableCursor> scan = (__bridge id<YFVirtualTableCursor>)cursor->cursor;
+    NSError *error = nil;
+
+    if ([scan nextRow:&error]) {
+        cursor->eof = NO;
+        cursor->position++;
+        return SQLITE_OK;
+    }
+
+    cursor->eof = YES;
+
+    if (error) {
+        YFVirtualTableSetError(cursor->base.pVtab, [error localizedDescription]);
+        return SQLITE_ERROR;
+    }
+
+    return SQLITE_OK;
+}
+
+static int YFVirtualTableFilter(sqlite3_vtab_cursor *cur, int idxNum, const char *idxStr, int argc, sqlite3_value **argv) {
+    YFVirtualTableCursorHandle *cursor = (YFVirtualTableCursorHandle *)cur;
+    YFVirtualTableHandle *table = (YFVirtualTableHandle *)cur->pVtab;
+    id<YFVirtualTableProvider> provider = (__bridge id<YFVirtualTableProvider>)table->provider;
+
+    int rc = SQLITE_OK;
+
+    YFVirtualTableCursorRelease(cursor);
+    cursor->eof = YES;
+    cursor->position = 0;
+
+    if (!cursor->context) {
+        cursor->context = (__bridge_retained void *)[[YFFunctionContext alloc] init];
+    }
+    YFFunctionContext *context = (__bridge YFFunctionContext *)cursor->context;
+
+    @autoreleasepool {
+        @try {
+            NSMutableArray<YFVirtualTableConstraint *> *constraints = [NSMutableArray arrayWithCapacity:(NSUInteger)argc];
+
+            // the term values are read through the context, as function arguments are
+            [context setSqliteContext:0x00 argumentCount:argc values:argv];
+
+            const char *p = idxStr;
+            for (int i = 0; i < argc && p; i++) {
+                int column, op, consumed = 0;
+                if (sscanf(p, "%d:%d,%n", &column, &op, &consumed) != 2 || !consumed) {
+                    break;
+                }
+                p += consumed;
+
+                [constraints addObject:[[YFVirtualTableConstraint alloc] initWithColumn:column op:(YFVirtualTableOperator)op value:[context objectAtIndex:i]]];
+            }
+
+            [context setSqliteContext:0x00 argumentCount:0 values:0x00];
+
+            NSError *error = nil;
+            id<YFVirtualTableCursor> scan = [provider cursorWithConstraints:constraints error:&error];
+
+            if (!scan) {
+                YFVirtualTableSetError(cur->pVtab, error ? [error localizedDescription] : @"virtual table scan failed");
+                rc = SQLITE_ERROR;
+            }
+            else {
+                cursor->cursor = (__bridge_retained void *)scan;
+                rc = YFVirtualTableAdvance(cursor);
+            }
+        }
+        @catch (NSException *exception) {
+            rc = YFVirtualTableSetException(cur->pVtab, exception);
+        }
+    }
+
+    return rc;
+}
+
+static int YFVirtualTableNext(sqlite3_vtab_cursor *cur) {
+    YFVirtualTableCursorHandle *cursor = (YFVirtualTableCursorHandle *)cur;
+    int rc = SQLITE_OK;
+
+    @autoreleasepool {
+        @try {
+            rc = YFVirtualTableAdvance(cursor);
+        }
+        @catch (NSException *exception) {
+            rc = YFVirtualTableSetException(cur->pVtab, exception);
+        }
+    }
+
+    if (rc != SQLITE_OK) {
+        cursor->eof = YES;
+    }
+
+    return rc;
+}
+
+static int YFVirtualTableEof(sqlite3_vtab_cursor *cur) {
+    return ((YFVirtualTableCursorHandle *)cur)->eof;
+}
+
+static int YFVirtualTableColumn(sqlite3_vtab_cursor *cur, sqlite3_context *ctx, int column) {
+    YFVirtualTableCursorHandle *cursor = (YFVirtualTableCursorHandle *)cur;
+    id<YFVirtualTableCursor> scan = (__bridge id<YFVirtualTableCursor>)cursor->cursor;
+    YFFunctionContext *context = (__bridge YFFunctionContext *)cursor->context;
+
+    @autoreleasepool {
+        [context setSqliteContext:ctx argumentCount:0 values:0x00];
+
+        @try {
+            [scan resultForColumn:column context:context];
+        }
+        @catch (NSException *exception) {
+            NSString *reason = [exception reason] ? [exception reason] : [exception name];
+            sqlite3_result_error(ctx, [reason UTF8String], -1);
+        }
+
+        [context setSqliteContext:0x00 argumentCount:0 values:0x00];
+    }
+
+    return SQLITE_OK;
+}
+
+static int YFVirtualTableRowid(sqlite3_vtab_cursor *cur, sqlite3_int64 *pRowid) {
+    YFVirtualTableCursorHandle *cursor = (YFVirtualTableCursorHandle *)cur;
+    id<YFVirtualTableCursor> scan = (__bridge id<YFVirtualTableCursor>)cursor->cursor;
+
+    *pRowid = [scan respondsToSelector:@selector(rowid)] ? [scan rowid] : cursor->position;
+
+    return SQLITE_OK;
+}
+
+static void YFVirtualTableProviderRelease(void *pAux) {
+    (void)(__bridge_transfer id)pAux;
+}
+
+// no xCreate: the module is eponymous only, so the table exists as soon as the module does
+static const sqlite3_module YFVirtualTableModule = {
+    .iVersion       = 0,
+    .xCreate        = 0x00,
+    .xConnect       = YFVirtualTableConnect,
+    .xBestIndex     = YFVirtualTableBestIndex,
+    .xDisconnect    = YFVirtualTableDisconnect,
+    .xDestroy       = 0x00,
+    .xOpen          = YFVirtualTableOpen,
+    .xClose         = YFVirtualTableClose,
+    .xFilter        = YFVirtualTableFilter,
+    .xNext          = YFVirtualTableNext,
+    .xEof           = YFVirtualTableEof,
+    .xColumn        = YFVirtualTableColumn,
+    .xRowid         = YFVirtualTableRowid,
+};
+
+// MARK: - YFArrayTableProvider
+
+// Text SQLite would turn into a number under numeric affinity: a decimal integer or real, optionally padded with spaces.
+static NSNumber *YFArrayTableNumberForText(NSString *text) {
+    const char *c = [text UTF8String];
+    char *end = 0x00;
+
+    if (!c || strspn(c, " \t\n\r\f\v+-.0123456789eE") != strlen(c)) {
+        return nil;
+    }
+
+    errno = 0;
+    long long integer = strtoll(c, &end, 10);
+    if (end != c && !errno && strspn(end, " \t\n\r\f\v") == strlen(end)) {
+        return [NSNumber numberWithLongLong:integer];
+    }
+
+    double real = strtod(c, &end);
+    if (end != c && isfinite(real) && strspn(end, " \t\n\r\f\v") == strlen(end)) {
+        return [NSNumber numberWithDouble:real];
+    }
+
+    return nil;
+}
+
+// A value as SQL sees it after -[YFFunctionContext resultObject:], so index keys match term values.
+// Comparing against a column with numeric or text affinity converts between the two, so text that reads
+// as a number shares the number's key; the extra rows that may bring in are weeded out by SQLite.
+static id YFArrayTableKey(id value) {
+    if (!value || (NSNull *)value == [NSNull null]) {
+        return nil;
+    }
+    if ([value isKindOfClass:[NSNumber class]] || [value isKindOfClass:[NSData class]]) {
+        return value;
+    }
+
+    NSString *text = [value isKindOfClass:[NSString class]] ? value : [value description];
+    NSNumber *number = YFArrayTableNumberForText(text);
+
+    return number ? number : text;
+}
+
+static id YFArrayTableValue(id row, int column, NSArray<NSString *> *columnNames) {
+    if ([row isKindOfClass:[NSArray class]]) {
+        return (NSUInteger)column < [(NSArray *)row count] ? [(NSArray *)row objectAtIndex:(NSUInteger)column] : nil;
+    }
+    if ([row isKindOfClass:[NSDictionary class]]) {
+        return [(NSDictionary *)row objectForKey:columnNames[(NSUInteger)column]];
+    }
+    return [row valueForKey:columnNames[(NSUInteger)column]];
+}
+
+@interface YFArrayTableCursor : NSObject <YFVirtualTableCursor> {
+@public
+    NSArray                 *_rows;
+    NSArray<NSString *>     *_columnNames;
+    NSIndexSet              *_candidates;       // nil for a full scan
+    NSUInteger              _next;
+    NSUInteger              _current;
+    id                      _row;
+}
+@end
+
+@implementation YFArrayTableCursor
+
+- (BOOL)nextRow:(NSError * _Nullable __autoreleasing *)outErr {
+    NSUInteger idx = _candidates ? [_candidates indexGreaterThanOrEqualToIndex:_next] : _next;
+
+    if (idx == NSNotFound || idx >= [_rows count]) {
+        _row = nil;
+        return NO;
+    }
+
+    _current = idx;
+    _next = idx + 1;
+    _row = [_rows objectAtIndex:idx];
+
+    return YES;
+}
+
+- (void)resultForColumn:(int)column context:(YFFunctionContext *)context {
+    [context resultObject:YFArrayTableValue(_row, column, _columnNames)];
+}
+
+- (int64_t)rowid {
+    return (int64_t)_current;
+}
+
+@end
+
+@interface YFArrayTableProvider () {
+    NSArray<NSString *>                                         *_columnNames;
+    NSArray                                                     *_rows;
+    NSMutableDictionary<NSNumber *, NSDictionary<id, NSIndexSet *> *> *_indexes;
+}
+@end
+
+@implementation YFArrayTableProvider
+
++ (instancetype)providerWithColumnNames:(NSArray<NSString *> *)columnNames rows:(NSArray *)rows {
+    return [[self alloc] initWithColumnNames:columnNames rows:rows];
+}
+
+- (instancetype)initWithColumnNames:(NSArray<NSString *> *)columnNames rows:(NSArray *)rows {
+    self = [super init];
+    if (self) {
+        _columnNames = [columnNames copy];
+        _rows = [rows copy];
+        _indexes = [NSMutableDictionary dictionary];
+    }
+    return self;
+}
+
+- (NSArray<NSString *> *)columnNames {
+    return _columnNames;
+}
+
+- (double)estimatedRowCount {
+    return (double)[_rows count];
+}
+
+- (BOOL)canFilterColumn:(int)column op:(YFVirtualTableOperator)op {
+    return op == YFVirtualTableOperatorEqual;
+}
+
+// the index matches keys exactly, so it can only stand in for a byte-wise comparison
+- (BOOL)canFilterColumn:(int)column op:(YFVirtualTableOperator)op collation:(NSString *)collation {
+    return op == YFVirtualTableOperatorEqual && [collation caseInsensitiveCompare:@"BINARY"] == NSOrderedSame;
+}
+
+// built on first use; a provider may be shared by connections on other threads
+- (NSDictionary<id, NSIndexSet *> *)indexForColumn:(int)column {
+    @synchronized (self) {
+        NSDictionary<id, NSIndexSet *> *index = _indexes[@(column)];
+
+        if (!index) {
+            NSMutableDictionary<id, NSMutableIndexSet *> *building = [NSMutableDictionary dictionary];
+
+            [_rows enumerateObjectsUsingBlock:^(id row, NSUInteger idx, BOOL *stop) {
+                id key = YFArrayTableKey(YFArrayTableValue(row, column, self->_columnNames));
+                if (!key) {
+                    return;
+                }
+                NSMutableIndexSet *indexes = building[key];
+                if (!indexes) {
+                    indexes = [NSMutableIndexSet indexSet];
+                    building[key] = indexes;
+                }
+                [indexes addIndex:idx];
+            }];
+
+            index = building;
+            _indexes[@(column)] = index;
+        }
+
+        return index;
+    }
+}
+
+- (id<YFVirtualTableCursor>)cursorWithConstraints:(NSArray<YFVirtualTableConstraint *> *)constraints error:(NSError * _Nullable __autoreleasing *)outErr {
+    YFArrayTableCursor *cursor = [[YFArrayTableCursor alloc] init];
+    cursor->_rows = _rows;
+    cursor->_columnNames = _columnNames;
+
+    // one lookup narrows the scan enough; SQLite applies the other terms
+    for (YFVirtualTableConstraint *constraint in constraints) {
+        if (constraint.op == YFVirtualTableOperatorEqual) {
+            id key = YFArrayTableKey(constraint.value);
+            NSIndexSet *candidates = key ? [self indexForColumn:constraint.column][key] : nil;
+            cursor->_candidates = candidates ? candidates : [NSIndexSet indexSet];
+            break;
+        }
+    }
+
+    return cursor;
+}
+
+@end
+
+// MARK: - YFFileTableProvider
+
+@interface YFFileTableCursor : NSObject <YFVirtualTableCursor> {
+    FILE                    *_file;
+    YFFileTableFormat       _format;
+    char                    _delimiter;
+    NSArray<NSString *>     *_columnNames;
+
+    char                    *_line;
+    size_t                  _lineCapacity;
+    int64_t                 _lineNumber;
+
+    // the current record, unquoted in place; fields point into it
+    char                    *_record;
+    size_t                  _recordLength;
+    size_t                  _recordCapacity;
+    size_t                  *_fieldOffsets;
+    size_t                  *_fieldLengths;
+    int                     _fieldCount;
+    int                     _fieldCapacity;
+
+    NSDictionary            *_object;
+    int64_t                 _rowid;
+}
+- (instancetype)initWithPath:(NSString *)path format:(YFFileTableFormat)format delimiter:(char)delimiter columnNames:(NSArray<NSString *> *)columnNames error:(NSError * _Nullable __autoreleasing *)outErr;
+- (NSArray<NSString *> *)recordNames;
+@end
+
+@implementation YFFileTableCursor
+
+- (instancetype)initWithPath:(NSString *)path format:(YFFileTableFormat)format delimiter:(char)delimiter columnNames:(NSArray<NSString *> *)columnNames error:(NSError * _Nullable __autoreleasing *)outErr {
+    self = [super init];
+    if (self) {
+        _file = fopen([path fileSystemRepresentation], "r");
+
+        if (!_file) {
+            int code = errno;
+            if (outErr) {
+                NSString *message = [NSString stringWithFormat:@"cannot open %@: %s", path, strerror(code)];
+                *outErr = [NSError errorWithDomain:NSPOSIXErrorDomain code:code userInfo:@{NSLocalizedDescriptionKey: message, NSFilePathErrorKey: path}];
+            }
+            return nil;
+        }
+
+        _format = format;
+        _delimiter = delimiter;
+        _columnNames = columnNames;
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (_file) {
+        fclose(_file);
+    }
+    free(_line);
+    free(_record);
+    free(_fieldOffsets);
+    free(_fieldLengths);
+}
+
+- (NSError *)errorWithMessage:(NSString *)message {
+    NSString *description = [NSString stringWithFormat:@"line %lld: %@", (long long)_lineNumber, message];
+    return [NSError errorWithDomain:@"YFDatabase" code:SQLITE_ERROR userInfo:@{NSLocalizedDescriptionKey: description}];
+}
+
+// Reads lines into _record until the quotes balance, so a quoted CSV field may span lines.
+- (BOOL)readRecord:(NSError * _Nullable __autoreleasing *)outErr {
+    BOOL quoted = NO;
+    _recordLength = 0;
+
+    for (;;) {
+        ssize_t length = getline(&_line, &_lineCapacity, _file);
+
+        if (length < 0) {
+            if (ferror(_file)) {
+                if (outErr) {
+                    *outErr = [self errorWithMessage:[NSString stringWithUTF8String:strerror(errno)]];
+                }
+                return NO;
+            }
+            if (!_recordLength) {
+                return NO;
+            }
+            // an unterminated quote runs to the end of the file
+            break;
+        }
+
+        _lineNumber++;
+
+        if (_recordLength + (size_t)length + 1 > _recordCapacity) {
+            size_t capacity = MAX(_recordCapacity * 2, _recordLength + (size_t)length + 1);
+            char *record = realloc(_record, capacity);
+            if (!record) {
+                if (outErr) {
+                    *outErr = [self errorWithMessage:@"out of memory"];
+                }
+                return NO;
+            }
+            _record = record;
+            _recordCapacity = capacity;
+        }
+
+        memcpy(_record + _recordLength, _line, (size_t)length);
+        _recordLength += (size_t)length;
+
+        if (_format == YFFileTableFormatCSV) {
+            // "" inside a quoted field toggles twice, so counting is enough
+            for (ssize_t i = 0; i < length; i++) {
+                if (_line[i] == '"') {
+                    quoted = !quoted;
+                }
+            }
+        }
+
+        if (!quoted) {
+            break;
+        }
+    }
+
+    while (_recordLength && (_record[_recordLength - 1] == '\n' || _record[_recordLength - 1] == '\r')) {
+        _recordLength--;
+    }
+    _record[_recordLength] = '\0';
+
+    return YES;
+}
+
+- (BOOL)addFieldAtOffset:(size_t)offset length:(size_t)length {
+    if (_fieldCount == _fieldCapacity) {
+        int capacity = _fieldCapacity ? _fieldCapacity * 2 : 16;
+        size_t *offsets = realloc(_fieldOffsets, sizeof(size_t) * (size_t)capacity);
+        if (!offsets) {
+            return NO;
+        }
+        _fieldOffsets = offsets;
+        size_t *lengths = realloc(_fieldLengths, sizeof(size_t) * (size_t)capacity);
+        if (!lengths) {
+            return NO;
+        }
+        _fieldLengths = lengths;
+        _fieldCapacity = capacity;
+    }
+
+    _fieldOffsets[_fieldCount] = offset;
+    _fieldLengths[_fieldCount] = length;
+    _fieldCount++;
+
+    return YES;
+}
+
+- (BOOL)splitRecord {
+    char *p = _record;
+    char *end = _record + _recordLength;
+
+    _fieldCount = 0;
+
+    for (;;) {
+        char *start = p;
+        char *write = p;
+
+        if (p < end && *p == '"') {
+            p++;
+            start = write = p;
+            while (p < end) {
+                if (*p == '"') {
+                    if (p + 1 < end && p[1] == '"') {
+                        *write++ = '"';
+                        p += 2;
+                        continue;
+                    }
+                    p++;
+                    break;
+                }
+                *write++ = *p++;
+            }
+            // anything between the closing quote and the delimiter is dropped
+            while (p < end && *p != _delimiter) {
+                p++;
+            }
+        }
+        else {
+            while (p < end && *p != _delimiter) {
+                p++;
+            }
+            write = p;
+        }
+
+        if (![self addFieldAtOffset:(size_t)(start - _record) length:(size_t)(write - start)]) {
+            return NO;
+        }
+
+        if (p >= end) {
+            return YES;
+        }
+        p++;
+    }
+}
+
+- (BOOL)nextRow:(NSError * _Nullable __autoreleasing *)outErr {
+    for (;;) {
+        if (![self readRecord:outErr]) {
+            return NO;
+        }
+
+        if (!_recordLength) {
+            continue;
+        }
+
+        if (_format == YFFileTableFormatCSV) {
+            if (![self splitRecord]) {
+                if (outErr) {
+                    *outErr = [self errorWithMessage:@"out of memory"];
+                }
+                return NO;
+            }
+        }
+        else {
+            NSData *data = [NSData dataWithBytesNoCopy:_record length:_recordLength freeWhenDone:NO];
+            id object = [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+
+            if (![object isKindOfClass:[NSDictionary class]]) {
+                if (outErr) {
+                    *outErr = [self errorWithMessage:@"not a JSON object"];
+                }
+                return NO;
+            }
+            _object = object;
+        }
+
+        _rowid++;
+        return YES;
+    }
+}
+
+- (void)resultForColumn:(int)column context:(YFFunctionContext *)context {
+
+    if (_format == YFFileTableFormatCSV) {
+        if (column >= _fieldCount) {
+            [context resultNull];
+            return;
+        }
+        [context resultUTF8String:_record + _fieldOffsets[column] length:_fieldLengths[column]];
+        return;
+    }
+
+    id value = [_object objectForKey:_columnNames[(NSUInteger)column]];
+
+    if ([value isKindOfClass:[NSArray class]] || [value isKindOfClass:[NSDictionary class]]) {
+        NSData *json = [NSJSONSerialization dataWithJSONObject:value options:0 error:nil];
+        [context resultUTF8String:[json bytes] length:[json length]];
+        return;
+    }
+
+    [context resultObject:value];
+}
+
+- (int64_t)rowid {
+    return _rowid;
+}
+
+- (NSArray<NSString *> *)recordNames {
+    if (_format == YFFileTableFormatNDJSON) {
+        return [[_object allKeys] sortedArrayUsingSelector:@selector(compare:)];
+    }
+
+    NSMutableArray<NSString *> *names = [NSMutableArray arrayWithCapacity:(NSUInteger)_fieldCount];
+    for (int i = 0; i < _fieldCount; i++) {
+        NSString *name = [[NSString alloc] initWithBytes:_record + _fieldOffsets[i] length:_fieldLengths[i] encoding:NSUTF8StringEncoding];
+        [names addObject:name ? name : [NSString stringWithFormat:@"c%d", i]];
+    }
+    return names;
+}
+
+@end
+
+@interface YFFileTableProvider () {
+    NSArray<NSString *>     *_columnNames;
+    BOOL                    _hasHeaderRow;
+    double                  _estimatedRowCount;
+}
+@end
+
+@implementation YFFileTableProvider
+
++ (instancetype)providerWithPath:(NSString *)path format:(YFFileTableFormat)format columnNames:(NSArray<NSString *> *)columnNames {
+    return [[self alloc] initWithPath:path format:format columnNames:columnNames];
+}
+
+- (instancetype)initWithPath:(NSString *)path format:(YFFileTableFormat)format columnNames:(NSArray<NSString *> *)columnNames {
+    self = [super init];
+    if (self) {
+        _path = [path copy];
+        _format = format;
+        _delimiter = ',';
+        _columnNames = [columnNames copy];
+
+        if (!_columnNames) {
+            _columnNames = [self firstRecordNames];
+            if (!_columnNames) {
+                return nil;
+            }
+            _hasHeaderRow = (format == YFFileTableFormatCSV);
+        }
+
+        // a guess at the line length is all the planner needs
+        unsigned long long size = [[[NSFileManager defaultManager] attributesOfItemAtPath:_path error:nil] fileSize];
+        _estimatedRowCount = MAX((double)size / 64, 1);
+    }
+    return self;
+}
+
+- (NSArray<NSString *> *)firstRecordNames {
+    YFFileTableCursor *cursor = [[YFFileTableCursor alloc] initWithPath:_path format:_format delimiter:_delimiter columnNames:@[] error:nil];
+    return [cursor nextRow:nil] ? [cursor recordNames] : nil;
+}
+
+- (void)setDelimiter:(char)delimiter {
+    _delimiter = delimiter;
+
+    // the header was split on the old delimiter
+    if (_hasHeaderRow) {
+        NSArray<NSString *> *columnNames = [self firstRecordNames];
+        if (columnNames) {
+            _columnNames = columnNames;
+        }
+    }
+}
+
+- (NSArray<NSString *> *)columnNames {
+    return _columnNames;
+}
+
+- (double)estimatedRowCount {
+    return _estimatedRowCount;
+}
+
+- (id<YFVirtualTableCursor>)cursorWithConstraints:(NSArray<YFVirtualTableConstraint *> *)constraints error:(NSError * _Nullable __autoreleasing *)outErr {
+    YFFileTableCursor *cursor = [[YFFileTableCursor alloc] initWithPath:_path format:_format delimiter:_delimiter columnNames:_columnNames error:outErr];
+
+    if (cursor && _hasHeaderRow) {
+        [cursor nextRow:nil];
+    }
+
+    return cursor;
+}
+
+@end
+
+// MARK: - YFDatabase (YFVirtualTables)
+
+@implementation YFDatabase (YFVirtualTables)
+
+- (BOOL)makeVirtualTableNamed:(NSString *)name provider:(id<YFVirtualTableProvider>)provider error:(NSError * _Nullable __autoreleasing *)outErr {
+#if SQLITE_VERSION_NUMBER >= 3009000
+    if (![self sqliteHandle]) {
+        if (outErr) {
+            NSDictionary* errorMessage = [NSDictionary dictionaryWithObject:@"database is not open" forKey:NSLocalizedDescriptionKey];
+            *outErr = [NSError errorWithDomain:@"YFDatabase" code:SQLITE_MISUSE userInfo:errorMessage];
+        }
+        return NO;
+    }
+
+    // released by YFVirtualTableProviderRelease: when the table is removed, the connection closes, or registration fails
+    void *pAux = (__bridge_retained void *)provider;
+
+    int rc = sqlite3_create_module_v2([self sqliteHandle], [name UTF8String], &YFVirtualTableModule, pAux, &YFVirtualTableProviderRelease);
+
+    if (rc != SQLITE_OK) {
+        if ([self logsErrors]) {
+            NSLog(@"Error registering virtual table %@ (%d: %@)", name, rc, [self lastErrorMessage]);
+        }
+        if (outErr) {
+            *outErr = [self lastError];
+        }
+        return NO;
+    }
+
+    return YES;
+#else
+    if (outErr) {
+        NSDictionary* errorMessage = [NSDictionary dictionaryWithObject:@"virtual tables require SQLite 3.9" forKey:NSLocalizedDescriptionKey];
+        *outErr = [NSError errorWithDomain:@"YFDatabase" code:SQLITE_ERROR userInfo:errorMessage];
+    }
+    return NO;
+#endif
+}
+
+- (BOOL)removeVirtualTableNamed:(NSString *)name {
+#if SQLITE_VERSION_NUMBER >= 3030000
+    if (![self sqliteHandle]) {
+        return NO;
+    }
+
+    [self clearCachedStatements];
+
+    // a NULL module removes the name, releasing the provider
+    return sqlite3_create_module_v2([self sqliteHandle], [name UTF8String], 0x00, 0x00, 0x00) == SQLITE_OK;
+#else
+    return NO;
+#endif
+}
+
+@end